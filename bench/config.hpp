@@ -0,0 +1,9 @@
+// this file was generated by better-cmake
+// allegrex-bench v0.1.0
+
+#define allegrex_bench_NAME "allegrex-bench"
+#define allegrex_bench_AUTHOR "DaemonTsun"
+#define allegrex_bench_VERSION "0.1.0"
+#define allegrex_bench_VERSION_MAJOR 0
+#define allegrex_bench_VERSION_MINOR 1
+#define allegrex_bench_VERSION_PATCH 0
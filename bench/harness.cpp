@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "shl/file_stream.hpp"
+#include "shl/platform.hpp"
+#include "shl/print.hpp"
+#include "shl/sort.hpp"
+#include "shl/defer.hpp"
+
+#include "bench/harness.hpp"
+
+void init(bench_harness *h, u32 warmup, u32 repetitions)
+{
+    h->warmup = warmup;
+    h->repetitions = repetitions;
+    h->measure_peak_rss = false;
+    h->rss_before_case = 0;
+    ::init(&h->samples);
+    ::init(&h->results);
+}
+
+void free(bench_harness *h)
+{
+    ::free(&h->samples);
+    ::free(&h->results);
+}
+
+double seconds_since(bench_clock::time_point start)
+{
+    return std::chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+void begin_case(bench_harness *h)
+{
+    ::resize(&h->samples, 0);
+
+    if (h->measure_peak_rss)
+    {
+        reset_peak_rss();
+        h->rss_before_case = get_process_status_kib("VmRSS");
+    }
+}
+
+// linear interpolation between the closest ranks, sorted must not be empty
+static double _percentile(const double *sorted, u64 count, double p)
+{
+    double rank = p * (double)(count - 1);
+    u64 lower = (u64)rank;
+
+    if (lower + 1 >= count)
+        return sorted[count - 1];
+
+    return sorted[lower] + (sorted[lower + 1] - sorted[lower]) * (rank - (double)lower);
+}
+
+bench_result *end_case(bench_harness *h, const char *name, u64 operations, u64 bytes, u32 checksum)
+{
+    bench_result *ret = ::add_at_end(&h->results);
+    fill_memory(ret, 0, sizeof(bench_result));
+
+    snprintf(ret->name, sizeof(ret->name), "%s", name);
+    ret->operations = operations;
+    ret->bytes = bytes;
+    ret->repetitions = (u32)h->samples.size;
+    ret->checksum = checksum;
+
+    if (h->measure_peak_rss)
+    {
+        u64 peak = get_process_status_kib("VmHWM");
+        ret->peak_rss_kib = peak > h->rss_before_case ? peak - h->rss_before_case : 0;
+    }
+
+    if (h->samples.size > 0)
+    {
+        compare_function_p<double> compare_seconds =
+            [](const double *l, const double *r)
+            {
+                return compare_ascending(*l, *r);
+            };
+
+        ::sort(h->samples.data, h->samples.size, compare_seconds);
+
+        double sum = 0;
+
+        for_array(s, &h->samples)
+            sum += *s;
+
+        ret->min = h->samples[0];
+        ret->median = _percentile(h->samples.data, h->samples.size, 0.5);
+        ret->p90 = _percentile(h->samples.data, h->samples.size, 0.9);
+        ret->p99 = _percentile(h->samples.data, h->samples.size, 0.99);
+        ret->max = h->samples[h->samples.size - 1];
+        ret->mean = sum / (double)h->samples.size;
+    }
+
+    print_result(ret);
+
+    return ret;
+}
+
+bench_result *add_single_result(bench_harness *h, const char *name, u64 operations, u64 bytes, double seconds, u32 checksum)
+{
+    begin_case(h);
+    ::add_at_end(&h->samples, seconds);
+
+    return end_case(h, name, operations, bytes, checksum);
+}
+
+static double _per_second(u64 count, double seconds)
+{
+    return seconds > 0 ? (double)count / seconds : 0;
+}
+
+void print_result(const bench_result *result)
+{
+    // unit of the median, so short and long cases are both readable
+    const char *unit = "s";
+    double scale = 1;
+
+    if (result->median < 0.001)
+    {
+        unit = "us";
+        scale = 1e6;
+    }
+    else if (result->median < 1)
+    {
+        unit = "ms";
+        scale = 1e3;
+    }
+
+    tprint("%-34s median %8.3f %-2s p90 %8.3f p99 %8.3f",
+           result->name, result->median * scale, unit, result->p90 * scale, result->p99 * scale);
+
+    double ops_per_second = _per_second(result->operations, result->median);
+
+    if (ops_per_second >= 1e6)
+        tprint(", %9.2f M ops/s", ops_per_second / 1e6);
+    else if (result->operations > 0)
+        tprint(", %11.1f ops/s", ops_per_second);
+
+    if (result->bytes > 0)
+        tprint(", %8.1f MB/s", _per_second(result->bytes, result->median) / 1e6);
+
+    if (result->peak_rss_kib > 0)
+        tprint(", peak RSS +%u KiB", (u32)result->peak_rss_kib);
+
+    tprint(" (%08x)\n", result->checksum);
+}
+
+#define RESULT_COLUMNS "name,operations,bytes,repetitions,min_s,median_s,p90_s,p99_s,max_s,mean_s,ops_per_s,bytes_per_s,peak_rss_kib,checksum"
+
+bool write_results_csv(const bench_harness *h, const char *path, error *err)
+{
+    file_stream out{};
+
+    if (!init(&out, path, open_mode::WriteTrunc, err))
+        return false;
+
+    defer { free(&out); };
+
+    tprint(out.handle, RESULT_COLUMNS "\n");
+
+    // names don't contain commas or quotes
+    for_array(r, &h->results)
+        tprint(out.handle, "%s,%llu,%llu,%u,%.9f,%.9f,%.9f,%.9f,%.9f,%.9f,%.3f,%.3f,%llu,%08x\n",
+               r->name, (unsigned long long)r->operations, (unsigned long long)r->bytes, r->repetitions,
+               r->min, r->median, r->p90, r->p99, r->max, r->mean,
+               _per_second(r->operations, r->median), _per_second(r->bytes, r->median),
+               (unsigned long long)r->peak_rss_kib, r->checksum);
+
+    return true;
+}
+
+bool write_results_json(const bench_harness *h, const char *path, error *err)
+{
+    file_stream out{};
+
+    if (!init(&out, path, open_mode::WriteTrunc, err))
+        return false;
+
+    defer { free(&out); };
+
+    tprint(out.handle, "{\n  \"warmup\": %u,\n  \"repetitions\": %u,\n  \"results\": [", h->warmup, h->repetitions);
+
+    for_array(i, r, &h->results)
+    {
+        tprint(out.handle, "%s\n    {\"name\": \"%s\", \"operations\": %llu, \"bytes\": %llu, \"repetitions\": %u, "
+                           "\"min_s\": %.9f, \"median_s\": %.9f, \"p90_s\": %.9f, \"p99_s\": %.9f, \"max_s\": %.9f, \"mean_s\": %.9f, "
+                           "\"ops_per_s\": %.3f, \"bytes_per_s\": %.3f, \"peak_rss_kib\": %llu, \"checksum\": \"%08x\"}",
+               i > 0 ? "," : "",
+               r->name, (unsigned long long)r->operations, (unsigned long long)r->bytes, r->repetitions,
+               r->min, r->median, r->p90, r->p99, r->max, r->mean,
+               _per_second(r->operations, r->median), _per_second(r->bytes, r->median),
+               (unsigned long long)r->peak_rss_kib, r->checksum);
+    }
+
+    tprint(out.handle, "\n  ]\n}\n");
+
+    return true;
+}
+
+#if Linux
+#include <malloc.h>
+
+/* resets the peak resident set size (VmHWM) of the process. freed memory is
+   returned to the system first, otherwise allocations that reuse it would not
+   show up in the peak. */
+void reset_peak_rss()
+{
+    malloc_trim(0);
+
+    FILE *f = fopen("/proc/self/clear_refs", "w");
+
+    if (f == nullptr)
+        return;
+
+    fputs("5", f);
+    fclose(f);
+}
+
+// field of /proc/self/status in KiB, e.g. VmRSS or VmHWM
+u64 get_process_status_kib(const char *field)
+{
+    FILE *f = fopen("/proc/self/status", "r");
+
+    if (f == nullptr)
+        return 0;
+
+    char line[256];
+    u64 ret = 0;
+    u64 field_length = strlen(field);
+
+    while (fgets(line, sizeof(line), f) != nullptr)
+    {
+        if (strncmp(line, field, field_length) == 0 && line[field_length] == ':')
+        {
+            ret = strtoull(line + field_length + 1, nullptr, 10);
+            break;
+        }
+    }
+
+    fclose(f);
+
+    return ret;
+}
+#else
+void reset_peak_rss() {}
+u64 get_process_status_kib(const char *) { return 0; }
+#endif
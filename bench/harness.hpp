@@ -0,0 +1,131 @@
+
+#pragma once
+
+#include <chrono>
+
+#include "shl/array.hpp"
+#include "shl/number_types.hpp"
+#include "shl/error.hpp"
+
+/*
+BENCH HARNESS
+
+Runs a benchmark case a few times to warm up, then times every repetition
+separately. The result of a case has the median and percentiles of the
+repetition times and the throughput at the median, in operations (e.g.
+opcodes or modules) and bytes per second.
+Results are printed when a case finishes and kept in the harness, so they
+can be written as CSV or JSON for comparing runs.
+
+The function of a case returns a checksum of what it computed, so the work
+cannot be optimized away and different runs can be checked for the same
+output, or -1 on error, which stops the case.
+
+Usage:
+
+    bench_harness h;
+    init(&h, warmup, repetitions);
+
+    bench_run(&h, "parse_instructions", opcodes.size, opcodes.size * sizeof(u32), [&]() -> s64
+    {
+        parse_instructions(...);
+        return instructions.size;
+    });
+
+    write_results_csv(&h, "results.csv", &err);
+    free(&h);
+*/
+
+#define BENCH_NAME_SIZE 48
+
+typedef std::chrono::steady_clock bench_clock;
+
+struct bench_result
+{
+    char name[BENCH_NAME_SIZE];
+    u64 operations; // per repetition, 0 if there is nothing to count
+    u64 bytes;      // per repetition, 0 if there is nothing to count
+    u32 repetitions;
+
+    // seconds per repetition
+    double min;
+    double median;
+    double p90;
+    double p99;
+    double max;
+    double mean;
+
+    u64 peak_rss_kib; // above the RSS before the case, 0 if not measured
+    u32 checksum;
+};
+
+struct bench_harness
+{
+    u32 warmup;
+    u32 repetitions;
+
+    // resets the peak RSS before each case and adds the peak to its result
+    bool measure_peak_rss;
+    u64 rss_before_case; // KiB
+
+    array<double> samples; // of the current case
+    array<bench_result> results;
+};
+
+void init(bench_harness *h, u32 warmup, u32 repetitions);
+void free(bench_harness *h);
+
+double seconds_since(bench_clock::time_point start);
+
+// used by bench_run
+void begin_case(bench_harness *h);
+bench_result *end_case(bench_harness *h, const char *name, u64 operations, u64 bytes, u32 checksum);
+
+/* runs setup, which is not timed, and run warmup + repetitions times.
+returns the result, which is valid until the next case, or nullptr if run
+returned -1. */
+template<typename Setup, typename Run>
+bench_result *bench_run(bench_harness *h, const char *name, u64 operations, u64 bytes, Setup &&setup, Run &&run)
+{
+    begin_case(h);
+
+    u32 checksum = 0;
+
+    for (u32 i = 0; i < h->warmup + h->repetitions; ++i)
+    {
+        setup();
+
+        auto start = bench_clock::now();
+        s64 ret = run();
+        double seconds = seconds_since(start);
+
+        if (ret < 0)
+            return nullptr;
+
+        if (i < h->warmup)
+            continue;
+
+        checksum = checksum * 31 + (u32)ret;
+        ::add_at_end(&h->samples, seconds);
+    }
+
+    return end_case(h, name, operations, bytes, checksum);
+}
+
+template<typename Run>
+bench_result *bench_run(bench_harness *h, const char *name, u64 operations, u64 bytes, Run &&run)
+{
+    return bench_run(h, name, operations, bytes, [](){}, run);
+}
+
+// for cases that are not run repeatedly, e.g. building an index once
+bench_result *add_single_result(bench_harness *h, const char *name, u64 operations, u64 bytes, double seconds, u32 checksum);
+
+void print_result(const bench_result *result);
+
+bool write_results_csv(const bench_harness *h, const char *path, error *err = nullptr);
+bool write_results_json(const bench_harness *h, const char *path, error *err = nullptr);
+
+// peak resident set size, only on Linux. 0 elsewhere.
+void reset_peak_rss();
+u64 get_process_status_kib(const char *field);
@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "shl/memory.hpp"
+#include "shl/print.hpp"
+#include "shl/defer.hpp"
+#include "bench/harness.hpp"
+
+extern "C"
+{
+#include "libkirk/kirk_engine.h"
+#include "libkirk/AES.h"
+#include "libkirk/SHA1.h"
+}
+
+#include "bench/kirk_bench.hpp"
+
+#define KIRK_BENCH_DATA_SIZE (16 * 1024 * 1024)
+#define KIRK_BENCH_SEED 0x2545f491
+#define SHA1_BENCH_MESSAGE_COUNT 4096
+#define SHA1_BENCH_MESSAGE_SIZE 0x150 // about the size of the hashed part of a PRX header
+
+static void _fill_pseudorandom(u8 *out, u32 size)
+{
+    u32 x = KIRK_BENCH_SEED;
+
+    for (u32 i = 0; i < size; ++i)
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        out[i] = (u8)x;
+    }
+}
+
+void bench_kirk_cmd1(bench_harness *h)
+{
+    const u32 header_size = sizeof(KIRK_CMD1_HEADER);
+    const u32 buffer_size = header_size + KIRK_BENCH_DATA_SIZE;
+
+    u8 *plain = alloc<u8>(buffer_size);
+    u8 *encrypted = alloc<u8>(buffer_size);
+    u8 *decrypted = alloc<u8>(KIRK_BENCH_DATA_SIZE);
+
+    defer { dealloc(plain, buffer_size); };
+    defer { dealloc(encrypted, buffer_size); };
+    defer { dealloc(decrypted, KIRK_BENCH_DATA_SIZE); };
+
+    _fill_pseudorandom(plain, buffer_size);
+
+    KIRK_CMD1_HEADER *header = (KIRK_CMD1_HEADER*)plain;
+    header->mode = KIRK_MODE_CMD1;
+    header->ecdsa_hash = 0;
+    header->data_size = KIRK_BENCH_DATA_SIZE;
+    header->data_offset = 0;
+
+    kirk_init();
+
+    if (kirk_CMD0(encrypted, plain, buffer_size, 0) != KIRK_OPERATION_SUCCESS)
+    {
+        tprint("kirk CMD1            could not encrypt test data\n");
+        return;
+    }
+
+    for (int aesni = 0; aesni <= AES_aesni_supported(); ++aesni)
+    {
+        AES_set_aesni_enabled(aesni);
+
+        bench_result *res = bench_run(h, aesni ? "kirk CMD1 (AES-NI)" : "kirk CMD1 (tables)", 1, KIRK_BENCH_DATA_SIZE, [&]()
+        {
+            if (kirk_CMD1(decrypted, encrypted, buffer_size) != KIRK_OPERATION_SUCCESS)
+                return (s64)-1;
+
+            return (s64)decrypted[0];
+        });
+
+        if (res == nullptr || memcmp(decrypted, plain + header_size, KIRK_BENCH_DATA_SIZE) != 0)
+            tprint("%-34s WRONG OUTPUT\n", aesni ? "kirk CMD1 (AES-NI)" : "kirk CMD1 (tables)");
+    }
+
+    AES_set_aesni_enabled(1);
+}
+
+void bench_kirk_sha1(bench_harness *h)
+{
+    const u32 messages_size = SHA1_BENCH_MESSAGE_COUNT * SHA1_BENCH_MESSAGE_SIZE;
+
+    u8 *data = alloc<u8>(KIRK_BENCH_DATA_SIZE);
+    u8 *digests = alloc<u8>(SHA1_BENCH_MESSAGE_COUNT * 20);
+    u8 **inputs = alloc<u8*>(SHA1_BENCH_MESSAGE_COUNT);
+    int *sizes = alloc<int>(SHA1_BENCH_MESSAGE_COUNT);
+
+    defer { dealloc(data, KIRK_BENCH_DATA_SIZE); };
+    defer { dealloc(digests, SHA1_BENCH_MESSAGE_COUNT * 20); };
+    defer { dealloc(inputs, SHA1_BENCH_MESSAGE_COUNT); };
+    defer { dealloc(sizes, SHA1_BENCH_MESSAGE_COUNT); };
+
+    _fill_pseudorandom(data, KIRK_BENCH_DATA_SIZE);
+
+    for (u32 i = 0; i < SHA1_BENCH_MESSAGE_COUNT; ++i)
+    {
+        inputs[i] = data + i * SHA1_BENCH_MESSAGE_SIZE;
+        sizes[i] = SHA1_BENCH_MESSAGE_SIZE;
+    }
+
+    struct
+    {
+        const char *name;
+        int acceleration;
+        int supported;
+    } backends[] = {
+        { "C",      SHA_ACCELERATION_NONE,  1 },
+        { "SHA-NI", SHA_ACCELERATION_SHANI, SHA_shani_supported() },
+        { "AVX2",   SHA_ACCELERATION_AVX2,  SHA_avx2_supported() }
+    };
+
+    for (const auto &backend : backends)
+    {
+        if (!backend.supported)
+            continue;
+
+        SHA_set_acceleration(backend.acceleration);
+        char name[BENCH_NAME_SIZE];
+
+        // one large buffer, AVX2 only helps with many messages
+        if (backend.acceleration != SHA_ACCELERATION_AVX2)
+        {
+            snprintf(name, sizeof(name), "sha1 large (%s)", backend.name);
+
+            bench_run(h, name, 1, KIRK_BENCH_DATA_SIZE, [&]()
+            {
+                u8 digest[20];
+
+                SHA_CTX ctx;
+                SHAInit(&ctx);
+                SHAUpdate(&ctx, data, KIRK_BENCH_DATA_SIZE);
+                SHAFinal(digest, &ctx);
+
+                return (s64)(digest[0] | digest[1] << 8 | digest[2] << 16 | (u32)digest[3] << 24);
+            });
+        }
+
+        // many headers
+        snprintf(name, sizeof(name), "sha1 many (%s)", backend.name);
+
+        bench_run(h, name, SHA1_BENCH_MESSAGE_COUNT, messages_size, [&]()
+        {
+            SHAMulti(inputs, sizes, SHA1_BENCH_MESSAGE_COUNT, digests);
+
+            const u8 *last = digests + 20 * (SHA1_BENCH_MESSAGE_COUNT - 1);
+            return (s64)(last[0] | last[1] << 8 | last[2] << 16 | (u32)last[3] << 24);
+        });
+    }
+
+    SHA_set_acceleration(SHA_ACCELERATION_ALL);
+}
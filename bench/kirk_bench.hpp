@@ -0,0 +1,14 @@
+
+#pragma once
+
+#include "shl/number_types.hpp"
+
+struct bench_harness;
+
+// separate from main.cpp since the libkirk headers define macros (e.g. array_size) that clash with shl
+
+// KIRK CMD1 decryption (CMAC check + AES-128-CBC) of a large buffer, with the AES lookup tables and AES-NI
+void bench_kirk_cmd1(bench_harness *h);
+
+// SHA-1 of one large buffer and of many PRX header sized messages, with the C code, SHA-NI and AVX2
+void bench_kirk_sha1(bench_harness *h);
@@ -0,0 +1,1677 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+#include "shl/memory.hpp"
+#include "shl/streams.hpp"
+#include "shl/number_types.hpp"
+#include "shl/string.hpp"
+#include "shl/print.hpp"
+#include "shl/error.hpp"
+#include "shl/defer.hpp"
+#include "shl/platform.hpp"
+
+#include "allegrex/psp_elf.hpp"
+#include "allegrex/parse_instructions.hpp"
+#include "allegrex/compact_instructions.hpp"
+#include "allegrex/disassemble.hpp"
+#include "allegrex/lazy_disassembly.hpp"
+
+#include "allegrex/elf.hpp"
+#include "allegrex/prx_decrypt.hpp"
+#include "allegrex/inflate.hpp"
+#include "psp-elfdump/dump_format.hpp"
+#include "psp-elfdump/asm_formatter.hpp"
+#include "psp-elfgen/gzip_writer.hpp"
+#include "tests/prx_fixture.hpp"
+
+#include "bench/config.hpp"
+#include "bench/harness.hpp"
+#include "bench/kirk_bench.hpp"
+
+#define DEFAULT_REPETITIONS 10
+#define DEFAULT_WARMUP 1
+#define RANDOM_SEED 0x2545f491
+#define LAZY_QUERY_COUNT 1000
+#define CATEGORY_BENCH_OPCODE_COUNT (64 * 1024)
+#define SYNTHETIC_SECTION_OPCODE_COUNT (1024 * 1024)
+#define BRANCH_BENCH_INSTRUCTION_COUNT (4 * 1024 * 1024)
+#define BRANCH_BENCH_SET_JUMP_COUNT (64 * 1024) // inserting into a set is quadratic, only use a few
+#define LABEL_BENCH_EXPORT_MODULE_COUNT 8
+#define LABEL_BENCH_EXPORTS_PER_MODULE 512
+#define LABEL_BENCH_IMPORT_COUNT 1024
+#define SECTION_BENCH_SECTION_COUNT 600 // e.g. MHFU has ~600 sections
+#define SECTION_BENCH_SYMBOLS_PER_SECTION 8
+#define PRX_BENCH_MODULE_COUNT 96
+#define PRX_BENCH_MIN_MODULE_SIZE (4 * 1024)
+#define PRX_LOAD_BENCH_ELF_SIZE (16 * 1024 * 1024)
+#define PRX_LOAD_BENCH_FILE "allegrex-bench-encrypted.prx"
+#define PRX_COMPRESSED_BENCH_FILE "allegrex-bench-compressed.prx"
+#define ASM_BENCH_FILE "allegrex-bench-asm.s"
+#define ASM_BENCH_BYTES_PER_INSTRUCTION 256 // more than any line and its labels
+
+struct arguments
+{
+    u32 repetitions;  // -n
+    u32 warmup;       // -w
+    u32 random_count; // --random
+    const_string csv_file;  // --csv
+    const_string json_file; // --json
+    const_string input_file;
+};
+
+const arguments default_arguments{
+    .repetitions = DEFAULT_REPETITIONS,
+    .warmup = DEFAULT_WARMUP,
+    .random_count = 0,
+    .csv_file = ""_cs,
+    .json_file = ""_cs,
+    .input_file = ""_cs
+};
+
+static void _print_usage()
+{
+    puts("Usage: " allegrex_bench_NAME " [-h] [-n REPETITIONS] [-w WARMUP] [--random COUNT] [--csv FILE] [--json FILE] [ELFFILE]\n"
+         "\n"
+         allegrex_bench_NAME " v" allegrex_bench_VERSION ": liballegrex benchmarks\n"
+         "by " allegrex_bench_AUTHOR "\n"
+         "\n"
+         "Optional arguments:\n"
+         "  -h, --help                  show this help and exit\n"
+         "  -n REPETITIONS              number of times each benchmark is timed (default: 10)\n"
+         "  -w WARMUP                   number of untimed runs before that (default: 1)\n"
+         "  --random COUNT              benchmark COUNT pseudorandom opcodes instead of\n"
+         "                              the instructions of ELFFILE\n"
+         "  --csv FILE                  also write the results to FILE as CSV\n"
+         "  --json FILE                 also write the results to FILE as JSON\n"
+         "\n"
+         "Arguments:\n"
+         "  ELFFILE      (encrypted) PSP ELF, e.g. EBOOT.BIN, whose sections to decode\n"
+         );
+}
+
+static bool _load_elf_opcodes(const_string path, array<u32> *out, error *err)
+{
+    elf_psp_module mod;
+    init(&mod);
+    defer { free(&mod); };
+
+    if (!parse_psp_module_from_elf(path.c_str, &mod, err))
+        return false;
+
+    for_array(sec, &mod.sections)
+    {
+        const u32 *words = (const u32*)sec->content;
+        u64 count = sec->content_size / sizeof(u32);
+
+        ::reserve(out, out->size + count);
+
+        for (u64 i = 0; i < count; ++i)
+            ::add_at_end(out, words[i]);
+    }
+
+    return true;
+}
+
+static void _random_opcodes(u32 count, array<u32> *out)
+{
+    u32 x = RANDOM_SEED;
+    ::reserve(out, out->size + count);
+
+    for (u32 i = 0; i < count; ++i)
+    {
+        // xorshift32
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        ::add_at_end(out, x);
+    }
+}
+
+// every instruction is either a beq with a random offset or a jal with a random target
+static void _branch_heavy_opcodes(u32 count, array<u32> *out)
+{
+    u32 x = RANDOM_SEED;
+    ::reserve(out, out->size + count);
+
+    for (u32 i = 0; i < count; ++i)
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+
+        if (x & 1)
+            ::add_at_end(out, 0x10000000u | (x & 0x03ffffffu)); // beq rs, rt, offset
+        else
+            ::add_at_end(out, 0x0c000000u | (x >> 6)); // jal target
+    }
+}
+
+#define PRIMARY(X) (1ull << (X))
+#define PRIMARY_RANGE(FIRST, LAST) (((2ull << (LAST)) - 1) & ~(PRIMARY(FIRST) - 1))
+
+// groups of primary opcodes (the upper 6 bits), roughly the categories of the decoder
+static const struct
+{
+    const char *name;
+    u64 primaries; // bit n is set if primary opcode n is part of the group
+} _opcode_categories[] = {
+    { "special",         PRIMARY(0x00) },
+    { "regimm",          PRIMARY(0x01) },
+    { "jump/branch",     PRIMARY_RANGE(0x02, 0x07) | PRIMARY_RANGE(0x14, 0x17) },
+    { "immediate",       PRIMARY_RANGE(0x08, 0x0f) },
+    { "cop0",            PRIMARY(0x10) },
+    { "cop1",            PRIMARY(0x11) | PRIMARY(0x31) | PRIMARY(0x39) },
+    { "cop2",            PRIMARY(0x12) },
+    { "special2/3",      PRIMARY(0x1c) | PRIMARY(0x1f) },
+    { "load/store",      PRIMARY_RANGE(0x20, 0x2f) | PRIMARY(0x30) | PRIMARY(0x38) },
+    { "vfpu",            PRIMARY(0x18) | PRIMARY(0x19) | PRIMARY(0x1b) | PRIMARY(0x34) | PRIMARY(0x37) | PRIMARY(0x3c) | PRIMARY(0x3f) },
+    { "vfpu load/store", PRIMARY(0x32) | PRIMARY(0x35) | PRIMARY(0x36) | PRIMARY(0x3a) | PRIMARY(0x3d) | PRIMARY(0x3e) }
+};
+
+// pseudorandom opcodes whose primary opcode is one of primaries
+static void _category_opcodes(u64 primaries, u32 count, array<u32> *out)
+{
+    u32 opcodes[64];
+    u32 opcode_count = 0;
+
+    for (u32 p = 0; p < 64; ++p)
+        if (primaries & PRIMARY(p))
+            opcodes[opcode_count++] = p << 26;
+
+    u32 x = RANDOM_SEED;
+    ::reserve(out, out->size + count);
+
+    for (u32 i = 0; i < count; ++i)
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        ::add_at_end(out, opcodes[(x >> 26) % opcode_count] | (x & 0x03ffffffu));
+    }
+}
+
+static void _default_parse_config(parse_instructions_config *conf)
+{
+    conf->vaddr = 0;
+    conf->log = nullptr;
+    conf->verbose = false;
+    conf->emit_pseudo = true;
+}
+
+static s64 _parse_each_instruction(const array<u32> *opcodes, const parse_instructions_config *conf)
+{
+    instruction inst;
+    u32 checksum = 0;
+
+    for (u64 i = 0; i < opcodes->size; ++i)
+    {
+        inst = {};
+        inst.opcode = opcodes->data[i];
+        inst.address = (u32)(i * sizeof(u32));
+
+        parse_instruction(inst.opcode, &inst, nullptr, conf);
+        checksum = checksum * 31 + (u32)inst.mnemonic;
+    }
+
+    return checksum;
+}
+
+static void _bench_parse_instruction(bench_harness *h, const array<u32> *opcodes)
+{
+    parse_instructions_config conf{};
+    _default_parse_config(&conf);
+
+    bench_run(h, "parse_instruction", opcodes->size, opcodes->size * sizeof(u32), [&]()
+    {
+        return _parse_each_instruction(opcodes, &conf);
+    });
+}
+
+// the same number of opcodes of every category, to see which are slow to decode
+static void _bench_parse_instruction_categories(bench_harness *h)
+{
+    parse_instructions_config conf{};
+    _default_parse_config(&conf);
+
+    array<u32> opcodes;
+    ::init(&opcodes);
+    defer { ::free(&opcodes); };
+
+    char name[BENCH_NAME_SIZE];
+
+    for (const auto &cat : _opcode_categories)
+    {
+        ::resize(&opcodes, 0);
+        _category_opcodes(cat.primaries, CATEGORY_BENCH_OPCODE_COUNT, &opcodes);
+
+        snprintf(name, sizeof(name), "parse_instruction %s", cat.name);
+
+        bench_run(h, name, opcodes.size, opcodes.size * sizeof(u32), [&]()
+        {
+            return _parse_each_instruction(&opcodes, &conf);
+        });
+    }
+}
+
+// returns the median time of one repetition
+static double _bench_parse_instructions(bench_harness *h, const char *name, const array<u32> *opcodes)
+{
+    parse_instructions_config conf{};
+    _default_parse_config(&conf);
+
+    array<instruction> instructions;
+    array<jump_destination> jumps;
+    ::init(&instructions);
+    ::init(&jumps);
+    defer { ::free(&instructions); ::free(&jumps); };
+
+    auto setup = [&]()
+    {
+        ::resize(&instructions, 0);
+        ::resize(&jumps, 0);
+    };
+
+    bench_result *res = bench_run(h, name, opcodes->size, opcodes->size * sizeof(u32), setup, [&]()
+    {
+        parse_instructions((const char*)opcodes->data, opcodes->size * sizeof(u32), &instructions, &jumps, &conf);
+        sort_jumps(&jumps);
+
+        return (s64)(instructions.size + jumps.size);
+    });
+
+    return res != nullptr ? res->median : 0;
+}
+
+/* the same section as _bench_parse_instructions, parse_seconds is its median time.
+   suffix is appended to the names of the cases. */
+static void _bench_scan_mnemonics(bench_harness *h, const char *suffix, const array<u32> *opcodes, double parse_seconds)
+{
+    parse_instructions_config conf{};
+    _default_parse_config(&conf);
+
+    array<allegrex_mnemonic> mnemonics;
+    array<jump_destination> jumps;
+    ::init(&mnemonics);
+    ::init(&jumps);
+    defer { ::free(&mnemonics); ::free(&jumps); };
+
+    auto setup = [&]()
+    {
+        ::resize(&mnemonics, 0);
+        ::resize(&jumps, 0);
+    };
+
+    char case_name[BENCH_NAME_SIZE];
+
+    for (int with_jumps = 1; with_jumps >= 0; --with_jumps)
+    {
+        snprintf(case_name, sizeof(case_name), "scan_mnemonics%s%s", with_jumps ? "" : ", no jumps", suffix);
+
+        bench_result *res = bench_run(h, case_name, opcodes->size, opcodes->size * sizeof(u32), setup, [&]()
+        {
+            scan_mnemonics((const char*)opcodes->data, opcodes->size * sizeof(u32), &mnemonics, with_jumps ? &jumps : nullptr, &conf);
+            sort_jumps(&jumps);
+
+            return (s64)(mnemonics.size + jumps.size);
+        });
+
+        if (res == nullptr)
+            continue;
+
+        tprint("%-34s speedup %.2fx over parse_instructions\n", "",
+               res->median > 0 ? parse_seconds / res->median : 0);
+    }
+}
+
+/* the same section as _bench_parse_instructions with a decode cache that is empty
+   at the start of every repetition, parse_seconds is the median time without cache. */
+static void _bench_decode_cache(bench_harness *h, const char *suffix, const array<u32> *opcodes, double parse_seconds)
+{
+    parse_instructions_config conf{};
+    _default_parse_config(&conf);
+
+    array<instruction> instructions;
+    array<jump_destination> jumps;
+    decode_cache cache{};
+    ::init(&instructions);
+    ::init(&jumps);
+    ::init(&cache);
+    defer { ::free(&instructions); ::free(&jumps); ::free(&cache); };
+
+    auto setup = [&]()
+    {
+        ::resize(&instructions, 0);
+        ::resize(&jumps, 0);
+        ::free(&cache);
+        ::init(&cache);
+    };
+
+    char case_name[BENCH_NAME_SIZE];
+    snprintf(case_name, sizeof(case_name), "parse_instructions, decode cache%s", suffix);
+
+    bench_result *res = bench_run(h, case_name, opcodes->size, opcodes->size * sizeof(u32), setup, [&]()
+    {
+        parse_instructions((const char*)opcodes->data, opcodes->size * sizeof(u32), &instructions, &jumps, &conf, &cache);
+        sort_jumps(&jumps);
+
+        return (s64)(instructions.size + jumps.size);
+    });
+
+    if (res == nullptr)
+        return;
+
+    u64 lookups = cache.hits + cache.misses;
+
+    tprint("%-34s hit rate %.2f, speedup %.2fx over parse_instructions\n", "",
+           lookups > 0 ? (double)cache.hits / (double)lookups : 0,
+           res->median > 0 ? parse_seconds / res->median : 0);
+}
+
+// a section of opcodes of all categories, so some cases don't depend on the input
+static void _synthetic_section_opcodes(array<u32> *out)
+{
+    u64 primaries = 0;
+
+    for (const auto &cat : _opcode_categories)
+        primaries |= cat.primaries;
+
+    _category_opcodes(primaries, SYNTHETIC_SECTION_OPCODE_COUNT, out);
+}
+
+// collecting jumps of a section where every instruction jumps somewhere
+static void _bench_jumps(bench_harness *h)
+{
+    parse_instructions_config conf{};
+    _default_parse_config(&conf);
+    conf.vaddr = 0x08804000;
+
+    array<u32> opcodes;
+    array<instruction> instructions;
+    array<jump_destination> jumps;
+    array<jump_destination> unsorted_jumps;
+    ::init(&opcodes);
+    ::init(&instructions);
+    ::init(&jumps);
+    ::init(&unsorted_jumps);
+    defer { ::free(&opcodes); ::free(&instructions); ::free(&jumps); ::free(&unsorted_jumps); };
+
+    _branch_heavy_opcodes(BRANCH_BENCH_INSTRUCTION_COUNT, &opcodes);
+    ::resize(&instructions, opcodes.size);
+
+    bench_run(h, "parse (branches)", opcodes.size, opcodes.size * sizeof(u32),
+        [&]() { ::resize(&jumps, 0); },
+        [&]()
+        {
+            parse_instructions((const char*)opcodes.data, opcodes.size * sizeof(u32), instructions.data, &jumps, &conf);
+            return (s64)jumps.size;
+        });
+
+    ::resize(&unsorted_jumps, jumps.size);
+    copy_memory(jumps.data, unsorted_jumps.data, jumps.size * sizeof(jump_destination));
+
+    bench_run(h, "sort_jumps", unsorted_jumps.size, 0,
+        [&]()
+        {
+            ::resize(&jumps, unsorted_jumps.size);
+            copy_memory(unsorted_jumps.data, jumps.data, jumps.size * sizeof(jump_destination));
+        },
+        [&]()
+        {
+            sort_jumps(&jumps);
+            return (s64)jumps.size;
+        });
+
+    // for comparison, sorted insertion of the first few jumps into a set
+    ::resize(&jumps, 0);
+    parse_instructions((const char*)opcodes.data, BRANCH_BENCH_SET_JUMP_COUNT * sizeof(u32), instructions.data, &jumps, &conf);
+
+    set<jump_destination> jump_set;
+    ::init(&jump_set);
+    defer { ::free(&jump_set); };
+
+    auto start = bench_clock::now();
+
+    for_array(jmp, &jumps)
+        ::insert_element(&jump_set, *jmp);
+
+    add_single_result(h, "set insert_element", jumps.size, 0, seconds_since(start), (u32)jump_set.size);
+}
+
+// how get_psp_function_by_nid used to find functions, for comparison
+static const psp_function *_get_psp_function_by_nid_linear(const char *mod, u32 nid)
+{
+    const psp_module *mods = get_psp_modules();
+    u32 count = get_psp_module_count();
+
+    for (u32 m = 0; m < count; ++m)
+    {
+        if (strcmp(mods[m].name, mod) != 0)
+            continue;
+
+        for (u32 i = 0; i < mods[m].function_count; ++i)
+            if (mods[m].functions[i].nid == nid)
+                return mods[m].functions + i;
+
+        return nullptr;
+    }
+
+    return nullptr;
+}
+
+// resolving every NID of every known module
+static void _bench_psp_modules(bench_harness *h)
+{
+    const psp_module *mods = get_psp_modules();
+    u32 count = get_psp_module_count();
+    u64 function_count = 0;
+
+    for (u32 m = 0; m < count; ++m)
+        function_count += mods[m].function_count;
+
+    bench_run(h, "nid lookup (hash)", function_count, 0, [&]()
+    {
+        u32 checksum = 0;
+
+        for (u32 m = 0; m < count; ++m)
+        {
+            for (u32 i = 0; i < mods[m].function_count; ++i)
+                checksum = checksum * 31 + get_psp_function_by_nid(mods[m].name, mods[m].functions[i].nid)->function_num;
+        }
+
+        return (s64)checksum;
+    });
+
+    bench_run(h, "nid lookup (global)", function_count, 0, [&]()
+    {
+        u32 checksum = 0;
+
+        for (u32 m = 0; m < count; ++m)
+        {
+            for (u32 i = 0; i < mods[m].function_count; ++i)
+                checksum = checksum * 31 + get_psp_function_by_nid(mods[m].functions[i].nid)->function_num;
+        }
+
+        return (s64)checksum;
+    });
+
+    bench_run(h, "nid lookup (linear)", function_count, 0, [&]()
+    {
+        u32 checksum = 0;
+
+        for (u32 m = 0; m < count; ++m)
+        {
+            for (u32 i = 0; i < mods[m].function_count; ++i)
+                checksum = checksum * 31 + _get_psp_function_by_nid_linear(mods[m].name, mods[m].functions[i].nid)->function_num;
+        }
+
+        return (s64)checksum;
+    });
+}
+
+// how lookup_address_name used to find names, for comparison
+static const char *_lookup_address_name_linear(u32 addr, const dump_config *conf)
+{
+    elf_symbol *sym = ::search(conf->symbols, &addr);
+
+    if (sym != nullptr)
+        return sym->name;
+
+    function_import *fimp = ::search(conf->imports, &addr);
+
+    if (fimp != nullptr)
+        return fimp->function->name;
+
+    for_array(mod, conf->exported_modules)
+    {
+        for_array(func, &mod->functions)
+            if (func->address == addr)
+                return func->function->name;
+    }
+
+    return nullptr;
+}
+
+// label names of jumps into a module with thousands of exports
+static void _bench_address_names(bench_harness *h)
+{
+    psp_function func{};
+    func.name = "exported_function";
+
+    psp_function imported_func{};
+    imported_func.name = "imported_function";
+
+    hash_table<u32, elf_symbol> symbols;
+    hash_table<u32, function_import> imports;
+    array<module_import> imported_modules;
+    array<module_export> exported_modules;
+    array<u32> addresses;
+    ::init(&symbols);
+    ::init(&imports);
+    ::init(&imported_modules);
+    ::init(&exported_modules);
+    ::init(&addresses);
+
+    defer
+    {
+        for_array(mod, &exported_modules)
+        {
+            ::free(&mod->functions);
+            ::free(&mod->variables);
+        }
+
+        ::free(&symbols);
+        ::free(&imports);
+        ::free(&imported_modules);
+        ::free(&exported_modules);
+        ::free(&addresses);
+    };
+
+    u32 addr = 0x08804000;
+
+    for (u32 m = 0; m < LABEL_BENCH_EXPORT_MODULE_COUNT; ++m)
+    {
+        module_export *mod = ::add_at_end(&exported_modules);
+        mod->module_name = "module";
+        ::init(&mod->functions);
+        ::init(&mod->variables);
+
+        for (u32 f = 0; f < LABEL_BENCH_EXPORTS_PER_MODULE; ++f)
+        {
+            ::add_at_end(&mod->functions, function_export{addr, &func});
+            ::add_at_end(&addresses, addr);
+            addr += 0x40;
+        }
+    }
+
+    for (u32 i = 0; i < LABEL_BENCH_IMPORT_COUNT; ++i)
+    {
+        imports[addr] = function_import{addr, &imported_func};
+        ::add_at_end(&addresses, addr);
+        addr += 8;
+    }
+
+    // jumps to functions without a name
+    for (u32 i = 0; i < LABEL_BENCH_IMPORT_COUNT; ++i)
+    {
+        ::add_at_end(&addresses, addr);
+        addr += 0x40;
+    }
+
+    dump_config conf;
+    init(&conf);
+    defer { free(&conf); };
+
+    conf.symbols = &symbols;
+    conf.imports = &imports;
+    conf.imported_modules = &imported_modules;
+    conf.exported_modules = &exported_modules;
+
+    auto start = bench_clock::now();
+    index_address_names(&conf);
+    add_single_result(h, "index_address_names", addresses.size, 0, seconds_since(start), (u32)conf.address_names.size);
+
+    bench_run(h, "lookup (index)", addresses.size, 0, [&]()
+    {
+        u32 checksum = 0;
+
+        for_array(a, &addresses)
+            checksum = checksum * 31 + (lookup_address_name(*a, &conf) != nullptr);
+
+        return (s64)checksum;
+    });
+
+    bench_run(h, "lookup (linear)", addresses.size, 0, [&]()
+    {
+        u32 checksum = 0;
+
+        for_array(a, &addresses)
+            checksum = checksum * 31 + (_lookup_address_name_linear(*a, &conf) != nullptr);
+
+        return (s64)checksum;
+    });
+}
+
+static u32 _add_string(array<char> *strings, const char *str)
+{
+    u32 offset = (u32)strings->size;
+    u64 len = strlen(str) + 1;
+
+    ::resize(strings, strings->size + len);
+    copy_memory(str, strings->data + offset, len);
+
+    return offset;
+}
+
+template<typename T>
+static u32 _add_data(array<char> *elf, const T *data, u64 size)
+{
+    u32 offset = (u32)elf->size;
+
+    ::resize(elf, elf->size + size);
+    copy_memory(data, elf->data + offset, size);
+
+    return offset;
+}
+
+/* a module with SECTION_BENCH_SECTION_COUNT small executable sections, each
+   with SECTION_BENCH_SYMBOLS_PER_SECTION symbols, and the sections psp_elf
+   expects (.rodata.sceModuleInfo, .symtab, .strtab, .shstrtab). */
+static void _many_section_elf(array<char> *out)
+{
+    const u32 code_size = 16;
+    const u32 base_vaddr = 0x08804000;
+    const u32 section_count = SECTION_BENCH_SECTION_COUNT + 5; // + null, module info, symtab, strtab, shstrtab
+    const u32 module_info_index = SECTION_BENCH_SECTION_COUNT + 1;
+    const u32 symtab_index = module_info_index + 1;
+    const u32 strtab_index = symtab_index + 1;
+    const u32 shstrtab_index = strtab_index + 1;
+
+    array<Elf32_Shdr> headers;
+    array<Elf32_Sym> symbols;
+    array<char> strtab;
+    array<char> shstrtab;
+    ::init(&headers);
+    ::init(&symbols);
+    ::init(&strtab);
+    ::init(&shstrtab);
+
+    defer
+    {
+        ::free(&headers);
+        ::free(&symbols);
+        ::free(&strtab);
+        ::free(&shstrtab);
+    };
+
+    ::resize(&headers, section_count);
+    fill_memory(headers.data, 0, headers.size * sizeof(Elf32_Shdr));
+
+    ::resize(out, sizeof(Elf32_Ehdr));
+    _add_string(&strtab, "");
+    _add_string(&shstrtab, "");
+    ::add_at_end(&symbols, Elf32_Sym{});
+
+    char name[64];
+    const u32 nops[code_size / sizeof(u32)]{};
+
+    for (u32 i = 1; i <= SECTION_BENCH_SECTION_COUNT; ++i)
+    {
+        u32 vaddr = base_vaddr + (i - 1) * code_size;
+
+        Elf32_Shdr *sec = headers.data + i;
+        snprintf(name, sizeof(name), ".text.%u", i);
+        sec->sh_name = _add_string(&shstrtab, name);
+        sec->sh_type = SHT_PROGBITS;
+        sec->sh_flags = SHF_ALLOC | SHF_EXECINSTR;
+        sec->sh_addr = vaddr;
+        sec->sh_offset = _add_data(out, nops, code_size);
+        sec->sh_size = code_size;
+
+        for (u32 s = 0; s < SECTION_BENCH_SYMBOLS_PER_SECTION; ++s)
+        {
+            snprintf(name, sizeof(name), "func_%u_%u", i, s);
+
+            Elf32_Sym *sym = ::add_at_end(&symbols);
+            *sym = Elf32_Sym{};
+            sym->st_name = _add_string(&strtab, name);
+            sym->st_value = vaddr + (s * sizeof(u32)) % code_size;
+            sym->st_shndx = (u16)i;
+        }
+    }
+
+    prx_sce_module_info mod_info{};
+    copy_memory("bench", mod_info.name, 6);
+
+    Elf32_Shdr *sec = headers.data + module_info_index;
+    sec->sh_name = _add_string(&shstrtab, ".rodata.sceModuleInfo");
+    sec->sh_type = SHT_PROGBITS;
+    sec->sh_flags = SHF_ALLOC;
+    sec->sh_addr = base_vaddr + SECTION_BENCH_SECTION_COUNT * code_size;
+    sec->sh_offset = _add_data(out, &mod_info, sizeof(mod_info));
+    sec->sh_size = sizeof(mod_info);
+
+    sec = headers.data + symtab_index;
+    sec->sh_name = _add_string(&shstrtab, ".symtab");
+    sec->sh_type = SHT_SYMTAB;
+    sec->sh_offset = _add_data(out, symbols.data, symbols.size * sizeof(Elf32_Sym));
+    sec->sh_size = (u32)(symbols.size * sizeof(Elf32_Sym));
+    sec->sh_link = strtab_index;
+    sec->sh_entsize = sizeof(Elf32_Sym);
+
+    sec = headers.data + strtab_index;
+    sec->sh_name = _add_string(&shstrtab, ".strtab");
+    sec->sh_type = SHT_STRTAB;
+    sec->sh_offset = _add_data(out, strtab.data, strtab.size);
+    sec->sh_size = (u32)strtab.size;
+
+    sec = headers.data + shstrtab_index;
+    sec->sh_name = _add_string(&shstrtab, ".shstrtab");
+    sec->sh_type = SHT_STRTAB;
+    sec->sh_offset = _add_data(out, shstrtab.data, shstrtab.size);
+    sec->sh_size = (u32)shstrtab.size;
+
+    Elf32_Ehdr ehdr{};
+    copy_memory("\x7f" "ELF", ehdr.e_ident, 4);
+    ehdr.e_ident[EI_CLASS] = ELFCLASS32;
+    ehdr.e_ident[EI_DATA] = ELFDATA2LSB;
+    ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+    ehdr.e_type = ET_EXEC;
+    ehdr.e_machine = EM_MIPS;
+    ehdr.e_version = EV_CURRENT;
+    ehdr.e_entry = base_vaddr;
+    ehdr.e_ehsize = sizeof(Elf32_Ehdr);
+    ehdr.e_shentsize = sizeof(Elf32_Shdr);
+    ehdr.e_shnum = (u16)section_count;
+    ehdr.e_shstrndx = (u16)shstrtab_index;
+    ehdr.e_shoff = _add_data(out, headers.data, headers.size * sizeof(Elf32_Shdr));
+
+    copy_memory(&ehdr, out->data, sizeof(Elf32_Ehdr));
+}
+
+static void _default_parse_elf_config(psp_parse_elf_config *conf)
+{
+    conf->section = ""_cs;
+    conf->vaddr = INFER_VADDR;
+    conf->verbose = false;
+    conf->log = nullptr;
+    conf->log_buffer = nullptr;
+    conf->map_file = false;
+}
+
+// parsing a module with many sections, most of the time goes into the section header table
+static bool _bench_many_section_elf(bench_harness *h, error *err)
+{
+    array<char> elf;
+    ::init(&elf);
+    defer { ::free(&elf); };
+
+    _many_section_elf(&elf);
+
+    psp_parse_elf_config conf{};
+    _default_parse_elf_config(&conf);
+
+    bench_result *res = bench_run(h, "parse_psp_module_from_elf", 1, elf.size, [&]()
+    {
+        elf_psp_module mod;
+        init(&mod);
+        defer { free(&mod); };
+
+        if (!parse_psp_module_from_elf(elf.data, elf.size, &mod, &conf, err))
+            return (s64)-1;
+
+        return (s64)(mod.sections.size + mod.symbols.size);
+    });
+
+    return res != nullptr;
+}
+
+// a tag of each PRX type, tag 0 is in both tag tables
+static const struct
+{
+    u32 tag;
+    prx_type type;
+} _prx_bench_modules[] = {
+    { 0x02000000, prx_type::Type0 },
+    { 0x08000000, prx_type::Type1 },
+    { 0xC0CB167C, prx_type::Type1 },
+    { 0xD91605F0, prx_type::Type2 },
+    { 0x4C9494F0, prx_type::Type2 },
+    { 0x457B0AF0, prx_type::Type2 },
+    { 0x2FD313F0, prx_type::Type5 },
+    { 0x00000000, prx_type::Type2 }
+};
+
+// decrypting synthetic modules of different PRX types and sizes, every 8th is corrupt
+static bool _bench_prx_decrypt(bench_harness *h, error *err)
+{
+    constexpr u32 kind_count = (u32)(sizeof(_prx_bench_modules) / sizeof(_prx_bench_modules[0]));
+
+    array<u8> prxs[PRX_BENCH_MODULE_COUNT];
+    u64 total_size = 0;
+    u64 max_size = 0;
+
+    for (u32 i = 0; i < PRX_BENCH_MODULE_COUNT; ++i)
+        ::init(prxs + i);
+
+    defer { for (u32 i = 0; i < PRX_BENCH_MODULE_COUNT; ++i) ::free(prxs + i); };
+
+    for (u32 i = 0; i < PRX_BENCH_MODULE_COUNT; ++i)
+    {
+        // 4 KiB - 128 KiB, like most firmware modules
+        u32 elf_size = PRX_BENCH_MIN_MODULE_SIZE << (i / kind_count % 6);
+
+        array<u8> elf;
+        ::init(&elf);
+        defer { ::free(&elf); };
+        ::resize(&elf, elf_size);
+
+        u32 x = RANDOM_SEED + i;
+
+        for (u32 j = 0; j < elf_size; ++j)
+        {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            elf[j] = (u8)x;
+        }
+
+        ::resize(prxs + i, prx_encrypted_size(elf_size));
+
+        if (pspEncryptPRX(elf.data, elf_size, prxs[i].data,
+                          _prx_bench_modules[i % kind_count].tag,
+                          _prx_bench_modules[i % kind_count].type) < 0)
+        {
+            set_error(err, 1, "could not encrypt test module");
+            return false;
+        }
+
+        if (i % 8 == 7)
+            prxs[i][0x10] ^= 1;
+
+        total_size += prxs[i].size;
+        max_size = Max(max_size, prxs[i].size);
+    }
+
+    array<u8> out;
+    ::init(&out);
+    defer { ::free(&out); };
+    ::resize(&out, max_size);
+
+    u32 attempts = 0;
+    u32 failed = 0;
+
+    bench_run(h, "pspDecryptPRX", PRX_BENCH_MODULE_COUNT, total_size, [&]()
+    {
+        attempts = 0;
+        failed = 0;
+
+        for (u32 i = 0; i < PRX_BENCH_MODULE_COUNT; ++i)
+        {
+            prx_decrypt_info info;
+
+            if (pspDecryptPRX(prxs[i].data, out.data, (u32)prxs[i].size, nullptr, &info) < 0)
+                failed += 1;
+
+            attempts += info.attempts;
+        }
+
+        return (s64)(attempts * 31 + failed);
+    });
+
+    tprint("%-34s %.2f attempts per module, %u of %u failed\n", "",
+           (double)attempts / PRX_BENCH_MODULE_COUNT, failed, PRX_BENCH_MODULE_COUNT);
+
+    return true;
+}
+
+// memory used by array<instruction> vs. compact_instructions and the cost of decoding on access
+static void _bench_compact_instructions(bench_harness *h, const array<u32> *opcodes)
+{
+    parse_instructions_config conf{};
+    _default_parse_config(&conf);
+
+    compact_instructions compact;
+    init(&compact);
+    defer { free(&compact); };
+
+    auto setup = [&]()
+    {
+        free(&compact);
+        init(&compact);
+    };
+
+    bench_run(h, "parse (compact)", opcodes->size, opcodes->size * sizeof(u32), setup, [&]()
+    {
+        parse_instructions((const char*)opcodes->data, opcodes->size * sizeof(u32), &compact, nullptr, &conf);
+        return (s64)compact.opcodes.size;
+    });
+
+    bench_run(h, "iterate (compact)", opcodes->size, 0, [&]()
+    {
+        u32 checksum = 0;
+        compact_instruction_iterator it = iterate_instructions(&compact);
+
+        while (next(&it))
+            checksum = checksum * 31 + it.current.argument_count;
+
+        return (s64)checksum;
+    });
+
+    u64 array_size = opcodes->size * sizeof(instruction);
+    u64 compact_size = get_memory_size(&compact);
+
+    tprint("%-34s array<instruction> %llu bytes, compact_instructions %llu bytes (%.1fx smaller)\n",
+           "memory", (unsigned long long)array_size, (unsigned long long)compact_size,
+           compact_size > 0 ? (double)array_size / (double)compact_size : 0);
+}
+
+/* formatting a section as assembly with the default psp-elfdump options.
+   the output goes to memory, the buffer is large enough for all of it so
+   only formatting is measured and the file is not written to. */
+static bool _bench_asm_format(bench_harness *h, const char *name, const array<u32> *opcodes, error *err)
+{
+    const u32 vaddr = 0x08804000;
+
+    parse_instructions_config pconf{};
+    _default_parse_config(&pconf);
+    pconf.vaddr = vaddr;
+
+    array<instruction> instructions;
+    array<jump_destination> jumps;
+    ::init(&instructions);
+    ::init(&jumps);
+    defer { ::free(&instructions); ::free(&jumps); };
+
+    parse_instructions((const char*)opcodes->data, opcodes->size * sizeof(u32), &instructions, &jumps, &pconf);
+    sort_jumps(&jumps);
+
+    elf_section sec{};
+    sec.content = (char*)opcodes->data;
+    sec.content_size = opcodes->size * sizeof(u32);
+    sec.content_offset = 0;
+    sec.vaddr = vaddr;
+    sec.name = ".text";
+
+    dump_config dconf;
+    init(&dconf);
+    defer { free(&dconf); };
+
+    dconf.format = default_mips_format_options;
+    dconf.jumps = jumps.data;
+    dconf.jump_count = (s32)jumps.size;
+    index_address_names(&dconf);
+
+    dump_section *dsec = ::add_at_end(&dconf.dump_sections);
+    dsec->section = &sec;
+    dsec->first_instruction_offset = 0;
+    dsec->instructions = instructions.data;
+    dsec->instruction_count = (s32)instructions.size;
+    dsec->instruction_start_index = 0;
+    dsec->compact = nullptr;
+
+    file_stream out{};
+
+    if (!init(&out, ASM_BENCH_FILE, open_mode::WriteTrunc, err))
+        return false;
+
+    defer { free(&out); remove(ASM_BENCH_FILE); };
+
+    output_buffer buf;
+    init(&buf, &out, Max(opcodes->size * ASM_BENCH_BYTES_PER_INSTRUCTION, (u64)DEFAULT_OUTPUT_BUFFER_SIZE));
+    defer { free(&buf); };
+
+    auto reset = [&]()
+    {
+        buf.size = 0;
+        buf.written = 0;
+    };
+
+    // once for the size of the output
+    asm_format(&dconf, &buf);
+    u64 output_size = buf.written + buf.size;
+
+    bench_result *res = bench_run(h, name, instructions.size, output_size, reset, [&]()
+    {
+        asm_format(&dconf, &buf);
+        return (s64)(buf.written + buf.size);
+    });
+
+    return res != nullptr;
+}
+
+// loads the module by reading and copying the file vs. mapping it
+static bool _bench_load_psp_module(bench_harness *h, const_string path, error *err)
+{
+    file_stream log{};
+    log.handle = stdout_handle();
+
+    h->measure_peak_rss = true;
+    defer { h->measure_peak_rss = false; };
+
+    for (int map_file = 0; map_file <= 1; ++map_file)
+    {
+        psp_parse_elf_config conf{};
+        _default_parse_elf_config(&conf);
+        conf.log = &log;
+        conf.map_file = map_file != 0;
+
+        u64 file_size = 0;
+
+        {
+            file_stream in{};
+
+            if (!init(&in, path.c_str, open_mode::Read, err))
+                return false;
+
+            defer { free(&in); };
+
+            s64 sz = get_file_size(&in, err);
+
+            if (sz < 0)
+                return false;
+
+            file_size = (u64)sz;
+        }
+
+        bench_result *res = bench_run(h, map_file ? "load (mmap)" : "load (read)", 1, file_size, [&]()
+        {
+            elf_psp_module mod;
+            init(&mod);
+            defer { free(&mod); };
+
+            if (!parse_psp_module_from_elf(path.c_str, &mod, &conf, err))
+                return (s64)-1;
+
+            return (s64)mod.elf_size;
+        });
+
+        if (res == nullptr)
+            return false;
+    }
+
+    return true;
+}
+
+// writes the module of _many_section_elf, padded to PRX_LOAD_BENCH_ELF_SIZE, encrypted to path
+static bool _write_encrypted_module(const char *path, error *err)
+{
+    array<char> elf;
+    ::init(&elf);
+    defer { ::free(&elf); };
+
+    _many_section_elf(&elf);
+
+    // the padding is not part of any section, like the data at the end of large modules
+    ::resize(&elf, Max(elf.size, (u64)PRX_LOAD_BENCH_ELF_SIZE));
+
+    array<u8> prx;
+    ::init(&prx);
+    defer { ::free(&prx); };
+    ::resize(&prx, prx_encrypted_size((u32)elf.size));
+
+    if (pspEncryptPRX((const u8*)elf.data, (u32)elf.size, prx.data, 0xD91605F0, prx_type::Type2) < 0)
+    {
+        set_error(err, 1, "could not encrypt test module");
+        return false;
+    }
+
+    file_stream out{};
+
+    if (!init(&out, path, open_mode::WriteTrunc, err))
+        return false;
+
+    defer { free(&out); };
+
+    return write(&out, prx.data, prx.size, err) >= 0;
+}
+
+/* loads an encrypted module by reading it and decrypting into a second buffer,
+   like loading from memory does, vs. decrypting within the buffer it is read into. */
+static bool _bench_load_encrypted_psp_module(bench_harness *h, error *err)
+{
+    if (!_write_encrypted_module(PRX_LOAD_BENCH_FILE, err))
+        return false;
+
+    defer { remove(PRX_LOAD_BENCH_FILE); };
+
+    psp_parse_elf_config conf{};
+    _default_parse_elf_config(&conf);
+    conf.map_file = true;
+
+    h->measure_peak_rss = true;
+    defer { h->measure_peak_rss = false; };
+
+    u64 prx_size = prx_encrypted_size(PRX_LOAD_BENCH_ELF_SIZE);
+
+    bench_result *res = bench_run(h, "load prx (copy)", 1, prx_size, [&]()
+    {
+        elf_psp_module mod;
+        init(&mod);
+        defer { free(&mod); };
+
+        memory_stream prx{};
+
+        if (!read_entire_file(PRX_LOAD_BENCH_FILE, &prx, err))
+            return (s64)-1;
+
+        defer { ::free(&prx); };
+
+        if (!parse_psp_module_from_elf(&prx, &mod, &conf, err))
+            return (s64)-1;
+
+        return (s64)mod.elf_size;
+    });
+
+    if (res == nullptr)
+        return false;
+
+    res = bench_run(h, "load prx (in place)", 1, prx_size, [&]()
+    {
+        elf_psp_module mod;
+        init(&mod);
+        defer { free(&mod); };
+
+        if (!parse_psp_module_from_elf(PRX_LOAD_BENCH_FILE, &mod, &conf, err))
+            return (s64)-1;
+
+        return (s64)mod.elf_size;
+    });
+
+    return res != nullptr;
+}
+
+/* code-like data: functions of random opcodes that are repeated with some
+   opcodes changed. repeats are of one of the last 64 functions, so they are
+   within the 32 KiB window of deflate. */
+static void _compressible_code(u32 size, array<u8> *out)
+{
+    const u32 function_words = 64;
+    const u32 unique_words = 64 * function_words;
+
+    ::resize(out, size);
+    u32 *words = (u32*)out->data;
+    u32 count = size / sizeof(u32);
+    u32 x = RANDOM_SEED;
+    u32 src = 0;
+
+    for (u32 i = 0; i < count; ++i)
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+
+        if (i >= unique_words && i % function_words == 0)
+            src = i - (1 + x % 64) * function_words;
+
+        if (i < unique_words || (x & 0x700) == 0)
+            words[i] = x;
+        else
+            words[i] = words[src + i % function_words];
+    }
+}
+
+/* decrypting and inflating a compressed module within one buffer vs. into
+   separate buffers for the file, the decrypted gzip data and the ELF. */
+static bool _bench_compressed_prx(bench_harness *h, error *err)
+{
+    array<u8> elf;
+    ::init(&elf);
+    defer { ::free(&elf); };
+
+    array<u8> gz;
+    ::init(&gz);
+    defer { ::free(&gz); };
+
+    array<u8> prx;
+    ::init(&prx);
+    defer { ::free(&prx); };
+
+    _compressible_code(PRX_LOAD_BENCH_ELF_SIZE, &elf);
+    gzip_fixed(elf.data, (u32)elf.size, &gz);
+    ::resize(&prx, prx_encrypted_size((u32)gz.size));
+
+    if (pspEncryptPRX(gz.data, (u32)gz.size, prx.data, 0xD91605F0, prx_type::Type2, (u32)elf.size) < 0)
+    {
+        set_error(err, 1, "could not encrypt test module");
+        return false;
+    }
+
+    {
+        file_stream out{};
+
+        if (!init(&out, PRX_COMPRESSED_BENCH_FILE, open_mode::WriteTrunc, err))
+            return false;
+
+        defer { free(&out); };
+
+        if (write(&out, prx.data, prx.size, err) < 0)
+            return false;
+    }
+
+    defer { remove(PRX_COMPRESSED_BENCH_FILE); };
+
+    u32 elf_size = (u32)elf.size;
+    u32 prx_size = (u32)prx.size;
+
+    // inflating alone, from the decrypted module
+    {
+        array<u8> decrypted;
+        ::init(&decrypted);
+        defer { ::free(&decrypted); };
+        ::resize(&decrypted, prx_size);
+
+        int decrypted_size = pspDecryptPRX(prx.data, decrypted.data, prx_size);
+
+        if (decrypted_size < 0)
+        {
+            set_error(err, 1, "could not decrypt compressed test module");
+            return false;
+        }
+
+        bench_result *res = bench_run(h, "inflate_gzip", 1, elf_size, [&]()
+        {
+            return inflate_gzip(decrypted.data, (u64)decrypted_size, elf.data, elf.size, err);
+        });
+
+        if (res == nullptr)
+            return false;
+    }
+
+    ::free(&elf);
+    ::free(&gz);
+    ::free(&prx);
+
+    h->measure_peak_rss = true;
+    defer { h->measure_peak_rss = false; };
+
+    bench_result *res = bench_run(h, "compressed prx (separate)", 1, elf_size, [&]()
+    {
+        memory_stream in{};
+
+        if (!read_entire_file(PRX_COMPRESSED_BENCH_FILE, &in, err))
+            return (s64)-1;
+
+        defer { ::free(&in); };
+
+        array<u8> decrypted;
+        ::init(&decrypted);
+        defer { ::free(&decrypted); };
+        ::resize(&decrypted, prx_size);
+
+        int decrypted_size = pspDecryptPRX((const u8*)in.data, decrypted.data, prx_size);
+
+        array<u8> out;
+        ::init(&out);
+        defer { ::free(&out); };
+        ::resize(&out, elf_size);
+
+        if (decrypted_size < 0
+         || inflate_gzip(decrypted.data, (u64)decrypted_size, out.data, out.size, err) != elf_size)
+        {
+            set_error(err, 1, "could not decrypt compressed test module");
+            return (s64)-1;
+        }
+
+        return (s64)out.size;
+    });
+
+    if (res == nullptr)
+        return false;
+
+    res = bench_run(h, "compressed prx (in place)", 1, elf_size, [&]()
+    {
+        file_stream in{};
+
+        if (!init(&in, PRX_COMPRESSED_BENCH_FILE, open_mode::Read, err))
+            return (s64)-1;
+
+        defer { free(&in); };
+
+        array<u8> out;
+        ::init(&out);
+        defer { ::free(&out); };
+
+        if (decrypt_elf(&in, &out, err) != elf_size)
+        {
+            set_error(err, 1, "could not decrypt compressed test module");
+            return (s64)-1;
+        }
+
+        return (s64)out.size;
+    });
+
+    return res != nullptr;
+}
+
+static bool _is_same_disassembly(const psp_disassembly *a, const psp_disassembly *b)
+{
+    if (a->all_instructions.size != b->all_instructions.size
+     || a->all_jumps.size != b->all_jumps.size)
+        return false;
+
+    for (u64 i = 0; i < a->all_instructions.size; ++i)
+        if (memcmp(a->all_instructions.data + i, b->all_instructions.data + i, sizeof(instruction)) != 0)
+            return false;
+
+    for (u64 i = 0; i < a->all_jumps.size; ++i)
+        if (a->all_jumps[i].address != b->all_jumps[i].address
+         || a->all_jumps[i].type != b->all_jumps[i].type)
+            return false;
+
+    return true;
+}
+
+static u32 _next_thread_count(u32 threads, u32 max_threads)
+{
+    if (threads < max_threads && threads * 2 > max_threads)
+        return max_threads;
+
+    return threads * 2;
+}
+
+// disassembles the entire file with 1, 2, 4, ... threads up to the number of hardware threads
+static bool _bench_disassemble_psp_elf(bench_harness *h, const_string path, error *err)
+{
+    memory_stream elf_data{};
+
+    if (!read_entire_file(path.c_str, &elf_data, err))
+        return false;
+
+    defer { free(&elf_data); };
+
+    u32 max_threads = std::thread::hardware_concurrency();
+
+    if (max_threads == 0)
+        max_threads = 1;
+
+    psp_disassembly reference;
+    init(&reference);
+    defer { free(&reference); };
+
+    psp_disassembly_config conf{};
+    conf.thread_count = 1;
+
+    if (!disassemble_psp_elf(elf_data.data, elf_data.size, &reference, &conf, err))
+        return false;
+
+    double single_thread_seconds = 0;
+    char name[BENCH_NAME_SIZE];
+
+    for (u32 threads = 1; threads <= max_threads; threads = _next_thread_count(threads, max_threads))
+    {
+        conf.thread_count = threads;
+        bool same = true;
+
+        snprintf(name, sizeof(name), "disassemble_psp_elf (%u threads)", threads);
+
+        bench_result *res = bench_run(h, name, reference.all_instructions.size, elf_data.size, [&]()
+        {
+            psp_disassembly disasm;
+            init(&disasm);
+            defer { free(&disasm); };
+
+            if (!disassemble_psp_elf(elf_data.data, elf_data.size, &disasm, &conf, err))
+                return (s64)-1;
+
+            same = same && _is_same_disassembly(&reference, &disasm);
+
+            return (s64)disasm.all_instructions.size;
+        });
+
+        if (res == nullptr)
+            return false;
+
+        if (threads == 1)
+            single_thread_seconds = res->median;
+
+        tprint("%-34s speedup %.2fx%s\n", "",
+               res->median > 0 ? single_thread_seconds / res->median : 0,
+               same ? "" : " (DIFFERENT OUTPUT)");
+    }
+
+    return true;
+}
+
+// opens the file lazily and looks up LAZY_QUERY_COUNT pseudorandom instructions
+static bool _bench_lazy_disassembly(bench_harness *h, const_string path, error *err)
+{
+    memory_stream elf_data{};
+
+    if (!read_entire_file(path.c_str, &elf_data, err))
+        return false;
+
+    defer { free(&elf_data); };
+
+    lazy_disassembly disasm;
+    init(&disasm);
+    defer { free(&disasm); };
+
+    auto reopen = [&]()
+    {
+        free(&disasm);
+        init(&disasm);
+    };
+
+    bench_result *res = bench_run(h, "lazy_disassembly open", 1, elf_data.size, reopen, [&]()
+    {
+        if (!lazy_disassemble_psp_elf(elf_data.data, elf_data.size, &disasm, err))
+            return (s64)-1;
+
+        return (s64)disasm.instruction_count;
+    });
+
+    if (res == nullptr)
+        return false;
+
+    u64 instruction_count = disasm.instruction_count;
+
+    if (instruction_count == 0)
+        return true;
+
+    // every repetition starts with nothing decoded
+    auto reopen_undecoded = [&]()
+    {
+        reopen();
+        lazy_disassemble_psp_elf(elf_data.data, elf_data.size, &disasm, err);
+    };
+
+    bench_run(h, "lazy_disassembly lookup", LAZY_QUERY_COUNT, 0, reopen_undecoded, [&]()
+    {
+        u32 checksum = 0;
+        u32 x = RANDOM_SEED;
+
+        for (u32 i = 0; i < LAZY_QUERY_COUNT; ++i)
+        {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+
+            const instruction *inst = get_instruction(&disasm, x % instruction_count);
+            checksum = checksum * 31 + (u32)inst->mnemonic;
+        }
+
+        return (s64)checksum;
+    });
+
+    tprint("%-34s %u of %u instructions, %u pages decoded\n", "",
+           LAZY_QUERY_COUNT, (u32)instruction_count, (u32)disasm.decoded_page_count);
+
+    return true;
+}
+
+static bool _parse_arguments(int argc, const char **argv, arguments *out, error *err)
+{
+    for (int i = 1; i < argc;)
+    {
+        const_string arg = to_const_string(argv[i]);
+
+        if (arg == "-h"_cs || arg == "--help"_cs)
+        {
+            _print_usage();
+            exit(0);
+        }
+
+        if (arg == "-n"_cs)
+        {
+            if (i >= argc - 1)
+            {
+                format_error(err, 1, "%s expects a positional argument: the number of repetitions", arg.c_str);
+                return false;
+            }
+
+            out->repetitions = string_to_u32(argv[i + 1], nullptr, 0);
+            i += 2;
+            continue;
+        }
+
+        if (arg == "-w"_cs)
+        {
+            if (i >= argc - 1)
+            {
+                format_error(err, 1, "%s expects a positional argument: the number of warmup runs", arg.c_str);
+                return false;
+            }
+
+            out->warmup = string_to_u32(argv[i + 1], nullptr, 0);
+            i += 2;
+            continue;
+        }
+
+        if (arg == "--csv"_cs)
+        {
+            if (i >= argc - 1)
+            {
+                format_error(err, 1, "%s expects a positional argument: the output file", arg.c_str);
+                return false;
+            }
+
+            out->csv_file = to_const_string(argv[i + 1]);
+            i += 2;
+            continue;
+        }
+
+        if (arg == "--json"_cs)
+        {
+            if (i >= argc - 1)
+            {
+                format_error(err, 1, "%s expects a positional argument: the output file", arg.c_str);
+                return false;
+            }
+
+            out->json_file = to_const_string(argv[i + 1]);
+            i += 2;
+            continue;
+        }
+
+        if (arg == "--random"_cs)
+        {
+            if (i >= argc - 1)
+            {
+                format_error(err, 1, "%s expects a positional argument: the number of opcodes", arg.c_str);
+                return false;
+            }
+
+            out->random_count = string_to_u32(argv[i + 1], nullptr, 0);
+            i += 2;
+            continue;
+        }
+
+        if (string_begins_with(arg, "-"_cs))
+        {
+            format_error(err, 1, "unknown argument '%s'", arg.c_str);
+            return false;
+        }
+
+        if (string_is_blank(out->input_file))
+        {
+            out->input_file = arg;
+            i += 1;
+            continue;
+        }
+
+        format_error(err, 1, "unexpected argument '%s'", arg.c_str);
+        return false;
+    }
+
+    if (out->random_count == 0 && string_is_blank(out->input_file))
+    {
+        set_error(err, 1, "expected input file or --random COUNT");
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, const char **argv)
+{
+    arguments args = default_arguments;
+    error err{};
+
+    if (!_parse_arguments(argc, argv, &args, &err))
+    {
+        tprint("Error: %\n", err.what);
+        return err.error_code;
+    }
+
+    bench_harness h;
+    init(&h, args.warmup, args.repetitions);
+    defer { free(&h); };
+
+    // first, so the peak memory usage of loading is not hidden by earlier allocations
+    if (args.random_count == 0
+     && !_bench_load_psp_module(&h, args.input_file, &err))
+    {
+        tprint("Error: %\n", err.what);
+        return err.error_code;
+    }
+
+    if (!_bench_load_encrypted_psp_module(&h, &err)
+     || !_bench_compressed_prx(&h, &err))
+    {
+        tprint("Error: %\n", err.what);
+        return err.error_code;
+    }
+
+    array<u32> opcodes;
+    ::init(&opcodes);
+    defer { ::free(&opcodes); };
+
+    if (args.random_count > 0)
+        _random_opcodes(args.random_count, &opcodes);
+    else if (!_load_elf_opcodes(args.input_file, &opcodes, &err))
+    {
+        tprint("Error: %\n", err.what);
+        return err.error_code;
+    }
+
+    array<u32> synthetic;
+    ::init(&synthetic);
+    defer { ::free(&synthetic); };
+
+    _synthetic_section_opcodes(&synthetic);
+
+    _bench_parse_instruction(&h, &opcodes);
+    _bench_parse_instruction_categories(&h);
+    double parse_seconds = _bench_parse_instructions(&h, "parse_instructions", &opcodes);
+    _bench_scan_mnemonics(&h, "", &opcodes, parse_seconds);
+    _bench_decode_cache(&h, "", &opcodes, parse_seconds);
+    parse_seconds = _bench_parse_instructions(&h, "parse_instructions (synthetic)", &synthetic);
+    _bench_scan_mnemonics(&h, " (synthetic)", &synthetic, parse_seconds);
+    _bench_decode_cache(&h, " (synthetic)", &synthetic, parse_seconds);
+    _bench_compact_instructions(&h, &opcodes);
+    _bench_jumps(&h);
+    _bench_address_names(&h);
+    _bench_psp_modules(&h);
+
+    if (!_bench_many_section_elf(&h, &err)
+     || !_bench_prx_decrypt(&h, &err)
+     || !_bench_asm_format(&h, "asm_format", &opcodes, &err)
+     || !_bench_asm_format(&h, "asm_format (synthetic)", &synthetic, &err))
+    {
+        tprint("Error: %\n", err.what);
+        return err.error_code;
+    }
+
+    bench_kirk_cmd1(&h);
+    bench_kirk_sha1(&h);
+
+    if (args.random_count == 0
+     && (!_bench_disassemble_psp_elf(&h, args.input_file, &err)
+      || !_bench_lazy_disassembly(&h, args.input_file, &err)))
+    {
+        tprint("Error: %\n", err.what);
+        return err.error_code;
+    }
+
+    if ((!string_is_blank(args.csv_file) && !write_results_csv(&h, args.csv_file.c_str, &err))
+     || (!string_is_blank(args.json_file) && !write_results_json(&h, args.json_file.c_str, &err)))
+    {
+        tprint("Error: %\n", err.what);
+        return err.error_code;
+    }
+
+    return 0;
+}
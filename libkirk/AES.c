@@ -1309,6 +1309,7 @@ void AES_cbc_encrypt(AES_ctx *ctx, const u8 *src, u8 *dst, int size)
 	u8 block_buff[16];
 	
 	int i;
+	if(AES_NI_cbc_encrypt(ctx, src, dst, size)) return;
 	for(i = 0; i < size; i+=16)
 	{
 		//step 1: copy block to dst
@@ -1331,6 +1332,7 @@ void AES_cbc_decrypt(AES_ctx *ctx, const u8 *src, u8 *dst, int size)
 	u8 block_buff_previous[16];
 	int i;
 	
+	if(AES_NI_cbc_decrypt(ctx, src, dst, size)) return;
 	memcpy(block_buff, src, 16);
 	memcpy(block_buff_previous, src, 16);
 	AES_decrypt(ctx, src, dst);
@@ -1449,10 +1451,13 @@ void AES_CMAC (AES_ctx *ctx, unsigned char *input, int length, unsigned char *ma
     }
 
     for ( i=0; i<16; i++ ) X[i] = 0;
-    for ( i=0; i<n-1; i++ ) 
+    if ( !AES_NI_cbc_mac(ctx, X, input, n-1) ) /* X := CBC-MAC(M1 .. Mn-1) */
     {
-        xor_128(X,&input[16*i],Y); /* Y := Mi (+) X  */
-		AES_encrypt(ctx, Y, X); /* X := AES-128(KEY, Y); */ 
+        for ( i=0; i<n-1; i++ ) 
+        {
+            xor_128(X,&input[16*i],Y); /* Y := Mi (+) X  */
+            AES_encrypt(ctx, Y, X); /* X := AES-128(KEY, Y); */ 
+        }
     }
 
     xor_128(X,M_last,Y);
@@ -44,6 +44,18 @@ void AES_cbc_encrypt(AES_ctx *ctx, const u8 *src, u8 *dst, int size);
 void AES_cbc_decrypt(AES_ctx *ctx, const u8 *src, u8 *dst, int size);
 void AES_CMAC(AES_ctx *ctx, unsigned char *input, int length, unsigned char *mac);
 
+/* AES-NI (AES_NI.c)
+   AES_cbc_encrypt, AES_cbc_decrypt and AES_CMAC use AES-NI if the CPU
+   supports it. AES_set_aesni_enabled(0) makes the calling thread use the
+   lookup tables instead, e.g. for comparisons. */
+int AES_aesni_supported(void);
+void AES_set_aesni_enabled(int enabled);
+
+/* return 0 without doing anything if AES-NI is not used */
+int AES_NI_cbc_encrypt(AES_ctx *ctx, const u8 *src, u8 *dst, int size);
+int AES_NI_cbc_decrypt(AES_ctx *ctx, const u8 *src, u8 *dst, int size);
+int AES_NI_cbc_mac(AES_ctx *ctx, u8 *mac, const u8 *input, int blocks);
+
 int	rijndaelKeySetupEnc(unsigned int [], const unsigned char [], int);
 int	rijndaelKeySetupDec(unsigned int [], const unsigned char [], int);
 void rijndaelEncrypt(const unsigned int [], int, const unsigned char [],
@@ -0,0 +1,269 @@
+/*
+	AES-NI implementation of the AES.c functions that process whole buffers:
+	AES_cbc_encrypt, AES_cbc_decrypt and the CBC-MAC part of AES_CMAC.
+
+	The round keys are taken from the encryption key schedule of AES_ctx, so
+	contexts set up by AES_set_key work with both implementations and the
+	results are identical.
+	AES-NI is used if CPUID reports it and it was not disabled on the calling
+	thread with AES_set_aesni_enabled, otherwise the AES_NI_* functions return
+	0 and the caller uses the lookup tables.
+*/
+
+#include <string.h>
+
+#include "AES.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define AES_NI_TARGET
+#else
+#include <cpuid.h>
+#define AES_NI_TARGET __attribute__((target("aes,sse2")))
+#endif
+
+#include <emmintrin.h>
+#include <wmmintrin.h>
+
+static int cpu_has_aesni(void)
+{
+#if defined(_MSC_VER)
+	int regs[4];
+	__cpuid(regs, 1);
+	return ((regs[2] >> 25) & 1) && ((regs[3] >> 26) & 1);
+#else
+	unsigned int eax, ebx, ecx, edx;
+
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return 0;
+
+	return (ecx & bit_AES) && (edx & bit_SSE2);
+#endif
+}
+
+static KIRK_THREAD_LOCAL int aesni_supported = -1; // -1 = not checked yet
+static KIRK_THREAD_LOCAL int aesni_enabled = 1;
+
+int AES_aesni_supported(void)
+{
+	if (aesni_supported < 0)
+		aesni_supported = cpu_has_aesni();
+
+	return aesni_supported;
+}
+
+void AES_set_aesni_enabled(int enabled)
+{
+	aesni_enabled = enabled;
+}
+
+static int use_aesni(void)
+{
+	return aesni_enabled && AES_aesni_supported();
+}
+
+// the schedule in ctx->ek is stored as big endian words
+AES_NI_TARGET static void load_encrypt_keys(const AES_ctx *ctx, __m128i *rk)
+{
+	u8 bytes[16];
+	int i, j;
+
+	for (i = 0; i <= ctx->Nr; i++)
+	{
+		for (j = 0; j < 4; j++)
+		{
+			u32 w = ctx->ek[4*i + j];
+			bytes[4*j + 0] = (u8)(w >> 24);
+			bytes[4*j + 1] = (u8)(w >> 16);
+			bytes[4*j + 2] = (u8)(w >> 8);
+			bytes[4*j + 3] = (u8)(w);
+		}
+
+		rk[i] = _mm_loadu_si128((const __m128i *)bytes);
+	}
+}
+
+AES_NI_TARGET static void load_decrypt_keys(const AES_ctx *ctx, __m128i *dk)
+{
+	__m128i rk[AES_MAXROUNDS + 1];
+	int Nr = ctx->Nr;
+	int i;
+
+	load_encrypt_keys(ctx, rk);
+
+	dk[0] = rk[Nr];
+
+	for (i = 1; i < Nr; i++)
+		dk[i] = _mm_aesimc_si128(rk[Nr - i]);
+
+	dk[Nr] = rk[0];
+}
+
+AES_NI_TARGET static inline __m128i encrypt_block(const __m128i *rk, int Nr, __m128i b)
+{
+	int r;
+
+	b = _mm_xor_si128(b, rk[0]);
+
+	for (r = 1; r < Nr; r++)
+		b = _mm_aesenc_si128(b, rk[r]);
+
+	return _mm_aesenclast_si128(b, rk[Nr]);
+}
+
+AES_NI_TARGET static void cbc_encrypt(const AES_ctx *ctx, const u8 *src, u8 *dst, int size)
+{
+	__m128i rk[AES_MAXROUNDS + 1];
+	__m128i prev = _mm_setzero_si128();
+	int i;
+
+	load_encrypt_keys(ctx, rk);
+
+	for (i = 0; i < size; i += 16)
+	{
+		__m128i b = _mm_loadu_si128((const __m128i *)(src + i));
+		prev = encrypt_block(rk, ctx->Nr, _mm_xor_si128(b, prev));
+		_mm_storeu_si128((__m128i *)(dst + i), prev);
+	}
+}
+
+// blocks are independent when decrypting, four are decrypted at once to hide the latency
+AES_NI_TARGET static void cbc_decrypt(const AES_ctx *ctx, const u8 *src, u8 *dst, int size)
+{
+	__m128i dk[AES_MAXROUNDS + 1];
+	__m128i prev = _mm_setzero_si128();
+	int Nr = ctx->Nr;
+	int count;
+	int i = 0;
+	int r;
+
+	load_decrypt_keys(ctx, dk);
+
+	// like the table version, the first block is always decrypted
+	count = size <= 16 ? 1 : (size + 15) / 16;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128i *in = (const __m128i *)(src + 16*i);
+		__m128i c0 = _mm_loadu_si128(in + 0);
+		__m128i c1 = _mm_loadu_si128(in + 1);
+		__m128i c2 = _mm_loadu_si128(in + 2);
+		__m128i c3 = _mm_loadu_si128(in + 3);
+		__m128i b0 = _mm_xor_si128(c0, dk[0]);
+		__m128i b1 = _mm_xor_si128(c1, dk[0]);
+		__m128i b2 = _mm_xor_si128(c2, dk[0]);
+		__m128i b3 = _mm_xor_si128(c3, dk[0]);
+		__m128i *out = (__m128i *)(dst + 16*i);
+
+		for (r = 1; r < Nr; r++)
+		{
+			b0 = _mm_aesdec_si128(b0, dk[r]);
+			b1 = _mm_aesdec_si128(b1, dk[r]);
+			b2 = _mm_aesdec_si128(b2, dk[r]);
+			b3 = _mm_aesdec_si128(b3, dk[r]);
+		}
+
+		b0 = _mm_aesdeclast_si128(b0, dk[Nr]);
+		b1 = _mm_aesdeclast_si128(b1, dk[Nr]);
+		b2 = _mm_aesdeclast_si128(b2, dk[Nr]);
+		b3 = _mm_aesdeclast_si128(b3, dk[Nr]);
+
+		// src may be dst, all blocks are loaded before anything is stored
+		_mm_storeu_si128(out + 0, _mm_xor_si128(b0, prev));
+		_mm_storeu_si128(out + 1, _mm_xor_si128(b1, c0));
+		_mm_storeu_si128(out + 2, _mm_xor_si128(b2, c1));
+		_mm_storeu_si128(out + 3, _mm_xor_si128(b3, c2));
+		prev = c3;
+	}
+
+	for (; i < count; i++)
+	{
+		__m128i c = _mm_loadu_si128((const __m128i *)(src + 16*i));
+		__m128i b = _mm_xor_si128(c, dk[0]);
+
+		for (r = 1; r < Nr; r++)
+			b = _mm_aesdec_si128(b, dk[r]);
+
+		b = _mm_aesdeclast_si128(b, dk[Nr]);
+		_mm_storeu_si128((__m128i *)(dst + 16*i), _mm_xor_si128(b, prev));
+		prev = c;
+	}
+}
+
+AES_NI_TARGET static void cbc_mac(const AES_ctx *ctx, u8 *mac, const u8 *input, int blocks)
+{
+	__m128i rk[AES_MAXROUNDS + 1];
+	__m128i x = _mm_loadu_si128((const __m128i *)mac);
+	int i;
+
+	load_encrypt_keys(ctx, rk);
+
+	for (i = 0; i < blocks; i++)
+	{
+		__m128i m = _mm_loadu_si128((const __m128i *)(input + 16*i));
+		x = encrypt_block(rk, ctx->Nr, _mm_xor_si128(x, m));
+	}
+
+	_mm_storeu_si128((__m128i *)mac, x);
+}
+
+int AES_NI_cbc_encrypt(AES_ctx *ctx, const u8 *src, u8 *dst, int size)
+{
+	if (!use_aesni())
+		return 0;
+
+	cbc_encrypt(ctx, src, dst, size);
+	return 1;
+}
+
+int AES_NI_cbc_decrypt(AES_ctx *ctx, const u8 *src, u8 *dst, int size)
+{
+	if (!use_aesni())
+		return 0;
+
+	cbc_decrypt(ctx, src, dst, size);
+	return 1;
+}
+
+int AES_NI_cbc_mac(AES_ctx *ctx, u8 *mac, const u8 *input, int blocks)
+{
+	if (!use_aesni())
+		return 0;
+
+	cbc_mac(ctx, mac, input, blocks);
+	return 1;
+}
+
+#else // no AES-NI on this architecture
+
+int AES_aesni_supported(void)
+{
+	return 0;
+}
+
+void AES_set_aesni_enabled(int enabled)
+{
+	(void)enabled;
+}
+
+int AES_NI_cbc_encrypt(AES_ctx *ctx, const u8 *src, u8 *dst, int size)
+{
+	(void)ctx; (void)src; (void)dst; (void)size;
+	return 0;
+}
+
+int AES_NI_cbc_decrypt(AES_ctx *ctx, const u8 *src, u8 *dst, int size)
+{
+	(void)ctx; (void)src; (void)dst; (void)size;
+	return 0;
+}
+
+int AES_NI_cbc_mac(AES_ctx *ctx, u8 *mac, const u8 *input, int blocks)
+{
+	(void)ctx; (void)mac; (void)input; (void)blocks;
+	return 0;
+}
+
+#endif
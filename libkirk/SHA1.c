@@ -291,13 +291,25 @@ void SHAUpdate(SHA_CTX *shsInfo, BYTE *buffer, int count)
             return;
             }
         memcpy( p, buffer, dataCount );
-        longReverse( shsInfo->data, SHS_DATASIZE, shsInfo->Endianness);
-        SHSTransform( shsInfo->digest, shsInfo->data );
+        if( SHA_NI_enabled() )
+            SHA_NI_transform( shsInfo->digest, ( BYTE * ) shsInfo->data, 1 );
+        else
+            {
+            longReverse( shsInfo->data, SHS_DATASIZE, shsInfo->Endianness);
+            SHSTransform( shsInfo->digest, shsInfo->data );
+            }
         buffer += dataCount;
         count -= dataCount;
         }
 
     /* Process data in SHS_DATASIZE chunks */
+    if( count >= SHS_DATASIZE && SHA_NI_enabled() )
+        {
+        SHA_NI_transform( shsInfo->digest, buffer, count / SHS_DATASIZE );
+        buffer += count - count % SHS_DATASIZE;
+        count %= SHS_DATASIZE;
+        }
+
     while( count >= SHS_DATASIZE )
         {
         memcpy( (POINTER)shsInfo->data, (POINTER)buffer, SHS_DATASIZE );
@@ -336,8 +348,13 @@ void SHAFinal(BYTE *output, SHA_CTX *shsInfo)
         {
         /* Two lots of padding:  Pad the first block to 64 bytes */
         memset( dataPtr, 0, count );
-        longReverse( shsInfo->data, SHS_DATASIZE, shsInfo->Endianness );
-        SHSTransform( shsInfo->digest, shsInfo->data );
+        if( SHA_NI_enabled() )
+            SHA_NI_transform( shsInfo->digest, ( BYTE * ) shsInfo->data, 1 );
+        else
+            {
+            longReverse( shsInfo->data, SHS_DATASIZE, shsInfo->Endianness );
+            SHSTransform( shsInfo->digest, shsInfo->data );
+            }
 
         /* Now fill the next block with 56 bytes */
         memset( (POINTER)shsInfo->data, 0, SHS_DATASIZE - 8 );
@@ -347,11 +364,23 @@ void SHAFinal(BYTE *output, SHA_CTX *shsInfo)
         memset( dataPtr, 0, count - 8 );
 
     /* Append length in bits and transform */
-    shsInfo->data[ 14 ] = shsInfo->countHi;
-    shsInfo->data[ 15 ] = shsInfo->countLo;
+    if( SHA_NI_enabled() )
+        {
+        /* SHA-NI takes the block as bytes, so the length is stored MSB-first */
+        UINT4 bitCount[ 2 ];
+        bitCount[ 0 ] = shsInfo->countHi;
+        bitCount[ 1 ] = shsInfo->countLo;
+        SHAtoByte( ( BYTE * ) shsInfo->data + SHS_DATASIZE - 8, bitCount, 8 );
+        SHA_NI_transform( shsInfo->digest, ( BYTE * ) shsInfo->data, 1 );
+        }
+    else
+        {
+        shsInfo->data[ 14 ] = shsInfo->countHi;
+        shsInfo->data[ 15 ] = shsInfo->countLo;
 
-    longReverse( shsInfo->data, SHS_DATASIZE - 8, shsInfo->Endianness );
-    SHSTransform( shsInfo->digest, shsInfo->data );
+        longReverse( shsInfo->data, SHS_DATASIZE - 8, shsInfo->Endianness );
+        SHSTransform( shsInfo->digest, shsInfo->data );
+        }
 
 	/* Output to an array of bytes */
 	SHAtoByte(output, shsInfo->digest, SHS_DIGESTSIZE);
@@ -40,6 +40,28 @@ void SHAInit(SHA_CTX *);
 void SHAUpdate(SHA_CTX *, BYTE *buffer, int count);
 void SHAFinal(BYTE *output, SHA_CTX *);
 
+/* SHA-NI and AVX2 (SHA1_NI.c)
+   SHAUpdate and SHAFinal use SHA-NI if the CPU supports it.
+   SHA_set_acceleration limits what the calling thread may use, e.g.
+   SHA_ACCELERATION_NONE for the C code only. */
+#define SHA_ACCELERATION_NONE  0
+#define SHA_ACCELERATION_SHANI 1
+#define SHA_ACCELERATION_AVX2  2
+#define SHA_ACCELERATION_ALL   (SHA_ACCELERATION_SHANI | SHA_ACCELERATION_AVX2)
+
+int SHA_shani_supported(void);
+int SHA_avx2_supported(void);
+void SHA_set_acceleration(int flags);
+
+int SHA_NI_enabled(void);
+void SHA_NI_transform(UINT4 *digest, const BYTE *data, int blocks);
+
+/* hashes count independent messages of counts[i] bytes, writing 20 byte
+   digests to outputs. Without SHA-NI but with AVX2, SHA_MULTI_LANES messages
+   are hashed at once. SHA-NI on one message at a time is as fast. */
+#define SHA_MULTI_LANES 8
+void SHAMulti(BYTE **inputs, const int *counts, int count, BYTE *outputs);
+
 #endif /* end _SHA_H_ */
 
 /* endian.h */
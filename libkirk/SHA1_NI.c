@@ -0,0 +1,533 @@
+/*
+	Hardware accelerated SHA-1 for SHA1.c.
+
+	SHA_NI_transform hashes whole 64 byte blocks with the x86 SHA extensions.
+	SHAUpdate and SHAFinal use it if CPUID reports SHA-NI and it was not
+	disabled on the calling thread with SHA_set_acceleration.
+
+	SHAMulti hashes independent messages, e.g. the headers of many modules.
+	On CPUs with AVX2 but without SHA-NI it hashes SHA_MULTI_LANES messages at
+	a time in the 32 bit lanes of AVX2 registers. Messages of different
+	lengths are fine, lanes that are done keep their state.
+	Otherwise it hashes one message after the other with SHAInit, SHAUpdate
+	and SHAFinal, which is about as fast as AVX2 when SHA-NI is used.
+*/
+
+#include <string.h>
+
+#include "kirk_engine.h"
+#include "SHA1.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define SHA_NI_TARGET
+#define SHA_AVX2_TARGET
+#else
+#include <cpuid.h>
+#define SHA_NI_TARGET __attribute__((target("sha,sse4.1,ssse3")))
+#define SHA_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+#include <immintrin.h>
+
+static void cpuid(unsigned int leaf, unsigned int *regs)
+{
+#if defined(_MSC_VER)
+	__cpuidex((int *)regs, (int)leaf, 0);
+#else
+	__cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static int cpu_has_shani(void)
+{
+	unsigned int regs[4];
+
+	cpuid(0, regs);
+
+	if (regs[0] < 7)
+		return 0;
+
+	cpuid(1, regs);
+
+	// SSSE3, SSE4.1
+	if (!((regs[2] >> 9) & 1) || !((regs[2] >> 19) & 1))
+		return 0;
+
+	cpuid(7, regs);
+	return (regs[1] >> 29) & 1;
+}
+
+static unsigned long long xgetbv0(void)
+{
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	unsigned int eax, edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+
+static int cpu_has_avx2(void)
+{
+	unsigned int regs[4];
+
+	cpuid(0, regs);
+
+	if (regs[0] < 7)
+		return 0;
+
+	cpuid(1, regs);
+
+	// OSXSAVE and AVX, then check that the OS saves the YMM registers
+	if (!((regs[2] >> 27) & 1) || !((regs[2] >> 28) & 1))
+		return 0;
+
+	if ((xgetbv0() & 6) != 6)
+		return 0;
+
+	cpuid(7, regs);
+	return (regs[1] >> 5) & 1;
+}
+
+static KIRK_THREAD_LOCAL int shani_supported = -1; // -1 = not checked yet
+static KIRK_THREAD_LOCAL int avx2_supported = -1;
+static KIRK_THREAD_LOCAL int acceleration = SHA_ACCELERATION_ALL;
+
+int SHA_shani_supported(void)
+{
+	if (shani_supported < 0)
+		shani_supported = cpu_has_shani();
+
+	return shani_supported;
+}
+
+int SHA_avx2_supported(void)
+{
+	if (avx2_supported < 0)
+		avx2_supported = cpu_has_avx2();
+
+	return avx2_supported;
+}
+
+void SHA_set_acceleration(int flags)
+{
+	acceleration = flags;
+}
+
+int SHA_NI_enabled(void)
+{
+	return (acceleration & SHA_ACCELERATION_SHANI) && SHA_shani_supported();
+}
+
+static int use_avx2(void)
+{
+	return (acceleration & SHA_ACCELERATION_AVX2) && SHA_avx2_supported();
+}
+
+/* ------------------------- SHA-NI ------------------------- */
+
+SHA_NI_TARGET void SHA_NI_transform(UINT4 *digest, const BYTE *data, int blocks)
+{
+	// reverses the bytes of the block, W0 ends up in the highest lane as sha1rnds4 wants it
+	const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+	__m128i ABCD, ABCD_SAVE, E0, E0_SAVE, E1;
+	__m128i MSG0, MSG1, MSG2, MSG3;
+
+	ABCD = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)digest), 0x1B);
+	E0 = _mm_set_epi32((int)digest[4], 0, 0, 0);
+
+	for (; blocks > 0; blocks--, data += 64)
+	{
+		ABCD_SAVE = ABCD;
+		E0_SAVE = E0;
+
+		/* rounds 0-3 */
+		MSG0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 0)), mask);
+		E0 = _mm_add_epi32(E0, MSG0);
+		E1 = ABCD;
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 0);
+
+		/* rounds 4-7 */
+		MSG1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16)), mask);
+		E1 = _mm_sha1nexte_epu32(E1, MSG1);
+		E0 = ABCD;
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 0);
+		MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+
+		/* rounds 8-11 */
+		MSG2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 32)), mask);
+		E0 = _mm_sha1nexte_epu32(E0, MSG2);
+		E1 = ABCD;
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 0);
+		MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+		MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+		/* rounds 12-15 */
+		MSG3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 48)), mask);
+		E1 = _mm_sha1nexte_epu32(E1, MSG3);
+		E0 = ABCD;
+		MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 0);
+		MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+		MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+		/* rounds 16-19 */
+		E0 = _mm_sha1nexte_epu32(E0, MSG0);
+		E1 = ABCD;
+		MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 0);
+		MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+		MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+		/* rounds 20-23 */
+		E1 = _mm_sha1nexte_epu32(E1, MSG1);
+		E0 = ABCD;
+		MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 1);
+		MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+		MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+		/* rounds 24-27 */
+		E0 = _mm_sha1nexte_epu32(E0, MSG2);
+		E1 = ABCD;
+		MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 1);
+		MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+		MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+		/* rounds 28-31 */
+		E1 = _mm_sha1nexte_epu32(E1, MSG3);
+		E0 = ABCD;
+		MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 1);
+		MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+		MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+		/* rounds 32-35 */
+		E0 = _mm_sha1nexte_epu32(E0, MSG0);
+		E1 = ABCD;
+		MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 1);
+		MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+		MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+		/* rounds 36-39 */
+		E1 = _mm_sha1nexte_epu32(E1, MSG1);
+		E0 = ABCD;
+		MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 1);
+		MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+		MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+		/* rounds 40-43 */
+		E0 = _mm_sha1nexte_epu32(E0, MSG2);
+		E1 = ABCD;
+		MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 2);
+		MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+		MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+		/* rounds 44-47 */
+		E1 = _mm_sha1nexte_epu32(E1, MSG3);
+		E0 = ABCD;
+		MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 2);
+		MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+		MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+		/* rounds 48-51 */
+		E0 = _mm_sha1nexte_epu32(E0, MSG0);
+		E1 = ABCD;
+		MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 2);
+		MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+		MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+		/* rounds 52-55 */
+		E1 = _mm_sha1nexte_epu32(E1, MSG1);
+		E0 = ABCD;
+		MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 2);
+		MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+		MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+		/* rounds 56-59 */
+		E0 = _mm_sha1nexte_epu32(E0, MSG2);
+		E1 = ABCD;
+		MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 2);
+		MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+		MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+		/* rounds 60-63 */
+		E1 = _mm_sha1nexte_epu32(E1, MSG3);
+		E0 = ABCD;
+		MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 3);
+		MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+		MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+		/* rounds 64-67 */
+		E0 = _mm_sha1nexte_epu32(E0, MSG0);
+		E1 = ABCD;
+		MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 3);
+		MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+		MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+		/* rounds 68-71 */
+		E1 = _mm_sha1nexte_epu32(E1, MSG1);
+		E0 = ABCD;
+		MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 3);
+		MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+		/* rounds 72-75 */
+		E0 = _mm_sha1nexte_epu32(E0, MSG2);
+		E1 = ABCD;
+		MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 3);
+
+		/* rounds 76-79 */
+		E1 = _mm_sha1nexte_epu32(E1, MSG3);
+		E0 = ABCD;
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 3);
+
+		E0 = _mm_sha1nexte_epu32(E0, E0_SAVE);
+		ABCD = _mm_add_epi32(ABCD, ABCD_SAVE);
+	}
+
+	_mm_storeu_si128((__m128i *)digest, _mm_shuffle_epi32(ABCD, 0x1B));
+	digest[4] = (UINT4)_mm_extract_epi32(E0, 3);
+}
+
+/* ------------------------- AVX2 multi-buffer ------------------------- */
+
+#define ROTL256(x, n) _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - (n)))
+
+// r[i] = word 0-7 of lane i -> r[i] = word i of lanes 0-7
+SHA_AVX2_TARGET static void transpose8(__m256i *r)
+{
+	__m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+	__m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+	__m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+	__m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+	__m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+	__m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+	__m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+	__m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+
+	__m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+	__m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+	__m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+	__m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+	__m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+	__m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+	__m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+	__m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+	r[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+	r[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+	r[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+	r[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+	r[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+	r[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+	r[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+	r[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+#define MB_F1(x, y, z) _mm256_xor_si256(z, _mm256_and_si256(x, _mm256_xor_si256(y, z)))
+#define MB_F2(x, y, z) _mm256_xor_si256(x, _mm256_xor_si256(y, z))
+#define MB_F3(x, y, z) _mm256_or_si256(_mm256_and_si256(x, y), _mm256_and_si256(z, _mm256_or_si256(x, y)))
+#define MB_F4 MB_F2
+
+#define MB_ROUNDS(FIRST, LAST, F, K) \
+	for (t = FIRST; t <= LAST; t++) \
+	{ \
+		if (t >= 16) \
+			W[t & 15] = ROTL256(_mm256_xor_si256(_mm256_xor_si256(W[(t - 3) & 15], W[(t - 8) & 15]), \
+			                                     _mm256_xor_si256(W[(t - 14) & 15], W[t & 15])), 1); \
+		tmp = _mm256_add_epi32(_mm256_add_epi32(ROTL256(a, 5), F(b, c, d)), \
+		                       _mm256_add_epi32(_mm256_add_epi32(e, W[t & 15]), _mm256_set1_epi32((int)K))); \
+		e = d; \
+		d = c; \
+		c = ROTL256(b, 30); \
+		b = a; \
+		a = tmp; \
+	}
+
+SHA_AVX2_TARGET static void sha1_multi_avx2(BYTE **inputs, const int *counts, int lanes, BYTE *outputs)
+{
+	static const BYTE zero_block[64] = {0};
+	const __m256i byteswap = _mm256_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+	                                         12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+	BYTE tails[SHA_MULTI_LANES][128];
+	int full_blocks[SHA_MULTI_LANES];
+	int blocks[SHA_MULTI_LANES];
+	UINT4 digests[5][SHA_MULTI_LANES];
+	int max_blocks = 0;
+	int lane, block, i, t;
+
+	__m256i h[5];
+	__m256i W[16];
+	__m256i a, b, c, d, e, tmp, active, block_counts;
+
+	// the padded last one or two blocks of every lane
+	for (lane = 0; lane < SHA_MULTI_LANES; lane++)
+	{
+		int size = lane < lanes ? counts[lane] : 0;
+		int rest = size % 64;
+		unsigned long long bits = (unsigned long long)size * 8;
+		int tail_size = rest + 9 <= 64 ? 64 : 128;
+
+		full_blocks[lane] = size / 64;
+		blocks[lane] = lane < lanes ? full_blocks[lane] + tail_size / 64 : 0;
+
+		memset(tails[lane], 0, sizeof(tails[lane]));
+
+		if (rest > 0)
+			memcpy(tails[lane], inputs[lane] + size - rest, rest);
+
+		tails[lane][rest] = 0x80;
+
+		for (i = 0; i < 8; i++)
+			tails[lane][tail_size - 1 - i] = (BYTE)(bits >> (8 * i));
+
+		if (blocks[lane] > max_blocks)
+			max_blocks = blocks[lane];
+	}
+
+	h[0] = _mm256_set1_epi32(0x67452301);
+	h[1] = _mm256_set1_epi32((int)0xEFCDAB89);
+	h[2] = _mm256_set1_epi32((int)0x98BADCFE);
+	h[3] = _mm256_set1_epi32(0x10325476);
+	h[4] = _mm256_set1_epi32((int)0xC3D2E1F0);
+
+	block_counts = _mm256_loadu_si256((const __m256i *)blocks);
+
+	for (block = 0; block < max_blocks; block++)
+	{
+		for (lane = 0; lane < SHA_MULTI_LANES; lane++)
+		{
+			const BYTE *data;
+
+			if (block < full_blocks[lane])
+				data = inputs[lane] + 64 * block;
+			else if (block < blocks[lane])
+				data = tails[lane] + 64 * (block - full_blocks[lane]);
+			else
+				data = zero_block;
+
+			W[lane] = _mm256_loadu_si256((const __m256i *)data);
+			W[lane + 8] = _mm256_loadu_si256((const __m256i *)(data + 32));
+		}
+
+		transpose8(W);
+		transpose8(W + 8);
+
+		for (i = 0; i < 16; i++)
+			W[i] = _mm256_shuffle_epi8(W[i], byteswap);
+
+		a = h[0];
+		b = h[1];
+		c = h[2];
+		d = h[3];
+		e = h[4];
+
+		MB_ROUNDS( 0, 19, MB_F1, 0x5A827999)
+		MB_ROUNDS(20, 39, MB_F2, 0x6ED9EBA1)
+		MB_ROUNDS(40, 59, MB_F3, 0x8F1BBCDC)
+		MB_ROUNDS(60, 79, MB_F4, 0xCA62C1D6)
+
+		// lanes without this block keep their digest
+		active = _mm256_cmpgt_epi32(block_counts, _mm256_set1_epi32(block));
+		h[0] = _mm256_blendv_epi8(h[0], _mm256_add_epi32(h[0], a), active);
+		h[1] = _mm256_blendv_epi8(h[1], _mm256_add_epi32(h[1], b), active);
+		h[2] = _mm256_blendv_epi8(h[2], _mm256_add_epi32(h[2], c), active);
+		h[3] = _mm256_blendv_epi8(h[3], _mm256_add_epi32(h[3], d), active);
+		h[4] = _mm256_blendv_epi8(h[4], _mm256_add_epi32(h[4], e), active);
+	}
+
+	for (i = 0; i < 5; i++)
+		_mm256_storeu_si256((__m256i *)digests[i], h[i]);
+
+	for (lane = 0; lane < lanes; lane++)
+	{
+		BYTE *out = outputs + 20 * lane;
+
+		for (i = 0; i < 5; i++)
+		{
+			out[4*i + 0] = (BYTE)(digests[i][lane] >> 24);
+			out[4*i + 1] = (BYTE)(digests[i][lane] >> 16);
+			out[4*i + 2] = (BYTE)(digests[i][lane] >> 8);
+			out[4*i + 3] = (BYTE)(digests[i][lane]);
+		}
+	}
+}
+
+#else // no SHA-NI or AVX2 on this architecture
+
+int SHA_shani_supported(void)
+{
+	return 0;
+}
+
+int SHA_avx2_supported(void)
+{
+	return 0;
+}
+
+void SHA_set_acceleration(int flags)
+{
+	(void)flags;
+}
+
+int SHA_NI_enabled(void)
+{
+	return 0;
+}
+
+void SHA_NI_transform(UINT4 *digest, const BYTE *data, int blocks)
+{
+	(void)digest; (void)data; (void)blocks;
+}
+
+static int use_avx2(void)
+{
+	return 0;
+}
+
+static void sha1_multi_avx2(BYTE **inputs, const int *counts, int lanes, BYTE *outputs)
+{
+	(void)inputs; (void)counts; (void)lanes; (void)outputs;
+}
+
+#endif
+
+void SHAMulti(BYTE **inputs, const int *counts, int count, BYTE *outputs)
+{
+	int i;
+
+	if (use_avx2() && !SHA_NI_enabled())
+	{
+		for (i = 0; i < count; i += SHA_MULTI_LANES)
+		{
+			int lanes = count - i < SHA_MULTI_LANES ? count - i : SHA_MULTI_LANES;
+			sha1_multi_avx2(inputs + i, counts + i, lanes, outputs + 20 * i);
+		}
+
+		return;
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		SHA_CTX ctx;
+		SHAInit(&ctx);
+		SHAUpdate(&ctx, inputs[i], counts[i]);
+		SHAFinal(outputs + 20 * i, &ctx);
+	}
+}
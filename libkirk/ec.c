@@ -18,13 +18,14 @@ struct point {
 };
 // Simplified for use by Kirk Engine since it has only 1 curve
 
-u8 ec_p[20];
-u8 ec_a[20];
-u8 ec_b[20];
-u8 ec_N[21];
-struct point ec_G;  // mon
-struct point ec_Q;  // mon
-u8 ec_k[21];
+// set by ecdsa_set_curve / ecdsa_set_pub etc., per thread
+KIRK_THREAD_LOCAL u8 ec_p[20];
+KIRK_THREAD_LOCAL u8 ec_a[20];
+KIRK_THREAD_LOCAL u8 ec_b[20];
+KIRK_THREAD_LOCAL u8 ec_N[21];
+KIRK_THREAD_LOCAL struct point ec_G;  // mon
+KIRK_THREAD_LOCAL struct point ec_Q;  // mon
+KIRK_THREAD_LOCAL u8 ec_k[21];
 
 
 
@@ -207,13 +207,13 @@ typedef struct header_keys
 }header_keys;  //small struct for temporary keeping AES & CMAC key from CMD1 header
 
 
-u32 g_fuse90;  // This is to match FuseID HW at BC100090 and BC100094
-u32 g_fuse94;
+KIRK_THREAD_LOCAL u32 g_fuse90;  // This is to match FuseID HW at BC100090 and BC100094
+KIRK_THREAD_LOCAL u32 g_fuse94;
 
-AES_ctx aes_kirk1; //global
-u8 PRNG_DATA[0x14];
+KIRK_THREAD_LOCAL AES_ctx aes_kirk1; //per thread
+KIRK_THREAD_LOCAL u8 PRNG_DATA[0x14];
 
-char is_kirk_initialized; //"init" emulation
+KIRK_THREAD_LOCAL char is_kirk_initialized; //"init" emulation
 
 /* ------------------------- INTERNAL STUFF END ------------------------- */
 
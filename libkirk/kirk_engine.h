@@ -30,6 +30,16 @@ typedef unsigned char u8;
 typedef unsigned short int u16;
 typedef unsigned int u32;
 
+// The engine state (KIRK1 key, PRNG data, fuse ID, ECDSA curve) is kept per
+// thread, so kirk_init has to be called on every thread that uses the engine.
+#if defined(__cplusplus)
+#define KIRK_THREAD_LOCAL thread_local
+#elif defined(_MSC_VER)
+#define KIRK_THREAD_LOCAL __declspec(thread)
+#else
+#define KIRK_THREAD_LOCAL _Thread_local
+#endif
+
 //Kirk return values
 #define KIRK_OPERATION_SUCCESS 0
 #define KIRK_NOT_ENABLED 1
@@ -1,17 +1,27 @@
 
 #include <assert.h>
+#include <string.h>
 
 #include "shl/print.hpp"
 #include "allegrex/instruction.hpp"
 #include "psp-elfdump/asm_formatter.hpp"
 
+#define MNEMONIC_WIDTH 10
+
 // asm-specific formatting functions
-static inline void _asm_fmt_comment_pos_addr_instr(file_stream *out, u32 pos, const instruction *inst, const char *format_string)
+// e.g. /* 0025b4 08804000 27bdffd0 */
+static inline void _asm_fmt_comment_pos_addr_instr(output_buffer *out, u32 pos, const instruction *inst, u32 pos_digits)
 {
-    tprint(out->handle, format_string, pos, inst->address, inst->opcode);
+    append(out, "/* ", 3);
+    append_hex(out, pos, pos_digits);
+    append(out, ' ');
+    append_hex(out, inst->address, 8);
+    append(out, ' ');
+    append_hex(out, inst->opcode, 8);
+    append(out, " */  ", 5);
 }
 
-static void _format_name(file_stream *out, const instruction *inst)
+static void _format_name(output_buffer *out, const instruction *inst)
 {
     const char *name = get_mnemonic_name(inst->mnemonic);
 
@@ -19,15 +29,28 @@ static void _format_name(file_stream *out, const instruction *inst)
     {
         vfpu_size sz = get_vfpu_size(inst->opcode);
         const char *suf = size_suffix(sz);
-        auto fullname = tformat("%%"_cs, name, suf);
+        u32 len = (u32)strlen(name);
+
+        append(out, name, len);
+        append_padded(out, suf, len < MNEMONIC_WIDTH ? MNEMONIC_WIDTH - len : 0);
+    }
+    else
+        append_padded(out, name, MNEMONIC_WIDTH);
+}
 
-        tprint(out->handle, "%-10s", fullname);
+// "%#x", or "-%#x" if negative
+static inline void _format_signed_hex(output_buffer *out, s32 x)
+{
+    if (x < 0)
+    {
+        append(out, '-');
+        append_hex_prefixed(out, (u32)0 - (u32)x);
     }
     else
-        tprint(out->handle, "%-10s", name);
+        append_hex_prefixed(out, (u32)x);
 }
 
-static void _asm_format_section(const dump_config *conf, const dump_section *dsec, file_stream *out)
+static void _asm_format_section(const dump_config *conf, const dump_section *dsec, output_buffer *out)
 {
     assert(dsec != nullptr);
 
@@ -48,15 +71,13 @@ static void _asm_format_section(const dump_config *conf, const dump_section *dse
     auto f_branch_label = fmt_branch_label;
 
     // prepare
-    char comment_format_string[32] = R"(/* %0Xx %08x %08x */  )";
+    u32 pos_digits = 0;
 
     if (is_flag_set(conf->format, mips_format_options::comment_pos_addr_instr))
     {
-        // prepare format string for comment
+        // number of digits of the position in the comment
         u32 max_instruction_offset = dsec->first_instruction_offset + (u32)dsec->instruction_count * sizeof(u32);
-        u32 pos_digits = hex_digits(max_instruction_offset);
-
-        to_string(comment_format_string + 5, 2, pos_digits);
+        pos_digits = hex_digits(max_instruction_offset);
     }
     else
     {
@@ -97,16 +118,30 @@ static void _asm_format_section(const dump_config *conf, const dump_section *dse
             ++jmp_i;
     }
 
+    compact_instruction_iterator compact_it{};
+
+    if (dsec->compact != nullptr)
+        compact_it = iterate_instructions(dsec->compact, dsec->instruction_start_index, dsec->instruction_count);
+
     // do the writing
-    tprint(out->handle, "\n\n/* Disassembly of section %s */\n", sec->name);
+    append(out, "\n\n/* Disassembly of section ");
+    append(out, sec->name);
+    append(out, " */\n");
 
     for (s32 instr_i = 0; instr_i < dsec->instruction_count; ++instr_i)
     {
         instruction *inst = dsec->instructions + instr_i;
+
+        if (dsec->compact != nullptr)
+        {
+            next(&compact_it);
+            inst = &compact_it.current;
+        }
+
         bool write_label = (jmp_i < jump_count) && (jumps[jmp_i].address <= inst->address);
 
         if (write_label)
-            put(out->handle, "\n");
+            append(out, '\n');
 
         while (write_label)
         {
@@ -128,7 +163,7 @@ static void _asm_format_section(const dump_config *conf, const dump_section *dse
         }
 
         if (f_comment_pos_addr_instr != nullptr)
-            f_comment_pos_addr_instr(out, pos, inst, comment_format_string);
+            f_comment_pos_addr_instr(out, pos, inst, pos_digits);
 
         _format_name(out, inst);
 
@@ -146,7 +181,7 @@ static void _asm_format_section(const dump_config *conf, const dump_section *dse
             switch (arg_type)
             {
             case argument_type::Invalid:
-                tprint(out->handle, "[?invalid?]");
+                append(out, "[?invalid?]");
                 break;
 
             case argument_type::MIPS_Register:
@@ -162,77 +197,96 @@ static void _asm_format_section(const dump_config *conf, const dump_section *dse
                 break;
 
             case argument_type::VFPU_Matrix:
-                tprint(out->handle, "%s%s", matrix_name(arg->vfpu_matrix)
-                                  , size_suffix(arg->vfpu_matrix.size));
+                append(out, matrix_name(arg->vfpu_matrix));
+                append(out, size_suffix(arg->vfpu_matrix.size));
                 break;
 
             case argument_type::VFPU_Condition:
-                tprint(out->handle, "%s", vfpu_condition_name(arg->vfpu_condition));
+                append(out, vfpu_condition_name(arg->vfpu_condition));
                 break;
 
             case argument_type::VFPU_Constant:
-                tprint(out->handle, "%s", vfpu_constant_name(arg->vfpu_constant));
+                append(out, vfpu_constant_name(arg->vfpu_constant));
                 break;
 
             case argument_type::VFPU_Prefix_Array:
             {
                 vfpu_prefix_array *arr = &arg->vfpu_prefix_array;
-                tprint(out->handle, "[%s,%s,%s,%s]", vfpu_prefix_name(arr->data[0])
-                                           , vfpu_prefix_name(arr->data[1])
-                                           , vfpu_prefix_name(arr->data[2])
-                                           , vfpu_prefix_name(arr->data[3])
-                );
+                append(out, '[');
+                append(out, vfpu_prefix_name(arr->data[0]));
+                append(out, ',');
+                append(out, vfpu_prefix_name(arr->data[1]));
+                append(out, ',');
+                append(out, vfpu_prefix_name(arr->data[2]));
+                append(out, ',');
+                append(out, vfpu_prefix_name(arr->data[3]));
+                append(out, ']');
                 break;
             }
 
             case argument_type::VFPU_Destination_Prefix_Array:
             {
                 vfpu_destination_prefix_array *arr = &arg->vfpu_destination_prefix_array;
-                tprint(out->handle, "[%s,%s,%s,%s]", vfpu_destination_prefix_name(arr->data[0])
-                                           , vfpu_destination_prefix_name(arr->data[1])
-                                           , vfpu_destination_prefix_name(arr->data[2])
-                                           , vfpu_destination_prefix_name(arr->data[3])
-                );
+                append(out, '[');
+                append(out, vfpu_destination_prefix_name(arr->data[0]));
+                append(out, ',');
+                append(out, vfpu_destination_prefix_name(arr->data[1]));
+                append(out, ',');
+                append(out, vfpu_destination_prefix_name(arr->data[2]));
+                append(out, ',');
+                append(out, vfpu_destination_prefix_name(arr->data[3]));
+                append(out, ']');
                 break;
             }
 
             case argument_type::VFPU_Rotation_Array:
             {
                 vfpu_rotation_array *arr = &arg->vfpu_rotation_array;
-                tprint(out->handle, "[%s", vfpu_rotation_name(arr->data[0]));
+                append(out, '[');
+                append(out, vfpu_rotation_name(arr->data[0]));
 
                 for (u32 j = 1; j < arr->size; ++j)
-                    tprint(out->handle, ",%s", vfpu_rotation_name(arr->data[j]));
+                {
+                    append(out, ',');
+                    append(out, vfpu_rotation_name(arr->data[j]));
+                }
 
-                tprint(out->handle, "]");
+                append(out, ']');
                 break;
             }
 
             case argument_type::PSP_Function_Pointer:
             {
                 const psp_function *sc = arg->psp_function_pointer;
-                tprint(out->handle, "%s <0x%08x>", sc->name, sc->nid);
+                append(out, sc->name);
+                append(out, " <0x", 4);
+                append_hex(out, sc->nid, 8);
+                append(out, '>');
                 break;
             }
 
-#define ARG_TYPE_FORMAT(out, arg, ArgumentType, UnionMember, FMT) \
+#define ARG_TYPE_FORMAT_HEX(out, arg, ArgumentType, UnionMember) \
     case argument_type::ArgumentType: \
-        tprint(out->handle, FMT, arg->UnionMember.data);\
+        append_hex_prefixed(out, (u32)arg->UnionMember.data);\
         break;
 
-            ARG_TYPE_FORMAT(out, arg, Shift, shift, "%#x");
+            ARG_TYPE_FORMAT_HEX(out, arg, Shift, shift);
 
             case argument_type::Coprocessor_Register:
             {
                 coprocessor_register *reg = &arg->coprocessor_register;
-                tprint(out->handle, "[%u, %u]", reg->rd, reg->sel);
+                append(out, '[');
+                append_decimal(out, reg->rd);
+                append(out, ", ", 2);
+                append_decimal(out, reg->sel);
+                append(out, ']');
                 break;
             }
 
             case argument_type::Base_Register:
-                write(out, "(");
+                append(out, '(');
                 f_mips_register_name(out, arg->base_register.data);
-                write(out, ")");
+                append(out, ')');
                 break;
 
             case argument_type::Jump_Address:
@@ -244,41 +298,37 @@ static void _asm_format_section(const dump_config *conf, const dump_section *dse
                 break;
 
             case argument_type::Memory_Offset:
-                tprint(out->handle, "%#x", (u32)arg->memory_offset.data);
+                append_hex_prefixed(out, (u32)arg->memory_offset.data);
                 break;
-            ARG_TYPE_FORMAT(out, arg, Immediate_u32, immediate_u32, "%#x");
+            ARG_TYPE_FORMAT_HEX(out, arg, Immediate_u32, immediate_u32);
             case argument_type::Immediate_s32:
-            {
-                s32 d = arg->immediate_s32.data;
-
-                if (d < 0)
-                    tprint(out->handle, "-%#x", -d);
-                else
-                    tprint(out->handle, "%#x", d);
-
+                _format_signed_hex(out, arg->immediate_s32.data);
                 break;
-            }
 
-            ARG_TYPE_FORMAT(out, arg, Immediate_u16, immediate_u16, "%#x");
+            ARG_TYPE_FORMAT_HEX(out, arg, Immediate_u16, immediate_u16);
             case argument_type::Immediate_s16:
-            {
-                s16 d = arg->immediate_s16.data;
+                _format_signed_hex(out, arg->immediate_s16.data);
+                break;
 
-                if (d < 0)
-                    tprint(out->handle, "-%#x", -d);
-                else
-                    tprint(out->handle, "%#x", d);
+            ARG_TYPE_FORMAT_HEX(out, arg, Immediate_u8,  immediate_u8);
 
+            case argument_type::Immediate_float:
+                // rare enough to not need a hand-written float formatter
+                append(out, tformat("%f"_cs, arg->immediate_float.data));
+                break;
+
+            case argument_type::Condition_Code:
+                append(out, "(CC[", 4);
+                append_hex_prefixed(out, arg->condition_code.data);
+                append(out, "])", 2);
                 break;
-            }
 
-            ARG_TYPE_FORMAT(out, arg, Immediate_u8,  immediate_u8,  "%#x");
-            ARG_TYPE_FORMAT(out, arg, Immediate_float, immediate_float, "%f");
-            ARG_TYPE_FORMAT(out, arg, Condition_Code, condition_code, "(CC[%#x])");
-            ARG_TYPE_FORMAT(out, arg, Bitfield_Pos, bitfield_pos, "%#x");
-            ARG_TYPE_FORMAT(out, arg, Bitfield_Size, bitfield_size, "%#x");
+            ARG_TYPE_FORMAT_HEX(out, arg, Bitfield_Pos, bitfield_pos);
+            ARG_TYPE_FORMAT_HEX(out, arg, Bitfield_Size, bitfield_size);
 
-            ARG_TYPE_FORMAT(out, arg, String, string_argument, "%s");
+            case argument_type::String:
+                append(out, arg->string_argument.data);
+                break;
 
             case argument_type::Extra:
             case argument_type::MAX:
@@ -288,7 +338,7 @@ static void _asm_format_section(const dump_config *conf, const dump_section *dse
         }
         
         // end
-        put(out->handle, "\n");
+        append(out, '\n');
         pos += sizeof(u32);
     }
 }
@@ -298,6 +348,20 @@ void asm_format(const dump_config *conf, file_stream *out)
     assert(conf != nullptr);
     assert(out != nullptr);
 
+    output_buffer buf;
+    init(&buf, out);
+
+    asm_format(conf, &buf);
+
+    flush(&buf);
+    free(&buf);
+}
+
+void asm_format(const dump_config *conf, output_buffer *out)
+{
+    assert(conf != nullptr);
+    assert(out != nullptr);
+
     for_array(dsec, &conf->dump_sections)
         _asm_format_section(conf, dsec, out);
 }
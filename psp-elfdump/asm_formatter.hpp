@@ -3,3 +3,6 @@
 
 void asm_format(const dump_config *conf, file_stream *out);
 
+// writes to out, does not flush it
+void asm_format(const dump_config *conf, output_buffer *out);
+
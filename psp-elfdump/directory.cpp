@@ -0,0 +1,197 @@
+#include <string.h>
+
+#include "shl/array.hpp"
+#include "shl/defer.hpp"
+#include "shl/memory.hpp"
+#include "shl/platform.hpp"
+
+#include "psp-elfdump/directory.hpp"
+
+#if Windows
+#include <windows.h>
+#else
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+typedef void (*on_file_function)(const char *path, u64 relative_offset, void *userdata);
+
+bool is_directory(const char *path)
+{
+#if Windows
+    DWORD attributes = GetFileAttributesA(path);
+
+    return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+#else
+    struct stat st;
+
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+#endif
+}
+
+static bool _create_directory(const char *path, error *err)
+{
+#if Windows
+    if (!CreateDirectoryA(path, nullptr))
+    {
+        DWORD code = GetLastError();
+
+        if (code != ERROR_ALREADY_EXISTS)
+        {
+            format_error(err, (int)code, "could not create directory %s: error %u", path, (u32)code);
+            return false;
+        }
+    }
+#else
+    if (mkdir(path, 0755) == -1 && errno != EEXIST)
+    {
+        format_error(err, errno, "could not create directory %s: %s", path, strerror(errno));
+        return false;
+    }
+#endif
+
+    return true;
+}
+
+bool create_directories(const char *path, error *err)
+{
+    u64 size = strlen(path);
+
+    array<char> parent{};
+    ::init(&parent);
+    ::resize(&parent, size + 1);
+    defer { ::free(&parent); };
+
+    copy_memory(path, parent.data, size + 1);
+
+    // every parent and then path itself, starting at 1 so "/" is not created
+    for (u64 i = 1; i <= size; ++i)
+    {
+        if (i < size && parent[i] != '/' && parent[i] != '\\')
+            continue;
+
+        char c = parent[i];
+        parent[i] = '\0';
+
+        bool ok = is_directory(parent.data) || _create_directory(parent.data, err);
+        parent[i] = c;
+
+        if (!ok)
+            return false;
+    }
+
+    return true;
+}
+
+// sets path to the first dir_size characters of path, a separator and name
+static void _set_entry_path(array<char> *path, u64 dir_size, const char *name)
+{
+    u64 name_size = strlen(name);
+    ::resize(path, dir_size + 1 + name_size + 1);
+    path->data[dir_size] = '/';
+    copy_memory(name, path->data + dir_size + 1, name_size + 1);
+}
+
+static bool _is_dot_or_dot_dot(const char *name)
+{
+    return strcmp(name, ".") == 0 || strcmp(name, "..") == 0;
+}
+
+// path is the null terminated directory of dir_size characters
+static bool _for_each_file(array<char> *path, u64 dir_size, u64 relative_offset, on_file_function on_file, void *userdata, error *err)
+{
+#if Windows
+    _set_entry_path(path, dir_size, "*");
+
+    WIN32_FIND_DATAA entry;
+    HANDLE find = FindFirstFileA(path->data, &entry);
+
+    if (find == INVALID_HANDLE_VALUE)
+    {
+        DWORD code = GetLastError();
+        path->data[dir_size] = '\0';
+        format_error(err, (int)code, "could not read directory %s: error %u", path->data, (u32)code);
+        return false;
+    }
+
+    defer { FindClose(find); };
+
+    do
+    {
+        if (_is_dot_or_dot_dot(entry.cFileName))
+            continue;
+
+        _set_entry_path(path, dir_size, entry.cFileName);
+
+        if ((entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+            on_file(path->data, relative_offset, userdata);
+        else if ((entry.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) == 0
+              && !_for_each_file(path, strlen(path->data), relative_offset, on_file, userdata, err))
+            return false;
+    }
+    while (FindNextFileA(find, &entry));
+#else
+    DIR *dir = opendir(path->data);
+
+    if (dir == nullptr)
+    {
+        format_error(err, errno, "could not read directory %s: %s", path->data, strerror(errno));
+        return false;
+    }
+
+    defer { closedir(dir); };
+
+    struct dirent *entry;
+
+    while ((entry = readdir(dir)) != nullptr)
+    {
+        if (_is_dot_or_dot_dot(entry->d_name))
+            continue;
+
+        _set_entry_path(path, dir_size, entry->d_name);
+
+        struct stat st;
+
+        // lstat, so links to directories are not followed
+        if (lstat(path->data, &st) == -1)
+            continue;
+
+        if (S_ISDIR(st.st_mode))
+        {
+            if (!_for_each_file(path, strlen(path->data), relative_offset, on_file, userdata, err))
+                return false;
+
+            continue;
+        }
+
+        // links to files count as the file they link to
+        if (S_ISLNK(st.st_mode) && stat(path->data, &st) == -1)
+            continue;
+
+        if (S_ISREG(st.st_mode))
+            on_file(path->data, relative_offset, userdata);
+    }
+#endif
+
+    return true;
+}
+
+bool for_each_file_recursive(const char *dir, on_file_function on_file, void *userdata, error *err)
+{
+    u64 dir_size = strlen(dir);
+
+    // "dir/" and "dir" list the same files
+    while (dir_size > 1 && (dir[dir_size - 1] == '/' || dir[dir_size - 1] == '\\'))
+        dir_size -= 1;
+
+    array<char> path{};
+    ::init(&path);
+    ::resize(&path, dir_size + 1);
+    defer { ::free(&path); };
+
+    copy_memory(dir, path.data, dir_size);
+    path[dir_size] = '\0';
+
+    return _for_each_file(&path, dir_size, dir_size + 1, on_file, userdata, err);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "shl/number_types.hpp"
+#include "shl/error.hpp"
+
+/*
+DIRECTORIES
+
+The few directory operations of psp-elfdump --output-dir, which shl doesn't
+have. Paths may use '/' on every platform.
+
+Usage:
+
+    void print_file(const char *path, u64 relative_offset, void *userdata)
+    {
+        // e.g. "dump/PSP_GAME/SYSDIR/EBOOT.BIN" and "SYSDIR/EBOOT.BIN"
+        printf("%s (%s)\n", path, path + relative_offset);
+    }
+
+    if (is_directory("dump/PSP_GAME"))
+        for_each_file_recursive("dump/PSP_GAME", print_file, nullptr, &err);
+
+    create_directories("out/SYSDIR", &err);
+*/
+
+bool is_directory(const char *path);
+
+// creates path and all of its parents that don't exist yet
+bool create_directories(const char *path, error *err);
+
+/* Calls on_file for every regular file in dir and its subdirectories.
+   path is only valid during the call, path + relative_offset is the path
+   relative to dir. Links to directories are not followed, and the order
+   of the files is unspecified. */
+bool for_each_file_recursive(const char *dir, void (*on_file)(const char *path, u64 relative_offset, void *userdata), void *userdata, error *err);
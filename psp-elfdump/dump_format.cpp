@@ -1,7 +1,6 @@
 
 #include <assert.h>
 
-#include "shl/print.hpp"
 #include "psp-elfdump/dump_format.hpp"
 
 static_assert(hex_digits(0x00000000) == 0);
@@ -18,6 +17,12 @@ static_assert(hex_digits(0x10000000) == 8);
 void init(dump_config *conf)
 {
     assert(conf != nullptr);
+
+    conf->symbols = nullptr;
+    conf->imports = nullptr;
+    conf->imported_modules = nullptr;
+    conf->exported_modules = nullptr;
+    ::init(&conf->address_names);
     ::init(&conf->dump_sections);
 }
 
@@ -25,124 +30,175 @@ void free(dump_config *conf)
 {
     assert(conf != nullptr);
 
+    ::free(&conf->address_names);
     ::free(&conf->dump_sections);
 }
 
-const char *lookup_address_name(u32 addr, const dump_config *conf)
+static inline void _add_address_name(dump_config *conf, u32 addr, const char *name)
 {
-    // symbols
-    elf_symbol *sym = ::search(conf->symbols, &addr);
+    // first name wins, names are added by precedence
+    if (::search(&conf->address_names, &addr) == nullptr)
+        conf->address_names[addr] = name;
+}
 
-    if (sym != nullptr)
-        return sym->name;
+void index_address_names(dump_config *conf)
+{
+    assert(conf != nullptr);
 
-    // imports
-    function_import *fimp = ::search(conf->imports, &addr);
+    ::free(&conf->address_names);
+    ::init(&conf->address_names);
 
-    if (fimp != nullptr)
-        return fimp->function->name;
+    if (conf->symbols != nullptr)
+    {
+        for_hash_table(addr, sym, conf->symbols)
+            _add_address_name(conf, *addr, sym->name);
+    }
+
+    if (conf->imports != nullptr)
+    {
+        for_hash_table(addr, fimp, conf->imports)
+            _add_address_name(conf, *addr, fimp->function->name);
+    }
+
+    if (conf->exported_modules == nullptr)
+        return;
 
-    // exports (unoptimized, but probably not too common)
     for_array(mod, conf->exported_modules)
     {
         for_array(func, &mod->functions)
-            if (func->address == addr)
-                return func->function->name;
+            _add_address_name(conf, func->address, func->function->name);
+    }
+
+    for_array(mod, conf->exported_modules)
+    {
+        for_array(var, &mod->variables)
+            _add_address_name(conf, var->address, var->variable->name);
     }
+}
+
+const char *lookup_address_name(u32 addr, const dump_config *conf)
+{
+    const char **name = ::search(&conf->address_names, &addr);
+
+    if (name == nullptr)
+        return nullptr;
 
-    return nullptr;
+    return *name;
 }
 
-void fmt_mips_register_name(file_stream *out, mips_register reg)
+void fmt_mips_register_name(output_buffer *out, mips_register reg)
 {
-    tprint(out->handle, "%s", register_name(reg));
+    append(out, register_name(reg));
 }
 
-void fmt_dollar_mips_register_name(file_stream *out, mips_register reg)
+void fmt_dollar_mips_register_name(output_buffer *out, mips_register reg)
 {
-    tprint(out->handle, "$%s", register_name(reg));
+    append(out, '$');
+    append(out, register_name(reg));
 }
 
-void fmt_mips_fpu_register_name(file_stream *out, mips_fpu_register reg)
+void fmt_mips_fpu_register_name(output_buffer *out, mips_fpu_register reg)
 {
-    tprint(out->handle, "%s", register_name(reg));
+    append(out, register_name(reg));
 }
 
-void fmt_dollar_mips_fpu_register_name(file_stream *out, mips_fpu_register reg)
+void fmt_dollar_mips_fpu_register_name(output_buffer *out, mips_fpu_register reg)
 {
-    tprint(out->handle, "$%s", register_name(reg));
+    append(out, '$');
+    append(out, register_name(reg));
 }
 
-void fmt_vfpu_register_name(file_stream *out, vfpu_register reg)
+void fmt_vfpu_register_name(output_buffer *out, vfpu_register reg)
 {
-    tprint(out->handle, "%s%s", register_name(reg), size_suffix(reg.size));
+    append(out, register_name(reg));
+    append(out, size_suffix(reg.size));
 }
 
-void fmt_dollar_vfpu_register_name(file_stream *out, vfpu_register reg)
+void fmt_dollar_vfpu_register_name(output_buffer *out, vfpu_register reg)
 {
-    tprint(out->handle, "$%s%s", register_name(reg), size_suffix(reg.size));
+    append(out, '$');
+    append(out, register_name(reg));
+    append(out, size_suffix(reg.size));
 }
 
-void fmt_vfpu_matrix_name(file_stream *out, vfpu_matrix mtx)
+void fmt_vfpu_matrix_name(output_buffer *out, vfpu_matrix mtx)
 {
-    tprint(out->handle, "%s%s", matrix_name(mtx), size_suffix(mtx.size));
+    append(out, matrix_name(mtx));
+    append(out, size_suffix(mtx.size));
 }
 
-void fmt_dollar_vfpu_matrix_name(file_stream *out, vfpu_matrix mtx)
+void fmt_dollar_vfpu_matrix_name(output_buffer *out, vfpu_matrix mtx)
 {
-    tprint(out->handle, "$%s%s", matrix_name(mtx), size_suffix(mtx.size));
+    append(out, '$');
+    append(out, matrix_name(mtx));
+    append(out, size_suffix(mtx.size));
 }
 
-void fmt_argument_space(file_stream *out)
+void fmt_argument_space(output_buffer *out)
 {
-    put(out->handle, " ");
+    append(out, ' ');
 }
 
-void fmt_argument_comma_space(file_stream *out)
+void fmt_argument_comma_space(output_buffer *out)
 {
-    put(out->handle, ", ");
+    append(out, ", ", 2);
 }
 
-void fmt_jump_address_number(file_stream *out, u32 address, const dump_config *conf)
+void fmt_jump_address_number(output_buffer *out, u32 address, const dump_config *conf)
 {
-    tprint(out->handle, "0x%08x", address);
+    append(out, "0x", 2);
+    append_hex(out, address, 8);
 }
 
-void fmt_jump_address_label(file_stream *out, u32 address, const dump_config *conf)
+void fmt_jump_address_label(output_buffer *out, u32 address, const dump_config *conf)
 {
     const char *name = lookup_address_name(address, conf);
 
     if (name != nullptr)
-        tprint(out->handle, "%s", name);
+        append(out, name);
     else
-        tprint(out->handle, "func_%08x", address);
+    {
+        append(out, "func_", 5);
+        append_hex(out, address, 8);
+    }
 }
 
-void fmt_branch_address_number(file_stream *out, u32 address, const dump_config *conf)
+void fmt_branch_address_number(output_buffer *out, u32 address, const dump_config *conf)
 {
-    tprint(out->handle, "0x%08x", address);
+    append(out, "0x", 2);
+    append_hex(out, address, 8);
 }
 
-void fmt_branch_address_label(file_stream *out, u32 address, const dump_config *conf)
+void fmt_branch_address_label(output_buffer *out, u32 address, const dump_config *conf)
 {
     // we could use symbols for lookup, but these are just branch
     // labels, not jumps usually.
-    tprint(out->handle, ".L%08x", address);
+    append(out, ".L", 2);
+    append_hex(out, address, 8);
 }
 
-void fmt_jump_glabel(file_stream *out, u32 address, const dump_config *conf)
+void fmt_jump_glabel(output_buffer *out, u32 address, const dump_config *conf)
 {
     const char *name = lookup_address_name(address, conf);
 
+    append(out, "glabel ", 7);
+
     if (name != nullptr)
-        tprint(out->handle, "glabel %s\n", name);
+        append(out, name);
     else
-        tprint(out->handle, "glabel func_%08x\n", address);
+    {
+        append(out, "func_", 5);
+        append_hex(out, address, 8);
+    }
+
+    append(out, '\n');
 }
 
-void fmt_branch_label(file_stream *out, u32 address, const dump_config *conf)
+void fmt_branch_label(output_buffer *out, u32 address, const dump_config *conf)
 {
     // same thing as before, these are branches, not jumps.
     // address name lookup is probably not necessary.
-    tprint(out->handle, ".L%08x:\n", address);
+    append(out, ".L", 2);
+    append_hex(out, address, 8);
+    append(out, ":\n", 2);
 }
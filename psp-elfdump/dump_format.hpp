@@ -2,8 +2,11 @@
 #pragma once
 
 #include "shl/enum_flag.hpp"
+#include "shl/hash_table.hpp"
 #include "allegrex/psp_elf.hpp"
 #include "allegrex/parse_instructions.hpp"
+#include "allegrex/compact_instructions.hpp"
+#include "psp-elfdump/output_buffer.hpp"
 
 enum class mips_format_options : u8
 {
@@ -37,6 +40,10 @@ struct dump_section
     instruction *instructions;
     s32 instruction_count;
     s32 instruction_start_index;
+
+    // if not nullptr, instructions are decoded from compact starting at
+    // instruction_start_index instead of read from instructions.
+    const compact_instructions *compact;
 };
 
 // we don't just add a pointer to a elf_psp_module here because we don't
@@ -51,6 +58,10 @@ struct dump_config
     array<module_import> *imported_modules;
     array<module_export> *exported_modules;
 
+    // names of symbols, imports and exports by address, built from the
+    // above by index_address_names.
+    hash_table<u32, const char*> address_names;
+
     // relocations;
     jump_destination *jumps;
     s32 jump_count;
@@ -65,31 +76,41 @@ struct dump_config
 void init(dump_config *conf);
 void free(dump_config *conf);
 
+/* Builds conf->address_names from conf->symbols, conf->imports and
+conf->exported_modules, any of which may be nullptr. Call again if any of
+them change.
+If multiple names exist for an address, symbols take precedence over
+imports, imports over exported functions and exported functions over
+exported variables.
+*/
+void index_address_names(dump_config *conf);
+
+// nullptr if there is no name for addr
 const char *lookup_address_name(u32 addr, const dump_config *conf);
 
 // some default formatting functions
-void fmt_mips_register_name(file_stream *out, mips_register reg);
-void fmt_dollar_mips_register_name(file_stream *out, mips_register reg);
+void fmt_mips_register_name(output_buffer *out, mips_register reg);
+void fmt_dollar_mips_register_name(output_buffer *out, mips_register reg);
 
-void fmt_mips_fpu_register_name(file_stream *out, mips_fpu_register reg);
-void fmt_dollar_mips_fpu_register_name(file_stream *out, mips_fpu_register reg);
+void fmt_mips_fpu_register_name(output_buffer *out, mips_fpu_register reg);
+void fmt_dollar_mips_fpu_register_name(output_buffer *out, mips_fpu_register reg);
 
-void fmt_vfpu_register_name(file_stream *out, vfpu_register reg);
-void fmt_dollar_vfpu_register_name(file_stream *out, vfpu_register reg);
-void fmt_vfpu_matrix_name(file_stream *out, vfpu_matrix mtx);
-void fmt_dollar_vfpu_matrix_name(file_stream *out, vfpu_matrix mtx);
+void fmt_vfpu_register_name(output_buffer *out, vfpu_register reg);
+void fmt_dollar_vfpu_register_name(output_buffer *out, vfpu_register reg);
+void fmt_vfpu_matrix_name(output_buffer *out, vfpu_matrix mtx);
+void fmt_dollar_vfpu_matrix_name(output_buffer *out, vfpu_matrix mtx);
 
-void fmt_argument_space(file_stream *out);
-void fmt_argument_comma_space(file_stream *out);
+void fmt_argument_space(output_buffer *out);
+void fmt_argument_comma_space(output_buffer *out);
 
-void fmt_jump_address_number(file_stream *out, u32 address, const dump_config *conf);
-void fmt_jump_address_label(file_stream *out, u32 address, const dump_config *conf);
+void fmt_jump_address_number(output_buffer *out, u32 address, const dump_config *conf);
+void fmt_jump_address_label(output_buffer *out, u32 address, const dump_config *conf);
 
-void fmt_branch_address_number(file_stream *out, u32 address, const dump_config *conf);
-void fmt_branch_address_label(file_stream *out, u32 address, const dump_config *conf);
+void fmt_branch_address_number(output_buffer *out, u32 address, const dump_config *conf);
+void fmt_branch_address_label(output_buffer *out, u32 address, const dump_config *conf);
 
-void fmt_jump_glabel(file_stream *out, u32 address, const dump_config *conf);
-void fmt_branch_label(file_stream *out, u32 address, const dump_config *conf);
+void fmt_jump_glabel(output_buffer *out, u32 address, const dump_config *conf);
+void fmt_branch_label(output_buffer *out, u32 address, const dump_config *conf);
 
 // etc
 template<typename T>
@@ -2,6 +2,10 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 
 #include "shl/streams.hpp"
 #include "shl/number_types.hpp"
@@ -9,15 +13,24 @@
 #include "shl/print.hpp"
 #include "shl/error.hpp"
 #include "shl/defer.hpp"
+#include "shl/sort.hpp"
 
 #include "allegrex/psp_elf.hpp"
 #include "allegrex/parse_instructions.hpp"
+#include "allegrex/compact_instructions.hpp"
+#include "allegrex/batch_decrypt.hpp"
+#include "allegrex/stats.hpp"
+#include "allegrex/trace.hpp"
+#include "allegrex/worker_pool.hpp"
 
 #include "psp-elfdump/dump_format.hpp"
 #include "psp-elfdump/asm_formatter.hpp"
 #include "psp-elfdump/config.hpp"
+#include "psp-elfdump/directory.hpp"
 
 #define INFER_SIZE max_value(u32)
+#define MAX_BATCH_DUMP_THREADS 64
+#define DEFAULT_MAX_IN_FLIGHT_BYTES 0x10000000 // 256 MiB
 
 struct disasm_range
 {
@@ -30,11 +43,20 @@ struct arguments
 {
     const_string output_file; // -o, --output
     const_string log_file;    // --log
+    const_string trace_file;  // --trace
     const_string section;     // -s, --section
     const_string decrypted_elf_output; // --dump-decrypt
+    const_string decrypted_elf_output_dir; // --dump-decrypt-dir
+    const_string output_dir; // --output-dir
+    const_string file_list;  // --file-list
+    u32 thread_count;        // -j, --jobs
+    u64 max_in_flight;       // --max-in-flight
     u32 vaddr;               // -a, --vaddr
     array<disasm_range> ranges; // -r
     bool verbose;            // -v, --verbose
+    bool stats;              // --stats
+    bool compact;            // --compact
+    u64 output_buffer_size;  // --output-buffer-size
     // --no-comment
     // --no-comma-separator
     // --no-dollar-registers
@@ -46,24 +68,37 @@ struct arguments
     format_type output_type;
 
     const_string input_file;
+    array<const_string> input_files; // all input files, only batch modes take more than one
 };
 
 const arguments default_arguments{
     .output_file = ""_cs,
     .log_file = ""_cs,
+    .trace_file = ""_cs,
     .section = ""_cs,
     .decrypted_elf_output = ""_cs,
+    .decrypted_elf_output_dir = ""_cs,
+    .output_dir = ""_cs,
+    .file_list = ""_cs,
+    .thread_count = 0,
+    .max_in_flight = DEFAULT_MAX_IN_FLIGHT_BYTES,
     .vaddr = INFER_VADDR,
     .ranges = {},
     .verbose = false,
+    .stats = false,
+    .compact = false,
+    .output_buffer_size = DEFAULT_OUTPUT_BUFFER_SIZE,
     .output_format = default_mips_format_options,
     .output_type = format_type::Asm,
-    .input_file = ""_cs
+    .input_file = ""_cs,
+    .input_files = {}
 };
 
 static void _print_usage()
 {
-    puts("Usage: " psp_elfdump_NAME " [-h] [-g] [-o OUTPUT] [-p] [-a VADDR] [-v] OBJFILE\n"
+    puts("Usage: " psp_elfdump_NAME " [-h] [-g] [-o OUTPUT] [-p] [-a VADDR] [-v] [--stats] [--trace FILE] OBJFILE\n"
+         "       " psp_elfdump_NAME " --dump-decrypt-dir OUTDIR [-j JOBS] OBJFILE...\n"
+         "       " psp_elfdump_NAME " --output-dir OUTDIR [-j JOBS] [--file-list FILE] OBJFILE...\n"
          "\n"
          psp_elfdump_NAME " v" psp_elfdump_VERSION ": little-endian MIPS ELF object file disassembler\n"
          "by " psp_elfdump_AUTHOR "\n"
@@ -76,6 +111,26 @@ static void _print_usage()
          "                              if empty, disassembles all executable sections (default).\n"
          "  --dump-decrypt OUTPUT       optional output file to dump the decrypted ELF to.\n"
          "                              if set, only dumps the ELF to OUTPUT and exits.\n" 
+         "  --dump-decrypt-dir OUTDIR   decrypt all given OBJFILEs into OUTDIR, keeping\n"
+         "                              their file names, and exit. fails if two\n"
+         "                              OBJFILEs have the same file name or an OBJFILE\n"
+         "                              is in OUTDIR.\n"
+         "  --output-dir OUTDIR         disassemble all given OBJFILEs and all PSP ELFs\n"
+         "                              in given directories to OUTDIR/<file name>.s.\n"
+         "                              fails if two files would have the same output.\n"
+         "  --file-list FILE            also disassemble the files listed in FILE, one\n"
+         "                              path per line, with --output-dir.\n"
+         "  -j JOBS, --jobs JOBS        number of files decrypted or disassembled at the\n"
+         "                              same time with --dump-decrypt-dir or --output-dir\n"
+         "                              (default: number of CPUs).\n"
+         "  --max-in-flight BYTES       with --output-dir, only disassemble files at the\n"
+         "                              same time while the memory they need is at most\n"
+         "                              BYTES in total (default: 256MiB). the memory of a\n"
+         "                              file is estimated from the size of its ELF,\n"
+         "                              decrypted and inflated if it's encrypted, about\n"
+         "                              15 times the size, or 2.5 times with --compact.\n"
+         "                              a larger file is disassembled on its own.\n"
+         "                              0 means no limit.\n"
          "  -a VADDR, --vaddr VADDR     virtual address of the first instruction\n"
          "                              will be read from elf instead if not set\n"
          "  -r [VADDR:]START[-END]      if set, disassemble the given range of the\n"
@@ -87,6 +142,16 @@ static void _print_usage()
          "  -r [VADDR:]START+SIZE       same as above, but uses size instead of end\n"
          "                              position.\n"
          "  -v, --verbose               verbose progress output\n"
+         "  --stats                     print the time spent in each phase, the\n"
+         "                              throughput and other counts at exit.\n"
+         "  --trace FILE                write the phases of every file and thread to FILE\n"
+         "                              as Chrome trace events, e.g. for ui.perfetto.dev.\n"
+         "  --compact                   store only opcodes and mnemonics of the\n"
+         "                              instructions and decode them again while\n"
+         "                              writing the output. uses less memory.\n"
+         "  --output-buffer-size BYTES  size of the output buffer (default: 1MiB).\n"
+         "                              if 0, every token is written to the output\n"
+         "                              immediately.\n"
          "\n"
          "Formatting options:\n"
          "--no-comment                  omit position/address/opcode comment\n"
@@ -100,6 +165,8 @@ static void _print_usage()
          "\n"
          "Arguments:\n"
          "  OBJFILE      ELF object file to disassemble the given section for\n"
+         "  OBJFILE...   (encrypted) ELF files to decrypt with --dump-decrypt-dir, or\n"
+         "               ELF files and directories to disassemble with --output-dir\n"
          );
 }
 
@@ -150,69 +217,108 @@ static bool _parse_range(disasm_range *r, const char *arg, error *err)
     return true;
 }
 
-static void _add_symbols_to_jumps(set<jump_destination> *jumps, hash_table<u32, elf_symbol> *syms)
+static void _add_symbols_to_jumps(array<jump_destination> *jumps, hash_table<u32, elf_symbol> *syms)
 {
     // this adds symbols as jumps so they appear in the disassembly
     for_hash_table(k, _, syms)
-        ::insert_element(jumps, jump_destination{*k, jump_type::Jump});
+        ::add_at_end(jumps, jump_destination{*k, jump_type::Jump});
 }
 
-static void _add_imports_to_jumps(set<jump_destination> *jumps, array<module_import> *mods)
+static void _add_imports_to_jumps(array<jump_destination> *jumps, array<module_import> *mods)
 {
     for_array(mod, mods)
     {
         for_array(func, &mod->functions)
-            ::insert_element(jumps, jump_destination{func->address, jump_type::Jump});
+            ::add_at_end(jumps, jump_destination{func->address, jump_type::Jump});
     }
 }
 
-static void _add_exports_to_jumps(set<jump_destination> *jumps, array<module_export> *mods)
+static void _add_exports_to_jumps(array<jump_destination> *jumps, array<module_export> *mods)
 {
     for_array(mod, mods)
     {
         for_array(func, &mod->functions)
-            ::insert_element(jumps, jump_destination{func->address, jump_type::Jump});
+            ::add_at_end(jumps, jump_destination{func->address, jump_type::Jump});
     }
 }
 
-static void _format_dump(format_type type, const dump_config *dconf, file_stream *out)
+/* appends str to log_buffer, or writes it to log if log_buffer is nullptr.
+   with --output-dir every file has its own log_buffer, which is written to
+   log once the file is done, so lines of different files don't mix. */
+static void _log(file_stream *log, array<char> *log_buffer, const_string str)
 {
-    switch (type)
+    if (log_buffer == nullptr)
     {
-    case format_type::Asm:
-        asm_format(dconf, out);
-        break;
+        put(log->handle, str);
+        return;
     }
+
+    u64 offset = log_buffer->size;
+    ::resize(log_buffer, offset + str.size);
+    copy_memory(str.c_str, log_buffer->data + offset, str.size);
 }
 
-static bool _disassemble_elf(file_stream *in, file_stream *log, const arguments *args, error *err)
+static void _format_dump(const dump_config *dconf, file_stream *out, file_stream *log, array<char> *log_buffer, const arguments *args)
 {
-    memory_stream elf_data{};
+    output_buffer buf;
+    init(&buf, out, args->output_buffer_size);
+    defer { free(&buf); };
 
-    if (!read_entire_file(in, &elf_data, err))
-        return false;
+    auto start = std::chrono::steady_clock::now();
+
+    {
+        ALLEGREX_STATS_TIMER(Format);
+
+        switch (args->output_type)
+        {
+        case format_type::Asm:
+            asm_format(dconf, &buf);
+            break;
+        }
+
+        flush(&buf);
+    }
+
+    ALLEGREX_STATS_ADD(BytesWritten, buf.written);
 
-    defer { free(&elf_data); };
+    if (args->verbose)
+    {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double mib = (double)buf.written / (1024.0 * 1024.0);
+
+        _log(log, log_buffer, tformat("\nwrote %llu bytes in %.3fs (%.1f MiB/s)\n", buf.written, seconds, seconds > 0 ? mib / seconds : 0.0));
+    }
+}
+
+static bool _disassemble_elf(const_string input_file, const_string output_file, file_stream *log, array<char> *log_buffer, const arguments *args, error *err)
+{
+    ALLEGREX_TRACE_FILE(input_file.c_str);
 
     psp_parse_elf_config rconf;
     rconf.section = args->section;
     rconf.vaddr = args->vaddr;
     rconf.verbose = args->verbose;
     rconf.log = log;
+    rconf.log_buffer = log_buffer;
+    rconf.map_file = true;
 
     elf_psp_module pspmodule;
     init(&pspmodule);
     defer { free(&pspmodule); };
 
-    if (!parse_psp_module_from_elf(&elf_data, &pspmodule, &rconf, err))
+    if (!parse_psp_module_from_elf(input_file.c_str, &pspmodule, &rconf, err))
         return false;
 
-    set<jump_destination> jumps{};
+    array<jump_destination> jumps{};
     defer { ::free(&jumps); };
 
     array<instruction> instructions{};
     defer { ::free(&instructions); };
 
+    compact_instructions compact;
+    init(&compact);
+    defer { free(&compact); };
+
     dump_config dconf{};
     init(&dconf);
     defer { ::free(&dconf); };
@@ -224,6 +330,7 @@ static bool _disassemble_elf(file_stream *in, file_stream *log, const arguments
     dconf.exported_modules = &pspmodule.exported_modules;
     dconf.module_info = &pspmodule.module_info;
     dconf.format = args->output_format;
+    index_address_names(&dconf);
     ::resize(&dconf.dump_sections, pspmodule.sections.size);
 
     for_array(i, sec, &pspmodule.sections)
@@ -237,6 +344,21 @@ static bool _disassemble_elf(file_stream *in, file_stream *log, const arguments
         dump_section *dumpsec = dconf.dump_sections.data + i;
         dumpsec->section = sec;
         dumpsec->first_instruction_offset = sec->content_offset;
+        dumpsec->instructions = nullptr;
+        dumpsec->compact = nullptr;
+
+        if (args->compact)
+        {
+            dumpsec->instruction_start_index = (s32)compact.opcodes.size;
+            dumpsec->compact = &compact;
+
+            if (sec->content_size > 0)
+                parse_instructions(sec->content, sec->content_size, &compact, &jumps, &pconf);
+
+            dumpsec->instruction_count = (s32)compact.opcodes.size - dumpsec->instruction_start_index;
+            continue;
+        }
+
         dumpsec->instruction_start_index = (s32)instructions.size;
 
         if (sec->content_size > 0)
@@ -249,9 +371,11 @@ static bool _disassemble_elf(file_stream *in, file_stream *log, const arguments
     _add_imports_to_jumps(&jumps, &pspmodule.imported_modules);
     _add_exports_to_jumps(&jumps, &pspmodule.exported_modules);
 
+    sort_jumps(&jumps);
+
     for_array(dumpsec, &dconf.dump_sections)
     {
-        if (dumpsec->instruction_count == 0)
+        if (dumpsec->instruction_count == 0 || dumpsec->compact != nullptr)
             continue;
 
         dumpsec->instructions = instructions.data + dumpsec->instruction_start_index;
@@ -259,7 +383,7 @@ static bool _disassemble_elf(file_stream *in, file_stream *log, const arguments
 
     file_stream out{};
 
-    if (!_get_file_stream_or_stdout(args->output_file, &out, err))
+    if (!_get_file_stream_or_stdout(output_file, &out, err))
         return false;
 
     defer { if (out.handle != stdout_handle()) free(&out); };
@@ -267,17 +391,22 @@ static bool _disassemble_elf(file_stream *in, file_stream *log, const arguments
     dconf.jumps = jumps.data;
     dconf.jump_count = (s32)jumps.size;
 
-    _format_dump(args->output_type, &dconf, &out);
+    _format_dump(&dconf, &out, log, log_buffer, args);
 
     return true;
 }
 
 static bool _dump_decrypted_elf(file_stream *in, file_stream *log, const arguments *args, error *err)
 {
+    ALLEGREX_TRACE_FILE(args->input_file.c_str);
+
     array<u8> decrypted_elf_bytes{};
     defer { free(&decrypted_elf_bytes); };
 
-    u64 sz = decrypt_elf(in, &decrypted_elf_bytes);
+    s64 sz = decrypt_elf(in, &decrypted_elf_bytes, err);
+
+    if (sz < 0)
+        return false;
 
     if (sz == 0)
     {
@@ -295,11 +424,485 @@ static bool _dump_decrypted_elf(file_stream *in, file_stream *log, const argumen
     if (write(&out, decrypted_elf_bytes.data, sz, err) < 0)
         return false;
 
+    ALLEGREX_STATS_ADD(BytesWritten, sz);
+
     tprint("dumped decrypted ELF from % to %\n", args->input_file, args->decrypted_elf_output);
 
     return true;
 }
 
+static const char *_prx_type_name(prx_type type)
+{
+    switch (type)
+    {
+    case prx_type::Type0: return "0";
+    case prx_type::Type1: return "1";
+    case prx_type::Type2: return "2";
+    case prx_type::Type5: return "5";
+    case prx_type::Type6: return "6";
+    default:              return "unknown";
+    }
+}
+
+static void _print_batch_decrypt_status(const batch_decrypt_file *file, void *userdata)
+{
+    file_stream *log = (file_stream*)userdata;
+
+    switch (file->status)
+    {
+    case batch_decrypt_status::Decrypted:
+        tprint(log->handle, "decrypted %s to %s (%lld bytes, PRX type %s, %u attempt%s)\n",
+               file->input_path, file->output_path, file->decrypted_size,
+               _prx_type_name(file->decrypt_info.type),
+               file->decrypt_info.attempts,
+               file->decrypt_info.attempts == 1 ? "" : "s");
+        break;
+    case batch_decrypt_status::NotEncrypted:
+        tprint(log->handle, "skipped %s: not encrypted\n", file->input_path);
+        break;
+    case batch_decrypt_status::Failed:
+        if (file->decrypt_info.type == prx_type::Unknown && file->decrypt_info.attempts > 0)
+            tprint(log->handle, "failed %s: %s (%u attempt%s)\n", file->input_path, file->err.what,
+                   file->decrypt_info.attempts,
+                   file->decrypt_info.attempts == 1 ? "" : "s");
+        else
+            tprint(log->handle, "failed %s: %s\n", file->input_path, file->err.what);
+        break;
+    default:
+        break;
+    }
+}
+
+static const char *_file_name(const char *path)
+{
+    const char *ret = path;
+
+    for (const char *c = path; *c != '\0'; ++c)
+        if (*c == '/' || *c == '\\')
+            ret = c + 1;
+
+    return ret;
+}
+
+// fails if two of files would be written to the same output path
+template<typename T>
+static bool _check_unique_output_paths(const T *files, u64 count, error *err)
+{
+    array<const T*> sorted{};
+    ::init(&sorted);
+    ::resize(&sorted, count);
+    defer { ::free(&sorted); };
+
+    for (u64 i = 0; i < count; ++i)
+        sorted[i] = files + i;
+
+    compare_function_p<const T*> compare_output_paths =
+        [](const T *const *l, const T *const *r)
+        {
+            return strcmp((*l)->output_path, (*r)->output_path);
+        };
+
+    ::sort(sorted.data, sorted.size, compare_output_paths);
+
+    for (u64 i = 1; i < count; ++i)
+    {
+        const T *l = sorted[i - 1];
+        const T *r = sorted[i];
+
+        if (strcmp(l->output_path, r->output_path) == 0)
+        {
+            format_error(err, 1, "%s and %s would both be written to %s", l->input_path, r->input_path, r->output_path);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool _dump_decrypted_elfs(file_stream *log, const arguments *args, error *err)
+{
+    const_string dir = args->decrypted_elf_output_dir;
+    u64 count = args->input_files.size;
+
+    // "out/" and "out" are the same directory
+    while (dir.size > 1 && (dir.c_str[dir.size - 1] == '/' || dir.c_str[dir.size - 1] == '\\'))
+        dir.size -= 1;
+
+    // OUTDIR/<file name of input>, all in one buffer
+    u64 paths_size = 0;
+
+    for_array(input, &args->input_files)
+        paths_size += dir.size + 1 + strlen(_file_name(input->c_str)) + 1;
+
+    array<char> paths{};
+    ::init(&paths);
+    ::resize(&paths, paths_size);
+    defer { ::free(&paths); };
+
+    array<batch_decrypt_file> files{};
+    ::init(&files);
+    ::resize(&files, count);
+    defer { ::free(&files); };
+
+    char *path = paths.data;
+
+    for_array(i, input, &args->input_files)
+    {
+        const char *name = _file_name(input->c_str);
+        u64 name_size = strlen(name);
+
+        copy_memory(dir.c_str, path, dir.size);
+        path[dir.size] = '/';
+        copy_memory(name, path + dir.size + 1, name_size + 1);
+
+        // e.g. --dump-decrypt-dir out out/a.prx, same as --dump-decrypt
+        if (strcmp(input->c_str, path) == 0)
+        {
+            format_error(err, 1, "decrypted elf of %s would overwrite its input, aborting", input->c_str);
+            return false;
+        }
+
+        files[i] = batch_decrypt_file{};
+        files[i].input_path = input->c_str;
+        files[i].output_path = path;
+
+        path += dir.size + 1 + name_size + 1;
+    }
+
+    // inputs of different directories may have the same file name
+    if (!_check_unique_output_paths(files.data, count, err))
+        return false;
+
+    if (!create_directories(dir.c_str, err))
+        return false;
+
+    batch_decrypt_config conf{};
+    conf.thread_count = args->thread_count;
+    conf.on_file_done = _print_batch_decrypt_status;
+    conf.userdata = log;
+
+    u64 failed = batch_decrypt(files.data, count, &conf);
+
+    if (failed > 0)
+    {
+        format_error(err, 1, "%u of %u files could not be decrypted", (u32)failed, (u32)count);
+        return false;
+    }
+
+    return true;
+}
+
+struct batch_dump_file
+{
+    // offsets into the path buffer, which moves while files are added
+    u64 input_offset;
+    u64 output_offset;
+    u64 elf_size;    // of the ELF, decrypted and inflated if the input is encrypted
+    u64 buffer_size; // of the buffer the ELF is loaded or decrypted in
+    u64 memory;      // estimated memory to disassemble the file, counts towards --max-in-flight
+
+    const char *input_path;
+    const char *output_path;
+};
+
+// appends str and a null terminator to paths, returns the offset of str
+static u64 _add_path(array<char> *paths, const char *str, u64 size)
+{
+    u64 offset = paths->size;
+    ::resize(paths, offset + size + 1);
+    copy_memory(str, paths->data + offset, size);
+    paths->data[offset + size] = '\0';
+
+    return offset;
+}
+
+// appends outdir/name.s and a null terminator to paths, returns the offset of the path
+static u64 _add_output_path(array<char> *paths, const_string outdir, const char *name)
+{
+    // "out/" and "out" are the same directory
+    while (outdir.size > 1 && (outdir.c_str[outdir.size - 1] == '/' || outdir.c_str[outdir.size - 1] == '\\'))
+        outdir.size -= 1;
+
+    u64 name_size = strlen(name);
+    u64 offset = paths->size;
+    ::resize(paths, offset + outdir.size + 1 + name_size + 3);
+
+    char *path = paths->data + offset;
+    copy_memory(outdir.c_str, path, outdir.size);
+    path[outdir.size] = '/';
+    copy_memory(name, path + outdir.size + 1, name_size);
+    copy_memory(".s", path + outdir.size + 1 + name_size, 3);
+
+    return offset;
+}
+
+/* sets the elf_size and buffer_size of file from the header of the file at
+   path, returns false if it's not a regular or encrypted ELF, so other files
+   of directories are skipped. the sizes are 0 then, and opening the file
+   fails later if it was given explicitly. */
+static bool _read_batch_file_sizes(const char *path, batch_dump_file *file)
+{
+    file->elf_size = 0;
+    file->buffer_size = 0;
+
+    file_stream in{};
+
+    if (!init(&in, path, open_mode::Read, nullptr))
+        return false;
+
+    defer { free(&in); };
+
+    return get_decrypted_elf_size(&in, &file->elf_size, &file->buffer_size, nullptr) >= 0;
+}
+
+static void _add_batch_file(const char *input, u64 output_offset, const batch_dump_file *sizes, array<char> *paths, array<batch_dump_file> *files)
+{
+    batch_dump_file *file = ::add_at_end(files);
+    *file = *sizes;
+    file->input_offset = _add_path(paths, input, strlen(input));
+    file->output_offset = output_offset;
+}
+
+struct batch_directory
+{
+    const_string outdir;
+    array<char> *paths;
+    array<batch_dump_file> *files;
+    error *err;
+    bool failed;
+};
+
+static void _add_batch_directory_file(const char *path, u64 relative_offset, void *userdata)
+{
+    batch_directory *dir = (batch_directory*)userdata;
+    batch_dump_file sizes{};
+
+    if (dir->failed || !_read_batch_file_sizes(path, &sizes))
+        return;
+
+    u64 output_offset = _add_output_path(dir->paths, dir->outdir, path + relative_offset);
+
+    // the subdirectories of the file in outdir
+    char *output = dir->paths->data + output_offset;
+    char *separator = strrchr(output, '/');
+    *separator = '\0';
+    dir->failed = !create_directories(output, dir->err);
+    *separator = '/';
+
+    if (!dir->failed)
+        _add_batch_file(path, output_offset, &sizes, dir->paths, dir->files);
+}
+
+// adds all PSP ELFs in dir and its subdirectories, keeping their relative paths in outdir
+static bool _add_batch_directory(const char *dir, const_string outdir, array<char> *paths, array<batch_dump_file> *files, error *err)
+{
+    batch_directory bdir{};
+    bdir.outdir = outdir;
+    bdir.paths = paths;
+    bdir.files = files;
+    bdir.err = err;
+    bdir.failed = false;
+
+    if (!for_each_file_recursive(dir, _add_batch_directory_file, &bdir, err))
+        return false;
+
+    return !bdir.failed;
+}
+
+/* the memory disassembling a file needs, roughly: the buffer the ELF is loaded
+   or decrypted in and its decoded instructions, as if all of the ELF was code.
+   the ELF of a compressed module is much larger than the file. */
+static u64 _estimate_disassembly_memory(const batch_dump_file *file, bool compact)
+{
+    u64 instruction_size = compact ? sizeof(u32) + sizeof(allegrex_mnemonic) : sizeof(instruction);
+
+    return file->buffer_size + (file->elf_size / sizeof(u32)) * instruction_size;
+}
+
+static bool _add_batch_input(const char *input, const_string outdir, array<char> *paths, array<batch_dump_file> *files, error *err)
+{
+    if (is_directory(input))
+        return _add_batch_directory(input, outdir, paths, files, err);
+
+    batch_dump_file sizes{};
+    _read_batch_file_sizes(input, &sizes);
+
+    u64 output_offset = _add_output_path(paths, outdir, _file_name(input));
+    _add_batch_file(input, output_offset, &sizes, paths, files);
+
+    return true;
+}
+
+// one path per line, empty lines are ignored
+static bool _add_batch_inputs_from_list(const char *list, const_string outdir, array<char> *paths, array<batch_dump_file> *files, error *err)
+{
+    memory_stream content{};
+
+    if (!read_entire_file(list, &content, err))
+        return false;
+
+    defer { free(&content); };
+
+    // the current line with a null terminator
+    array<char> line{};
+    ::init(&line);
+    defer { ::free(&line); };
+
+    s64 start = 0;
+
+    while (start < content.size)
+    {
+        s64 end = start;
+
+        while (end < content.size && content.data[end] != '\n')
+            end += 1;
+
+        s64 next = end + 1;
+
+        while (end > start && content.data[end - 1] == '\r')
+            end -= 1;
+
+        if (end > start)
+        {
+            ::clear(&line);
+            _add_path(&line, content.data + start, (u64)(end - start));
+
+            if (!_add_batch_input(line.data, outdir, paths, files, err))
+                return false;
+        }
+
+        start = next;
+    }
+
+    return true;
+}
+
+/* disassembles many files on multiple threads, each to its own output file.
+   files are started in order, each once the estimated memory of the files
+   being disassembled plus its own is at most --max-in-flight, or nothing else
+   is being disassembled. */
+static bool _disassemble_elfs(file_stream *log, const arguments *args, error *err)
+{
+    if (args->ranges.size > 0)
+    {
+        set_error(err, 1, "-r can't be used with --output-dir");
+        return false;
+    }
+
+    array<char> paths{};
+    ::init(&paths);
+    defer { ::free(&paths); };
+
+    array<batch_dump_file> files{};
+    ::init(&files);
+    defer { ::free(&files); };
+
+    if (!create_directories(args->output_dir.c_str, err))
+        return false;
+
+    for_array(input, &args->input_files)
+        if (!_add_batch_input(input->c_str, args->output_dir, &paths, &files, err))
+            return false;
+
+    if (!string_is_blank(args->file_list)
+     && !_add_batch_inputs_from_list(args->file_list.c_str, args->output_dir, &paths, &files, err))
+        return false;
+
+    for_array(file, &files)
+    {
+        file->input_path = paths.data + file->input_offset;
+        file->output_path = paths.data + file->output_offset;
+        file->memory = _estimate_disassembly_memory(file, args->compact);
+    }
+
+    // e.g. umd1/EBOOT.BIN and umd2/EBOOT.BIN, or two directories with the same files
+    if (!_check_unique_output_paths(files.data, files.size, err))
+        return false;
+
+    u64 count = files.size;
+    u64 max_in_flight = args->max_in_flight;
+
+    std::atomic<u64> next_file = 0;
+    std::atomic<u64> failed = 0;
+
+    // guarded by mutex
+    u64 next_started = 0;
+    u64 in_flight = 0;
+    std::mutex mutex;
+    std::condition_variable changed;
+
+    // all output to log, separate from mutex so logging doesn't hold up starting files
+    std::mutex log_mutex;
+
+    u32 thread_count = get_worker_count(args->thread_count, count, MAX_BATCH_DUMP_THREADS);
+
+    run_workers(thread_count, [&](u32)
+    {
+        // verbose output of the current file, see _log
+        array<char> file_log{};
+        defer { ::free(&file_log); };
+
+        while (true)
+        {
+            u64 i = next_file.fetch_add(1);
+
+            if (i >= count)
+                break;
+
+            batch_dump_file *file = files.data + i;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+
+                changed.wait(lock, [&]()
+                {
+                    return next_started == i
+                        && (max_in_flight == 0 || in_flight == 0 || in_flight + file->memory <= max_in_flight);
+                });
+
+                next_started += 1;
+                in_flight += file->memory;
+            }
+
+            changed.notify_all();
+
+            error file_err{};
+            ::clear(&file_log);
+            bool ok = _disassemble_elf(to_const_string(file->input_path), to_const_string(file->output_path), log, &file_log, args, &file_err);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                in_flight -= file->memory;
+            }
+
+            changed.notify_all();
+
+            if (!ok)
+                failed.fetch_add(1);
+
+            {
+                std::lock_guard<std::mutex> lock(log_mutex);
+
+                if (file_log.size > 0)
+                    put(log->handle, const_string{file_log.data, file_log.size});
+
+                if (ok)
+                    tprint(log->handle, "disassembled %s to %s\n", file->input_path, file->output_path);
+                else
+                    tprint(log->handle, "failed %s: %s\n", file->input_path, file_err.what);
+            }
+        }
+    });
+
+    if (failed.load() > 0)
+    {
+        format_error(err, 1, "%u of %u files could not be disassembled", (u32)failed.load(), (u32)count);
+        return false;
+    }
+
+    return true;
+}
+
 static bool _disassemble_range(file_stream *in, file_stream *out, file_stream *log, const disasm_range *range, const arguments *args, error *err)
 {
     u32 from = range->start;
@@ -332,32 +935,41 @@ static bool _disassemble_range(file_stream *in, file_stream *out, file_stream *l
     init(&memstr, sz);
     defer { free(&memstr); };
     
-    read_at(in, memstr.data, from, sz);
+    {
+        ALLEGREX_STATS_TIMER(ReadFile);
+        read_at(in, memstr.data, from, sz);
+    }
+
+    ALLEGREX_STATS_ADD(BytesRead, sz);
 
     array<instruction> instructions;
     defer { free(&instructions); };
 
-    set<jump_destination> jumps{};
+    array<jump_destination> jumps{};
     defer { ::free(&jumps); };
 
     parse_instructions(memstr.data, memstr.size, &instructions, &jumps, &pconf);
+    sort_jumps(&jumps);
+
+    dump_config dconf{};
+    init(&dconf);
+    defer { ::free(&dconf); };
 
-    dump_config dconf;
+    // no symbols, imports or exports, so no names either
     dconf.jumps = jumps.data;
     dconf.jump_count = (s32)jumps.size;
     dconf.log = log;
     dconf.format = args->output_format;
     dconf.module_info = nullptr;
-    dconf.imported_modules = nullptr;
-    dconf.exported_modules = nullptr;
 
     dump_section *dsec = ::add_at_end(&dconf.dump_sections);
     dsec->section = nullptr;
     dsec->first_instruction_offset = from;
     dsec->instructions = instructions.data;
     dsec->instruction_count = (s32)instructions.size;
+    dsec->compact = nullptr;
 
-    _format_dump(args->output_type, &dconf, out);
+    _format_dump(&dconf, out, log, nullptr, args);
 
     if (args->verbose)
         put(log->handle, "\n");
@@ -367,6 +979,8 @@ static bool _disassemble_range(file_stream *in, file_stream *out, file_stream *l
 
 static bool _disassemble_ranges(file_stream *in, file_stream *log, const arguments *args, error *err)
 {
+    ALLEGREX_TRACE_FILE(args->input_file.c_str);
+
     file_stream out{};
 
     if (!_get_file_stream_or_stdout(args->output_file, &out, err))
@@ -381,9 +995,89 @@ static bool _disassemble_ranges(file_stream *in, file_stream *log, const argumen
     return true;
 }
 
+// the counter a phase processes, for its throughput
+static bool _get_phase_counter(allegrex_phase phase, allegrex_counter *out)
+{
+    switch (phase)
+    {
+    case allegrex_phase::ReadFile:          *out = allegrex_counter::BytesRead; return true;
+    case allegrex_phase::Decrypt:           *out = allegrex_counter::BytesDecrypted; return true;
+    case allegrex_phase::Inflate:           *out = allegrex_counter::BytesInflated; return true;
+    case allegrex_phase::ParseInstructions: *out = allegrex_counter::InstructionsDecoded; return true;
+    case allegrex_phase::Format:            *out = allegrex_counter::BytesWritten; return true;
+    default:                                return false;
+    }
+}
+
+static void _print_stats(file_stream *log, std::chrono::steady_clock::time_point start)
+{
+    if (!ALLEGREX_STATS)
+    {
+        put(log->handle, "\nno stats, " psp_elfdump_NAME " was built without ALLEGREX_STATS\n");
+        return;
+    }
+
+    allegrex_stats stats;
+    get_stats(&stats);
+
+    // times of phases are summed over all threads, e.g. with -j
+    tprint(log->handle, "\n%-24s %8s %12s %18s\n", "phase", "calls", "time", "throughput");
+
+    for (u32 i = 0; i < ALLEGREX_PHASE_COUNT; ++i)
+    {
+        allegrex_phase phase = (allegrex_phase)i;
+        const allegrex_phase_stats *p = stats.phases + i;
+
+        if (p->calls == 0)
+            continue;
+
+        double seconds = (double)p->nanoseconds / 1000000000.0;
+
+        // imports and exports are read within read elf
+        if (phase == allegrex_phase::ImportsExports)
+            tprint(log->handle, "  %-22s %8llu %11.6fs", allegrex_phase_name(phase), p->calls, seconds);
+        else
+            tprint(log->handle, "%-24s %8llu %11.6fs", allegrex_phase_name(phase), p->calls, seconds);
+
+        allegrex_counter counter;
+
+        if (seconds > 0 && _get_phase_counter(phase, &counter))
+        {
+            double n = (double)stats.counters[(u32)counter];
+
+            if (counter == allegrex_counter::InstructionsDecoded)
+                tprint(log->handle, " %9.1f Minst/s", n / 1000000.0 / seconds);
+            else
+                tprint(log->handle, " %11.1f MiB/s", n / (1024.0 * 1024.0) / seconds);
+        }
+
+        put(log->handle, "\n");
+    }
+
+    double wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    tprint(log->handle, "%-24s %8s %11.6fs\n\n", "total (wall clock)", "", wall_seconds);
+
+    for (u32 i = 0; i < ALLEGREX_COUNTER_COUNT; ++i)
+        tprint(log->handle, "%-24s %llu\n", allegrex_counter_name((allegrex_counter)i), stats.counters[i]);
+}
+
+static void _write_trace(file_stream *log, const arguments *args)
+{
+    if (!ALLEGREX_STATS)
+    {
+        put(log->handle, "\nno trace, " psp_elfdump_NAME " was built without ALLEGREX_STATS\n");
+        return;
+    }
+
+    error err{};
+
+    if (!write_trace(args->trace_file.c_str, &err))
+        tprint(log->handle, "Error: could not write trace to %s: %s\n", args->trace_file.c_str, err.what);
+}
+
 static bool _psp_elfdump(arguments *args, error *err)
 {
-    if (string_is_blank(args->input_file))
+    if (string_is_blank(args->input_file) && string_is_blank(args->file_list))
     {
         set_error(err, 1, "expected input file");
         return false;
@@ -404,6 +1098,32 @@ static bool _psp_elfdump(arguments *args, error *err)
 
     defer { if (log.handle != stdout_handle()) free(&log); };
 
+    set_stats_enabled(args->stats);
+    auto start = std::chrono::steady_clock::now();
+
+    defer { if (args->stats) _print_stats(&log, start); };
+
+    set_trace_enabled(!string_is_blank(args->trace_file));
+    defer { if (!string_is_blank(args->trace_file)) _write_trace(&log, args); };
+
+    if (!string_is_blank(args->decrypted_elf_output_dir))
+        return _dump_decrypted_elfs(&log, args, err);
+
+    if (!string_is_blank(args->output_dir))
+        return _disassemble_elfs(&log, args, err);
+
+    if (!string_is_blank(args->file_list))
+    {
+        set_error(err, 1, "--file-list requires --output-dir");
+        return false;
+    }
+
+    if (args->input_files.size > 1)
+    {
+        format_error(err, 1, "unexpected argument '%s', use --output-dir to disassemble multiple files", args->input_files[1].c_str);
+        return false;
+    }
+
     file_stream in{};
 
     if (!init(&in, args->input_file.c_str, open_mode::Read, err))
@@ -424,7 +1144,7 @@ static bool _psp_elfdump(arguments *args, error *err)
     else if (args->ranges.size > 0)
         return _disassemble_ranges(&in, &log, args, err);
     else
-        return _disassemble_elf(&in, &log, args, err);
+        return _disassemble_elf(args->input_file, args->output_file, &log, nullptr, args, err);
 
     return true;
 }
@@ -432,6 +1152,7 @@ static bool _psp_elfdump(arguments *args, error *err)
 static bool _parse_arguments(int argc, const char **argv, arguments *out, error *err)
 {
     ::init(&out->ranges);
+    ::init(&out->input_files);
 
     for (int i = 1; i < argc;)
     {
@@ -469,6 +1190,19 @@ static bool _parse_arguments(int argc, const char **argv, arguments *out, error
             continue;
         }
 
+        if (arg == "--trace"_cs)
+        {
+            if (i >= argc - 1)
+            {
+                format_error(err, 1, "%s expects a positional argument: the trace file", arg.c_str);
+                return false;
+            }
+
+            out->trace_file = to_const_string(argv[i + 1]);
+            i += 2;
+            continue;
+        }
+
         if (arg == "-s"_cs || arg == "--section"_cs)
         {
             if (i >= argc - 1)
@@ -495,6 +1229,71 @@ static bool _parse_arguments(int argc, const char **argv, arguments *out, error
             continue;
         }
 
+        if (arg == "--dump-decrypt-dir"_cs)
+        {
+            if (i >= argc - 1)
+            {
+                format_error(err, 1, "%s expects a positional argument: the output directory", arg.c_str);
+                return false;
+            }
+
+            out->decrypted_elf_output_dir = to_const_string(argv[i + 1]);
+            i += 2;
+            continue;
+        }
+
+        if (arg == "--output-dir"_cs)
+        {
+            if (i >= argc - 1)
+            {
+                format_error(err, 1, "%s expects a positional argument: the output directory", arg.c_str);
+                return false;
+            }
+
+            out->output_dir = to_const_string(argv[i + 1]);
+            i += 2;
+            continue;
+        }
+
+        if (arg == "--file-list"_cs)
+        {
+            if (i >= argc - 1)
+            {
+                format_error(err, 1, "%s expects a positional argument: the file list", arg.c_str);
+                return false;
+            }
+
+            out->file_list = to_const_string(argv[i + 1]);
+            i += 2;
+            continue;
+        }
+
+        if (arg == "--max-in-flight"_cs)
+        {
+            if (i >= argc - 1)
+            {
+                format_error(err, 1, "%s expects a positional argument: the size in bytes", arg.c_str);
+                return false;
+            }
+
+            out->max_in_flight = string_to_u64(argv[i + 1], nullptr, 0);
+            i += 2;
+            continue;
+        }
+
+        if (arg == "-j"_cs || arg == "--jobs"_cs)
+        {
+            if (i >= argc - 1)
+            {
+                format_error(err, 1, "%s expects a positional argument: the number of jobs", arg.c_str);
+                return false;
+            }
+
+            out->thread_count = string_to_u32(argv[i + 1], nullptr, 0);
+            i += 2;
+            continue;
+        }
+
         if (arg == "-a"_cs || arg == "--vaddr"_cs)
         {
             if (i >= argc - 1)
@@ -532,6 +1331,33 @@ static bool _parse_arguments(int argc, const char **argv, arguments *out, error
             continue;
         }
 
+        if (arg == "--stats"_cs)
+        {
+            out->stats = true;
+            i += 1;
+            continue;
+        }
+
+        if (arg == "--compact"_cs)
+        {
+            out->compact = true;
+            i += 1;
+            continue;
+        }
+
+        if (arg == "--output-buffer-size"_cs)
+        {
+            if (i >= argc - 1)
+            {
+                format_error(err, 1, "%s expects a positional argument: the size in bytes", arg.c_str);
+                return false;
+            }
+
+            out->output_buffer_size = string_to_u64(argv[i + 1], nullptr, 0);
+            i += 2;
+            continue;
+        }
+
         // format
         if (arg == "--no-comment"_cs)
         {
@@ -591,16 +1417,10 @@ static bool _parse_arguments(int argc, const char **argv, arguments *out, error
         }
 
         if (string_is_blank(out->input_file))
-        {
             out->input_file = arg;
-            i += 1;
-            continue;
-        }
-        else
-        {
-            format_error(err, 1, "unexpected argument '%s'", arg.c_str);
-            return false;
-        }
+
+        ::add_at_end(&out->input_files, arg);
+        i += 1;
     }
 
     return true;
@@ -617,7 +1437,7 @@ int main(int argc, const char **argv)
         return err.error_code;
     }
 
-    defer { ::free(&args.ranges); };
+    defer { ::free(&args.ranges); ::free(&args.input_files); };
 
     if (!_psp_elfdump(&args, &err))
     {
@@ -0,0 +1,171 @@
+
+#include <assert.h>
+#include <string.h>
+
+#include "shl/memory.hpp"
+#include "psp-elfdump/output_buffer.hpp"
+
+void init(output_buffer *buf, file_stream *out, u64 capacity)
+{
+    assert(buf != nullptr);
+    assert(out != nullptr);
+
+    buf->out = out;
+    buf->data = nullptr;
+    buf->size = 0;
+    buf->capacity = capacity;
+    buf->written = 0;
+
+    if (capacity > 0)
+        buf->data = alloc<char>(capacity);
+}
+
+void free(output_buffer *buf)
+{
+    assert(buf != nullptr);
+
+    if (buf->data != nullptr)
+        dealloc(buf->data, buf->capacity);
+
+    buf->data = nullptr;
+    buf->size = 0;
+    buf->capacity = 0;
+}
+
+bool flush(output_buffer *buf, error *err)
+{
+    assert(buf != nullptr);
+
+    if (buf->size == 0)
+        return true;
+
+    s64 written = write(buf->out, buf->data, buf->size, err);
+    buf->size = 0;
+
+    if (written < 0)
+        return false;
+
+    buf->written += (u64)written;
+    return true;
+}
+
+void append(output_buffer *buf, const char *data, u64 size)
+{
+    if (size == 0)
+        return;
+
+    if (buf->size + size > buf->capacity)
+    {
+        flush(buf);
+
+        // does not fit at all, e.g. unbuffered
+        if (size > buf->capacity)
+        {
+            s64 written = write(buf->out, data, size);
+
+            if (written > 0)
+                buf->written += (u64)written;
+
+            return;
+        }
+    }
+
+    copy_memory(data, buf->data + buf->size, size);
+    buf->size += size;
+}
+
+void append(output_buffer *buf, const char *str)
+{
+    append(buf, str, strlen(str));
+}
+
+void append(output_buffer *buf, const_string str)
+{
+    append(buf, str.c_str, str.size);
+}
+
+void append(output_buffer *buf, char c)
+{
+    if (buf->size < buf->capacity)
+    {
+        buf->data[buf->size] = c;
+        buf->size += 1;
+        return;
+    }
+
+    append(buf, &c, 1);
+}
+
+#define MAX_PADDING 32
+
+void append_padded(output_buffer *buf, const char *str, u32 width)
+{
+    static const char spaces[MAX_PADDING + 1] = "                                ";
+
+    u64 len = strlen(str);
+    append(buf, str, len);
+
+    while (len < width)
+    {
+        u64 pad = width - len;
+
+        if (pad > MAX_PADDING)
+            pad = MAX_PADDING;
+
+        append(buf, spaces, pad);
+        len += pad;
+    }
+}
+
+static const char _hex_chars[] = "0123456789abcdef";
+
+void append_hex(output_buffer *buf, u32 x, u32 min_digits)
+{
+    char tmp[8];
+    u32 digits = 0;
+
+    // fill from the back
+    do
+    {
+        tmp[7 - digits] = _hex_chars[x & 0xf];
+        x >>= 4;
+        digits += 1;
+    }
+    while (x != 0);
+
+    while (digits < min_digits && digits < 8)
+    {
+        tmp[7 - digits] = '0';
+        digits += 1;
+    }
+
+    append(buf, tmp + 8 - digits, digits);
+}
+
+void append_hex_prefixed(output_buffer *buf, u32 x)
+{
+    if (x == 0)
+    {
+        append(buf, '0');
+        return;
+    }
+
+    append(buf, "0x", 2);
+    append_hex(buf, x, 0);
+}
+
+void append_decimal(output_buffer *buf, u32 x)
+{
+    char tmp[10];
+    u32 digits = 0;
+
+    do
+    {
+        tmp[9 - digits] = (char)('0' + x % 10);
+        x /= 10;
+        digits += 1;
+    }
+    while (x != 0);
+
+    append(buf, tmp + 10 - digits, digits);
+}
@@ -0,0 +1,67 @@
+
+#pragma once
+
+#include "shl/number_types.hpp"
+#include "shl/file_stream.hpp"
+#include "shl/string.hpp"
+#include "shl/error.hpp"
+
+/*
+OUTPUT BUFFER
+
+Collects formatted output in memory and writes it to a file_stream in large
+blocks, instead of writing every token separately.
+The append functions format integers by hand and produce the same output as
+the printf-style format given in their comments.
+
+With a capacity of 0 every append is written to the file_stream
+immediately, which is how psp-elfdump used to write its output.
+
+Usage:
+
+    output_buffer buf;
+    init(&buf, &out);
+
+    append(&buf, "glabel ");
+    append_hex(&buf, 0x08804000, 8);
+    append(&buf, '\n');
+
+    flush(&buf);
+    free(&buf);
+*/
+
+#define DEFAULT_OUTPUT_BUFFER_SIZE (1024 * 1024)
+
+struct output_buffer
+{
+    file_stream *out;
+    char *data;
+    u64 size;     // bytes in data that have not been written yet
+    u64 capacity; // if 0, everything is written immediately
+    u64 written;  // total bytes written to out
+};
+
+void init(output_buffer *buf, file_stream *out, u64 capacity = DEFAULT_OUTPUT_BUFFER_SIZE);
+
+// does not flush
+void free(output_buffer *buf);
+
+// writes everything in the buffer to the file_stream
+bool flush(output_buffer *buf, error *err = nullptr);
+
+void append(output_buffer *buf, const char *data, u64 size);
+void append(output_buffer *buf, const char *str);
+void append(output_buffer *buf, const_string str);
+void append(output_buffer *buf, char c);
+
+// "%-<width>s"
+void append_padded(output_buffer *buf, const char *str, u32 width);
+
+// "%0<min_digits>x"
+void append_hex(output_buffer *buf, u32 x, u32 min_digits);
+
+// "%#x", e.g. 0x1f, or 0 if x is 0
+void append_hex_prefixed(output_buffer *buf, u32 x);
+
+// "%u"
+void append_decimal(output_buffer *buf, u32 x);
@@ -0,0 +1,9 @@
+// this file was generated by better-cmake
+// psp-elfgen v0.1.0
+
+#define psp_elfgen_NAME "psp-elfgen"
+#define psp_elfgen_AUTHOR "DaemonTsun"
+#define psp_elfgen_VERSION "0.1.0"
+#define psp_elfgen_VERSION_MAJOR 0
+#define psp_elfgen_VERSION_MINOR 1
+#define psp_elfgen_VERSION_PATCH 0
@@ -0,0 +1,901 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "shl/assert.hpp"
+#include "shl/memory.hpp"
+#include "shl/defer.hpp"
+
+#include "allegrex/elf.hpp"
+#include "allegrex/psp_prx.hpp"
+#include "allegrex/psp_modules.hpp"
+#include "allegrex/parse_instructions.hpp"
+#include "psp-elfgen/elf_generator.hpp"
+
+#define DEFAULT_SEED 0x2545f491
+#define BASE_VADDR 0x08804000
+#define ELF_FLAGS 0x10a23001 // allegrex
+#define SECTION_ALIGNMENT 16
+#define MIN_FUNCTION_SIZE 8 // prologue, epilogue and a few instructions
+#define MAX_FUNCTION_SIZE 4096 // branch offsets have to reach within functions
+#define MAX_CODE_SIZE (96 * 1024 * 1024) // jumps can't leave the 256 MiB region of BASE_VADDR
+#define MAX_SECTION_COUNT 16384
+#define MAX_OPCODE_TRIES 64
+#define SDK_VERSION 0x06060010
+
+// pspsdk values
+#define SYSLIB_EXPORT_FLAGS  0x80000000
+#define LIBRARY_EXPORT_FLAGS 0x00010000
+#define IMPORT_FLAGS         0x00090011
+#define EXPORT_ENTRY_SIZE    (sizeof(prx_module_export) / sizeof(u32))
+#define IMPORT_ENTRY_SIZE    (sizeof(prx_module_import) / sizeof(u32))
+#define STUB_SIZE            8
+
+#define NID_MODULE_START     0xd632acdb
+#define NID_MODULE_STOP      0xcee8593c
+#define NID_MODULE_INFO      0xf01d73a7
+#define NID_MODULE_SDK_VERSION 0x11b97506
+
+// opcodes
+#define OP_NOP      0x00000000
+#define OP_JR_RA    0x03e00008
+#define OP_ADDIU_SP 0x27bd0000 // addiu sp, sp, imm
+#define OP_SW_RA    0xafbf0000 // sw ra, imm(sp)
+#define OP_LW_RA    0x8fbf0000 // lw ra, imm(sp)
+#define OP_J        0x08000000
+#define OP_JAL      0x0c000000
+#define OP_BEQ      0x10000000
+#define OP_BNE      0x14000000
+#define OP_BLEZ     0x18000000
+#define OP_BGTZ     0x1c000000
+#define OP_BEQL     0x50000000
+#define OP_BNEL     0x54000000
+#define OP_REGIMM   0x04000000 // bltz with rt 0, bgez with rt 1
+#define OP_BC1      0x45000000 // bc1f, bc1t with bit 16 set
+
+#define PRIMARY(X) (1ull << (X))
+#define PRIMARY_RANGE(FIRST, LAST) (((2ull << (LAST)) - 1) & ~(PRIMARY(FIRST) - 1))
+
+static const struct
+{
+    const char *name;
+    u32 default_weight;
+    u64 primaries; // bit n is set if primary opcode n is part of the category
+} _categories[ELFGEN_CATEGORY_COUNT] = {
+    { "special",    22, PRIMARY(0x00) },
+    { "immediate",  20, PRIMARY_RANGE(0x08, 0x0f) },
+    { "load/store", 24, PRIMARY_RANGE(0x20, 0x2f) | PRIMARY(0x30) | PRIMARY(0x38) },
+    { "branch",     10, 0 },
+    { "cop1",        8, PRIMARY(0x11) | PRIMARY(0x31) | PRIMARY(0x39) },
+    { "special2/3",  4, PRIMARY(0x1c) | PRIMARY(0x1f) },
+    { "vfpu",       12, PRIMARY(0x12) | PRIMARY(0x18) | PRIMARY(0x19) | PRIMARY(0x1b) | PRIMARY(0x32) | PRIMARY(0x34)
+                      | PRIMARY_RANGE(0x35, 0x37) | PRIMARY_RANGE(0x3c, 0x3f) | PRIMARY(0x3a) }
+};
+
+const char *elfgen_category_name(elfgen_category cat)
+{
+    if (cat >= elfgen_category::_MAX)
+        return "";
+
+    return _categories[(u32)cat].name;
+}
+
+void init(elfgen_config *conf)
+{
+    conf->seed = DEFAULT_SEED;
+    conf->code_size = 1024 * 1024;
+    conf->section_count = 16;
+    conf->average_function_size = 64;
+    conf->import_module_count = 16;
+    conf->imports_per_module = 16;
+    conf->export_count = 16;
+    conf->module_name = "elfgen";
+
+    for (u32 i = 0; i < ELFGEN_CATEGORY_COUNT; ++i)
+        conf->category_weights[i] = _categories[i].default_weight;
+}
+
+struct elfgen_function
+{
+    u32 vaddr;
+    u32 size; // in instructions
+    u16 section_index;
+    const char *name; // nullptr for func_<vaddr>
+};
+
+struct elfgen_import
+{
+    const psp_module *module;
+    u32 first_function;
+    u32 function_count;
+};
+
+struct elfgen_ctx
+{
+    const elfgen_config *conf;
+    elfgen_stats *stats;
+    u32 x; // xorshift32 state
+
+    u32 primaries[ELFGEN_CATEGORY_COUNT][64];
+    u32 primary_counts[ELFGEN_CATEGORY_COUNT];
+    u32 total_weight;
+    u32 total_weight_without_branches;
+
+    parse_instructions_config parse_conf;
+
+    array<elfgen_function> functions;
+    array<elfgen_import> imports;
+    array<u32> stubs; // vaddrs of all import stubs
+    const psp_module *export_module;
+    u32 export_count;
+
+    array<char> *out;
+    u32 alloc_offset; // file offset of BASE_VADDR
+
+    array<Elf32_Shdr> headers;
+    array<Elf32_Sym> symbols;
+    array<array<Elf32_Rel>> relocations; // per text section
+    array<char> strtab;
+    array<char> shstrtab;
+};
+
+static u32 _next(elfgen_ctx *ctx)
+{
+    // xorshift32
+    ctx->x ^= ctx->x << 13;
+    ctx->x ^= ctx->x >> 17;
+    ctx->x ^= ctx->x << 5;
+    return ctx->x;
+}
+
+// pseudorandom number in [0, max)
+static u32 _next(elfgen_ctx *ctx, u32 max)
+{
+    return max == 0 ? 0 : _next(ctx) % max;
+}
+
+static u32 _add_string(array<char> *strings, const char *str)
+{
+    u32 offset = (u32)strings->size;
+    u64 len = strlen(str) + 1;
+
+    ::resize(strings, strings->size + len);
+    copy_memory(str, strings->data + offset, len);
+
+    return offset;
+}
+
+static u32 _add_data(array<char> *out, const void *data, u64 size)
+{
+    u32 offset = (u32)out->size;
+
+    if (size == 0)
+        return offset;
+
+    ::resize(out, out->size + size);
+    copy_memory(data, out->data + offset, size);
+
+    return offset;
+}
+
+static void _pad(array<char> *out, u64 alignment)
+{
+    u64 size = out->size;
+    u64 aligned = (size + alignment - 1) & ~(alignment - 1);
+
+    ::resize(out, aligned);
+    fill_memory(out->data + size, 0, aligned - size);
+}
+
+static u32 _current_vaddr(const elfgen_ctx *ctx)
+{
+    return BASE_VADDR + ((u32)ctx->out->size - ctx->alloc_offset);
+}
+
+static u32 _file_offset(const elfgen_ctx *ctx, u32 vaddr)
+{
+    return vaddr - BASE_VADDR + ctx->alloc_offset;
+}
+
+static void _write_u32(elfgen_ctx *ctx, u32 vaddr, u32 value)
+{
+    copy_memory(&value, ctx->out->data + _file_offset(ctx, vaddr), sizeof(u32));
+}
+
+// starts a section at the end of out, returns its index
+static u32 _begin_section(elfgen_ctx *ctx, const char *name, u32 type, u32 flags)
+{
+    _pad(ctx->out, SECTION_ALIGNMENT);
+
+    Elf32_Shdr *sec = ::add_at_end(&ctx->headers);
+    fill_memory(sec, 0, sizeof(Elf32_Shdr));
+
+    sec->sh_name = _add_string(&ctx->shstrtab, name);
+    sec->sh_type = type;
+    sec->sh_flags = flags;
+    sec->sh_offset = (u32)ctx->out->size;
+    sec->sh_addralign = SECTION_ALIGNMENT;
+
+    if ((flags & SHF_ALLOC) != 0)
+        sec->sh_addr = _current_vaddr(ctx);
+
+    return (u32)(ctx->headers.size - 1);
+}
+
+static void _end_section(elfgen_ctx *ctx, u32 index)
+{
+    Elf32_Shdr *sec = ctx->headers.data + index;
+    sec->sh_size = (u32)ctx->out->size - sec->sh_offset;
+}
+
+static void _add_symbol(elfgen_ctx *ctx, const char *name, u32 vaddr, u32 size, u16 section_index)
+{
+    Elf32_Sym *sym = ::add_at_end(&ctx->symbols);
+    fill_memory(sym, 0, sizeof(Elf32_Sym));
+
+    sym->st_name = _add_string(&ctx->strtab, name);
+    sym->st_value = vaddr;
+    sym->st_size = size;
+    sym->st_info = ELF32_ST_INFO(STB_GLOBAL, STT_FUNC);
+    sym->st_shndx = section_index;
+}
+
+static bool _validate_config(const elfgen_config *conf, error *err)
+{
+    if (conf->section_count == 0 || conf->section_count > MAX_SECTION_COUNT)
+    {
+        format_error(err, 1, "section count must be between 1 and %u", MAX_SECTION_COUNT);
+        return false;
+    }
+
+    if (conf->code_size > MAX_CODE_SIZE)
+    {
+        format_error(err, 1, "code size must be at most %u bytes", MAX_CODE_SIZE);
+        return false;
+    }
+
+    if (conf->code_size / SECTION_ALIGNMENT / conf->section_count * SECTION_ALIGNMENT < MIN_FUNCTION_SIZE * sizeof(u32))
+    {
+        format_error(err, 1, "code size must be at least %u bytes per section", MIN_FUNCTION_SIZE * (u32)sizeof(u32));
+        return false;
+    }
+
+    if (conf->average_function_size < MIN_FUNCTION_SIZE || conf->average_function_size > MAX_FUNCTION_SIZE / 2)
+    {
+        format_error(err, 1, "average function size must be between %u and %u instructions", MIN_FUNCTION_SIZE, MAX_FUNCTION_SIZE / 2);
+        return false;
+    }
+
+    u32 total_weight = 0;
+
+    for (u32 i = 0; i < ELFGEN_CATEGORY_COUNT; ++i)
+        if (i != (u32)elfgen_category::Branch)
+            total_weight += conf->category_weights[i];
+
+    if (total_weight == 0)
+    {
+        set_error(err, 1, "at least one category besides branch needs a weight");
+        return false;
+    }
+
+    if (conf->module_name == nullptr || strlen(conf->module_name) >= PRX_MODULE_NAME_LEN)
+    {
+        format_error(err, 1, "module name must be shorter than %u characters", PRX_MODULE_NAME_LEN);
+        return false;
+    }
+
+    return true;
+}
+
+static void _init_categories(elfgen_ctx *ctx)
+{
+    ctx->total_weight = 0;
+    ctx->total_weight_without_branches = 0;
+
+    for (u32 c = 0; c < ELFGEN_CATEGORY_COUNT; ++c)
+    {
+        ctx->primary_counts[c] = 0;
+
+        for (u32 p = 0; p < 64; ++p)
+            if (_categories[c].primaries & PRIMARY(p))
+                ctx->primaries[c][ctx->primary_counts[c]++] = p << 26;
+
+        ctx->total_weight += ctx->conf->category_weights[c];
+
+        if (c != (u32)elfgen_category::Branch)
+            ctx->total_weight_without_branches += ctx->conf->category_weights[c];
+    }
+}
+
+/* splits the text sections into functions. every section has the same size
+   except the last one, which also gets the rest. */
+static void _layout_functions(elfgen_ctx *ctx, u32 first_section_index)
+{
+    const elfgen_config *conf = ctx->conf;
+    u32 section_words = conf->code_size / SECTION_ALIGNMENT / conf->section_count * (SECTION_ALIGNMENT / sizeof(u32));
+    u32 last_section_words = conf->code_size / SECTION_ALIGNMENT * (SECTION_ALIGNMENT / sizeof(u32)) - section_words * (conf->section_count - 1);
+    u32 max_size = conf->average_function_size * 2 - MIN_FUNCTION_SIZE;
+    u32 vaddr = BASE_VADDR;
+
+    for (u32 s = 0; s < conf->section_count; ++s)
+    {
+        u32 words = (s == conf->section_count - 1) ? last_section_words : section_words;
+
+        while (words > 0)
+        {
+            u32 size = MIN_FUNCTION_SIZE + _next(ctx, max_size - MIN_FUNCTION_SIZE + 1);
+
+            // the last function of a section gets the rest, which is less than MAX_FUNCTION_SIZE
+            if (words < size + MIN_FUNCTION_SIZE)
+                size = words;
+
+            ::add_at_end(&ctx->functions, elfgen_function{vaddr, size, (u16)(first_section_index + s), nullptr});
+            vaddr += size * sizeof(u32);
+            words -= size;
+        }
+    }
+}
+
+// picks the imported modules and which of their functions are imported
+static void _pick_imports(elfgen_ctx *ctx)
+{
+    const psp_module *modules = get_psp_modules();
+    u32 module_count = get_psp_module_count();
+
+    array<u32> candidates;
+    ::init(&candidates);
+    defer { ::free(&candidates); };
+
+    for (u32 i = 0; i < module_count; ++i)
+        if (modules[i].function_count > 0)
+            ::add_at_end(&candidates, i);
+
+    u32 count = Min(ctx->conf->import_module_count, (u32)candidates.size);
+
+    // partial Fisher-Yates shuffle, the first count candidates are picked
+    for (u32 i = 0; i < count; ++i)
+    {
+        u32 j = i + _next(ctx, (u32)candidates.size - i);
+        u32 tmp = candidates[i];
+        candidates[i] = candidates[j];
+        candidates[j] = tmp;
+
+        const psp_module *mod = modules + candidates[i];
+        u32 function_count = Min(ctx->conf->imports_per_module, mod->function_count);
+
+        if (function_count == 0)
+            continue;
+
+        ::add_at_end(&ctx->imports, elfgen_import{mod, _next(ctx, mod->function_count), function_count});
+    }
+
+    if (ctx->conf->export_count > 0 && candidates.size > 0)
+    {
+        ctx->export_module = modules + candidates[_next(ctx, (u32)candidates.size)];
+        ctx->export_count = Min(ctx->conf->export_count, ctx->export_module->function_count);
+    }
+}
+
+static const psp_function *_import_function(const elfgen_import *imp, u32 i)
+{
+    return imp->module->functions + (imp->first_function + i) % imp->module->function_count;
+}
+
+// names exported functions, others are named by their address
+static void _name_functions(elfgen_ctx *ctx)
+{
+    u32 count = (u32)ctx->functions.size;
+
+    for (u32 i = 0; i < ctx->export_count; ++i)
+        ctx->functions[(i * 7 + 1) % count].name = ctx->export_module->functions[i].name;
+
+    ctx->functions[count - 1].name = "module_stop";
+    ctx->functions[0].name = "module_start";
+}
+
+static elfgen_category _pick_category(elfgen_ctx *ctx, bool allow_branch)
+{
+    u32 total = allow_branch ? ctx->total_weight : ctx->total_weight_without_branches;
+    u32 r = _next(ctx, total);
+
+    for (u32 c = 0; c < ELFGEN_CATEGORY_COUNT; ++c)
+    {
+        if (!allow_branch && c == (u32)elfgen_category::Branch)
+            continue;
+
+        u32 w = ctx->conf->category_weights[c];
+
+        if (r < w)
+            return (elfgen_category)c;
+
+        r -= w;
+    }
+
+    return elfgen_category::Special;
+}
+
+// syscalls are left out too, their codes are assigned when the module is loaded
+static bool _is_valid_non_jump(const instruction *inst)
+{
+    if (inst->mnemonic == allegrex_mnemonic::_UNKNOWN
+     || inst->mnemonic == allegrex_mnemonic::JR
+     || inst->mnemonic == allegrex_mnemonic::JALR
+     || inst->mnemonic == allegrex_mnemonic::SYSCALL)
+        return false;
+
+    for (u32 i = 0; i < inst->argument_count; ++i)
+    {
+        argument_type t = inst->argument_types[i];
+
+        if (t == argument_type::Invalid
+         || t == argument_type::Branch_Address
+         || t == argument_type::Jump_Address)
+            return false;
+
+        // vcst has 19 constants, the rest of the 5 bits are undefined
+        if (t == argument_type::VFPU_Constant
+         && (inst->arguments[i].vfpu_constant == vfpu_constant::VFPU_UNDEFINED
+          || inst->arguments[i].vfpu_constant > vfpu_constant::VFPU_SQRT3_2))
+            return false;
+    }
+
+    return true;
+}
+
+/* pseudorandom opcodes of the category until one decodes to a valid
+   instruction that doesn't jump. */
+static u32 _category_opcode(elfgen_ctx *ctx, elfgen_category cat)
+{
+    u32 c = (u32)cat;
+    instruction inst;
+
+    for (u32 i = 0; i < MAX_OPCODE_TRIES; ++i)
+    {
+        u32 opcode = ctx->primaries[c][_next(ctx, ctx->primary_counts[c])] | (_next(ctx) & 0x03ffffff);
+
+        inst = {};
+        inst.opcode = opcode;
+        parse_instruction(opcode, &inst, nullptr, &ctx->parse_conf);
+
+        if (_is_valid_non_jump(&inst))
+            return opcode;
+    }
+
+    return OP_NOP;
+}
+
+static u32 _register(elfgen_ctx *ctx)
+{
+    return _next(ctx) & 0x1f;
+}
+
+static void _add_relocation(elfgen_ctx *ctx, const elfgen_function *func, u32 vaddr)
+{
+    array<Elf32_Rel> *rels = ctx->relocations.data + (func->section_index - 1);
+    ::add_at_end(rels, Elf32_Rel{vaddr, ELF32_R_INFO(0, R_MIPS_26)});
+    ctx->stats->relocation_count += 1;
+}
+
+/* a branch to an instruction of func, a jump within func or a call to
+   another function or an import stub. */
+static u32 _branch_opcode(elfgen_ctx *ctx, const elfgen_function *func, u32 vaddr)
+{
+    u32 target = func->vaddr + _next(ctx, func->size) * sizeof(u32);
+    u32 offset = (u32)((s32)(target - (vaddr + sizeof(u32))) / (s32)sizeof(u32)) & 0xffff;
+    u32 rs = _register(ctx) << 21;
+    u32 rt = _register(ctx) << 16;
+
+    switch (_next(ctx, 12))
+    {
+    case 0:  return OP_BEQ  | rs | rt | offset;
+    case 1:  return OP_BNE  | rs | rt | offset;
+    case 2:  return OP_BEQL | rs | rt | offset;
+    case 3:  return OP_BNEL | rs | rt | offset;
+    case 4:  return OP_BLEZ | rs | offset;
+    case 5:  return OP_BGTZ | rs | offset;
+    case 6:  return OP_REGIMM | rs | (_next(ctx, 2) << 16) | offset;
+    case 7:  return OP_BC1 | (_next(ctx, 2) << 16) | offset;
+    case 8:  return OP_BEQ | offset; // b
+    case 9:
+        _add_relocation(ctx, func, vaddr);
+        return OP_J | ((target >> 2) & 0x03ffffff);
+    default:
+        break;
+    }
+
+    // jal to a function or a stub
+    if (ctx->stubs.size > 0 && _next(ctx, 3) == 0)
+        target = ctx->stubs[_next(ctx, (u32)ctx->stubs.size)];
+    else
+        target = ctx->functions[_next(ctx, (u32)ctx->functions.size)].vaddr;
+
+    _add_relocation(ctx, func, vaddr);
+    return OP_JAL | ((target >> 2) & 0x03ffffff);
+}
+
+static void _generate_function(elfgen_ctx *ctx, const elfgen_function *func, u32 *out)
+{
+    u32 frame_size = 16 + _next(ctx, 31) * 8;
+    u32 body_end = func->size - 3;
+
+    out[0] = OP_ADDIU_SP | ((u32)-(s32)frame_size & 0xffff);
+    out[1] = OP_SW_RA | (frame_size - 4);
+
+    bool previous_was_branch = false;
+
+    for (u32 i = 2; i < body_end; ++i)
+    {
+        elfgen_category cat = _pick_category(ctx, !previous_was_branch);
+        u32 vaddr = func->vaddr + i * sizeof(u32);
+
+        if (cat == elfgen_category::Branch)
+            out[i] = _branch_opcode(ctx, func, vaddr);
+        else
+            out[i] = _category_opcode(ctx, cat);
+
+        ctx->stats->category_counts[(u32)cat] += 1;
+        previous_was_branch = cat == elfgen_category::Branch;
+    }
+
+    out[body_end] = OP_LW_RA | (frame_size - 4);
+    out[body_end + 1] = OP_JR_RA;
+    out[body_end + 2] = OP_ADDIU_SP | frame_size; // delay slot
+}
+
+static void _add_text_sections(elfgen_ctx *ctx)
+{
+    u32 f = 0;
+    char name[64];
+
+    for (u32 s = 0; s < ctx->conf->section_count; ++s)
+    {
+        snprintf(name, sizeof(name), ".text.%u", s);
+        u32 index = _begin_section(ctx, name, SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR);
+
+        for (; f < ctx->functions.size && ctx->functions[f].section_index == index; ++f)
+        {
+            const elfgen_function *func = ctx->functions.data + f;
+            u32 offset = (u32)ctx->out->size;
+            ::resize(ctx->out, ctx->out->size + func->size * sizeof(u32));
+
+            _generate_function(ctx, func, (u32*)(ctx->out->data + offset));
+
+            if (func->name != nullptr)
+                _add_symbol(ctx, func->name, func->vaddr, func->size * sizeof(u32), (u16)index);
+            else
+            {
+                snprintf(name, sizeof(name), "func_%08x", func->vaddr);
+                _add_symbol(ctx, name, func->vaddr, func->size * sizeof(u32), (u16)index);
+            }
+
+            ctx->stats->instruction_count += func->size;
+        }
+
+        _end_section(ctx, index);
+    }
+
+    ctx->stats->function_count = (u32)ctx->functions.size;
+}
+
+// jr ra, nop for every imported function, like the pspsdk stubs before they're linked
+static void _add_stub_section(elfgen_ctx *ctx)
+{
+    u32 index = _begin_section(ctx, ".sceStub.text", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR);
+    const u32 stub[2] = { OP_JR_RA, OP_NOP };
+
+    assert(ctx->stubs.size == 0 || ctx->stubs[0] == _current_vaddr(ctx));
+
+    for_array(imp, &ctx->imports)
+    {
+        for (u32 i = 0; i < imp->function_count; ++i)
+        {
+            const psp_function *pf = _import_function(imp, i);
+            _add_symbol(ctx, pf->name, _current_vaddr(ctx), STUB_SIZE, (u16)index);
+            _add_data(ctx->out, stub, STUB_SIZE);
+        }
+    }
+
+    ctx->stats->import_count = (u32)ctx->stubs.size;
+    ctx->stats->import_module_count = (u32)ctx->imports.size;
+    _end_section(ctx, index);
+}
+
+static void _generate(elfgen_ctx *ctx)
+{
+    const elfgen_config *conf = ctx->conf;
+    array<char> *out = ctx->out;
+
+    Elf32_Ehdr ehdr{};
+    Elf32_Phdr phdr{};
+
+    ::resize(out, sizeof(Elf32_Ehdr) + sizeof(Elf32_Phdr));
+    _pad(out, SECTION_ALIGNMENT);
+    ctx->alloc_offset = (u32)out->size;
+
+    ::add_at_end(&ctx->headers, Elf32_Shdr{});
+    _add_string(&ctx->shstrtab, "");
+    _add_string(&ctx->strtab, "");
+    ::add_at_end(&ctx->symbols, Elf32_Sym{});
+
+    _pick_imports(ctx);
+    _layout_functions(ctx, 1);
+    _name_functions(ctx);
+
+    // stubs come right after the code
+    u32 import_count = 0;
+
+    for_array(imp, &ctx->imports)
+        import_count += imp->function_count;
+
+    u32 stub_vaddr = ctx->functions[ctx->functions.size - 1].vaddr + ctx->functions[ctx->functions.size - 1].size * sizeof(u32);
+    stub_vaddr = (stub_vaddr + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+
+    for (u32 i = 0; i < import_count; ++i)
+        ::add_at_end(&ctx->stubs, stub_vaddr + i * STUB_SIZE);
+
+    ::resize(&ctx->relocations, conf->section_count);
+
+    for_array(rels, &ctx->relocations)
+        ::init(rels);
+
+    _add_text_sections(ctx);
+    _add_stub_section(ctx);
+
+    /* .rodata.sceResident: the SDK version, the NIDs and addresses of the
+       exports and the names of the libraries */
+    u32 resident_index = _begin_section(ctx, ".rodata.sceResident", SHT_PROGBITS, SHF_ALLOC);
+    u32 sdk_version = SDK_VERSION;
+    u32 sdk_version_vaddr = _current_vaddr(ctx);
+    _add_data(out, &sdk_version, sizeof(u32));
+
+    const u32 syslib_nids[4] = { NID_MODULE_START, NID_MODULE_STOP, NID_MODULE_INFO, NID_MODULE_SDK_VERSION };
+    u32 syslib_exports_vaddr = _current_vaddr(ctx);
+    _add_data(out, syslib_nids, sizeof(syslib_nids));
+
+    // module_info is patched once its address is known
+    const elfgen_function *last_function = ctx->functions.data + ctx->functions.size - 1;
+    const u32 syslib_addresses[4] = { ctx->functions[0].vaddr, last_function->vaddr, 0, sdk_version_vaddr };
+    u32 module_info_address_vaddr = _current_vaddr(ctx) + 2 * sizeof(u32);
+    _add_data(out, syslib_addresses, sizeof(syslib_addresses));
+
+    u32 library_exports_vaddr = _current_vaddr(ctx);
+
+    for (u32 i = 0; i < ctx->export_count; ++i)
+        _add_data(out, &ctx->export_module->functions[i].nid, sizeof(u32));
+
+    for (u32 i = 0; i < ctx->export_count; ++i)
+        _add_data(out, &ctx->functions[(i * 7 + 1) % ctx->functions.size].vaddr, sizeof(u32));
+
+    u32 library_name_vaddr = 0;
+
+    if (ctx->export_count > 0)
+    {
+        library_name_vaddr = _current_vaddr(ctx);
+        _add_string(out, ctx->export_module->name);
+    }
+
+    array<u32> import_name_vaddrs;
+    ::init(&import_name_vaddrs);
+    defer { ::free(&import_name_vaddrs); };
+
+    for_array(imp, &ctx->imports)
+    {
+        ::add_at_end(&import_name_vaddrs, _current_vaddr(ctx));
+        _add_string(out, imp->module->name);
+    }
+
+    _end_section(ctx, resident_index);
+
+    // .rodata.sceNid: the NIDs of the imported functions
+    u32 nid_index = _begin_section(ctx, ".rodata.sceNid", SHT_PROGBITS, SHF_ALLOC);
+    u32 nids_vaddr = _current_vaddr(ctx);
+
+    for_array(imp, &ctx->imports)
+    {
+        for (u32 i = 0; i < imp->function_count; ++i)
+            _add_data(out, &_import_function(imp, i)->nid, sizeof(u32));
+    }
+
+    _end_section(ctx, nid_index);
+
+    // .lib.ent: the export table
+    u32 ent_index = _begin_section(ctx, ".lib.ent", SHT_PROGBITS, SHF_ALLOC);
+    u32 exports_start = _current_vaddr(ctx);
+
+    prx_module_export exp{};
+    exp.name_vaddr = 0;
+    exp.flags = SYSLIB_EXPORT_FLAGS;
+    exp.entry_size = EXPORT_ENTRY_SIZE;
+    exp.variable_count = 2;
+    exp.function_count = 2;
+    exp.exports_vaddr = syslib_exports_vaddr;
+    _add_data(out, &exp, sizeof(exp));
+
+    if (ctx->export_count > 0)
+    {
+        exp.name_vaddr = library_name_vaddr;
+        exp.flags = LIBRARY_EXPORT_FLAGS;
+        exp.variable_count = 0;
+        exp.function_count = (u16)ctx->export_count;
+        exp.exports_vaddr = library_exports_vaddr;
+        _add_data(out, &exp, sizeof(exp));
+    }
+
+    u32 exports_end = _current_vaddr(ctx);
+    ctx->stats->export_count = 2 + ctx->export_count;
+    _end_section(ctx, ent_index);
+
+    // .lib.stub: the import table
+    u32 stub_table_index = _begin_section(ctx, ".lib.stub", SHT_PROGBITS, SHF_ALLOC);
+    u32 imports_start = _current_vaddr(ctx);
+    u32 nid_offset = 0;
+
+    for_array(i, imp, &ctx->imports)
+    {
+        prx_module_import entry{};
+        entry.name_vaddr = import_name_vaddrs[i];
+        entry.flags = IMPORT_FLAGS;
+        entry.entry_size = IMPORT_ENTRY_SIZE;
+        entry.variable_count = 0;
+        entry.function_count = (u16)imp->function_count;
+        entry.nids_vaddr = nids_vaddr + nid_offset * sizeof(u32);
+        entry.functions_vaddr = stub_vaddr + nid_offset * STUB_SIZE;
+        _add_data(out, &entry, sizeof(entry));
+
+        nid_offset += imp->function_count;
+    }
+
+    u32 imports_end = _current_vaddr(ctx);
+    _end_section(ctx, stub_table_index);
+
+    // .rodata.sceModuleInfo
+    u32 module_info_index = _begin_section(ctx, ELF_SECTION_PRX_MODULE_INFO, SHT_PROGBITS, SHF_ALLOC);
+    u32 module_info_vaddr = _current_vaddr(ctx);
+    u32 module_info_offset = (u32)out->size;
+
+    prx_sce_module_info mod_info{};
+    mod_info.version[0] = 1;
+    mod_info.version[1] = 1;
+    copy_memory(conf->module_name, mod_info.name, strlen(conf->module_name));
+    mod_info.gp = 0;
+    mod_info.export_offset_start = exports_start;
+    mod_info.export_offset_end = exports_end;
+    mod_info.import_offset_start = imports_start;
+    mod_info.import_offset_end = imports_end;
+    _add_data(out, &mod_info, sizeof(mod_info));
+    _end_section(ctx, module_info_index);
+
+    _write_u32(ctx, module_info_address_vaddr, module_info_vaddr);
+
+    u32 alloc_size = (u32)out->size - ctx->alloc_offset;
+
+    // relocations of the jumps of each text section
+    u32 symtab_index = (u32)ctx->headers.size + conf->section_count;
+    char name[64];
+
+    for (u32 s = 0; s < conf->section_count; ++s)
+    {
+        snprintf(name, sizeof(name), ".rel.text.%u", s);
+        u32 index = _begin_section(ctx, name, SHT_REL, 0);
+        array<Elf32_Rel> *rels = ctx->relocations.data + s;
+        _add_data(out, rels->data, rels->size * sizeof(Elf32_Rel));
+        _end_section(ctx, index);
+
+        Elf32_Shdr *sec = ctx->headers.data + index;
+        sec->sh_link = symtab_index;
+        sec->sh_info = s + 1;
+        sec->sh_entsize = sizeof(Elf32_Rel);
+        sec->sh_addralign = sizeof(u32);
+    }
+
+    u32 index = _begin_section(ctx, ".symtab", SHT_SYMTAB, 0);
+    _add_data(out, ctx->symbols.data, ctx->symbols.size * sizeof(Elf32_Sym));
+    _end_section(ctx, index);
+    ctx->headers[index].sh_link = index + 1;
+    ctx->headers[index].sh_info = 1; // first global symbol
+    ctx->headers[index].sh_entsize = sizeof(Elf32_Sym);
+    ctx->stats->symbol_count = (u32)ctx->symbols.size - 1;
+
+    index = _begin_section(ctx, ".strtab", SHT_STRTAB, 0);
+    _add_data(out, ctx->strtab.data, ctx->strtab.size);
+    _end_section(ctx, index);
+
+    // the name has to be added before the section is written
+    index = _begin_section(ctx, ".shstrtab", SHT_STRTAB, 0);
+    _add_data(out, ctx->shstrtab.data, ctx->shstrtab.size);
+    _end_section(ctx, index);
+    u32 shstrtab_index = index;
+
+    _pad(out, SECTION_ALIGNMENT);
+
+    copy_memory("\x7f" "ELF", ehdr.e_ident, 4);
+    ehdr.e_ident[EI_CLASS] = ELFCLASS32;
+    ehdr.e_ident[EI_DATA] = ELFDATA2LSB;
+    ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+    ehdr.e_type = ET_EXEC;
+    ehdr.e_machine = EM_MIPS;
+    ehdr.e_version = EV_CURRENT;
+    ehdr.e_entry = ctx->functions[0].vaddr;
+    ehdr.e_phoff = sizeof(Elf32_Ehdr);
+    ehdr.e_flags = ELF_FLAGS;
+    ehdr.e_ehsize = sizeof(Elf32_Ehdr);
+    ehdr.e_phentsize = sizeof(Elf32_Phdr);
+    ehdr.e_phnum = 1;
+    ehdr.e_shentsize = sizeof(Elf32_Shdr);
+    ehdr.e_shnum = (u16)ctx->headers.size;
+    ehdr.e_shstrndx = (u16)shstrtab_index;
+    ehdr.e_shoff = _add_data(out, ctx->headers.data, ctx->headers.size * sizeof(Elf32_Shdr));
+
+    // like in PRXs, the physical address of the segment is the file offset of the module info
+    phdr.p_type = PT_LOAD;
+    phdr.p_offset = ctx->alloc_offset;
+    phdr.p_vaddr = BASE_VADDR;
+    phdr.p_paddr = module_info_offset;
+    phdr.p_filesz = alloc_size;
+    phdr.p_memsz = alloc_size;
+    phdr.p_flags = PF_R | PF_W | PF_X;
+    phdr.p_align = SECTION_ALIGNMENT;
+
+    copy_memory(&ehdr, out->data, sizeof(Elf32_Ehdr));
+    copy_memory(&phdr, out->data + sizeof(Elf32_Ehdr), sizeof(Elf32_Phdr));
+}
+
+bool generate_psp_elf(const elfgen_config *conf, array<char> *out, elfgen_stats *stats, error *err)
+{
+    assert(conf != nullptr);
+    assert(out != nullptr);
+
+    if (!_validate_config(conf, err))
+        return false;
+
+    elfgen_stats _stats;
+
+    if (stats == nullptr)
+        stats = &_stats;
+
+    fill_memory(stats, 0, sizeof(elfgen_stats));
+
+    elfgen_ctx ctx;
+    ctx.conf = conf;
+    ctx.stats = stats;
+    ctx.x = conf->seed != 0 ? conf->seed : DEFAULT_SEED; // xorshift gets stuck at 0
+    ctx.export_module = nullptr;
+    ctx.export_count = 0;
+    ctx.out = out;
+    ctx.alloc_offset = 0;
+
+    ctx.parse_conf.vaddr = 0;
+    ctx.parse_conf.log = nullptr;
+    ctx.parse_conf.verbose = false;
+    ctx.parse_conf.emit_pseudo = false;
+
+    ::init(&ctx.functions);
+    ::init(&ctx.imports);
+    ::init(&ctx.stubs);
+    ::init(&ctx.headers);
+    ::init(&ctx.symbols);
+    ::init(&ctx.relocations);
+    ::init(&ctx.strtab);
+    ::init(&ctx.shstrtab);
+
+    defer
+    {
+        ::free(&ctx.functions);
+        ::free(&ctx.imports);
+        ::free(&ctx.stubs);
+        ::free(&ctx.headers);
+        ::free(&ctx.symbols);
+
+        for_array(rels, &ctx.relocations)
+            ::free(rels);
+
+        ::free(&ctx.relocations);
+        ::free(&ctx.strtab);
+        ::free(&ctx.shstrtab);
+    };
+
+    _init_categories(&ctx);
+    ::resize(out, 0);
+    _generate(&ctx);
+
+    return true;
+}
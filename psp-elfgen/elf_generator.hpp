@@ -0,0 +1,77 @@
+
+#pragma once
+
+#include "shl/array.hpp"
+#include "shl/number_types.hpp"
+#include "shl/error.hpp"
+
+/*
+ELF GENERATOR
+
+Generates little-endian MIPS PSP ELFs for testing and benchmarking, so large
+modules don't have to come from games.
+
+The code is split into functions with a prologue and an epilogue, the
+instructions in between are picked by the weights of the categories below.
+Every instruction decodes to a known mnemonic with valid arguments. Branches
+stay within their function, jumps and calls go to other functions or to the
+import stubs, and every j and jal has a relocation.
+
+Besides the text sections, a module has the sections of a PRX built with the
+pspsdk: .sceStub.text with one stub per imported function,
+.rodata.sceResident and .rodata.sceNid with the exported and imported NIDs,
+.lib.ent and .lib.stub with the export and import tables and
+.rodata.sceModuleInfo. Imported functions and the functions of the library
+export are real functions of psp_modules, so imports resolve to their names.
+Every function and stub has a symbol in .symtab.
+
+The same config and seed always generate the same module.
+*/
+
+enum class elfgen_category : u8
+{
+    Special,    // primary opcode 0, e.g. addu, sll, mult
+    Immediate,  // e.g. addiu, lui, ori
+    LoadStore,  // e.g. lw, sb, ll
+    Branch,     // branches within a function, j and jal
+    Cop1,       // FPU, including its loads and stores
+    Special2_3, // allegrex extensions, e.g. ext, seb, bitrev
+    Vfpu,       // VFPU, including its loads and stores
+    _MAX
+};
+
+#define ELFGEN_CATEGORY_COUNT ((u32)elfgen_category::_MAX)
+
+const char *elfgen_category_name(elfgen_category cat);
+
+struct elfgen_config
+{
+    u32 seed;
+    u32 code_size;             // bytes of code, split evenly across the text sections
+    u32 section_count;         // number of text sections
+    u32 average_function_size; // in instructions
+    u32 import_module_count;
+    u32 imports_per_module;    // at most, modules with fewer functions import all of them
+    u32 export_count;          // functions of the library export, at most
+    u32 category_weights[ELFGEN_CATEGORY_COUNT];
+    const char *module_name;
+};
+
+struct elfgen_stats
+{
+    u32 function_count;
+    u32 instruction_count;
+    u32 import_count;
+    u32 import_module_count;
+    u32 export_count;
+    u32 symbol_count;
+    u32 relocation_count;
+    u32 category_counts[ELFGEN_CATEGORY_COUNT];
+};
+
+// sets the default config
+void init(elfgen_config *conf);
+
+/* generates the ELF of conf into out, which is resized to fit.
+stats is optional. */
+bool generate_psp_elf(const elfgen_config *conf, array<char> *out, elfgen_stats *stats = nullptr, error *err = nullptr);
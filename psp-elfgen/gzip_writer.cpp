@@ -0,0 +1,138 @@
+#include "shl/memory.hpp"
+#include "shl/defer.hpp"
+
+#include "allegrex/inflate.hpp"
+#include "psp-elfgen/gzip_writer.hpp"
+
+#define GZIP_HASH_BITS 15
+
+struct gzip_bit_writer
+{
+    array<u8> *out;
+    u64 bits;
+    u32 bit_count;
+};
+
+static void _put_bits(gzip_bit_writer *w, u32 value, u32 count)
+{
+    w->bits |= (u64)value << w->bit_count;
+    w->bit_count += count;
+
+    while (w->bit_count >= 8)
+    {
+        ::add_at_end(w->out, (u8)w->bits);
+        w->bits >>= 8;
+        w->bit_count -= 8;
+    }
+}
+
+// Huffman codes are stored starting with their most significant bit
+static void _put_code(gzip_bit_writer *w, u32 code, u32 length)
+{
+    u32 reversed = 0;
+
+    for (u32 i = 0; i < length; ++i)
+        reversed |= ((code >> i) & 1) << (length - 1 - i);
+
+    _put_bits(w, reversed, length);
+}
+
+static void _put_fixed_literal(gzip_bit_writer *w, u32 sym)
+{
+    if (sym < 144)      _put_code(w, 0x30 + sym, 8);
+    else if (sym < 256) _put_code(w, 0x190 + sym - 144, 9);
+    else if (sym < 280) _put_code(w, sym - 256, 7);
+    else                _put_code(w, 0xC0 + sym - 280, 8);
+}
+
+static void _put_fixed_match(gzip_bit_writer *w, u32 length, u32 distance)
+{
+    static const u16 length_base[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    static const u8 length_extra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    static const u16 dist_base[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    static const u8 dist_extra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+    u32 l = 28;
+
+    while (length_base[l] > length)
+        l -= 1;
+
+    u32 d = 29;
+
+    while (dist_base[d] > distance)
+        d -= 1;
+
+    _put_fixed_literal(w, 257 + l);
+    _put_bits(w, length - length_base[l], length_extra[l]);
+    _put_code(w, d, 5);
+    _put_bits(w, distance - dist_base[d], dist_extra[d]);
+}
+
+static u32 _gzip_hash(const u8 *p)
+{
+    return (((u32)p[0] << 16) | ((u32)p[1] << 8) | p[2]) * 2654435761u >> (32 - GZIP_HASH_BITS);
+}
+
+void gzip_fixed(const u8 *data, u32 size, array<u8> *out)
+{
+    const u8 header[10] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 3 };
+    ::add_at_end(out, header, sizeof(header));
+
+    gzip_bit_writer w{out, 0, 0};
+    _put_bits(&w, 1, 1); // final block
+    _put_bits(&w, 1, 2); // fixed codes
+
+    array<u32> head;
+    ::init(&head);
+    defer { ::free(&head); };
+    ::resize(&head, 1 << GZIP_HASH_BITS);
+    fill_memory(head.data, 0xff, head.size * sizeof(u32));
+
+    u32 pos = 0;
+
+    while (pos < size)
+    {
+        u32 length = 0;
+        u32 distance = 0;
+
+        if (pos + 3 <= size)
+        {
+            u32 h = _gzip_hash(data + pos);
+            u32 candidate = head[h];
+            head[h] = pos;
+
+            if (candidate != 0xffffffff && pos - candidate <= 32768)
+            {
+                u32 max_length = Min(258u, size - pos);
+
+                while (length < max_length && data[candidate + length] == data[pos + length])
+                    length += 1;
+
+                distance = pos - candidate;
+            }
+        }
+
+        if (length < 3)
+        {
+            _put_fixed_literal(&w, data[pos]);
+            pos += 1;
+            continue;
+        }
+
+        _put_fixed_match(&w, length, distance);
+
+        // later matches may start anywhere within this one
+        u32 end = pos + length;
+
+        for (pos += 1; pos < end && pos + 3 <= size; ++pos)
+            head[_gzip_hash(data + pos)] = pos;
+
+        pos = end;
+    }
+
+    _put_fixed_literal(&w, 256);
+    _put_bits(&w, 0, (8 - w.bit_count) & 7); // the trailer starts at a byte
+
+    _put_bits(&w, gzip_crc32(0, data, size), 32);
+    _put_bits(&w, size, 32);
+}
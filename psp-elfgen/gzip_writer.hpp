@@ -0,0 +1,10 @@
+
+#pragma once
+
+#include "shl/array.hpp"
+#include "shl/number_types.hpp"
+
+/* gzip with a single fixed Huffman block and greedy matching, far from what
+   zlib achieves, but the output inflates like any other gzip data.
+   Appends the gzip data of size bytes at data to out. */
+void gzip_fixed(const u8 *data, u32 size, array<u8> *out);
@@ -0,0 +1,348 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "shl/file_stream.hpp"
+#include "shl/string.hpp"
+#include "shl/print.hpp"
+#include "shl/error.hpp"
+#include "shl/defer.hpp"
+
+#include "allegrex/prx_decrypt.hpp"
+#include "psp-elfgen/config.hpp"
+#include "psp-elfgen/elf_generator.hpp"
+#include "psp-elfgen/gzip_writer.hpp"
+#include "tests/prx_fixture.hpp"
+
+#define PRX_TAG 0xD91605F0 // a user module tag that pspEncryptPRX supports
+
+struct arguments
+{
+    elfgen_config conf;
+    bool encrypt;  // --encrypt
+    bool compress; // --compress
+    const_string output_file;
+};
+
+static void _print_usage()
+{
+    puts("Usage: " psp_elfgen_NAME " [-h] [-s SIZE] [-n SECTIONS] [--seed SEED] [-w CATEGORY=WEIGHT]\n"
+         "                  [--function-size INSTRUCTIONS] [--imports MODULES] [--imports-per-module COUNT]\n"
+         "                  [--exports COUNT] [--name NAME] [--encrypt] [--compress] OUTFILE\n"
+         "\n"
+         psp_elfgen_NAME " v" psp_elfgen_VERSION ": generates PSP ELFs for testing and benchmarking\n"
+         "by " psp_elfgen_AUTHOR "\n"
+         "\n"
+         "Optional arguments:\n"
+         "  -h, --help                  show this help and exit\n"
+         "  -s, --size SIZE             SIZE bytes of code (default: 1048576)\n"
+         "  -n, --sections SECTIONS     split the code into SECTIONS text sections (default: 16)\n"
+         "  --seed SEED                 the seed of the generator, the same arguments and seed\n"
+         "                              always generate the same ELF\n"
+         "  -w CATEGORY=WEIGHT          relative weight of an instruction category, one of\n"
+         "                              special (22), immediate (20), load/store (24), branch (10),\n"
+         "                              cop1 (8), special2/3 (4) and vfpu (12), default in brackets.\n"
+         "                              may be passed multiple times.\n"
+         "  --function-size INSTRUCTIONS\n"
+         "                              average number of instructions per function (default: 64)\n"
+         "  --imports MODULES           import functions of MODULES modules (default: 16)\n"
+         "  --imports-per-module COUNT  import up to COUNT functions per module (default: 16)\n"
+         "  --exports COUNT             export up to COUNT functions besides module_start and\n"
+         "                              module_stop (default: 16)\n"
+         "  --name NAME                 the module name in .rodata.sceModuleInfo (default: elfgen)\n"
+         "  --encrypt                   write an encrypted PRX instead of the ELF\n"
+         "  --compress                  write a gzip compressed and encrypted PRX instead of the ELF\n"
+         "\n"
+         "Arguments:\n"
+         "  OUTFILE                     the file to write the ELF or PRX to\n"
+         );
+}
+
+static bool _parse_weight(const char *arg, elfgen_config *conf, error *err)
+{
+    const char *eq = strchr(arg, '=');
+
+    if (eq == nullptr)
+    {
+        format_error(err, 1, "-w expects CATEGORY=WEIGHT, got '%s'", arg);
+        return false;
+    }
+
+    u64 name_length = eq - arg;
+
+    for (u32 c = 0; c < ELFGEN_CATEGORY_COUNT; ++c)
+    {
+        const char *name = elfgen_category_name((elfgen_category)c);
+
+        if (strlen(name) == name_length && strncmp(name, arg, name_length) == 0)
+        {
+            conf->category_weights[c] = string_to_u32(eq + 1, nullptr, 0);
+            return true;
+        }
+    }
+
+    format_error(err, 1, "unknown instruction category in '%s'", arg);
+    return false;
+}
+
+static bool _parse_arguments(int argc, const char **argv, arguments *out, error *err)
+{
+    for (int i = 1; i < argc;)
+    {
+        const_string arg = to_const_string(argv[i]);
+
+        if (arg == "-h"_cs || arg == "--help"_cs)
+        {
+            _print_usage();
+            exit(0);
+        }
+
+        if (arg == "-s"_cs || arg == "--size"_cs)
+        {
+            if (i >= argc - 1)
+            {
+                format_error(err, 1, "%s expects a positional argument: the size in bytes", arg.c_str);
+                return false;
+            }
+
+            out->conf.code_size = string_to_u32(argv[i + 1], nullptr, 0);
+            i += 2;
+            continue;
+        }
+
+        if (arg == "-n"_cs || arg == "--sections"_cs)
+        {
+            if (i >= argc - 1)
+            {
+                format_error(err, 1, "%s expects a positional argument: the number of sections", arg.c_str);
+                return false;
+            }
+
+            out->conf.section_count = string_to_u32(argv[i + 1], nullptr, 0);
+            i += 2;
+            continue;
+        }
+
+        if (arg == "--seed"_cs)
+        {
+            if (i >= argc - 1)
+            {
+                format_error(err, 1, "%s expects a positional argument: the seed", arg.c_str);
+                return false;
+            }
+
+            out->conf.seed = string_to_u32(argv[i + 1], nullptr, 0);
+            i += 2;
+            continue;
+        }
+
+        if (arg == "-w"_cs)
+        {
+            if (i >= argc - 1)
+            {
+                format_error(err, 1, "%s expects a positional argument: CATEGORY=WEIGHT", arg.c_str);
+                return false;
+            }
+
+            if (!_parse_weight(argv[i + 1], &out->conf, err))
+                return false;
+
+            i += 2;
+            continue;
+        }
+
+        if (arg == "--function-size"_cs)
+        {
+            if (i >= argc - 1)
+            {
+                format_error(err, 1, "%s expects a positional argument: the number of instructions", arg.c_str);
+                return false;
+            }
+
+            out->conf.average_function_size = string_to_u32(argv[i + 1], nullptr, 0);
+            i += 2;
+            continue;
+        }
+
+        if (arg == "--imports"_cs)
+        {
+            if (i >= argc - 1)
+            {
+                format_error(err, 1, "%s expects a positional argument: the number of modules", arg.c_str);
+                return false;
+            }
+
+            out->conf.import_module_count = string_to_u32(argv[i + 1], nullptr, 0);
+            i += 2;
+            continue;
+        }
+
+        if (arg == "--imports-per-module"_cs)
+        {
+            if (i >= argc - 1)
+            {
+                format_error(err, 1, "%s expects a positional argument: the number of functions", arg.c_str);
+                return false;
+            }
+
+            out->conf.imports_per_module = string_to_u32(argv[i + 1], nullptr, 0);
+            i += 2;
+            continue;
+        }
+
+        if (arg == "--exports"_cs)
+        {
+            if (i >= argc - 1)
+            {
+                format_error(err, 1, "%s expects a positional argument: the number of functions", arg.c_str);
+                return false;
+            }
+
+            out->conf.export_count = string_to_u32(argv[i + 1], nullptr, 0);
+            i += 2;
+            continue;
+        }
+
+        if (arg == "--name"_cs)
+        {
+            if (i >= argc - 1)
+            {
+                format_error(err, 1, "%s expects a positional argument: the module name", arg.c_str);
+                return false;
+            }
+
+            out->conf.module_name = argv[i + 1];
+            i += 2;
+            continue;
+        }
+
+        if (arg == "--encrypt"_cs)
+        {
+            out->encrypt = true;
+            i += 1;
+            continue;
+        }
+
+        if (arg == "--compress"_cs)
+        {
+            out->compress = true;
+            i += 1;
+            continue;
+        }
+
+        if (string_begins_with(arg, "-"_cs))
+        {
+            format_error(err, 1, "unknown argument '%s'", arg.c_str);
+            return false;
+        }
+
+        out->output_file = arg;
+        i += 1;
+    }
+
+    if (string_is_blank(out->output_file))
+    {
+        set_error(err, 1, "no output file given");
+        return false;
+    }
+
+    return true;
+}
+
+static bool _write_file(const char *path, const void *data, u64 size, error *err)
+{
+    file_stream out{};
+
+    if (!init(&out, path, open_mode::WriteTrunc, err))
+        return false;
+
+    defer { free(&out); };
+
+    return write(&out, data, size, err) >= 0;
+}
+
+// the PSP only loads compressed modules if they are also encrypted
+static bool _write_prx(const char *path, const array<char> *elf, bool compress, error *err)
+{
+    array<u8> gz;
+    ::init(&gz);
+    defer { ::free(&gz); };
+
+    const u8 *data = (const u8*)elf->data;
+    u32 size = (u32)elf->size;
+    u32 decompressed_size = 0;
+
+    if (compress)
+    {
+        gzip_fixed(data, size, &gz);
+        data = gz.data;
+        size = (u32)gz.size;
+        decompressed_size = (u32)elf->size;
+    }
+
+    array<u8> prx;
+    ::init(&prx);
+    defer { ::free(&prx); };
+    ::resize(&prx, prx_encrypted_size(size));
+
+    int prx_size = pspEncryptPRX(data, size, prx.data, PRX_TAG, prx_type::Type2, decompressed_size);
+
+    if (prx_size < 0)
+    {
+        set_error(err, 1, "could not encrypt module");
+        return false;
+    }
+
+    return _write_file(path, prx.data, (u64)prx_size, err);
+}
+
+int main(int argc, const char **argv)
+{
+    arguments args{};
+    init(&args.conf);
+    args.output_file = ""_cs;
+
+    error err{};
+
+    if (!_parse_arguments(argc, argv, &args, &err))
+    {
+        tprint("Error: %\n", err.what);
+        return err.error_code;
+    }
+
+    array<char> elf;
+    ::init(&elf);
+    defer { ::free(&elf); };
+
+    elfgen_stats stats;
+
+    if (!generate_psp_elf(&args.conf, &elf, &stats, &err))
+    {
+        tprint("Error: %\n", err.what);
+        return err.error_code;
+    }
+
+    bool ok;
+
+    if (args.encrypt || args.compress)
+        ok = _write_prx(args.output_file.c_str, &elf, args.compress, &err);
+    else
+        ok = _write_file(args.output_file.c_str, elf.data, elf.size, &err);
+
+    if (!ok)
+    {
+        tprint("Error: %\n", err.what);
+        return err.error_code;
+    }
+
+    tprint("%s: %u bytes ELF, %u sections, %u functions, %u instructions, %u symbols, %u relocations\n",
+           args.output_file.c_str, (u32)elf.size, args.conf.section_count, stats.function_count,
+           stats.instruction_count, stats.symbol_count, stats.relocation_count);
+
+    tprint("  %u imported functions of %u modules, %u exported functions\n",
+           stats.import_count, stats.import_module_count, stats.export_count);
+
+    for (u32 c = 0; c < ELFGEN_CATEGORY_COUNT; ++c)
+        tprint("  %-12s %u\n", elfgen_category_name((elfgen_category)c), stats.category_counts[c]);
+
+    return 0;
+}
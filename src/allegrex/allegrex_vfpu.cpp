@@ -560,7 +560,7 @@ const char *register_name(vfpu_register reg)
             return "(interlock)";
     }
 
-    if (reg.num >= 128)
+    if (reg.num >= 128 || reg.size == vfpu_size::Invalid)
     {
         return "?";
     }
@@ -1020,6 +1020,10 @@ static const char *_vfpu_constant_names[] = {
 
 const char *vfpu_constant_name(vfpu_constant constant)
 {
+    // the constant field of vcst has 5 bits, the rest are undefined
+    if (value(constant) >= sizeof(_vfpu_constant_names) / sizeof(_vfpu_constant_names[0]))
+        return _vfpu_constant_names[0];
+
     return _vfpu_constant_names[value(constant)];
 }
 
@@ -0,0 +1,109 @@
+#include <assert.h>
+#include <atomic>
+#include <mutex>
+
+#include "shl/array.hpp"
+#include "shl/defer.hpp"
+#include "shl/file_stream.hpp"
+#include "allegrex/psp_elf.hpp"
+#include "allegrex/batch_decrypt.hpp"
+#include "allegrex/trace.hpp"
+#include "allegrex/worker_pool.hpp"
+
+static void _decrypt_file(batch_decrypt_file *file)
+{
+    ALLEGREX_TRACE_FILE(file->input_path);
+
+    file->decrypted_size = 0;
+    file->decrypt_info = {prx_type::Unknown, 0};
+    file->err = {};
+
+    file_stream in{};
+
+    if (!init(&in, file->input_path, open_mode::Read, &file->err))
+    {
+        file->status = batch_decrypt_status::Failed;
+        return;
+    }
+
+    defer { free(&in); };
+
+    array<u8> decrypted;
+    ::init(&decrypted);
+    defer { ::free(&decrypted); };
+
+    s64 sz = decrypt_elf(&in, &decrypted, &file->decrypt_info, &file->err);
+
+    if (sz < 0)
+    {
+        file->status = batch_decrypt_status::Failed;
+        return;
+    }
+
+    if (sz == 0)
+    {
+        file->status = batch_decrypt_status::NotEncrypted;
+        return;
+    }
+
+    file_stream out{};
+
+    if (!init(&out, file->output_path, open_mode::WriteTrunc, &file->err))
+    {
+        file->status = batch_decrypt_status::Failed;
+        return;
+    }
+
+    defer { free(&out); };
+
+    if (write(&out, decrypted.data, (u64)sz, &file->err) < 0)
+    {
+        file->status = batch_decrypt_status::Failed;
+        return;
+    }
+
+    ALLEGREX_STATS_ADD(BytesWritten, sz);
+
+    file->decrypted_size = sz;
+    file->status = batch_decrypt_status::Decrypted;
+}
+
+u64 batch_decrypt(batch_decrypt_file *files, u64 count, const batch_decrypt_config *conf)
+{
+    assert(files != nullptr || count == 0);
+    assert(conf != nullptr);
+
+    for (u64 i = 0; i < count; ++i)
+        files[i].status = batch_decrypt_status::Pending;
+
+    std::atomic<u64> next_file = 0;
+    std::atomic<u64> failed = 0;
+    std::mutex report_mutex;
+
+    u32 thread_count = get_worker_count(conf->thread_count, count, MAX_BATCH_DECRYPT_THREADS);
+
+    run_workers(thread_count, [&](u32)
+    {
+        while (true)
+        {
+            u64 i = next_file.fetch_add(1);
+
+            if (i >= count)
+                break;
+
+            batch_decrypt_file *file = files + i;
+            _decrypt_file(file);
+
+            if (file->status == batch_decrypt_status::Failed)
+                failed.fetch_add(1);
+
+            if (conf->on_file_done != nullptr)
+            {
+                std::lock_guard<std::mutex> lock(report_mutex);
+                conf->on_file_done(file, conf->userdata);
+            }
+        }
+    });
+
+    return failed.load();
+}
@@ -0,0 +1,68 @@
+
+#pragma once
+
+#include "shl/number_types.hpp"
+#include "shl/error.hpp"
+
+#include "allegrex/prx_decrypt.hpp"
+
+/*
+BATCH DECRYPTION
+
+Decrypts many encrypted PSP executables / modules (e.g. all PRX files of a
+firmware or UMD dump) on multiple threads and writes the decrypted ELFs to
+files. Each file is read, decrypted with decrypt_elf and written by a single
+worker thread.
+
+Usage:
+
+    batch_decrypt_file files[2]{};
+    files[0].input_path = "dump/kd/a.prx";
+    files[0].output_path = "out/a.prx";
+    files[1].input_path = "dump/kd/b.prx";
+    files[1].output_path = "out/b.prx";
+
+    batch_decrypt_config conf{};
+    conf.thread_count = 0;
+    conf.on_file_done = print_status; // optional
+
+    u64 failed = batch_decrypt(files, 2, &conf);
+*/
+
+#define MAX_BATCH_DECRYPT_THREADS 64
+
+enum class batch_decrypt_status : u8
+{
+    Pending,
+    Decrypted,    // decrypted and written to output_path
+    NotEncrypted, // input is a regular ELF, nothing is written
+    Failed        // see err
+};
+
+struct batch_decrypt_file
+{
+    const char *input_path;
+    const char *output_path;
+
+    // set by batch_decrypt
+    batch_decrypt_status status;
+    s64 decrypted_size;
+    prx_decrypt_info decrypt_info; // PRX type and number of decryption attempts
+    error err; // the message is only guaranteed to be valid within on_file_done
+};
+
+struct batch_decrypt_config
+{
+    /* Number of worker threads.
+       1 decrypts everything on the calling thread,
+       0 uses as many threads as the hardware supports. */
+    u32 thread_count;
+
+    /* If not nullptr, called after each file is done, from the thread that
+       decrypted it. Calls are never concurrent. */
+    void (*on_file_done)(const batch_decrypt_file *file, void *userdata);
+    void *userdata;
+};
+
+// returns the number of files that failed
+u64 batch_decrypt(batch_decrypt_file *files, u64 count, const batch_decrypt_config *conf);
@@ -0,0 +1,187 @@
+#include "shl/assert.hpp"
+
+#include "allegrex/compact_instructions.hpp"
+#include "allegrex/stats.hpp"
+
+void init(compact_instructions *instrs)
+{
+    assert(instrs != nullptr);
+
+    ::init(&instrs->opcodes);
+    ::init(&instrs->mnemonics);
+    ::init(&instrs->ranges);
+    instrs->emit_pseudo = false;
+}
+
+void free(compact_instructions *instrs)
+{
+    assert(instrs != nullptr);
+
+    ::free(&instrs->ranges);
+    ::free(&instrs->mnemonics);
+    ::free(&instrs->opcodes);
+}
+
+void parse_instructions(const char *input, u64 size, compact_instructions *out_instructions, array<jump_destination> *out_jumps, const parse_instructions_config *conf)
+{
+    assert(out_instructions != nullptr);
+    assert(conf != nullptr);
+    assert(size % sizeof(u32) == 0);
+    assert(size <= max_value(u32));
+
+    ALLEGREX_STATS_TIMER(ParseInstructions);
+
+    // arguments are decoded again later, with the same setting
+    if (out_instructions->ranges.size == 0)
+        out_instructions->emit_pseudo = conf->emit_pseudo;
+
+    assert(out_instructions->emit_pseudo == conf->emit_pseudo);
+
+    u32 instruction_count = (u32)(size / sizeof(u32));
+
+    compact_instruction_range *range = ::add_at_end(&out_instructions->ranges);
+    range->vaddr = conf->vaddr;
+    range->start_index = (u32)out_instructions->opcodes.size;
+    range->count = instruction_count;
+
+    ::reserve(&out_instructions->opcodes, out_instructions->opcodes.size + instruction_count);
+    ::reserve(&out_instructions->mnemonics, out_instructions->mnemonics.size + instruction_count);
+
+    const u32 *in_data = (const u32*)(input);
+    instruction inst;
+    u64 first_jump = out_jumps != nullptr ? out_jumps->size : 0;
+    u32 unknown = 0;
+
+    for (u32 addr = 0x00000000, i = 0; addr < size; addr += sizeof(u32), ++i)
+    {
+        inst = {};
+        inst.opcode = in_data[i];
+        inst.address = conf->vaddr + addr;
+
+        parse_instruction(inst.opcode, &inst, out_jumps, conf);
+
+        ::add_at_end(&out_instructions->opcodes, inst.opcode);
+        ::add_at_end(&out_instructions->mnemonics, inst.mnemonic);
+
+        if (inst.mnemonic == allegrex_mnemonic::_UNKNOWN)
+            unknown += 1;
+    }
+
+    ALLEGREX_STATS_ADD(InstructionsDecoded, instruction_count);
+    ALLEGREX_STATS_ADD(UnknownOpcodes, unknown);
+    add_jump_stats(out_jumps, first_jump);
+}
+
+u64 get_memory_size(const compact_instructions *instrs)
+{
+    assert(instrs != nullptr);
+
+    return instrs->opcodes.size * sizeof(u32)
+         + instrs->mnemonics.size * sizeof(allegrex_mnemonic)
+         + instrs->ranges.size * sizeof(compact_instruction_range)
+         + sizeof(compact_instructions);
+}
+
+static u64 _get_range_index(const compact_instructions *instrs, u64 index)
+{
+    // last range with start_index <= index
+    u64 lo = 0;
+    u64 hi = instrs->ranges.size;
+
+    while (hi - lo > 1)
+    {
+        u64 mid = lo + (hi - lo) / 2;
+
+        if (instrs->ranges[mid].start_index <= index)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+static void _decode_instruction(const compact_instructions *instrs, const compact_instruction_range *range, u64 index, instruction *out)
+{
+    assert(index >= range->start_index && index < range->start_index + range->count);
+
+    parse_instructions_config conf;
+    conf.vaddr = range->vaddr;
+    conf.log = nullptr;
+    conf.verbose = false;
+    conf.emit_pseudo = instrs->emit_pseudo;
+
+    *out = {};
+    out->opcode = instrs->opcodes[index];
+    out->address = range->vaddr + (u32)((index - range->start_index) * sizeof(u32));
+
+    parse_instruction(out->opcode, out, nullptr, &conf);
+
+    assert(out->mnemonic == instrs->mnemonics[index]);
+}
+
+u32 get_instruction_address(const compact_instructions *instrs, u64 index)
+{
+    assert(instrs != nullptr);
+    assert(index < instrs->opcodes.size);
+
+    const compact_instruction_range *range = instrs->ranges.data + _get_range_index(instrs, index);
+
+    return range->vaddr + (u32)((index - range->start_index) * sizeof(u32));
+}
+
+void get_instruction(const compact_instructions *instrs, u64 index, instruction *out)
+{
+    assert(instrs != nullptr);
+    assert(out != nullptr);
+    assert(index < instrs->opcodes.size);
+
+    const compact_instruction_range *range = instrs->ranges.data + _get_range_index(instrs, index);
+
+    _decode_instruction(instrs, range, index, out);
+}
+
+compact_instruction_iterator iterate_instructions(const compact_instructions *instrs, u64 start, u64 count)
+{
+    assert(instrs != nullptr);
+    assert(start <= instrs->opcodes.size);
+
+    compact_instruction_iterator ret;
+    ret.instructions = instrs;
+    ret.index = start;
+    ret.end = instrs->opcodes.size;
+
+    if (count < ret.end - start)
+        ret.end = start + count;
+
+    ret.range_index = 0;
+
+    if (start < ret.end)
+        ret.range_index = _get_range_index(instrs, start);
+
+    ret.current = {};
+
+    return ret;
+}
+
+bool next(compact_instruction_iterator *it)
+{
+    assert(it != nullptr);
+
+    if (it->index >= it->end)
+        return false;
+
+    const compact_instructions *instrs = it->instructions;
+    const compact_instruction_range *range = instrs->ranges.data + it->range_index;
+
+    while (it->index >= range->start_index + range->count)
+    {
+        it->range_index += 1;
+        range += 1;
+    }
+
+    _decode_instruction(instrs, range, it->index, &it->current);
+    it->index += 1;
+
+    return true;
+}
@@ -0,0 +1,90 @@
+
+#pragma once
+
+#include "shl/number_types.hpp"
+#include "shl/array.hpp"
+
+#include "allegrex/instruction.hpp"
+#include "allegrex/parse_instructions.hpp"
+
+/*
+COMPACT INSTRUCTIONS
+
+An alternative to array<instruction> which only stores the opcode and the
+mnemonic of each instruction in two parallel arrays (6 bytes per instruction
+instead of sizeof(instruction)).
+Addresses are implied by the vaddr of the range an instruction was parsed in
+and arguments are decoded with parse_instruction when an instruction is accessed.
+
+Usage:
+
+    compact_instructions instrs;
+    init(&instrs);
+
+    parse_instructions(data, size, &instrs, &jumps, &conf);
+
+    compact_instruction_iterator it = iterate_instructions(&instrs);
+
+    while (next(&it))
+        do_something(&it.current);
+
+    free(&instrs);
+*/
+
+struct compact_instruction_range
+{
+    u32 vaddr;
+    u32 start_index; // index into opcodes / mnemonics
+    u32 count;
+};
+
+struct compact_instructions
+{
+    array<u32> opcodes;
+    array<allegrex_mnemonic> mnemonics;
+
+    /* consecutive instructions parsed with one call to parse_instructions,
+       sorted by start_index. */
+    array<compact_instruction_range> ranges;
+
+    // whether pseudoinstructions were emitted while parsing, used when decoding arguments
+    bool emit_pseudo;
+};
+
+void init(compact_instructions *instrs);
+void free(compact_instructions *instrs);
+
+/* Parses as many instructions as there are in input, like parse_instructions with an array.
+size in bytes, not number of instructions.
+Appends all instructions to the end of out_instructions as a new range starting at conf->vaddr.
+*/
+void parse_instructions(const char *input, u64 size, compact_instructions *out_instructions, array<jump_destination> *out_jumps, const parse_instructions_config *conf);
+
+// number of bytes used by the instructions, excluding unused reserved memory
+u64 get_memory_size(const compact_instructions *instrs);
+
+u32 get_instruction_address(const compact_instructions *instrs, u64 index);
+
+/* Decodes the instruction at index into out, the same instruction parse_instructions
+would have produced.
+*/
+void get_instruction(const compact_instructions *instrs, u64 index, instruction *out);
+
+struct compact_instruction_iterator
+{
+    const compact_instructions *instructions;
+    u64 index; // index of the next instruction
+    u64 end;
+    u64 range_index;
+    instruction current;
+};
+
+#define ITERATE_ALL_INSTRUCTIONS max_value(u64)
+
+/* Returns an iterator over count instructions starting at index start.
+Call next() to decode the next instruction into iterator.current.
+*/
+compact_instruction_iterator iterate_instructions(const compact_instructions *instrs, u64 start = 0, u64 count = ITERATE_ALL_INSTRUCTIONS);
+
+// returns false if there are no more instructions
+bool next(compact_instruction_iterator *it);
@@ -1,7 +1,31 @@
 
+#include <atomic>
+
 #include "shl/defer.hpp"
 #include "shl/streams.hpp"
 #include "allegrex/disassemble.hpp"
+#include "allegrex/worker_pool.hpp"
+
+// a part of a section, decoded by a single thread
+struct disassembly_chunk
+{
+    const char *data;
+    u64 size;
+    u32 vaddr;
+    instruction *instructions;
+};
+
+#define DEFAULT_DISASSEMBLY_CONFIG(NAME)\
+    psp_disassembly_config NAME;\
+    NAME.thread_count = 1;
+
+#define DISASSEMBLY_PARSE_ELF_CONFIG(NAME, LOG)\
+    psp_parse_elf_config NAME{};\
+    NAME.section = ""_cs;\
+    NAME.vaddr = INFER_VADDR;\
+    NAME.verbose = false;\
+    NAME.log = LOG;\
+    NAME.map_file = true;
 
 void init(psp_disassembly *disasm)
 {
@@ -23,44 +47,120 @@ void free(psp_disassembly *disasm)
     free(&disasm->psp_module);
 }
 
-static void _add_symbols_to_jumps(set<jump_destination> *jumps, hash_table<u32, elf_symbol> *syms)
+static void _add_symbols_to_jumps(array<jump_destination> *jumps, hash_table<u32, elf_symbol> *syms)
 {
     // this adds symbols as jumps so they appear in the disassembly
     for_hash_table(k, _, syms)
-        ::insert_element(jumps, jump_destination{*k, jump_type::Jump});
+        ::add_at_end(jumps, jump_destination{*k, jump_type::Jump});
 }
 
-static void _add_imports_to_jumps(set<jump_destination> *jumps, array<module_import> *mods)
+static void _add_imports_to_jumps(array<jump_destination> *jumps, array<module_import> *mods)
 {
     for_array(mod, mods)
     {
         for_array(func, &mod->functions)
-            ::insert_element(jumps, jump_destination{func->address, jump_type::Jump});
+            ::add_at_end(jumps, jump_destination{func->address, jump_type::Jump});
     }
 }
 
-static void _add_exports_to_jumps(set<jump_destination> *jumps, array<module_export> *mods)
+static void _add_exports_to_jumps(array<jump_destination> *jumps, array<module_export> *mods)
 {
     for_array(mod, mods)
     {
         for_array(func, &mod->functions)
-            ::insert_element(jumps, jump_destination{func->address, jump_type::Jump});
+            ::add_at_end(jumps, jump_destination{func->address, jump_type::Jump});
     }
 }
 
+static void _decode_chunk(const disassembly_chunk *chunk, array<jump_destination> *jumps, file_stream *log)
+{
+    parse_instructions_config pconf;
+    pconf.log = log;
+    pconf.vaddr = chunk->vaddr;
+    pconf.verbose = false;
+    pconf.emit_pseudo = true;
+
+    parse_instructions(chunk->data, chunk->size, chunk->instructions, jumps, &pconf);
+}
+
+static void _decode_chunks(array<disassembly_chunk> *chunks, array<jump_destination> *out_jumps, u32 thread_count, file_stream *log)
+{
+    if (thread_count <= 1)
+    {
+        for_array(chunk, chunks)
+            _decode_chunk(chunk, out_jumps, log);
+
+        return;
+    }
+
+    // instructions are written directly into their place in all_instructions,
+    // jumps are collected per worker and appended afterwards, the order
+    // does not matter since they are sorted later.
+    array<jump_destination> worker_jumps[MAX_DISASSEMBLY_THREADS];
+    std::atomic<u64> next_chunk = 0;
+
+    for (u32 t = 0; t < thread_count; ++t)
+        ::init(worker_jumps + t);
+
+    run_workers(thread_count, [&](u32 worker)
+    {
+        while (true)
+        {
+            u64 i = next_chunk.fetch_add(1);
+
+            if (i >= chunks->size)
+                break;
+
+            _decode_chunk(chunks->data + i, worker_jumps + worker, log);
+        }
+    });
+
+    u64 jump_count = out_jumps->size;
+
+    for (u32 t = 0; t < thread_count; ++t)
+        jump_count += worker_jumps[t].size;
+
+    ::reserve(out_jumps, jump_count);
+
+    for (u32 t = 0; t < thread_count; ++t)
+    {
+        for_array(jmp, worker_jumps + t)
+            ::add_at_end(out_jumps, *jmp);
+
+        ::free(worker_jumps + t);
+    }
+}
+
+static void _disassemble_psp_module(psp_disassembly *out, const psp_disassembly_config *conf, file_stream *log);
+
 bool disassemble_psp_elf(const char *path, psp_disassembly *out, error *err)
 {
     assert(path != nullptr);
     assert(out != nullptr);
 
-    memory_stream stream{};
+    DEFAULT_DISASSEMBLY_CONFIG(conf);
+
+    return disassemble_psp_elf(path, out, &conf, err);
+}
 
-    if (!read_entire_file(path, &stream, err))
+bool disassemble_psp_elf(const char *path, psp_disassembly *out, const psp_disassembly_config *conf, error *err)
+{
+    assert(path != nullptr);
+    assert(out != nullptr);
+    assert(conf != nullptr);
+
+    file_stream log{};
+    log.handle = stdout_handle();
+
+    // maps the file, unencrypted ELFs are not copied
+    DISASSEMBLY_PARSE_ELF_CONFIG(elfconf, &log);
+
+    if (!parse_psp_module_from_elf(path, &out->psp_module, &elfconf, err))
         return false;
 
-    defer { free(&stream); };
+    _disassemble_psp_module(out, conf, &log);
 
-    return disassemble_psp_elf(&stream, out, err);
+    return true;
 }
 
 bool disassemble_psp_elf(char *data, u64 size, psp_disassembly *out, error *err)
@@ -68,11 +168,21 @@ bool disassemble_psp_elf(char *data, u64 size, psp_disassembly *out, error *err)
     assert(data != nullptr);
     assert(out != nullptr);
 
+    DEFAULT_DISASSEMBLY_CONFIG(conf);
+
+    return disassemble_psp_elf(data, size, out, &conf, err);
+}
+
+bool disassemble_psp_elf(char *data, u64 size, psp_disassembly *out, const psp_disassembly_config *conf, error *err)
+{
+    assert(data != nullptr);
+    assert(out != nullptr);
+
     memory_stream stream{};
     stream.data = data;
     stream.size = size;
 
-    return disassemble_psp_elf(&stream, out, err);
+    return disassemble_psp_elf(&stream, out, conf, err);
 }
 
 bool disassemble_psp_elf(memory_stream *in, psp_disassembly *out, error *err)
@@ -80,48 +190,105 @@ bool disassemble_psp_elf(memory_stream *in, psp_disassembly *out, error *err)
     assert(in != nullptr);
     assert(out != nullptr);
 
+    DEFAULT_DISASSEMBLY_CONFIG(conf);
+
+    return disassemble_psp_elf(in, out, &conf, err);
+}
+
+bool disassemble_psp_elf(memory_stream *in, psp_disassembly *out, const psp_disassembly_config *conf, error *err)
+{
+    assert(in != nullptr);
+    assert(out != nullptr);
+    assert(conf != nullptr);
+
     file_stream log{};
     log.handle = stdout_handle();
 
-    psp_parse_elf_config elfconf{};
-    elfconf.section = ""_cs;
-    elfconf.vaddr = INFER_VADDR;
-    elfconf.verbose = false;
-    elfconf.log = &log;
+    DISASSEMBLY_PARSE_ELF_CONFIG(elfconf, &log);
 
     if (!parse_psp_module_from_elf(in, &out->psp_module, &elfconf, err))
         return false;
 
+    _disassemble_psp_module(out, conf, &log);
+
+    return true;
+}
+
+// index of the first jump with an address of at least vaddr in sorted jumps
+static u64 _first_jump_at_or_after(const array<jump_destination> *jumps, u32 vaddr)
+{
+    u64 lo = 0;
+    u64 hi = jumps->size;
+
+    while (lo < hi)
+    {
+        u64 mid = lo + (hi - lo) / 2;
+
+        if (jumps->data[mid].address < vaddr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+static void _disassemble_psp_module(psp_disassembly *out, const psp_disassembly_config *conf, file_stream *log)
+{
     ::resize(&out->disassembly_sections, out->psp_module.sections.size);
     ::fill_memory((void*)out->disassembly_sections.data, 0, out->disassembly_sections.size * sizeof(psp_disassembly_section));
     ::init(&out->all_instructions);
     ::init(&out->all_jumps);
     
+    // all instructions are allocated up front so sections can be decoded
+    // in any order, directly into their place.
+    u64 instruction_count = 0;
+
+    for_array(sec, &out->psp_module.sections)
+        instruction_count += sec->content_size / sizeof(u32);
+
+    ::resize(&out->all_instructions, instruction_count);
+
+    array<disassembly_chunk> chunks{};
+    ::init(&chunks);
+    defer { ::free(&chunks); };
+
+    u64 instruction_index = 0;
+
     for_array(i, sec, &out->psp_module.sections)
     {
-        parse_instructions_config pconf;
-        pconf.log = &log;
-        pconf.vaddr = sec->vaddr;
-        pconf.verbose = false;
-        pconf.emit_pseudo = true;
-
         psp_disassembly_section *dsec = out->disassembly_sections.data + i;
         fill_memory(dsec, 0);
         dsec->section = sec;
         dsec->vaddr_end = sec->vaddr;
-        dsec->instruction_start_index = (s32)out->all_instructions.size;
+        dsec->instruction_start_index = (s32)instruction_index;
+        dsec->instruction_count = (s32)(sec->content_size / sizeof(u32));
 
-        if (sec->content_size > 0)
-            parse_instructions(sec->content, sec->content_size, &out->all_instructions, &out->all_jumps, &pconf);
+        for (u64 offset = 0; offset < sec->content_size; offset += DISASSEMBLY_CHUNK_SIZE)
+        {
+            disassembly_chunk *chunk = ::add_at_end(&chunks);
+            chunk->data = sec->content + offset;
+            chunk->size = sec->content_size - offset;
+
+            if (chunk->size > DISASSEMBLY_CHUNK_SIZE)
+                chunk->size = DISASSEMBLY_CHUNK_SIZE;
 
-        assert((s32)out->all_instructions.size >= dsec->instruction_start_index);
-        dsec->instruction_count = (s32)out->all_instructions.size - dsec->instruction_start_index;
+            chunk->vaddr = sec->vaddr + (u32)offset;
+            chunk->instructions = out->all_instructions.data + instruction_index + offset / sizeof(u32);
+        }
+
+        instruction_index += dsec->instruction_count;
     }
 
+    // jumps are only appended while decoding, then sorted once
+    _decode_chunks(&chunks, &out->all_jumps, get_worker_count(conf->thread_count, chunks.size, MAX_DISASSEMBLY_THREADS), log);
+
     _add_symbols_to_jumps(&out->all_jumps, &out->psp_module.symbols);
     _add_imports_to_jumps(&out->all_jumps, &out->psp_module.imported_modules);
     _add_exports_to_jumps(&out->all_jumps, &out->psp_module.exported_modules);
 
+    sort_jumps(&out->all_jumps);
+
     // set instructions and jumps for sections
     for_array(dsec, &out->disassembly_sections)
     {
@@ -133,15 +300,10 @@ bool disassemble_psp_elf(memory_stream *in, psp_disassembly *out, error *err)
 
         u32 last_vaddr = (dsec->instructions + dsec->instruction_count - 1)->address;
         dsec->vaddr_end = last_vaddr;
-        auto search_result = ::nearest_index_of(&out->all_jumps, dsec->section->vaddr, compare_ascending_p);
-        s64 first_jump_idx = search_result.index;
-
-        if (first_jump_idx < 0)
-            first_jump_idx = 0;
-
+        s64 first_jump_idx = (s64)_first_jump_at_or_after(&out->all_jumps, dsec->section->vaddr);
         s64 i = first_jump_idx;
 
-        while (i < out->all_jumps.size)
+        while (i < (s64)out->all_jumps.size)
         {
             if (out->all_jumps[i].address > last_vaddr)
                 break;
@@ -154,7 +316,7 @@ bool disassemble_psp_elf(memory_stream *in, psp_disassembly *out, error *err)
 
         for (s32 j = 0; j < dsec->jump_count; ++j)
         {
-            if (out->all_jumps.data[j].type == jump_type::Jump)
+            if (dsec->jumps[j].type == jump_type::Jump)
                 dsec->function_count += 1;
             else
                 dsec->branch_count += 1;
@@ -162,6 +324,4 @@ bool disassemble_psp_elf(memory_stream *in, psp_disassembly *out, error *err)
 
         assert(dsec->function_count + dsec->branch_count == dsec->jump_count);
     }
-
-    return true;
 }
@@ -60,18 +60,36 @@ struct psp_disassembly
     /* Array of all instructions in the disassembly, sorted by ascending address. */
     array<instruction> all_instructions;
 
-    /* Set of all jump destinations (e.g. section starts,
+    /* Array of all jump destinations (e.g. section starts,
        functions, branches, etc.) in the disassembled binary, storing
-       addresses and jump types, sorted by ascending address. */
-    set<jump_destination> all_jumps;
+       addresses and jump types, sorted by ascending address and
+       without duplicates (see sort_jumps). */
+    array<jump_destination> all_jumps;
 
     /* Sections with additional information */ 
     array<psp_disassembly_section> disassembly_sections;
 };
 
+#define DISASSEMBLY_CHUNK_SIZE 0x40000 // bytes of a section decoded by a single thread at once
+#define MAX_DISASSEMBLY_THREADS 64
+
+struct psp_disassembly_config
+{
+    /* Number of threads to decode the sections with.
+       Sections larger than DISASSEMBLY_CHUNK_SIZE are split into chunks which
+       are decoded independently.
+       1 decodes everything on the calling thread,
+       0 uses as many threads as the hardware supports.
+       The disassembly is the same regardless of the number of threads. */
+    u32 thread_count;
+};
+
 void init(psp_disassembly *disasm);
 void free(psp_disassembly *disasm);
 
 bool disassemble_psp_elf(const char *path, psp_disassembly *out, error *err);
+bool disassemble_psp_elf(const char *path, psp_disassembly *out, const psp_disassembly_config *conf, error *err);
 bool disassemble_psp_elf(char *data, u64 size, psp_disassembly *out, error *err);
+bool disassemble_psp_elf(char *data, u64 size, psp_disassembly *out, const psp_disassembly_config *conf, error *err);
 bool disassemble_psp_elf(memory_stream *in, psp_disassembly *out, error *err);
+bool disassemble_psp_elf(memory_stream *in, psp_disassembly *out, const psp_disassembly_config *conf, error *err);
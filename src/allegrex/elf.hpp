@@ -78,6 +78,25 @@ typedef struct {
 
 #define ELF32_R_SYM(x) ((x) >> 8)
 #define ELF32_R_TYPE(x) ((x) & 0xff)
+#define ELF32_R_INFO(sym, type) (((sym) << 8) + ((type) & 0xff))
+
+#define ELF32_ST_INFO(bind, type) (((bind) << 4) + ((type) & 0xf))
+
+#define STB_LOCAL  0
+#define STB_GLOBAL 1
+
+#define STT_NOTYPE  0
+#define STT_OBJECT  1
+#define STT_FUNC    2
+#define STT_SECTION 3
+
+#define ET_EXEC 2
+
+#define PT_LOAD 1
+
+#define PF_X 0x1
+#define PF_W 0x2
+#define PF_R 0x4
 
 #define SHT_NULL     0
 #define SHT_PROGBITS 1
@@ -137,6 +156,8 @@ typedef struct {
 #define SHN_HIRESERVE 0xffff
 
 #define EM_MIPS		8	
+
+#define R_MIPS_26    4
 #else
 #include <elf.h>
 #endif
@@ -0,0 +1,676 @@
+#include <string.h>
+
+#include "shl/memory.hpp"
+#include "shl/defer.hpp"
+
+#include "allegrex/inflate.hpp"
+
+#define INFLATE_FAST_BITS 9
+#define INFLATE_MAX_BITS 15
+#define INFLATE_MAX_SYMBOLS 288
+#define INFLATE_LITLEN_CODES 286
+#define INFLATE_DIST_CODES 30
+
+/* canonical Huffman code. codes of up to INFLATE_FAST_BITS bits are decoded
+   with a single lookup of the next input bits, longer codes by comparing the
+   bit reversed input with the end of the codes of each length. */
+struct inflate_huffman
+{
+    u16 fast[1 << INFLATE_FAST_BITS];     // (length << 9) | symbol, 0 if the code is longer
+    u32 max_code[INFLATE_MAX_BITS + 2];   // first code after all codes of a length, left aligned to 16 bits
+    u16 first_code[INFLATE_MAX_BITS + 1];
+    u16 first_symbol[INFLATE_MAX_BITS + 1]; // index into symbols
+    u16 symbols[INFLATE_MAX_SYMBOLS];     // sorted by code
+};
+
+struct inflate_fixed_codes
+{
+    inflate_huffman litlen;
+    inflate_huffman dist;
+};
+
+struct inflate_state
+{
+    const u8 *in;
+    const u8 *in_end;
+    u64 bits;      // may contain the next byte above bit_count, see _refill
+    u32 bit_count;
+    u32 padding;   // zero bytes read past in_end
+
+    u8 *out_begin;
+    u8 *out;
+    u8 *out_end;
+
+    // input that was not read yet lies within the output buffer
+    bool input_in_output;
+    u8 *moved_input;
+    u64 moved_input_size;
+
+    error *err;
+};
+
+static const u8 _code_length_order[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+static const u16 _length_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+static const u8 _length_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+static const u16 _dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+
+static const u8 _dist_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+struct crc32_tables
+{
+    u32 table[8][256];
+};
+
+// slicing-by-8, table[n][b] is the CRC of byte b followed by n zero bytes
+static constexpr crc32_tables _build_crc32_tables()
+{
+    crc32_tables ret{};
+
+    for (u32 i = 0; i < 256; ++i)
+    {
+        u32 c = i;
+
+        for (u32 k = 0; k < 8; ++k)
+            c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+
+        ret.table[0][i] = c;
+    }
+
+    for (u32 i = 0; i < 256; ++i)
+    for (u32 n = 1; n < 8; ++n)
+    {
+        u32 prev = ret.table[n - 1][i];
+        ret.table[n][i] = (prev >> 8) ^ ret.table[0][prev & 0xff];
+    }
+
+    return ret;
+}
+
+static constexpr crc32_tables _crc32 = _build_crc32_tables();
+
+static inline u32 _load_le32(const u8 *p)
+{
+    return (u32)p[0] | ((u32)p[1] << 8) | ((u32)p[2] << 16) | ((u32)p[3] << 24);
+}
+
+static inline u64 _load_le64(const u8 *p)
+{
+    return (u64)_load_le32(p) | ((u64)_load_le32(p + 4) << 32);
+}
+
+u32 gzip_crc32(u32 crc, const void *data, u64 size)
+{
+    const u8 *p = (const u8*)data;
+    crc = ~crc;
+
+    for (; size >= 8; size -= 8, p += 8)
+    {
+        u32 lo = _load_le32(p) ^ crc;
+        u32 hi = _load_le32(p + 4);
+
+        crc = _crc32.table[7][lo & 0xff]         ^ _crc32.table[6][(lo >> 8) & 0xff]
+            ^ _crc32.table[5][(lo >> 16) & 0xff] ^ _crc32.table[4][lo >> 24]
+            ^ _crc32.table[3][hi & 0xff]         ^ _crc32.table[2][(hi >> 8) & 0xff]
+            ^ _crc32.table[1][(hi >> 16) & 0xff] ^ _crc32.table[0][hi >> 24];
+    }
+
+    for (; size > 0; --size, ++p)
+        crc = _crc32.table[0][(crc ^ *p) & 0xff] ^ (crc >> 8);
+
+    return ~crc;
+}
+
+static inline u32 _reverse16(u32 x)
+{
+    x = ((x & 0xAAAA) >> 1) | ((x & 0x5555) << 1);
+    x = ((x & 0xCCCC) >> 2) | ((x & 0x3333) << 2);
+    x = ((x & 0xF0F0) >> 4) | ((x & 0x0F0F) << 4);
+    x = ((x & 0xFF00) >> 8) | ((x & 0x00FF) << 8);
+    return x;
+}
+
+// incomplete codes are allowed, input that doesn't match a code fails to decode
+static bool _build_huffman(inflate_huffman *h, const u8 *lengths, u32 count)
+{
+    u16 counts[INFLATE_MAX_BITS + 1] = {};
+
+    for (u32 i = 0; i < count; ++i)
+        counts[lengths[i]] += 1;
+
+    counts[0] = 0;
+
+    s32 left = 1;
+
+    for (u32 len = 1; len <= INFLATE_MAX_BITS; ++len)
+    {
+        left = (left << 1) - counts[len];
+
+        if (left < 0)
+            return false; // over-subscribed
+    }
+
+    u32 next_code[INFLATE_MAX_BITS + 1];
+    u32 code = 0;
+    u32 symbol = 0;
+
+    for (u32 len = 1; len <= INFLATE_MAX_BITS; ++len)
+    {
+        next_code[len] = code;
+        h->first_code[len] = (u16)code;
+        h->first_symbol[len] = (u16)symbol;
+
+        code += counts[len];
+        symbol += counts[len];
+        h->max_code[len] = code << (16 - len);
+        code <<= 1;
+    }
+
+    h->max_code[INFLATE_MAX_BITS + 1] = 0x10000;
+
+    memset(h->fast, 0, sizeof(h->fast));
+
+    for (u32 i = 0; i < count; ++i)
+    {
+        u32 len = lengths[i];
+
+        if (len == 0)
+            continue;
+
+        u32 c = next_code[len]++;
+        h->symbols[h->first_symbol[len] + c - h->first_code[len]] = (u16)i;
+
+        if (len > INFLATE_FAST_BITS)
+            continue;
+
+        // the input is read from the least significant bit, so codes are looked up reversed
+        for (u32 j = _reverse16(c) >> (16 - len); j < (1u << INFLATE_FAST_BITS); j += 1u << len)
+            h->fast[j] = (u16)((len << 9) | i);
+    }
+
+    return true;
+}
+
+static inflate_fixed_codes _build_fixed_codes()
+{
+    inflate_fixed_codes ret;
+    u8 lengths[INFLATE_MAX_SYMBOLS];
+
+    memset(lengths, 8, 144);
+    memset(lengths + 144, 9, 256 - 144);
+    memset(lengths + 256, 7, 280 - 256);
+    memset(lengths + 280, 8, INFLATE_MAX_SYMBOLS - 280);
+    _build_huffman(&ret.litlen, lengths, INFLATE_MAX_SYMBOLS);
+
+    memset(lengths, 5, 32);
+    _build_huffman(&ret.dist, lengths, 32);
+
+    return ret;
+}
+
+static const inflate_fixed_codes *_get_fixed_codes()
+{
+    static const inflate_fixed_codes codes = _build_fixed_codes();
+    return &codes;
+}
+
+static bool _fail(inflate_state *s, const char *msg)
+{
+    set_error(s->err, 1, msg);
+    return false;
+}
+
+/* fills bits to at least 56 bits. with enough input, 8 bytes are loaded at
+   once and only the whole bytes that fit are counted, the rest of the last
+   byte stays above bit_count and is loaded again by the next refill.
+   past the end of the input zero bytes are added and counted in padding. */
+static inline void _refill(inflate_state *s)
+{
+    if (s->in_end - s->in >= 8)
+    {
+        s->bits |= _load_le64(s->in) << s->bit_count;
+        s->in += (63 - s->bit_count) >> 3;
+        s->bit_count |= 56;
+        return;
+    }
+
+    while (s->bit_count < 56)
+    {
+        u64 byte = 0;
+
+        if (s->in < s->in_end)
+            byte = *s->in++;
+        else
+            s->padding += 1;
+
+        s->bits |= byte << s->bit_count;
+        s->bit_count += 8;
+    }
+}
+
+static inline u32 _get_bits(inflate_state *s, u32 count)
+{
+    u32 ret = (u32)(s->bits & ((1ull << count) - 1));
+    s->bits >>= count;
+    s->bit_count -= count;
+    return ret;
+}
+
+// returns the symbol or -1 if the input is not a code of h
+static inline s32 _decode(inflate_state *s, const inflate_huffman *h)
+{
+    u32 entry = h->fast[s->bits & ((1u << INFLATE_FAST_BITS) - 1)];
+
+    if (entry != 0)
+    {
+        u32 len = entry >> 9;
+        s->bits >>= len;
+        s->bit_count -= len;
+        return (s32)(entry & 0x1ff);
+    }
+
+    u32 k = _reverse16((u32)s->bits & 0xffff);
+    u32 len = INFLATE_FAST_BITS + 1;
+
+    while (k >= h->max_code[len])
+        len += 1;
+
+    if (len > INFLATE_MAX_BITS)
+        return -1;
+
+    s->bits >>= len;
+    s->bit_count -= len;
+
+    return h->symbols[h->first_symbol[len] + (k >> (16 - len)) - h->first_code[len]];
+}
+
+// moves input that was not read yet out of the output buffer
+static void _move_input(inflate_state *s)
+{
+    s->moved_input_size = (u64)(s->in_end - s->in);
+    s->moved_input = alloc<u8>(s->moved_input_size);
+
+    if (s->moved_input_size > 0)
+        memcpy(s->moved_input, s->in, s->moved_input_size);
+
+    s->in = s->moved_input;
+    s->in_end = s->moved_input + s->moved_input_size;
+    s->input_in_output = false;
+}
+
+static inline bool _reserve_output(inflate_state *s, u64 count)
+{
+    if ((u64)(s->out_end - s->out) < count)
+        return _fail(s, "output buffer is too small for the inflated data");
+
+    if (s->input_in_output && s->out + count > s->in)
+        _move_input(s);
+
+    return true;
+}
+
+static bool _inflate_stored_block(inflate_state *s)
+{
+    // skip to the next byte
+    _get_bits(s, s->bit_count & 7);
+    _refill(s);
+
+    u32 len = _get_bits(s, 16);
+    u32 nlen = _get_bits(s, 16);
+
+    if ((len ^ 0xffff) != nlen)
+        return _fail(s, "invalid stored block length");
+
+    if ((u64)(s->out_end - s->out) < len)
+        return _fail(s, "output buffer is too small for the inflated data");
+
+    // the first bytes may already be in bits
+    u32 buffered = s->bit_count >> 3;
+
+    if (buffered > len)
+        buffered = len;
+
+    if (s->input_in_output && s->out + buffered > s->in)
+        _move_input(s);
+
+    for (u32 i = 0; i < buffered; ++i)
+        *s->out++ = (u8)_get_bits(s, 8);
+
+    len -= buffered;
+
+    if (len == 0)
+        return true;
+
+    s->bits = 0;
+
+    if ((u64)(s->in_end - s->in) < len)
+        return _fail(s, "unexpected end of compressed data");
+
+    // out <= in, so this is fine if the input is within the output
+    memmove(s->out, s->in, len);
+    s->out += len;
+    s->in += len;
+
+    return true;
+}
+
+static bool _inflate_huffman_block(inflate_state *s, const inflate_huffman *litlen, const inflate_huffman *dist)
+{
+    while (true)
+    {
+        // enough for a length and a distance with their extra bits
+        _refill(s);
+
+        s32 sym = _decode(s, litlen);
+
+        if (sym < 256)
+        {
+            if (sym < 0)
+                return _fail(s, "invalid literal/length code");
+
+            if (!_reserve_output(s, 1))
+                return false;
+
+            *s->out++ = (u8)sym;
+            continue;
+        }
+
+        if (sym == 256)
+            return true;
+
+        sym -= 257;
+
+        if (sym >= 29)
+            return _fail(s, "invalid length symbol");
+
+        u32 length = _length_base[sym] + _get_bits(s, _length_extra[sym]);
+        s32 dsym = _decode(s, dist);
+
+        if (dsym < 0 || dsym >= INFLATE_DIST_CODES)
+            return _fail(s, "invalid distance code");
+
+        u32 distance = _dist_base[dsym] + _get_bits(s, _dist_extra[dsym]);
+
+        if (distance > (u64)(s->out - s->out_begin))
+            return _fail(s, "distance is too far back");
+
+        if (!_reserve_output(s, length))
+            return false;
+
+        const u8 *src = s->out - distance;
+
+        if (distance >= length)
+            memcpy(s->out, src, length);
+        else if (distance == 1)
+            memset(s->out, *src, length);
+        else
+            for (u32 i = 0; i < length; ++i)
+                s->out[i] = src[i];
+
+        s->out += length;
+    }
+}
+
+static bool _read_dynamic_codes(inflate_state *s, inflate_huffman *litlen, inflate_huffman *dist)
+{
+    _refill(s);
+
+    u32 hlit = _get_bits(s, 5) + 257;
+    u32 hdist = _get_bits(s, 5) + 1;
+    u32 hclen = _get_bits(s, 4) + 4;
+
+    if (hlit > INFLATE_LITLEN_CODES || hdist > INFLATE_DIST_CODES)
+        return _fail(s, "invalid number of codes in dynamic block");
+
+    u8 code_lengths[19] = {};
+
+    for (u32 i = 0; i < hclen; ++i)
+    {
+        if (s->bit_count < 3)
+            _refill(s);
+
+        code_lengths[_code_length_order[i]] = (u8)_get_bits(s, 3);
+    }
+
+    // litlen is used for the code length code, it's not needed yet
+    if (!_build_huffman(litlen, code_lengths, 19))
+        return _fail(s, "invalid code length code");
+
+    u8 lengths[INFLATE_LITLEN_CODES + INFLATE_DIST_CODES];
+    u32 total = hlit + hdist;
+    u32 n = 0;
+
+    while (n < total)
+    {
+        _refill(s);
+
+        s32 sym = _decode(s, litlen);
+
+        if (sym < 0)
+            return _fail(s, "invalid code length code");
+
+        if (sym < 16)
+        {
+            lengths[n++] = (u8)sym;
+            continue;
+        }
+
+        u8 value = 0;
+        u32 repeat;
+
+        if (sym == 16)
+        {
+            if (n == 0)
+                return _fail(s, "code length repeat without a previous length");
+
+            value = lengths[n - 1];
+            repeat = 3 + _get_bits(s, 2);
+        }
+        else if (sym == 17)
+            repeat = 3 + _get_bits(s, 3);
+        else
+            repeat = 11 + _get_bits(s, 7);
+
+        if (n + repeat > total)
+            return _fail(s, "code lengths exceed the number of codes");
+
+        memset(lengths + n, value, repeat);
+        n += repeat;
+    }
+
+    if (lengths[256] == 0)
+        return _fail(s, "dynamic block has no end of block code");
+
+    if (!_build_huffman(litlen, lengths, hlit)
+     || !_build_huffman(dist, lengths + hlit, hdist))
+        return _fail(s, "invalid dynamic block code");
+
+    return true;
+}
+
+static bool _inflate(inflate_state *s)
+{
+    u32 final_block = 0;
+
+    while (!final_block)
+    {
+        // without input, blocks of zero bits would never end
+        if (s->padding * 8 > s->bit_count)
+            return _fail(s, "unexpected end of compressed data");
+
+        _refill(s);
+
+        final_block = _get_bits(s, 1);
+        u32 type = _get_bits(s, 2);
+
+        if (type == 0)
+        {
+            if (!_inflate_stored_block(s))
+                return false;
+        }
+        else if (type == 1)
+        {
+            const inflate_fixed_codes *fixed = _get_fixed_codes();
+
+            if (!_inflate_huffman_block(s, &fixed->litlen, &fixed->dist))
+                return false;
+        }
+        else if (type == 2)
+        {
+            inflate_huffman litlen;
+            inflate_huffman dist;
+
+            if (!_read_dynamic_codes(s, &litlen, &dist)
+             || !_inflate_huffman_block(s, &litlen, &dist))
+                return false;
+        }
+        else
+            return _fail(s, "invalid block type");
+    }
+
+    if (s->padding * 8 > s->bit_count)
+        return _fail(s, "unexpected end of compressed data");
+
+    return true;
+}
+
+static void _init_state(inflate_state *s, const u8 *in, u64 in_size, u8 *out, u64 out_size, error *err)
+{
+    s->in = in;
+    s->in_end = in + in_size;
+    s->bits = 0;
+    s->bit_count = 0;
+    s->padding = 0;
+
+    s->out_begin = out;
+    s->out = out;
+    s->out_end = out + out_size;
+
+    s->input_in_output = in < out + out_size && out < in + in_size;
+    s->moved_input = nullptr;
+    s->moved_input_size = 0;
+
+    s->err = err;
+}
+
+static void _free_state(inflate_state *s)
+{
+    if (s->moved_input != nullptr)
+        dealloc(s->moved_input, s->moved_input_size);
+
+    s->moved_input = nullptr;
+    s->moved_input_size = 0;
+}
+
+s64 inflate_raw(const u8 *in, u64 in_size, u8 *out, u64 out_size, error *err)
+{
+    inflate_state s;
+    _init_state(&s, in, in_size, out, out_size, err);
+    defer { _free_state(&s); };
+
+    if (!_inflate(&s))
+        return -1;
+
+    return (s64)(s.out - s.out_begin);
+}
+
+s64 inflate_gzip(const u8 *in, u64 in_size, u8 *out, u64 out_size, error *err)
+{
+    // header, trailer and an empty block
+    if (in_size < 20 || in[0] != 0x1f || in[1] != 0x8b)
+    {
+        set_error(err, 1, "input is not gzip data");
+        return -1;
+    }
+
+    u8 flags = in[3];
+
+    if (in[2] != 8 || (flags & 0xe0) != 0)
+    {
+        set_error(err, 1, "unsupported gzip compression method or flags");
+        return -1;
+    }
+
+    u64 pos = 10;
+
+    if (flags & 0x04) // FEXTRA
+        pos += 2 + ((u64)in[pos] | ((u64)in[pos + 1] << 8));
+
+    if (flags & 0x08) // FNAME
+    {
+        while (pos < in_size && in[pos] != 0)
+            pos += 1;
+
+        pos += 1;
+    }
+
+    if (flags & 0x10) // FCOMMENT
+    {
+        while (pos < in_size && in[pos] != 0)
+            pos += 1;
+
+        pos += 1;
+    }
+
+    if (flags & 0x02) // FHCRC
+        pos += 2;
+
+    if (pos + 8 > in_size)
+    {
+        set_error(err, 1, "gzip header exceeds the input");
+        return -1;
+    }
+
+    inflate_state s;
+    _init_state(&s, in + pos, in_size - pos, out, out_size, err);
+    defer { _free_state(&s); };
+
+    if (!_inflate(&s))
+        return -1;
+
+    // the trailer may have been overwritten by the output, read it through the state
+    _get_bits(&s, s.bit_count & 7);
+    _refill(&s);
+
+    u32 crc = _get_bits(&s, 32);
+    _refill(&s);
+    u32 size = _get_bits(&s, 32);
+
+    if (s.padding * 8 > s.bit_count)
+    {
+        set_error(err, 1, "unexpected end of gzip data");
+        return -1;
+    }
+
+    u64 written = (u64)(s.out - s.out_begin);
+
+    if (size != (u32)written)
+    {
+        set_error(err, 1, "gzip size does not match the inflated size");
+        return -1;
+    }
+
+    if (crc != gzip_crc32(0, out, written))
+    {
+        set_error(err, 1, "gzip CRC-32 does not match the inflated data");
+        return -1;
+    }
+
+    return (s64)written;
+}
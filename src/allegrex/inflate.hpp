@@ -0,0 +1,38 @@
+
+#pragma once
+
+#include "shl/number_types.hpp"
+#include "shl/error.hpp"
+
+/*
+INFLATE
+
+Decompresses deflate (RFC 1951) and gzip (RFC 1952) data, e.g. the payload
+of compressed PRX modules, which is a gzip member once decrypted.
+
+The whole output is written to a single buffer which also serves as the
+window, nothing is allocated except in the case below.
+The input may lie within the output buffer, e.g. at its end, so data can be
+inflated within the buffer it was decrypted in. If the output would overwrite
+input that was not read yet, the rest of the input is first moved to a
+temporary buffer. How often that happens depends on how far from the start
+of the output the input begins: with at least the difference between output
+and input size, plus a little for blocks that compress worse than the rest,
+it doesn't for data produced by zlib.
+
+Usage:
+
+    s64 size = inflate_gzip(compressed, compressed_size, out, out_size, &err);
+
+    if (size < 0)
+        // error, see err
+*/
+
+// returns the number of bytes written to out, or -1 on error
+s64 inflate_raw(const u8 *in, u64 in_size, u8 *out, u64 out_size, error *err = nullptr);
+
+// also checks the CRC-32 and size of the gzip trailer
+s64 inflate_gzip(const u8 *in, u64 in_size, u8 *out, u64 out_size, error *err = nullptr);
+
+// CRC-32 of gzip and zlib, pass 0 as crc to start
+u32 gzip_crc32(u32 crc, const void *data, u64 size);
@@ -0,0 +1,197 @@
+
+#pragma once
+
+#include "shl/number_types.hpp"
+
+/* Perfect hash tables built at compile time
+
+Maps a fixed set of 64 bit key hashes to the indices of their keys such that
+every key has its own slot, using "hash and displace": the keys are
+distributed into buckets by the high bits of their hash, and for every bucket,
+largest first, a seed is searched that moves all keys of the bucket into free
+slots. A lookup is one bucket read and one slot read.
+
+Keys that are not in the table still end up in some slot, so the caller has to
+compare the key at the returned index with the key that was looked up.
+Keys with equal hashes are treated as the same key, the first one wins.
+
+Usage:
+
+    constexpr auto table = _build_perfect_hash<KeyCount, BucketCount, SlotCount>(hashes);
+    static_assert(table.ok);
+
+    u32 index = _perfect_hash_lookup(&table, hash);
+
+    if (index != PERFECT_HASH_NOT_FOUND && keys[index] == key)
+        ...
+*/
+
+#define PERFECT_HASH_NOT_FOUND 0xffffffff
+#define PERFECT_HASH_MAX_SEED 0xffff
+
+constexpr inline u64 _perfect_hash_mix(u64 x)
+{
+    // splitmix64 finalizer, a bijection
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+// FNV-1a
+constexpr inline u64 _perfect_hash_string(const char *str)
+{
+    u64 h = 0xcbf29ce484222325ull;
+
+    for (; *str != '\0'; ++str)
+    {
+        h ^= (u8)*str;
+        h *= 0x100000001b3ull;
+    }
+
+    return _perfect_hash_mix(h);
+}
+
+// (a, b) -> hash, unique for unique pairs since the mix is a bijection
+constexpr inline u64 _perfect_hash_pair(u32 a, u32 b)
+{
+    return _perfect_hash_mix(((u64)a << 32) | b);
+}
+
+template<u64 BucketCount, u64 SlotCount>
+struct perfect_hash
+{
+    static_assert((BucketCount & (BucketCount - 1)) == 0, "bucket count must be a power of two");
+    static_assert((SlotCount & (SlotCount - 1)) == 0, "slot count must be a power of two");
+
+    u16 seeds[BucketCount];
+    u32 slots[SlotCount]; // key index + 1, 0 if empty
+    bool ok;              // false if no seed was found for some bucket
+};
+
+constexpr inline u64 _perfect_hash_bucket(u64 hash, u64 bucket_count)
+{
+    return (hash >> 32) & (bucket_count - 1);
+}
+
+constexpr inline u64 _perfect_hash_slot(u64 hash, u16 seed, u64 slot_count)
+{
+    return _perfect_hash_mix(hash + seed * 0x9e3779b97f4a7c15ull) & (slot_count - 1);
+}
+
+// smallest power of two >= x
+constexpr inline u64 _perfect_hash_size(u64 x)
+{
+    u64 ret = 1;
+
+    while (ret < x)
+        ret *= 2;
+
+    return ret;
+}
+
+template<u64 KeyCount, u64 BucketCount, u64 SlotCount>
+constexpr auto _build_perfect_hash(const u64 *hashes)
+{
+    static_assert(KeyCount < SlotCount);
+
+    perfect_hash<BucketCount, SlotCount> ret{};
+    ret.ok = true;
+
+    // key indices sorted by bucket, in key order within a bucket
+    u32 bucket_sizes[BucketCount]{};
+    u32 bucket_offsets[BucketCount]{};
+    u32 keys[KeyCount]{};
+    u64 bucket_slots[KeyCount]{};
+    u32 max_bucket_size = 0;
+
+    for (u64 i = 0; i < KeyCount; ++i)
+        bucket_sizes[_perfect_hash_bucket(hashes[i], BucketCount)] += 1;
+
+    for (u64 b = 1; b < BucketCount; ++b)
+        bucket_offsets[b] = bucket_offsets[b - 1] + bucket_sizes[b - 1];
+
+    for (u64 b = 0; b < BucketCount; ++b)
+    {
+        if (bucket_sizes[b] > max_bucket_size)
+            max_bucket_size = bucket_sizes[b];
+
+        bucket_sizes[b] = 0;
+    }
+
+    for (u64 i = 0; i < KeyCount; ++i)
+    {
+        u64 b = _perfect_hash_bucket(hashes[i], BucketCount);
+        keys[bucket_offsets[b] + bucket_sizes[b]] = (u32)i;
+        bucket_sizes[b] += 1;
+    }
+
+    // largest buckets first, they are the hardest to place
+    for (u32 size = max_bucket_size; size > 0; --size)
+    {
+        for (u64 b = 0; b < BucketCount; ++b)
+        {
+            if (bucket_sizes[b] != size)
+                continue;
+
+            const u32 *bucket = keys + bucket_offsets[b];
+            bool placed = false;
+
+            for (u32 seed = 0; seed <= PERFECT_HASH_MAX_SEED && !placed; ++seed)
+            {
+                placed = true;
+
+                for (u32 i = 0; i < size && placed; ++i)
+                {
+                    u64 h = hashes[bucket[i]];
+                    u64 slot = _perfect_hash_slot(h, (u16)seed, SlotCount);
+                    bucket_slots[i] = slot;
+
+                    if (ret.slots[slot] != 0)
+                        placed = false;
+
+                    for (u32 j = 0; j < i && placed; ++j)
+                    {
+                        // duplicate keys share the slot of the first one
+                        if (hashes[bucket[j]] == h)
+                        {
+                            bucket_slots[i] = SlotCount;
+                            break;
+                        }
+
+                        if (bucket_slots[j] == slot)
+                            placed = false;
+                    }
+                }
+
+                if (placed)
+                    ret.seeds[b] = (u16)seed;
+            }
+
+            if (!placed)
+            {
+                ret.ok = false;
+                return ret;
+            }
+
+            for (u32 i = 0; i < size; ++i)
+                if (bucket_slots[i] < SlotCount)
+                    ret.slots[bucket_slots[i]] = bucket[i] + 1;
+        }
+    }
+
+    return ret;
+}
+
+// returns the index of the key with the given hash, or PERFECT_HASH_NOT_FOUND.
+// if the key is not in the table, the index of another key may be returned.
+template<u64 BucketCount, u64 SlotCount>
+constexpr inline u32 _perfect_hash_lookup(const perfect_hash<BucketCount, SlotCount> *table, u64 hash)
+{
+    u16 seed = table->seeds[_perfect_hash_bucket(hash, BucketCount)];
+    u32 index = table->slots[_perfect_hash_slot(hash, seed, SlotCount)];
+
+    return index - 1; // 0 - 1 == PERFECT_HASH_NOT_FOUND
+}
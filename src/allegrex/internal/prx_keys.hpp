@@ -0,0 +1,25 @@
+
+#pragma once
+
+#include "shl/number_types.hpp"
+
+/* The keys of a PRX tag, as used by pspDecryptPRX.
+Not part of the API, this is only here so the tests and benchmarks can build
+encrypted modules of their own (see tests/prx_fixture.hpp).
+*/
+struct prx_tag_keys
+{
+    u8 types; // 1 << prx_type of the types that use the tag
+
+    // types 0 and 1, nullptr if the tag has no such key
+    const u8 *key; // 0x90 bytes
+    u8 code;
+
+    // types 2, 5 and 6, nullptr if the tag has no such key
+    const u8 *key2;  // 0x10 bytes
+    u8 code2;
+    const u8 *seed2; // 0x10 bytes, type 5 only, may be nullptr
+};
+
+// returns false if the tag is unknown
+bool get_prx_tag_keys(u32 tag, prx_tag_keys *out);
@@ -0,0 +1,230 @@
+
+#include "shl/memory.hpp"
+#include "shl/streams.hpp"
+#include "allegrex/lazy_disassembly.hpp"
+
+void init(lazy_disassembly *disasm)
+{
+    assert(disasm != nullptr);
+
+    init(&disasm->psp_module);
+    ::init(&disasm->sections);
+    ::init(&disasm->sections_by_vaddr);
+    disasm->instruction_count = 0;
+    disasm->decoded_page_count = 0;
+    disasm->emit_pseudo = true;
+}
+
+void free(lazy_disassembly *disasm)
+{
+    assert(disasm != nullptr);
+
+    for_array(lsec, &disasm->sections)
+    {
+        for_array(i, page, &lsec->pages)
+        {
+            if (*page == nullptr)
+                continue;
+
+            u64 count = lsec->instruction_count - i * LAZY_DISASSEMBLY_PAGE_INSTRUCTION_COUNT;
+
+            if (count > LAZY_DISASSEMBLY_PAGE_INSTRUCTION_COUNT)
+                count = LAZY_DISASSEMBLY_PAGE_INSTRUCTION_COUNT;
+
+            dealloc(*page, count);
+        }
+
+        ::free(&lsec->pages);
+    }
+
+    ::free(&disasm->sections_by_vaddr);
+    ::free(&disasm->sections);
+    free(&disasm->psp_module);
+}
+
+static void _setup_pages(lazy_disassembly *out);
+
+bool lazy_disassemble_psp_elf(const char *path, lazy_disassembly *out, error *err)
+{
+    assert(path != nullptr);
+    assert(out != nullptr);
+
+    file_stream log{};
+    log.handle = stdout_handle();
+
+    // maps the file, unencrypted ELFs are not copied
+    psp_parse_elf_config elfconf{};
+    elfconf.section = ""_cs;
+    elfconf.vaddr = INFER_VADDR;
+    elfconf.verbose = false;
+    elfconf.log = &log;
+    elfconf.map_file = true;
+
+    if (!parse_psp_module_from_elf(path, &out->psp_module, &elfconf, err))
+        return false;
+
+    _setup_pages(out);
+
+    return true;
+}
+
+bool lazy_disassemble_psp_elf(char *data, u64 size, lazy_disassembly *out, error *err)
+{
+    assert(data != nullptr);
+    assert(out != nullptr);
+
+    memory_stream stream{};
+    stream.data = data;
+    stream.size = size;
+
+    return lazy_disassemble_psp_elf(&stream, out, err);
+}
+
+bool lazy_disassemble_psp_elf(memory_stream *in, lazy_disassembly *out, error *err)
+{
+    assert(in != nullptr);
+    assert(out != nullptr);
+
+    file_stream log{};
+    log.handle = stdout_handle();
+
+    psp_parse_elf_config elfconf{};
+    elfconf.section = ""_cs;
+    elfconf.vaddr = INFER_VADDR;
+    elfconf.verbose = false;
+    elfconf.log = &log;
+    elfconf.map_file = false;
+
+    if (!parse_psp_module_from_elf(in, &out->psp_module, &elfconf, err))
+        return false;
+
+    _setup_pages(out);
+
+    return true;
+}
+
+// only the page tables are set up here, nothing is decoded yet
+static void _setup_pages(lazy_disassembly *out)
+{
+    ::resize(&out->sections, out->psp_module.sections.size);
+    ::resize(&out->sections_by_vaddr, out->psp_module.sections.size);
+    out->instruction_count = 0;
+    out->decoded_page_count = 0;
+
+    for_array(i, sec, &out->psp_module.sections)
+    {
+        lazy_disassembly_section *lsec = out->sections.data + i;
+        lsec->section = sec;
+        lsec->instruction_start_index = out->instruction_count;
+        lsec->instruction_count = sec->content_size / sizeof(u32);
+        lsec->vaddr_end = sec->vaddr + (u32)(lsec->instruction_count * sizeof(u32));
+
+        u64 page_count = (lsec->instruction_count + LAZY_DISASSEMBLY_PAGE_INSTRUCTION_COUNT - 1)
+                       / LAZY_DISASSEMBLY_PAGE_INSTRUCTION_COUNT;
+
+        ::init(&lsec->pages);
+        ::resize(&lsec->pages, page_count);
+        fill_memory((void*)lsec->pages.data, 0, page_count * sizeof(instruction*));
+
+        out->instruction_count += lsec->instruction_count;
+
+        // insertion sort, there are only a handful of sections
+        u64 j = i;
+
+        while (j > 0 && out->sections[out->sections_by_vaddr[j - 1]].section->vaddr > sec->vaddr)
+        {
+            out->sections_by_vaddr[j] = out->sections_by_vaddr[j - 1];
+            j -= 1;
+        }
+
+        out->sections_by_vaddr[j] = (u32)i;
+    }
+}
+
+static const instruction *_get_section_instruction(lazy_disassembly *disasm, lazy_disassembly_section *lsec, u64 index)
+{
+    assert(index < lsec->instruction_count);
+
+    u64 page_index = index / LAZY_DISASSEMBLY_PAGE_INSTRUCTION_COUNT;
+    instruction **page = lsec->pages.data + page_index;
+
+    if (*page == nullptr)
+    {
+        u64 first = page_index * LAZY_DISASSEMBLY_PAGE_INSTRUCTION_COUNT;
+        u64 count = lsec->instruction_count - first;
+
+        if (count > LAZY_DISASSEMBLY_PAGE_INSTRUCTION_COUNT)
+            count = LAZY_DISASSEMBLY_PAGE_INSTRUCTION_COUNT;
+
+        parse_instructions_config pconf;
+        pconf.log = nullptr;
+        pconf.vaddr = lsec->section->vaddr + (u32)(first * sizeof(u32));
+        pconf.verbose = false;
+        pconf.emit_pseudo = disasm->emit_pseudo;
+
+        *page = alloc<instruction>(count);
+        parse_instructions(lsec->section->content + first * sizeof(u32), count * sizeof(u32), *page, nullptr, &pconf);
+
+        disasm->decoded_page_count += 1;
+    }
+
+    return *page + (index % LAZY_DISASSEMBLY_PAGE_INSTRUCTION_COUNT);
+}
+
+const instruction *get_instruction_at_address(lazy_disassembly *disasm, u32 vaddr)
+{
+    assert(disasm != nullptr);
+
+    // last section with vaddr <= the given vaddr
+    u64 lo = 0;
+    u64 hi = disasm->sections_by_vaddr.size;
+
+    while (lo < hi)
+    {
+        u64 mid = lo + (hi - lo) / 2;
+
+        if (disasm->sections[disasm->sections_by_vaddr[mid]].section->vaddr <= vaddr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    // empty sections may start at the same vaddr as the section containing vaddr
+    while (lo > 0 && disasm->sections[disasm->sections_by_vaddr[lo - 1]].instruction_count == 0)
+        lo -= 1;
+
+    if (lo == 0)
+        return nullptr;
+
+    lazy_disassembly_section *lsec = disasm->sections.data + disasm->sections_by_vaddr[lo - 1];
+
+    if (vaddr >= lsec->vaddr_end || (vaddr % sizeof(u32)) != (lsec->section->vaddr % sizeof(u32)))
+        return nullptr;
+
+    return _get_section_instruction(disasm, lsec, (vaddr - lsec->section->vaddr) / sizeof(u32));
+}
+
+const instruction *get_instruction(lazy_disassembly *disasm, u64 index)
+{
+    assert(disasm != nullptr);
+    assert(index < disasm->instruction_count);
+
+    // last section with instruction_start_index <= index. empty sections are never
+    // found since the next section starts at the same index.
+    u64 lo = 0;
+    u64 hi = disasm->sections.size;
+
+    while (hi - lo > 1)
+    {
+        u64 mid = lo + (hi - lo) / 2;
+
+        if (disasm->sections[mid].instruction_start_index <= index)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    lazy_disassembly_section *lsec = disasm->sections.data + lo;
+
+    return _get_section_instruction(disasm, lsec, index - lsec->instruction_start_index);
+}
@@ -0,0 +1,87 @@
+
+#pragma once
+
+#include "shl/array.hpp"
+#include "shl/number_types.hpp"
+#include "shl/error.hpp"
+#include "shl/memory_stream.hpp"
+
+#include "allegrex/psp_elf.hpp"
+#include "allegrex/parse_instructions.hpp"
+
+/*
+LAZY DISASSEMBLY
+
+Disassembly of a psp module which decodes instructions only when they are
+accessed, instead of decoding all sections up front like disassemble_psp_elf.
+Opening a module only parses the ELF headers; instructions are decoded with
+parse_instruction one page (LAZY_DISASSEMBLY_PAGE_SIZE bytes of a section)
+at a time, the first time an instruction within the page is accessed, and
+stay decoded until the disassembly is freed.
+
+Jumps are not collected since that would require decoding everything.
+
+Usage:
+
+    lazy_disassembly disasm;
+    init(&disasm);
+
+    if (!lazy_disassemble_psp_elf("EBOOT.BIN", &disasm, &err))
+        ...
+
+    const instruction *inst = get_instruction_at_address(&disasm, 0x08804000);
+
+    if (inst != nullptr)
+        do_something(inst);
+
+    free(&disasm);
+*/
+
+#define LAZY_DISASSEMBLY_PAGE_SIZE 0x1000 // bytes of a section decoded at once
+#define LAZY_DISASSEMBLY_PAGE_INSTRUCTION_COUNT (LAZY_DISASSEMBLY_PAGE_SIZE / sizeof(u32))
+
+struct lazy_disassembly_section
+{
+    elf_section *section;
+    u32 vaddr_end; // first vaddr after the section
+    u64 instruction_start_index; // index of the first instruction of the section in the disassembly
+    u64 instruction_count;
+
+    /* decoded pages of LAZY_DISASSEMBLY_PAGE_INSTRUCTION_COUNT instructions,
+       nullptr if the page was not decoded yet. */
+    array<instruction*> pages;
+};
+
+struct lazy_disassembly
+{
+    elf_psp_module psp_module;
+
+    // same order as psp_module.sections
+    array<lazy_disassembly_section> sections;
+
+    // indices into sections, sorted by ascending vaddr
+    array<u32> sections_by_vaddr;
+
+    u64 instruction_count; // of all sections
+    u64 decoded_page_count;
+    bool emit_pseudo;
+};
+
+void init(lazy_disassembly *disasm);
+void free(lazy_disassembly *disasm);
+
+bool lazy_disassemble_psp_elf(const char *path, lazy_disassembly *out, error *err);
+bool lazy_disassemble_psp_elf(char *data, u64 size, lazy_disassembly *out, error *err);
+bool lazy_disassemble_psp_elf(memory_stream *in, lazy_disassembly *out, error *err);
+
+/* Returns the instruction at vaddr, decoding its page if necessary, or nullptr
+if vaddr is not within any section of the disassembly.
+The instruction stays valid until the disassembly is freed.
+*/
+const instruction *get_instruction_at_address(lazy_disassembly *disasm, u32 vaddr);
+
+/* Returns the instruction at index, counting the instructions of all sections in
+the order of psp_module.sections, like psp_disassembly.all_instructions.
+index must be less than disasm->instruction_count.
+*/
+const instruction *get_instruction(lazy_disassembly *disasm, u64 index);
@@ -124,7 +124,7 @@ void add_branch_address_argument(u32 addr, instruction *inst)
 }
 
 // argument parse functions
-void arg_parse_RdRsRt(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_RdRsRt(u32 opcode, instruction *inst)
 {
     u32 rs = RS(opcode);
     u32 rt = RT(opcode);
@@ -135,11 +135,12 @@ void arg_parse_RdRsRt(u32 opcode, instruction *inst, const parse_instructions_co
     add_register_argument(rt, inst);
 };
 
-void arg_parse_AdduOr(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+template<bool EmitPseudo>
+void arg_parse_AdduOr(u32 opcode, instruction *inst)
 {
-    if (!conf->emit_pseudo)
+    if constexpr (!EmitPseudo)
     {
-        arg_parse_RdRsRt(opcode, inst, conf);
+        arg_parse_RdRsRt(opcode, inst);
         return;
     }
 
@@ -169,11 +170,11 @@ void arg_parse_AdduOr(u32 opcode, instruction *inst, const parse_instructions_co
         return;
     }
 
-    arg_parse_RdRsRt(opcode, inst, conf);
+    arg_parse_RdRsRt(opcode, inst);
 };
 
 // only used by clz & clo...
-void arg_parse_RdRs(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_RdRs(u32 opcode, instruction *inst)
 {
     u32 rs = RS(opcode);
     u32 rd = RD(opcode);
@@ -182,7 +183,7 @@ void arg_parse_RdRs(u32 opcode, instruction *inst, const parse_instructions_conf
     add_register_argument(rs, inst);
 };
 
-void arg_parse_RsRt(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_RsRt(u32 opcode, instruction *inst)
 {
     u32 rs = RS(opcode);
     u32 rt = RT(opcode);
@@ -191,7 +192,7 @@ void arg_parse_RsRt(u32 opcode, instruction *inst, const parse_instructions_conf
     add_register_argument(rt, inst);
 };
 
-void arg_parse_RsRtCode(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_RsRtCode(u32 opcode, instruction *inst)
 {
     u32 rs = RS(opcode);
     u32 rt = RT(opcode);
@@ -202,7 +203,7 @@ void arg_parse_RsRtCode(u32 opcode, instruction *inst, const parse_instructions_
     _add_argument(extra{code}, inst);
 };
 
-void arg_parse_RdRtShift(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_RdRtShift(u32 opcode, instruction *inst)
 {
     u32 rt = RT(opcode);
     u32 rd = RD(opcode);
@@ -213,7 +214,7 @@ void arg_parse_RdRtShift(u32 opcode, instruction *inst, const parse_instructions
     _add_argument(shift{sa}, inst);
 };
 
-void arg_parse_VarShift(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VarShift(u32 opcode, instruction *inst)
 {
     u32 rs = RS(opcode);
     u32 rt = RT(opcode);
@@ -225,14 +226,14 @@ void arg_parse_VarShift(u32 opcode, instruction *inst, const parse_instructions_
     add_register_argument(rs, inst);
 };
 
-void arg_parse_RegJumpRs(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_RegJumpRs(u32 opcode, instruction *inst)
 {
     u32 rs = RS(opcode);
 
     add_register_argument(rs, inst);
 };
 
-void arg_parse_RegJumpRdRs(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_RegJumpRdRs(u32 opcode, instruction *inst)
 {
     u32 rs = RS(opcode);
     u32 rd = RD(opcode);
@@ -242,7 +243,7 @@ void arg_parse_RegJumpRdRs(u32 opcode, instruction *inst, const parse_instructio
 };
 
 
-void arg_parse_Syscall(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_Syscall(u32 opcode, instruction *inst)
 {
     u32 code = bitrange(opcode, 6, 25);
     u16 funcnum = (u16)bitrange(code, 0, 11);
@@ -254,28 +255,28 @@ void arg_parse_Syscall(u32 opcode, instruction *inst, const parse_instructions_c
     _add_argument(extra{code}, inst);
 };
 
-void arg_parse_Sync(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_Sync(u32 opcode, instruction *inst)
 {
     u32 stype = bitrange(opcode, 6, 10);
 
     _add_argument(extra{stype}, inst);
 };
 
-void arg_parse_Rs(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_Rs(u32 opcode, instruction *inst)
 {
     u32 rs = RS(opcode);
 
     add_register_argument(rs, inst);
 };
 
-void arg_parse_Rd(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_Rd(u32 opcode, instruction *inst)
 {
     u32 rd = RD(opcode);
 
     add_register_argument(rd, inst);
 };
 
-void arg_parse_RdRt(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_RdRt(u32 opcode, instruction *inst)
 {
     u32 rd = RD(opcode);
     u32 rt = RT(opcode);
@@ -284,7 +285,7 @@ void arg_parse_RdRt(u32 opcode, instruction *inst, const parse_instructions_conf
     add_register_argument(rt, inst);
 };
 
-void arg_parse_Cop0RtRdSel(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_Cop0RtRdSel(u32 opcode, instruction *inst)
 {
     u32 rt = RT(opcode);
     u8 rd = (u8)RD(opcode);
@@ -294,7 +295,7 @@ void arg_parse_Cop0RtRdSel(u32 opcode, instruction *inst, const parse_instructio
     _add_argument(coprocessor_register{rd, sel}, inst);
 };
 
-void arg_parse_RsImmediateU(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_RsImmediateU(u32 opcode, instruction *inst)
 {
     u32 rs = RS(opcode);
     u16 imm = (u16)bitrange(opcode, 0, 15);
@@ -303,7 +304,7 @@ void arg_parse_RsImmediateU(u32 opcode, instruction *inst, const parse_instructi
     _add_argument(immediate<u16>{imm}, inst);
 };
 
-void arg_parse_RsImmediateS(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_RsImmediateS(u32 opcode, instruction *inst)
 {
     u32 rs = RS(opcode);
     s16 imm = (s16)bitrange(opcode, 0, 15);
@@ -312,7 +313,7 @@ void arg_parse_RsImmediateS(u32 opcode, instruction *inst, const parse_instructi
     _add_argument(immediate<s16>{imm}, inst);
 };
 
-void arg_parse_RtImmediateU(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_RtImmediateU(u32 opcode, instruction *inst)
 {
     u32 rt = RT(opcode);
     u16 imm = (u16)bitrange(opcode, 0, 15);
@@ -321,7 +322,7 @@ void arg_parse_RtImmediateU(u32 opcode, instruction *inst, const parse_instructi
     _add_argument(immediate<u16>{imm}, inst);
 };
 
-void arg_parse_RsBranchAddress(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_RsBranchAddress(u32 opcode, instruction *inst)
 {
     u32 rs = RS(opcode);
     u32 off = inst->address;
@@ -332,12 +333,13 @@ void arg_parse_RsBranchAddress(u32 opcode, instruction *inst, const parse_instru
     add_branch_address_argument(off, inst);
 };
 
-void arg_parse_Bgezal(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+template<bool EmitPseudo>
+void arg_parse_Bgezal(u32 opcode, instruction *inst)
 {
     // pseudoinstruction Bal
-    if (!conf->emit_pseudo)
+    if constexpr (!EmitPseudo)
     {
-        arg_parse_RsBranchAddress(opcode, inst, conf);
+        arg_parse_RsBranchAddress(opcode, inst);
         return;
     }
 
@@ -345,7 +347,7 @@ void arg_parse_Bgezal(u32 opcode, instruction *inst, const parse_instructions_co
     
     if (rs > 0)
     {
-        arg_parse_RsBranchAddress(opcode, inst, conf);
+        arg_parse_RsBranchAddress(opcode, inst);
         return;
     }
 
@@ -358,7 +360,7 @@ void arg_parse_Bgezal(u32 opcode, instruction *inst, const parse_instructions_co
     add_jump_address_argument(off, inst);
 };
 
-void arg_parse_JumpAddress(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_JumpAddress(u32 opcode, instruction *inst)
 {
     u32 off = bitrange(opcode, 0, 25) << 2;
     u32 addr = inst->address & 0xf0000000;
@@ -367,7 +369,7 @@ void arg_parse_JumpAddress(u32 opcode, instruction *inst, const parse_instructio
     add_jump_address_argument(addr, inst);
 }
 
-void arg_parse_RsRtBranchAddress(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_RsRtBranchAddress(u32 opcode, instruction *inst)
 {
     u32 rs = RS(opcode);
     u32 rt = RT(opcode);
@@ -380,11 +382,12 @@ void arg_parse_RsRtBranchAddress(u32 opcode, instruction *inst, const parse_inst
     add_branch_address_argument(off, inst);
 }
 
-void arg_parse_Beq(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+template<bool EmitPseudo>
+void arg_parse_Beq(u32 opcode, instruction *inst)
 {
-    if (!conf->emit_pseudo)
+    if constexpr (!EmitPseudo)
     {
-        arg_parse_RsRtBranchAddress(opcode, inst, conf);
+        arg_parse_RsRtBranchAddress(opcode, inst);
         return;
     }
     
@@ -394,7 +397,7 @@ void arg_parse_Beq(u32 opcode, instruction *inst, const parse_instructions_confi
 
     if (rs != rt)
     {
-        arg_parse_RsRtBranchAddress(opcode, inst, conf);
+        arg_parse_RsRtBranchAddress(opcode, inst);
         return;
     }
 
@@ -406,11 +409,12 @@ void arg_parse_Beq(u32 opcode, instruction *inst, const parse_instructions_confi
     add_branch_address_argument(off, inst);
 }
 
-void arg_parse_Beql(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+template<bool EmitPseudo>
+void arg_parse_Beql(u32 opcode, instruction *inst)
 {
-    if (!conf->emit_pseudo)
+    if constexpr (!EmitPseudo)
     {
-        arg_parse_RsRtBranchAddress(opcode, inst, conf);
+        arg_parse_RsRtBranchAddress(opcode, inst);
         return;
     }
     
@@ -420,7 +424,7 @@ void arg_parse_Beql(u32 opcode, instruction *inst, const parse_instructions_conf
 
     if (rs != rt)
     {
-        arg_parse_RsRtBranchAddress(opcode, inst, conf);
+        arg_parse_RsRtBranchAddress(opcode, inst);
         return;
     }
 
@@ -432,7 +436,7 @@ void arg_parse_Beql(u32 opcode, instruction *inst, const parse_instructions_conf
     add_branch_address_argument(off, inst);
 }
 
-void arg_parse_RtRsSignExtendedImmediateU(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_RtRsSignExtendedImmediateU(u32 opcode, instruction *inst)
 {
     u32 rs = RS(opcode);
     u32 rt = RT(opcode);
@@ -443,7 +447,7 @@ void arg_parse_RtRsSignExtendedImmediateU(u32 opcode, instruction *inst, const p
     _add_argument(extend16_immu32(imm), inst);
 };
 
-void arg_parse_RtRsImmediateU(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_RtRsImmediateU(u32 opcode, instruction *inst)
 {
     u32 rs = RS(opcode);
     u32 rt = RT(opcode);
@@ -454,7 +458,7 @@ void arg_parse_RtRsImmediateU(u32 opcode, instruction *inst, const parse_instruc
     _add_argument(immediate<u32>{imm}, inst);
 };
 
-void arg_parse_RtRsImmediateS(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_RtRsImmediateS(u32 opcode, instruction *inst)
 {
     u32 rs = RS(opcode);
     u32 rt = RT(opcode);
@@ -465,11 +469,12 @@ void arg_parse_RtRsImmediateS(u32 opcode, instruction *inst, const parse_instruc
     _add_argument(extend16_imms32(imm), inst);
 };
 
-void arg_parse_Addi(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+template<bool EmitPseudo>
+void arg_parse_Addi(u32 opcode, instruction *inst)
 {
-    if (!conf->emit_pseudo)
+    if constexpr (!EmitPseudo)
     {
-        arg_parse_RtRsImmediateS(opcode, inst, conf);
+        arg_parse_RtRsImmediateS(opcode, inst);
         return;
     }
     
@@ -478,7 +483,7 @@ void arg_parse_Addi(u32 opcode, instruction *inst, const parse_instructions_conf
 
     if (rs != 0)
     {
-        arg_parse_RtRsImmediateS(opcode, inst, conf);
+        arg_parse_RtRsImmediateS(opcode, inst);
         return;
     }
 
@@ -489,11 +494,12 @@ void arg_parse_Addi(u32 opcode, instruction *inst, const parse_instructions_conf
     _add_argument(extend16_imms32(imm), inst);
 };
 
-void arg_parse_Ori(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+template<bool EmitPseudo>
+void arg_parse_Ori(u32 opcode, instruction *inst)
 {
-    if (!conf->emit_pseudo)
+    if constexpr (!EmitPseudo)
     {
-        arg_parse_RtRsImmediateU(opcode, inst, conf);
+        arg_parse_RtRsImmediateU(opcode, inst);
         return;
     }
     
@@ -502,7 +508,7 @@ void arg_parse_Ori(u32 opcode, instruction *inst, const parse_instructions_confi
 
     if (rs != 0)
     {
-        arg_parse_RtRsImmediateU(opcode, inst, conf);
+        arg_parse_RtRsImmediateU(opcode, inst);
         return;
     }
 
@@ -513,7 +519,7 @@ void arg_parse_Ori(u32 opcode, instruction *inst, const parse_instructions_confi
     _add_argument(immediate<u32>{imm}, inst);
 };
 
-void arg_parse_RsRtMemOffset(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_RsRtMemOffset(u32 opcode, instruction *inst)
 {
     u32 rs = RS(opcode);
     u32 rt = RT(opcode);
@@ -524,7 +530,7 @@ void arg_parse_RsRtMemOffset(u32 opcode, instruction *inst, const parse_instruct
     _add_argument(base_register{static_cast<mips_register>(rs)}, inst);
 };
 
-void arg_parse_Cache(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_Cache(u32 opcode, instruction *inst)
 {
     s16 off = (s16)bitrange(opcode, 0, 15);
     u32 rs = RS(opcode);
@@ -535,7 +541,7 @@ void arg_parse_Cache(u32 opcode, instruction *inst, const parse_instructions_con
     _add_argument(base_register{static_cast<mips_register>(rs)}, inst);
 }
 
-void arg_parse_Ext(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_Ext(u32 opcode, instruction *inst)
 {
     u32 rs = RS(opcode);
     u32 rt = RT(opcode);
@@ -549,7 +555,7 @@ void arg_parse_Ext(u32 opcode, instruction *inst, const parse_instructions_confi
     _add_argument(bitfield_size{sz}, inst);
 }
 
-void arg_parse_Ins(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_Ins(u32 opcode, instruction *inst)
 {
     u32 rs = RS(opcode);
     u32 rt = RT(opcode);
@@ -564,7 +570,7 @@ void arg_parse_Ins(u32 opcode, instruction *inst, const parse_instructions_confi
     _add_argument(bitfield_size{sz}, inst);
 }
 
-void arg_parse_FPUBranchAddress(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_FPUBranchAddress(u32 opcode, instruction *inst)
 {
     u32 off = inst->address;
     s16 imm = (s16)(bitrange(opcode, 0, 16)) << 2;
@@ -575,7 +581,7 @@ void arg_parse_FPUBranchAddress(u32 opcode, instruction *inst, const parse_instr
     _add_argument(condition_code{cc}, inst);
 };
 
-void arg_parse_RsFtMemOffset(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_RsFtMemOffset(u32 opcode, instruction *inst)
 {
     u32 rs = RS(opcode);
     u32 ft = FT(opcode);
@@ -586,7 +592,7 @@ void arg_parse_RsFtMemOffset(u32 opcode, instruction *inst, const parse_instruct
     _add_argument(base_register{static_cast<mips_register>(rs)}, inst);
 };
 
-void arg_parse_FPUFdFsFt(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_FPUFdFsFt(u32 opcode, instruction *inst)
 {
     u32 ft = FT(opcode);
     u32 fs = FS(opcode);
@@ -598,7 +604,7 @@ void arg_parse_FPUFdFsFt(u32 opcode, instruction *inst, const parse_instructions
     add_fpu_register_argument(ft, inst);
 }
 
-void arg_parse_FPUFdFs(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_FPUFdFs(u32 opcode, instruction *inst)
 {
     u32 fs = FS(opcode);
     u32 fd = FD(opcode);
@@ -608,7 +614,7 @@ void arg_parse_FPUFdFs(u32 opcode, instruction *inst, const parse_instructions_c
     add_fpu_register_argument(fs, inst);
 }
 
-void arg_parse_FPUCompare(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_FPUCompare(u32 opcode, instruction *inst)
 {
     u32 ft = FT(opcode);
     u32 fs = FS(opcode);
@@ -619,7 +625,7 @@ void arg_parse_FPUCompare(u32 opcode, instruction *inst, const parse_instruction
     _add_argument(extra{cc}, inst);
 }
 
-void arg_parse_FPURtFs(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_FPURtFs(u32 opcode, instruction *inst)
 {
     u32 rt = RT(opcode);
     u32 fs = FS(opcode);
@@ -629,7 +635,7 @@ void arg_parse_FPURtFs(u32 opcode, instruction *inst, const parse_instructions_c
 }
 
 // VFPU
-void arg_parse_VFPU_Cop2(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_Cop2(u32 opcode, instruction *inst)
 {
     u32 rt = RT(opcode);
     u16 unk = (u16)bitrange(opcode, 0u, 15u);
@@ -638,7 +644,7 @@ void arg_parse_VFPU_Cop2(u32 opcode, instruction *inst, const parse_instructions
     _add_argument(immediate<u16>{unk}, inst);
 }
 
-void arg_parse_VFPU_MFTV(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_MFTV(u32 opcode, instruction *inst)
 {
     // ppsspp
     u32 rt = RT(opcode);
@@ -648,7 +654,7 @@ void arg_parse_VFPU_MFTV(u32 opcode, instruction *inst, const parse_instructions
     add_vfpu_register_argument(vr, vfpu_size::Single, inst);
 }
 
-void arg_parse_VFPU_Vd_Vs_Vt(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_Vd_Vs_Vt(u32 opcode, instruction *inst)
 {
     vfpu_size sz = get_vfpu_size(opcode);
     u32 vd = VD(opcode);
@@ -660,7 +666,7 @@ void arg_parse_VFPU_Vd_Vs_Vt(u32 opcode, instruction *inst, const parse_instruct
     add_vfpu_register_argument(vt, sz, inst);
 }
 
-void arg_parse_VFPU_VdSingle_Vs_Vt(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_VdSingle_Vs_Vt(u32 opcode, instruction *inst)
 {
     vfpu_size sz = get_vfpu_size(opcode);
     u32 vd = VD(opcode);
@@ -672,7 +678,7 @@ void arg_parse_VFPU_VdSingle_Vs_Vt(u32 opcode, instruction *inst, const parse_in
     add_vfpu_register_argument(vt, sz, inst);
 }
 
-void arg_parse_VFPU_Vd_Vs_VtSingle(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_Vd_Vs_VtSingle(u32 opcode, instruction *inst)
 {
     vfpu_size sz = get_vfpu_size(opcode);
     u32 vd = VD(opcode);
@@ -684,7 +690,7 @@ void arg_parse_VFPU_Vd_Vs_VtSingle(u32 opcode, instruction *inst, const parse_in
     add_vfpu_register_argument(vt, vfpu_size::Single, inst);
 }
 
-void arg_parse_VFPU_Vcrs(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_Vcrs(u32 opcode, instruction *inst)
 {
     vfpu_size sz = get_vfpu_size(opcode);
     u32 vd = VD(opcode);
@@ -701,7 +707,7 @@ void arg_parse_VFPU_Vcrs(u32 opcode, instruction *inst, const parse_instructions
     }
 }
 
-void arg_parse_VFPU_Vcmp(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_Vcmp(u32 opcode, instruction *inst)
 {
     vfpu_size sz = get_vfpu_size(opcode);
     u32 vs = VS(opcode);
@@ -713,7 +719,7 @@ void arg_parse_VFPU_Vcmp(u32 opcode, instruction *inst, const parse_instructions
     add_vfpu_register_argument(vt, sz, inst);
 }
 
-void arg_parse_VFPU_Vd_Vs(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_Vd_Vs(u32 opcode, instruction *inst)
 {
     vfpu_size sz = get_vfpu_size(opcode);
     u32 vd = VD(opcode);
@@ -723,7 +729,7 @@ void arg_parse_VFPU_Vd_Vs(u32 opcode, instruction *inst, const parse_instruction
     add_vfpu_register_argument(vs, sz, inst);
 }
 
-void arg_parse_VFPU_VdSingle_Vs(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_VdSingle_Vs(u32 opcode, instruction *inst)
 {
     vfpu_size sz = get_vfpu_size(opcode);
     u32 vd = VD(opcode);
@@ -733,7 +739,7 @@ void arg_parse_VFPU_VdSingle_Vs(u32 opcode, instruction *inst, const parse_instr
     add_vfpu_register_argument(vs, sz, inst);
 }
 
-void arg_parse_VFPU_Vd_Vs_Imm5(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_Vd_Vs_Imm5(u32 opcode, instruction *inst)
 {
     vfpu_size sz = get_vfpu_size(opcode);
     u32 vd = VD(opcode);
@@ -745,7 +751,7 @@ void arg_parse_VFPU_Vd_Vs_Imm5(u32 opcode, instruction *inst, const parse_instru
     _add_argument(immediate<u8>{imm}, inst);
 }
 
-void arg_parse_VFPU_Vd(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_Vd(u32 opcode, instruction *inst)
 {
     vfpu_size sz = get_vfpu_size(opcode);
     u32 vd = VD(opcode);
@@ -753,14 +759,14 @@ void arg_parse_VFPU_Vd(u32 opcode, instruction *inst, const parse_instructions_c
     add_vfpu_register_argument(vd, sz, inst);
 }
 
-void arg_parse_VFPU_VdSingle(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_VdSingle(u32 opcode, instruction *inst)
 {
     u32 vd = VD(opcode);
 
     add_vfpu_register_argument(vd, vfpu_size::Single, inst);
 }
 
-void arg_parse_VFPU_VdHalf_Vs(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_VdHalf_Vs(u32 opcode, instruction *inst)
 {
     vfpu_size sz = get_vfpu_size(opcode);
     vfpu_size hsz = half_size(sz);
@@ -777,7 +783,7 @@ void arg_parse_VFPU_VdHalf_Vs(u32 opcode, instruction *inst, const parse_instruc
     add_vfpu_register_argument(vs, sz, inst);
 }
 
-void arg_parse_VFPU_VdDouble_Vs(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_VdDouble_Vs(u32 opcode, instruction *inst)
 {
     vfpu_size sz = get_vfpu_size(opcode);
     vfpu_size dsz = double_size(sz);
@@ -789,7 +795,7 @@ void arg_parse_VFPU_VdDouble_Vs(u32 opcode, instruction *inst, const parse_instr
     add_vfpu_register_argument(vs, sz, inst);
 }
 
-void arg_parse_VFPU_Vmfvc(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_Vmfvc(u32 opcode, instruction *inst)
 {
     u32 vd = VD(opcode);
     u32 vr = VS(opcode) + 128;
@@ -798,7 +804,7 @@ void arg_parse_VFPU_Vmfvc(u32 opcode, instruction *inst, const parse_instruction
     add_vfpu_register_argument(vr, vfpu_size::Single, inst);
 }
 
-void arg_parse_VFPU_Vmtvc(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_Vmtvc(u32 opcode, instruction *inst)
 {
     u32 vr = VD(opcode) + 128;
     u32 vs = VS(opcode);
@@ -807,7 +813,7 @@ void arg_parse_VFPU_Vmtvc(u32 opcode, instruction *inst, const parse_instruction
     add_vfpu_register_argument(vr, vfpu_size::Single, inst);
 }
 
-void arg_parse_VFPU_ColorConv(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_ColorConv(u32 opcode, instruction *inst)
 {
     vfpu_size sz = get_vfpu_size(opcode);
     vfpu_size hsz = half_size(sz);
@@ -819,7 +825,7 @@ void arg_parse_VFPU_ColorConv(u32 opcode, instruction *inst, const parse_instruc
     add_vfpu_register_argument(vs, sz, inst);
 }
 
-void arg_parse_VFPU_Vwbn(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_Vwbn(u32 opcode, instruction *inst)
 {
     vfpu_size sz = get_vfpu_size(opcode);
 
@@ -832,7 +838,7 @@ void arg_parse_VFPU_Vwbn(u32 opcode, instruction *inst, const parse_instructions
     _add_argument(immediate<u8>{imm}, inst);
 }
 
-void arg_parse_VFPU_Vcst(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_Vcst(u32 opcode, instruction *inst)
 {
     vfpu_size sz = get_vfpu_size(opcode);
 
@@ -843,7 +849,7 @@ void arg_parse_VFPU_Vcst(u32 opcode, instruction *inst, const parse_instructions
     _add_argument(static_cast<vfpu_constant>(constant), inst);
 }
 
-void arg_parse_VFPU_Vcmov(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_Vcmov(u32 opcode, instruction *inst)
 {
     vfpu_size sz = get_vfpu_size(opcode);
 
@@ -863,7 +869,7 @@ void arg_parse_VFPU_Vcmov(u32 opcode, instruction *inst, const parse_instruction
     _add_argument(immediate<u8>{imm}, inst);
 }
 
-void arg_parse_VFPU_PrefixST(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_PrefixST(u32 opcode, instruction *inst)
 {
     u32 data = bitrange(opcode, 0, 19);
     vfpu_prefix_array arr;
@@ -887,7 +893,7 @@ void arg_parse_VFPU_PrefixST(u32 opcode, instruction *inst, const parse_instruct
     _add_argument(arr, inst);
 }
 
-void arg_parse_VFPU_PrefixDest(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_PrefixDest(u32 opcode, instruction *inst)
 {
     u32 data = bitrange(opcode, 0, 19);
     vfpu_destination_prefix_array arr;
@@ -904,7 +910,7 @@ void arg_parse_VFPU_PrefixDest(u32 opcode, instruction *inst, const parse_instru
     _add_argument(arr, inst);
 }
 
-void arg_parse_VFPU_Viim(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_Viim(u32 opcode, instruction *inst)
 {
     u32 vt = VT(opcode);
     u16 imm = (u16)bitrange(opcode, 0, 15);
@@ -972,7 +978,7 @@ static float Float16ToFloat32(u16 l)
 	return f;
 }
 
-void arg_parse_VFPU_Vfim(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_Vfim(u32 opcode, instruction *inst)
 {
     u32 vt = VT(opcode);
     u16 imm = (u16)bitrange(opcode, 0, 15);
@@ -981,7 +987,7 @@ void arg_parse_VFPU_Vfim(u32 opcode, instruction *inst, const parse_instructions
     _add_argument(immediate<float>{Float16ToFloat32(imm)}, inst);
 }
 
-void arg_parse_VFPU_LvSv_S(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_LvSv_S(u32 opcode, instruction *inst)
 {
     u32 rs = RS(opcode);
     u32 vt = bitrange(opcode, 16, 20) | (bitrange(opcode, 0, 1) << 5);
@@ -992,7 +998,7 @@ void arg_parse_VFPU_LvSv_S(u32 opcode, instruction *inst, const parse_instructio
     _add_argument(base_register{static_cast<mips_register>(rs)}, inst);
 }
 
-void arg_parse_VFPU_LvSv_Q(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_LvSv_Q(u32 opcode, instruction *inst)
 {
     u32 rs = RS(opcode);
     u32 vt = bitrange(opcode, 16, 20) | (bitrange(opcode, 0, 0) << 5);
@@ -1006,7 +1012,7 @@ void arg_parse_VFPU_LvSv_Q(u32 opcode, instruction *inst, const parse_instructio
         _add_argument(string_argument{"wb"}, inst); // ??
 }
 
-void arg_parse_VFPU_LvSv_LRQ(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_LvSv_LRQ(u32 opcode, instruction *inst)
 {
     u32 rs = RS(opcode);
     u32 vt = bitrange(opcode, 16, 20) | (bitrange(opcode, 0, 0) << 5);
@@ -1017,7 +1023,7 @@ void arg_parse_VFPU_LvSv_LRQ(u32 opcode, instruction *inst, const parse_instruct
     _add_argument(base_register{static_cast<mips_register>(rs)}, inst);
 }
 
-void arg_parse_VFPU_MVd(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_MVd(u32 opcode, instruction *inst)
 {
     vfpu_size sz = get_vfpu_size(opcode);
     u32 vd = VD(opcode);
@@ -1025,7 +1031,7 @@ void arg_parse_VFPU_MVd(u32 opcode, instruction *inst, const parse_instructions_
     add_vfpu_matrix_argument(vd, sz, inst);
 }
 
-void arg_parse_VFPU_MVd_MVs(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_MVd_MVs(u32 opcode, instruction *inst)
 {
     vfpu_size sz = get_vfpu_size(opcode);
     u32 vd = VD(opcode);
@@ -1035,7 +1041,7 @@ void arg_parse_VFPU_MVd_MVs(u32 opcode, instruction *inst, const parse_instructi
     add_vfpu_matrix_argument(vs, sz, inst);
 }
 
-void arg_parse_VFPU_MVd_XVs_MVt(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_MVd_XVs_MVt(u32 opcode, instruction *inst)
 {
     // https://github.com/hrydgard/ppsspp/blob/6f04f52f5ca51b60c719e074199691b2ccf32860/Core/MIPS/MIPSDisVFPU.cpp#L291
     vfpu_size sz = get_vfpu_size(opcode);
@@ -1048,7 +1054,7 @@ void arg_parse_VFPU_MVd_XVs_MVt(u32 opcode, instruction *inst, const parse_instr
     add_vfpu_matrix_argument(vt, sz, inst);
 }
 
-void arg_parse_VFPU_Vhtfm2(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_Vhtfm2(u32 opcode, instruction *inst)
 {
     u32 vd = VD(opcode);
     u32 vs = VS(opcode);
@@ -1059,7 +1065,7 @@ void arg_parse_VFPU_Vhtfm2(u32 opcode, instruction *inst, const parse_instructio
     add_vfpu_register_argument(vt, vfpu_size::Pair, inst);
 }
 
-void arg_parse_VFPU_Vhtfm3(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_Vhtfm3(u32 opcode, instruction *inst)
 {
     u32 vd = VD(opcode);
     u32 vs = VS(opcode);
@@ -1070,7 +1076,7 @@ void arg_parse_VFPU_Vhtfm3(u32 opcode, instruction *inst, const parse_instructio
     add_vfpu_register_argument(vt, vfpu_size::Triple, inst);
 }
 
-void arg_parse_VFPU_Vhtfm4(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_Vhtfm4(u32 opcode, instruction *inst)
 {
     u32 vd = VD(opcode);
     u32 vs = VS(opcode);
@@ -1081,7 +1087,7 @@ void arg_parse_VFPU_Vhtfm4(u32 opcode, instruction *inst, const parse_instructio
     add_vfpu_register_argument(vt, vfpu_size::Quad, inst);
 }
 
-void arg_parse_VFPU_MVd_MVs_VtSingle(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_MVd_MVs_VtSingle(u32 opcode, instruction *inst)
 {
     vfpu_size sz = get_vfpu_size(opcode);
     u32 vd = VD(opcode);
@@ -1093,7 +1099,7 @@ void arg_parse_VFPU_MVd_MVs_VtSingle(u32 opcode, instruction *inst, const parse_
     add_vfpu_register_argument(vt, vfpu_size::Single, inst);
 }
 
-void arg_parse_VFPU_Vrot(u32 opcode, instruction *inst, const parse_instructions_config *conf)
+void arg_parse_VFPU_Vrot(u32 opcode, instruction *inst)
 {
     vfpu_size sz = get_vfpu_size(opcode);
     u32 vd = VD(opcode);
@@ -1123,3 +1129,16 @@ void arg_parse_VFPU_Vrot(u32 opcode, instruction *inst, const parse_instructions
     add_vfpu_register_argument(vs, vfpu_size::Single, inst);
     _add_argument(arr, inst);
 }
+
+template void arg_parse_AdduOr<false>(u32 opcode, instruction *inst);
+template void arg_parse_AdduOr<true>(u32 opcode, instruction *inst);
+template void arg_parse_Bgezal<false>(u32 opcode, instruction *inst);
+template void arg_parse_Bgezal<true>(u32 opcode, instruction *inst);
+template void arg_parse_Beq<false>(u32 opcode, instruction *inst);
+template void arg_parse_Beq<true>(u32 opcode, instruction *inst);
+template void arg_parse_Beql<false>(u32 opcode, instruction *inst);
+template void arg_parse_Beql<true>(u32 opcode, instruction *inst);
+template void arg_parse_Addi<false>(u32 opcode, instruction *inst);
+template void arg_parse_Addi<true>(u32 opcode, instruction *inst);
+template void arg_parse_Ori<false>(u32 opcode, instruction *inst);
+template void arg_parse_Ori<true>(u32 opcode, instruction *inst);
@@ -3,15 +3,23 @@
 #include "shl/assert.hpp"
 #include "shl/memory.hpp"
 #include "shl/fixed_array.hpp"
+#include "shl/defer.hpp"
 
 #include "allegrex/parse_instruction_arguments.hpp"
 #include "allegrex/parse_instructions.hpp"
+#include "allegrex/stats.hpp"
+
+// what scan_mnemonics needs the arguments of an instruction for
+#define SCAN_JUMP   0x01 // the arguments have a jump or branch address
+#define SCAN_PSEUDO 0x02 // the mnemonic may change if conf->emit_pseudo is set
 
 struct instruction_info
 {
     allegrex_mnemonic mnemonic;
     u32 opcode;
     argument_parse_function_t argument_parse_function;
+    argument_parse_function_t pseudo_argument_parse_function; // used if conf->emit_pseudo is set
+    u8 scan_flags;
 };
 
 struct category
@@ -26,9 +34,23 @@ struct category
     u64 sub_category_count;
 };
 
+constexpr u8 _get_scan_flags(argument_parse_function_t f)
+{
+    if (f == arg_parse_RsBranchAddress || f == arg_parse_RsRtBranchAddress
+     || f == arg_parse_JumpAddress || f == arg_parse_FPUBranchAddress
+     || f == arg_parse_Bgezal<false> || f == arg_parse_Beq<false> || f == arg_parse_Beql<false>)
+        return SCAN_JUMP;
+
+    return 0;
+}
+
 // instructions
 #define I(Mnemonic, Opcode, ...) \
-    instruction_info{allegrex_mnemonic::Mnemonic, Opcode __VA_OPT__(,) __VA_ARGS__}
+    instruction_info{allegrex_mnemonic::Mnemonic, Opcode __VA_OPT__(, __VA_ARGS__, __VA_ARGS__, _get_scan_flags(__VA_ARGS__))}
+
+// instructions that may be pseudoinstructions, Parser is specialized for emit_pseudo
+#define P(Mnemonic, Opcode, Parser) \
+    instruction_info{allegrex_mnemonic::Mnemonic, Opcode, Parser<false>, Parser<true>, (u8)(_get_scan_flags(Parser<false>) | SCAN_PSEUDO)}
 
 constexpr fixed_array instructions_Fixed = {
     I(NOP, 0x00000000, nullptr)
@@ -69,11 +91,11 @@ constexpr fixed_array instructions_Special = {
     I(MADD,    0x0000001c, arg_parse_RsRt),
     I(MADDU,   0x0000001d, arg_parse_RsRt),
     I(ADD,     0x00000020, arg_parse_RdRsRt),
-    I(ADDU,    0x00000021, arg_parse_AdduOr),
+    P(ADDU,    0x00000021, arg_parse_AdduOr),
     I(SUB,     0x00000022, arg_parse_RdRsRt),
     I(SUBU,    0x00000023, arg_parse_RdRsRt),
     I(AND,     0x00000024, arg_parse_RdRsRt),
-    I(OR,      0x00000025, arg_parse_AdduOr),
+    P(OR,      0x00000025, arg_parse_AdduOr),
     I(XOR,     0x00000026, arg_parse_RdRsRt),
     I(NOR,     0x00000027, arg_parse_RdRsRt),
     I(SLT,     0x0000002a, arg_parse_RdRsRt),
@@ -354,19 +376,19 @@ constexpr fixed_array instructions_lvsvrl = {
 constexpr fixed_array instructions_Immediate = {
     I(J,     0x08000000, arg_parse_JumpAddress),
     I(JAL,   0x0c000000, arg_parse_JumpAddress),
-    I(BEQ,   0x10000000, arg_parse_Beq),
+    P(BEQ,   0x10000000, arg_parse_Beq),
     I(BNE,   0x14000000, arg_parse_RsRtBranchAddress),
     I(BLEZ,  0x18000000, arg_parse_RsBranchAddress),
     I(BGTZ,  0x1c000000, arg_parse_RsBranchAddress),
-    I(ADDI,  0x20000000, arg_parse_Addi),
-    I(ADDIU, 0x24000000, arg_parse_Addi),
+    P(ADDI,  0x20000000, arg_parse_Addi),
+    P(ADDIU, 0x24000000, arg_parse_Addi),
     I(SLTI,  0x28000000, arg_parse_RtRsImmediateS),
     I(SLTIU, 0x2c000000, arg_parse_RtRsSignExtendedImmediateU),
     I(ANDI,  0x30000000, arg_parse_RtRsImmediateU),
-    I(ORI,   0x34000000, arg_parse_Ori),
+    P(ORI,   0x34000000, arg_parse_Ori),
     I(XORI,  0x38000000, arg_parse_RtRsImmediateU),
     I(LUI,   0x3c000000, arg_parse_RtImmediateU),
-    I(BEQL,  0x50000000, arg_parse_Beql),
+    P(BEQL,  0x50000000, arg_parse_Beql),
     I(BNEL,  0x54000000, arg_parse_RsRtBranchAddress),
     I(BLEZL, 0x58000000, arg_parse_RsBranchAddress),
     I(BGTZL, 0x5c000000, arg_parse_RsBranchAddress),
@@ -405,7 +427,7 @@ constexpr fixed_array instructions_RegisterImmediate = {
     I(TEQI,    0x040c0000, arg_parse_RsImmediateS),
     I(TNEI,    0x040e0000, arg_parse_RsImmediateS),
     I(BLTZAL,  0x04100000, arg_parse_RsBranchAddress),
-    I(BGEZAL,  0x04110000, arg_parse_Bgezal),
+    P(BGEZAL,  0x04110000, arg_parse_Bgezal),
     I(BLTZALL, 0x04120000, arg_parse_RsBranchAddress),
     I(BGEZALL, 0x04130000, arg_parse_RsBranchAddress),
     I(SYNCI,   0x041f0000, nullptr)
@@ -784,86 +806,728 @@ constexpr category AllInstructions{
     CATEGORY_SUB_CATEGORIES(AllInstructions)
 };
 
-static void _populate_instruction(instruction *instr, const instruction_info *info, const parse_instructions_config *conf)
+/* Decode table
+
+The recursive category walk tries the sub categories of a category (depth first)
+before the instructions of the category itself and the first instruction whose
+opcode matches the opcode masked by the category mask wins.
+This flattens that walk into an ordered list of (mask, opcode) candidates and
+distributes the candidates into a two level table at compile time:
+the primary table is indexed by the top 6 bits of the opcode, each primary entry
+selects a bucket by (at most) two bit fields of the opcode, which are derived from
+the masks of the candidates of that primary opcode.
+Candidates within a bucket keep the order of the category walk, so the first
+match in the bucket is the instruction the category walk would have found.
+*/
+#define DECODE_PRIMARY_SHIFT 26
+#define DECODE_PRIMARY_COUNT 64
+#define DECODE_SECONDARY_FIELD_MASK 0x03ffffff
+#define DECODE_MAX_SECONDARY_BITS 11
+
+struct decode_candidate
 {
-    instr->mnemonic = info->mnemonic;
-    
-    if (info->argument_parse_function != nullptr)
-        info->argument_parse_function(instr->opcode, instr, conf);
+    u32 mask;
+    u32 opcode;
+    const instruction_info *info;
+};
 
-}
+struct decode_primary
+{
+    u8 hi_shift;
+    u8 lo_shift;
+    u8 lo_bits;
+    u8 bits; // hi bits + lo bits
+    u16 hi_mask;
+    u16 lo_mask;
+    u32 bucket_offset;
+};
+
+struct decode_bucket
+{
+    u32 candidate_offset;
+    u32 candidate_count;
+};
+
+struct decode_table_size
+{
+    u64 candidate_count;
+    u64 bucket_count;
+    u64 bucket_candidate_count;
+};
+
+template<u64 CandidateCount, u64 BucketCount, u64 BucketCandidateCount>
+struct decode_table
+{
+    decode_primary primaries[DECODE_PRIMARY_COUNT];
+    decode_bucket buckets[BucketCount];
+    decode_candidate candidates[BucketCandidateCount];
+};
 
-static bool _try_parse_category_instruction(u32 opcode, const category *cat, instruction *out, const parse_instructions_config *conf)
+constexpr u64 _count_category_candidates(const category *cat)
 {
-    if (cat == nullptr)
-        return false;
+    u64 ret = cat->instruction_count;
 
     for (u64 i = 0; i < cat->sub_category_count; ++i)
-        if (_try_parse_category_instruction(opcode, cat->sub_categories[i], out, conf))
-            return true;
+        ret += _count_category_candidates(cat->sub_categories[i]);
 
-    u32 mop = opcode & cat->mask;
+    return ret;
+}
 
-    if (mop < cat->min || mop > cat->max)
-        return false;
+// same order as the category walk: sub categories first
+constexpr void _flatten_category(const category *cat, decode_candidate *out, u64 *count)
+{
+    for (u64 i = 0; i < cat->sub_category_count; ++i)
+        _flatten_category(cat->sub_categories[i], out, count);
 
     for (u64 i = 0; i < cat->instruction_count; ++i)
     {
-        const instruction_info &instr = cat->instructions[i];
+        const instruction_info *info = cat->instructions + i;
+
+        // the category walk checks the range first, instructions outside
+        // of the range of their category are never found.
+        if (info->opcode < cat->min || info->opcode > cat->max)
+            continue;
+
+        out[*count] = decode_candidate{cat->mask, info->opcode, info};
+        *count += 1;
+    }
+}
+
+constexpr bool _is_primary_candidate(const decode_candidate *cand, u32 primary)
+{
+    u32 primary_bits = primary << DECODE_PRIMARY_SHIFT;
+    u32 mask = cand->mask & ~DECODE_SECONDARY_FIELD_MASK;
+
+    return (primary_bits & mask) == (cand->opcode & mask);
+}
+
+constexpr u32 _secondary_key(u32 opcode, const decode_primary *prim)
+{
+    return (((opcode >> prim->hi_shift) & prim->hi_mask) << prim->lo_bits)
+         | ((opcode >> prim->lo_shift) & prim->lo_mask);
+}
+
+constexpr u32 _bit_run_length(u32 bits, u32 from, s32 step)
+{
+    u32 ret = 0;
+
+    for (s32 i = (s32)from; i >= 0 && i < 32 && ((bits >> i) & 1); i += step)
+        ++ret;
+
+    return ret;
+}
+
+/* Selects the secondary fields of a primary opcode from the union of the masks
+of its candidates (excluding exact matches such as nop, those are resolved
+within the bucket).
+If the union fits into DECODE_MAX_SECONDARY_BITS bits, the single field spanning the
+union is used, otherwise the highest and lowest contiguous runs of the union
+(e.g. rs and funct) are used.
+*/
+constexpr decode_primary _get_decode_primary(const decode_candidate *cands, u64 count, u32 primary)
+{
+    decode_primary ret{};
+    u32 fields = 0;
+
+    for (u64 i = 0; i < count; ++i)
+        if (_is_primary_candidate(cands + i, primary) && cands[i].mask != 0xffffffff)
+            fields |= cands[i].mask & DECODE_SECONDARY_FIELD_MASK;
+
+    if (fields == 0)
+        return ret;
+
+    u32 top = 31;
+    u32 bottom = 0;
+
+    while (((fields >> top) & 1) == 0)
+        --top;
+
+    while (((fields >> bottom) & 1) == 0)
+        ++bottom;
+
+    u32 hi_bits = 0;
+    u32 lo_bits = 0;
+
+    if (top - bottom + 1 <= DECODE_MAX_SECONDARY_BITS)
+    {
+        ret.hi_shift = (u8)bottom;
+        hi_bits = top - bottom + 1;
+    }
+    else
+    {
+        hi_bits = _bit_run_length(fields, top, -1);
+        lo_bits = _bit_run_length(fields, bottom, 1);
+
+        if (hi_bits > DECODE_MAX_SECONDARY_BITS)
+            hi_bits = DECODE_MAX_SECONDARY_BITS;
+
+        if (hi_bits + lo_bits > DECODE_MAX_SECONDARY_BITS)
+            lo_bits = DECODE_MAX_SECONDARY_BITS - hi_bits;
+
+        ret.hi_shift = (u8)(top + 1 - hi_bits);
+        ret.lo_shift = (u8)bottom;
+    }
+
+    ret.lo_bits = (u8)lo_bits;
+    ret.bits = (u8)(hi_bits + lo_bits);
+    ret.hi_mask = (u16)((1u << hi_bits) - 1);
+    ret.lo_mask = (u16)((1u << lo_bits) - 1);
+
+    return ret;
+}
+
+// the secondary key bits that are not determined by the candidate mask
+constexpr u32 _free_secondary_key_bits(const decode_candidate *cand, const decode_primary *prim)
+{
+    return ~_secondary_key(cand->mask, prim) & ((1u << prim->bits) - 1);
+}
+
+constexpr u64 _subset_count(u32 bits)
+{
+    u64 ret = 1;
+
+    for (; bits != 0; bits &= bits - 1)
+        ret *= 2;
+
+    return ret;
+}
 
-        if (mop == instr.opcode)
+template<u64 MaxCandidateCount>
+constexpr decode_table_size _get_decode_table_size(const category *root)
+{
+    decode_table_size ret{};
+
+    decode_candidate cands[MaxCandidateCount]{};
+    u64 count = 0;
+    _flatten_category(root, cands, &count);
+    ret.candidate_count = count;
+
+    for (u32 p = 0; p < DECODE_PRIMARY_COUNT; ++p)
+    {
+        decode_primary prim = _get_decode_primary(cands, count, p);
+        ret.bucket_count += 1ull << prim.bits;
+
+        for (u64 i = 0; i < count; ++i)
+            if (_is_primary_candidate(cands + i, p))
+                ret.bucket_candidate_count += _subset_count(_free_secondary_key_bits(cands + i, &prim));
+    }
+
+    return ret;
+}
+
+template<u64 CandidateCount, u64 BucketCount, u64 BucketCandidateCount>
+constexpr auto _build_decode_table(const category *root)
+{
+    decode_table<CandidateCount, BucketCount, BucketCandidateCount> ret{};
+
+    decode_candidate cands[CandidateCount]{};
+    u64 count = 0;
+    _flatten_category(root, cands, &count);
+
+    // first pass: number of candidates per bucket
+    u32 bucket_offset = 0;
+
+    for (u32 p = 0; p < DECODE_PRIMARY_COUNT; ++p)
+    {
+        decode_primary *prim = ret.primaries + p;
+        *prim = _get_decode_primary(cands, count, p);
+        prim->bucket_offset = bucket_offset;
+        bucket_offset += 1u << prim->bits;
+
+        for (u64 i = 0; i < count; ++i)
+        {
+            if (!_is_primary_candidate(cands + i, p))
+                continue;
+
+            u32 key = _secondary_key(cands[i].opcode & cands[i].mask, prim);
+            u32 free_bits = _free_secondary_key_bits(cands + i, prim);
+            u32 subset = 0;
+
+            do
+            {
+                ret.buckets[prim->bucket_offset + (key | subset)].candidate_count += 1;
+                subset = (subset - free_bits) & free_bits;
+            } while (subset != 0);
+        }
+    }
+
+    u32 candidate_offset = 0;
+
+    for (u64 b = 0; b < BucketCount; ++b)
+    {
+        ret.buckets[b].candidate_offset = candidate_offset;
+        candidate_offset += ret.buckets[b].candidate_count;
+        ret.buckets[b].candidate_count = 0;
+    }
+
+    // second pass: fill the buckets in category walk order
+    for (u32 p = 0; p < DECODE_PRIMARY_COUNT; ++p)
+    {
+        const decode_primary *prim = ret.primaries + p;
+
+        for (u64 i = 0; i < count; ++i)
         {
-            _populate_instruction(out, &instr, conf);
-            return true;
+            if (!_is_primary_candidate(cands + i, p))
+                continue;
+
+            u32 key = _secondary_key(cands[i].opcode & cands[i].mask, prim);
+            u32 free_bits = _free_secondary_key_bits(cands + i, prim);
+            u32 subset = 0;
+
+            do
+            {
+                decode_bucket *bucket = ret.buckets + prim->bucket_offset + (key | subset);
+                ret.candidates[bucket->candidate_offset + bucket->candidate_count] = cands[i];
+                bucket->candidate_count += 1;
+                subset = (subset - free_bits) & free_bits;
+            } while (subset != 0);
         }
     }
 
-    return false;
+    return ret;
 }
 
-void parse_instruction(u32 opcode, instruction *out, set<jump_destination> *out_jumps, const parse_instructions_config *conf)
+constexpr decode_table_size decode_size = _get_decode_table_size<_count_category_candidates(&AllInstructions)>(&AllInstructions);
+
+constexpr auto decoder = _build_decode_table<decode_size.candidate_count,
+                                             decode_size.bucket_count,
+                                             decode_size.bucket_candidate_count>(&AllInstructions);
+
+static inline const instruction_info *_decode_instruction_info(u32 opcode)
+{
+    const decode_primary *prim = decoder.primaries + (opcode >> DECODE_PRIMARY_SHIFT);
+    const decode_bucket *bucket = decoder.buckets + prim->bucket_offset + _secondary_key(opcode, prim);
+    const decode_candidate *cand = decoder.candidates + bucket->candidate_offset;
+    const decode_candidate *end = cand + bucket->candidate_count;
+
+    for (; cand < end; ++cand)
+        if ((opcode & cand->mask) == cand->opcode)
+            return cand->info;
+
+    return nullptr;
+}
+
+template<bool EmitPseudo>
+static inline void _populate_instruction(instruction *instr, const instruction_info *info)
 {
-    bool found;
+    instr->mnemonic = info->mnemonic;
 
-    found = _try_parse_category_instruction(opcode, &AllInstructions, out, conf);
+    argument_parse_function_t parse = EmitPseudo ? info->pseudo_argument_parse_function : info->argument_parse_function;
 
-    if (!found)
+    if (parse != nullptr)
+        parse(instr->opcode, instr);
+}
+
+static void _add_jumps(const instruction *inst, array<jump_destination> *out_jumps)
+{
+    // add jumps / branches
+    assert(inst->argument_count <= MAX_ARGUMENT_COUNT);
+    for (u32 i = 0; i < inst->argument_count; ++i)
+    {
+        if (inst->argument_types[i] == argument_type::Jump_Address)
+            ::add_at_end(out_jumps, jump_destination{inst->arguments[i].jump_address.data, jump_type::Jump});
+        else if (inst->argument_types[i] == argument_type::Branch_Address)
+            ::add_at_end(out_jumps, jump_destination{inst->arguments[i].branch_address.data, jump_type::Branch});
+    }
+}
+
+template<bool EmitPseudo>
+static inline void _parse_instruction(u32 opcode, instruction *out, array<jump_destination> *out_jumps)
+{
+    const instruction_info *info = _decode_instruction_info(opcode);
+
+    if (info == nullptr)
     {
         out->mnemonic = allegrex_mnemonic::_UNKNOWN;
         return;
     }
 
+    _populate_instruction<EmitPseudo>(out, info);
+
     if (out_jumps != nullptr)
+        _add_jumps(out, out_jumps);
+}
+
+void parse_instruction(u32 opcode, instruction *out, array<jump_destination> *out_jumps, const parse_instructions_config *conf)
+{
+    if (conf->emit_pseudo)
+        _parse_instruction<true>(opcode, out, out_jumps);
+    else
+        _parse_instruction<false>(opcode, out, out_jumps);
+}
+
+void parse_instructions(const char *input, u64 size, array<instruction> *out_instructions, array<jump_destination> *out_jumps, const parse_instructions_config *conf, decode_cache *cache)
+{
+    assert(size % sizeof(u32) == 0);
+    assert(size <= max_value(u32));
+
+    u64 start = out_instructions->size;
+    u32 instruction_count = (u32)(size / sizeof(u32));
+    ::resize(out_instructions, start + instruction_count);
+
+    parse_instructions(input, size, out_instructions->data + start, out_jumps, conf, cache);
+}
+
+// returns the number of unknown opcodes
+template<bool EmitPseudo>
+static u32 _parse_instructions(const char *input, u64 size, instruction *out_instructions, array<jump_destination> *out_jumps, u32 vaddr)
+{
+    u32 *in_data = (u32*)(input);
+    u32 unknown = 0;
+
+    for (u32 addr = 0x00000000, i = 0; addr < size; addr += sizeof(u32), ++i)
     {
-        // add jumps / branches
-        assert(out->argument_count <= MAX_ARGUMENT_COUNT);
-        for (u32 i = 0; i < out->argument_count; ++i)
+        instruction *out_inst = out_instructions + i;
+        *out_inst = {};
+        out_inst->opcode = in_data[i];
+        out_inst->address = vaddr + addr;
+
+        _parse_instruction<EmitPseudo>(out_inst->opcode, out_inst, out_jumps);
+
+        if (out_inst->mnemonic == allegrex_mnemonic::_UNKNOWN)
+            unknown += 1;
+    }
+
+    return unknown;
+}
+
+static inline u32 _decode_cache_index(u32 opcode)
+{
+    static_assert(DECODE_CACHE_BITS > 0 && DECODE_CACHE_BITS < 32, "DECODE_CACHE_BITS must be within 1 - 31");
+
+    // the register and immediate bits of similar opcodes differ, so hash all bits
+    return (opcode * 0x9e3779b1u) >> (32 - DECODE_CACHE_BITS);
+}
+
+// empty entries are nop, which is what opcode 0 decodes to at any address
+static void _clear_decode_cache(decode_cache *cache, bool emit_pseudo)
+{
+    instruction nop{};
+
+    if (emit_pseudo)
+        _parse_instruction<true>(0x00000000, &nop, nullptr);
+    else
+        _parse_instruction<false>(0x00000000, &nop, nullptr);
+
+    for (u32 i = 0; i < DECODE_CACHE_SIZE; ++i)
+        cache->entries[i] = nop;
+
+    cache->emit_pseudo = emit_pseudo;
+}
+
+void init(decode_cache *cache)
+{
+    assert(cache != nullptr);
+
+    cache->entries = alloc<instruction>(DECODE_CACHE_SIZE);
+    cache->hits = 0;
+    cache->misses = 0;
+
+    _clear_decode_cache(cache, false);
+}
+
+void free(decode_cache *cache)
+{
+    assert(cache != nullptr);
+
+    if (cache->entries != nullptr)
+        dealloc(cache->entries, DECODE_CACHE_SIZE);
+
+    cache->entries = nullptr;
+}
+
+// same as _parse_instructions, returns the number of unknown opcodes
+template<bool EmitPseudo>
+static u32 _parse_instructions_cached(const char *input, u64 size, instruction *out_instructions, array<jump_destination> *out_jumps, u32 vaddr, decode_cache *cache)
+{
+    u32 *in_data = (u32*)(input);
+    u32 unknown = 0;
+    u64 hits = 0;
+
+    for (u32 addr = 0x00000000, i = 0; addr < size; addr += sizeof(u32), ++i)
+    {
+        u32 opcode = in_data[i];
+        instruction *out_inst = out_instructions + i;
+        instruction *entry = cache->entries + _decode_cache_index(opcode);
+
+        if (entry->opcode == opcode)
         {
-            if (out->argument_types[i] == argument_type::Jump_Address)
-                ::insert_element(out_jumps, jump_destination{out->arguments[i].jump_address.data, jump_type::Jump});
-            else if (out->argument_types[i] == argument_type::Branch_Address)
-                ::insert_element(out_jumps, jump_destination{out->arguments[i].branch_address.data, jump_type::Branch});
+            *out_inst = *entry;
+            out_inst->address = vaddr + addr;
+
+            if (out_inst->mnemonic == allegrex_mnemonic::_UNKNOWN)
+                unknown += 1;
+
+            hits += 1;
+            continue;
         }
+
+        *out_inst = {};
+        out_inst->opcode = opcode;
+        out_inst->address = vaddr + addr;
+
+        const instruction_info *info = _decode_instruction_info(opcode);
+
+        if (info == nullptr)
+        {
+            out_inst->mnemonic = allegrex_mnemonic::_UNKNOWN;
+            *entry = *out_inst;
+            unknown += 1;
+            continue;
+        }
+
+        _populate_instruction<EmitPseudo>(out_inst, info);
+
+        if (info->scan_flags & SCAN_JUMP)
+        {
+            if (out_jumps != nullptr)
+                _add_jumps(out_inst, out_jumps);
+
+            continue;
+        }
+
+        *entry = *out_inst;
     }
+
+    cache->hits += hits;
+    cache->misses += size / sizeof(u32) - hits;
+
+    ALLEGREX_STATS_ADD(DecodeCacheHits, hits);
+    ALLEGREX_STATS_ADD(DecodeCacheMisses, size / sizeof(u32) - hits);
+
+    return unknown;
 }
 
-void parse_instructions(const char *input, u64 size, array<instruction> *out_instructions, set<jump_destination> *out_jumps, const parse_instructions_config *conf)
+void parse_instructions(const char *input, u64 size, instruction *out_instructions, array<jump_destination> *out_jumps, const parse_instructions_config *conf, decode_cache *cache)
 {
     assert(size % sizeof(u32) == 0);
     assert(size <= max_value(u32));
 
+    ALLEGREX_STATS_TIMER(ParseInstructions);
+
+    u64 first_jump = out_jumps != nullptr ? out_jumps->size : 0;
+    u32 unknown;
+
+    if (cache != nullptr && cache->emit_pseudo != conf->emit_pseudo)
+        _clear_decode_cache(cache, conf->emit_pseudo);
+
+    if (cache != nullptr)
+    {
+        if (conf->emit_pseudo)
+            unknown = _parse_instructions_cached<true>(input, size, out_instructions, out_jumps, conf->vaddr, cache);
+        else
+            unknown = _parse_instructions_cached<false>(input, size, out_instructions, out_jumps, conf->vaddr, cache);
+    }
+    else if (conf->emit_pseudo)
+        unknown = _parse_instructions<true>(input, size, out_instructions, out_jumps, conf->vaddr);
+    else
+        unknown = _parse_instructions<false>(input, size, out_instructions, out_jumps, conf->vaddr);
+
+    ALLEGREX_STATS_ADD(InstructionsDecoded, size / sizeof(u32));
+    ALLEGREX_STATS_ADD(UnknownOpcodes, unknown);
+    add_jump_stats(out_jumps, first_jump);
+}
+
+void scan_mnemonics(const char *input, u64 size, array<allegrex_mnemonic> *out_mnemonics, array<jump_destination> *out_jumps, const parse_instructions_config *conf)
+{
+    assert(size % sizeof(u32) == 0);
+    assert(size <= max_value(u32));
+
+    u64 start = out_mnemonics->size;
     u32 instruction_count = (u32)(size / sizeof(u32));
-    ::reserve(out_instructions, out_instructions->size + instruction_count);
+    ::resize(out_mnemonics, start + instruction_count);
 
+    scan_mnemonics(input, size, out_mnemonics->data + start, out_jumps, conf);
+}
+
+// returns the number of unknown opcodes
+template<bool EmitPseudo>
+static u32 _scan_mnemonics(const char *input, u64 size, allegrex_mnemonic *out_mnemonics, array<jump_destination> *out_jumps, u32 vaddr)
+{
     u32 *in_data = (u32*)(input);
+    u32 unknown = 0;
+
+    // only instructions with jumps or pseudoinstructions need their arguments
+    u8 argument_flags = EmitPseudo ? SCAN_PSEUDO : 0;
+
+    if (out_jumps != nullptr)
+        argument_flags |= SCAN_JUMP;
+
+    instruction inst;
 
     for (u32 addr = 0x00000000, i = 0; addr < size; addr += sizeof(u32), ++i)
     {
-        instruction *out_inst = ::add_at_end(out_instructions);
-        *out_inst = {};
-        out_inst->opcode = in_data[i];
-        out_inst->address = conf->vaddr + addr;
+        u32 opcode = in_data[i];
+        const instruction_info *info = _decode_instruction_info(opcode);
+
+        if (info == nullptr)
+        {
+            out_mnemonics[i] = allegrex_mnemonic::_UNKNOWN;
+            unknown += 1;
+            continue;
+        }
 
-        parse_instruction(out_inst->opcode, out_inst, out_jumps, conf);
+        if ((info->scan_flags & argument_flags) == 0)
+        {
+            out_mnemonics[i] = info->mnemonic;
+            continue;
+        }
+
+        inst = {};
+        inst.opcode = opcode;
+        inst.address = vaddr + addr;
+
+        _populate_instruction<EmitPseudo>(&inst, info);
+
+        if (out_jumps != nullptr)
+            _add_jumps(&inst, out_jumps);
+
+        out_mnemonics[i] = inst.mnemonic;
     }
+
+    return unknown;
+}
+
+void scan_mnemonics(const char *input, u64 size, allegrex_mnemonic *out_mnemonics, array<jump_destination> *out_jumps, const parse_instructions_config *conf)
+{
+    assert(size % sizeof(u32) == 0);
+    assert(size <= max_value(u32));
+
+    ALLEGREX_STATS_TIMER(ParseInstructions);
+
+    u64 first_jump = out_jumps != nullptr ? out_jumps->size : 0;
+    u32 unknown;
+
+    if (conf->emit_pseudo)
+        unknown = _scan_mnemonics<true>(input, size, out_mnemonics, out_jumps, conf->vaddr);
+    else
+        unknown = _scan_mnemonics<false>(input, size, out_mnemonics, out_jumps, conf->vaddr);
+
+    ALLEGREX_STATS_ADD(InstructionsDecoded, size / sizeof(u32));
+    ALLEGREX_STATS_ADD(UnknownOpcodes, unknown);
+    add_jump_stats(out_jumps, first_jump);
+}
+
+void add_jump_stats(const array<jump_destination> *jumps, u64 first)
+{
+#if ALLEGREX_STATS
+    if (jumps == nullptr || !stats_enabled())
+        return;
+
+    u64 branches = 0;
+
+    for (u64 i = first; i < jumps->size; ++i)
+        if (jumps->data[i].type == jump_type::Branch)
+            branches += 1;
+
+    ALLEGREX_STATS_ADD(Jumps, jumps->size - first - branches);
+    ALLEGREX_STATS_ADD(Branches, branches);
+#endif
+}
+
+// jumps are sorted by this key, which orders them the same way compare_ascending_p does:
+// by address, and jumps before branches at the same address.
+#define JUMP_SORT_KEY_BITS 33
+#define JUMP_RADIX_BITS 11
+#define JUMP_RADIX_SIZE (1 << JUMP_RADIX_BITS)
+#define JUMP_INSERTION_SORT_THRESHOLD 32
+
+static inline u64 _jump_sort_key(const jump_destination *jmp)
+{
+    return ((u64)jmp->address << 1) | (jmp->type == jump_type::Jump ? 0 : 1);
+}
+
+static void _insertion_sort_jumps(jump_destination *jumps, u64 count)
+{
+    for (u64 i = 1; i < count; ++i)
+    {
+        jump_destination jmp = jumps[i];
+        u64 key = _jump_sort_key(&jmp);
+        u64 j = i;
+
+        while (j > 0 && _jump_sort_key(jumps + j - 1) > key)
+        {
+            jumps[j] = jumps[j - 1];
+            j -= 1;
+        }
+
+        jumps[j] = jmp;
+    }
+}
+
+// LSD radix sort, stable
+static void _radix_sort_jumps(array<jump_destination> *jumps)
+{
+    array<jump_destination> tmp;
+    ::init(&tmp);
+    ::resize(&tmp, jumps->size);
+    defer { ::free(&tmp); };
+
+    jump_destination *src = jumps->data;
+    jump_destination *dst = tmp.data;
+    u64 counts[JUMP_RADIX_SIZE];
+
+    for (u32 shift = 0; shift < JUMP_SORT_KEY_BITS; shift += JUMP_RADIX_BITS)
+    {
+        fill_memory(counts, 0, sizeof(counts));
+
+        for (u64 i = 0; i < jumps->size; ++i)
+            counts[(_jump_sort_key(src + i) >> shift) & (JUMP_RADIX_SIZE - 1)] += 1;
+
+        // all keys have the same digit, nothing to do
+        if (counts[(_jump_sort_key(src) >> shift) & (JUMP_RADIX_SIZE - 1)] == jumps->size)
+            continue;
+
+        u64 offset = 0;
+
+        for (u32 d = 0; d < JUMP_RADIX_SIZE; ++d)
+        {
+            u64 count = counts[d];
+            counts[d] = offset;
+            offset += count;
+        }
+
+        for (u64 i = 0; i < jumps->size; ++i)
+        {
+            u64 d = (_jump_sort_key(src + i) >> shift) & (JUMP_RADIX_SIZE - 1);
+            dst[counts[d]] = src[i];
+            counts[d] += 1;
+        }
+
+        jump_destination *swp = src;
+        src = dst;
+        dst = swp;
+    }
+
+    if (src != jumps->data)
+        copy_memory(src, jumps->data, jumps->size * sizeof(jump_destination));
+}
+
+void sort_jumps(array<jump_destination> *jumps)
+{
+    assert(jumps != nullptr);
+
+    ALLEGREX_STATS_TIMER(CollectJumps);
+
+    if (jumps->size < 2)
+        return;
+
+    if (jumps->size <= JUMP_INSERTION_SORT_THRESHOLD)
+        _insertion_sort_jumps(jumps->data, jumps->size);
+    else
+        _radix_sort_jumps(jumps);
+
+    // remove duplicates
+    u64 count = 1;
+
+    for (u64 i = 1; i < jumps->size; ++i)
+    {
+        if (_jump_sort_key(jumps->data + i) == _jump_sort_key(jumps->data + count - 1))
+            continue;
+
+        jumps->data[count] = jumps->data[i];
+        count += 1;
+    }
+
+    ::resize(jumps, count);
 }
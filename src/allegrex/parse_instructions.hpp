@@ -60,14 +60,84 @@ constexpr int compare_ascending_p(const jump_destination *l, const u32 *r)
     return compare_ascending_p(&l->address, r);
 }
 
+/* A cache of decoded instructions by opcode.
+Code repeats the same opcodes a lot, e.g. nop, jr ra, or the addiu and lw / sw
+of stack frames, and an instruction is copied from the cache faster than it is
+decoded. Only instructions whose arguments don't depend on their address are
+cached, i.e. no jumps or branches, and the address of a cached instruction is
+set to the address of the opcode.
+
+The cache is direct-mapped with DECODE_CACHE_SIZE entries, it is cleared when
+used with a different emit_pseudo setting than before.
+A cache must not be used by more than one thread at a time.
+
+Usage:
+
+    decode_cache cache;
+    init(&cache);
+
+    parse_instructions(data, size, &instructions, &jumps, &conf, &cache);
+    ...
+
+    free(&cache);
+*/
+#define DECODE_CACHE_BITS 8
+#define DECODE_CACHE_SIZE (1u << DECODE_CACHE_BITS)
+
+struct decode_cache
+{
+    instruction *entries; // DECODE_CACHE_SIZE
+    bool emit_pseudo;     // of the cached instructions
+
+    u64 hits;
+    u64 misses; // including instructions that are never cached
+};
+
+void init(decode_cache *cache);
+void free(decode_cache *cache);
+
 /* Parses a single instruction.
-If the instruction is a jump or a branch, optionally adds the jump to out_jumps if out_jumps
+If the instruction is a jump or a branch, optionally appends the jump to out_jumps if out_jumps
 is not nullptr.
+out_jumps is not kept sorted, call sort_jumps once all instructions are parsed.
 */
-void parse_instruction(u32 opcode, instruction *out, set<jump_destination> *out_jumps, const parse_instructions_config *conf);
+void parse_instruction(u32 opcode, instruction *out, array<jump_destination> *out_jumps, const parse_instructions_config *conf);
 
 /* Parses as many instructions as there are in input.
 size in bytes, not number of instructions.
-Appends all instructions to the end of out_instructions.
+Appends all instructions to the end of out_instructions and all jumps to the end
+of out_jumps, if out_jumps is not nullptr.
+If cache is not nullptr, instructions are looked up in and added to cache,
+which doesn't change the result.
+*/
+void parse_instructions(const char *input, u64 size, array<instruction> *out_instructions, array<jump_destination> *out_jumps, const parse_instructions_config *conf, decode_cache *cache = nullptr);
+
+/* Same as above, but writes the instructions to out_instructions, which must have
+room for size / sizeof(u32) instructions.
+*/
+void parse_instructions(const char *input, u64 size, instruction *out_instructions, array<jump_destination> *out_jumps, const parse_instructions_config *conf, decode_cache *cache = nullptr);
+
+/* Decodes only the mnemonics of the instructions in input, e.g. for opcode
+histograms or to find all calls, which is a lot faster than parse_instructions
+because the arguments of most instructions are not parsed.
+The mnemonics are the same as those of parse_instructions with the same conf,
+including pseudoinstructions, and all jumps are appended to the end of
+out_jumps the same way, if out_jumps is not nullptr.
+Appends all mnemonics to the end of out_mnemonics.
+*/
+void scan_mnemonics(const char *input, u64 size, array<allegrex_mnemonic> *out_mnemonics, array<jump_destination> *out_jumps, const parse_instructions_config *conf);
+
+/* Same as above, but writes the mnemonics to out_mnemonics, which must have
+room for size / sizeof(u32) mnemonics.
+*/
+void scan_mnemonics(const char *input, u64 size, allegrex_mnemonic *out_mnemonics, array<jump_destination> *out_jumps, const parse_instructions_config *conf);
+
+/* Sorts jumps by compare_ascending_p and removes duplicates, so jumps
+can be used like a set<jump_destination>.
+*/
+void sort_jumps(array<jump_destination> *jumps);
+
+/* Adds the jumps and branches of jumps, starting at index first, to the
+Jumps and Branches counters of allegrex/stats.hpp, if stats are enabled.
 */
-void parse_instructions(const char *input, u64 size, array<instruction> *out_instructions, set<jump_destination> *out_jumps, const parse_instructions_config *conf);
+void add_jump_stats(const array<jump_destination> *jumps, u64 first);
@@ -16,10 +16,10 @@ extern "C"
 #pragma warning(disable : 5264) // unused const variable, disabled because some keys aren't used
 #endif
 
+#include "allegrex/internal/perfect_hash.hpp"
+#include "allegrex/internal/prx_keys.hpp"
 #include "allegrex/prx_decrypt.hpp"
 
-#define ROUNDUP16(x)  (((x)+15)&~15)
-
 // Thank you PSARDUMPER & JPCSP keys
 
 // PRXDecrypter 16-byte tag keys.
@@ -287,7 +287,7 @@ struct TAG_INFO
 	u8 codeExtra;
 };
 
-static const TAG_INFO g_tagInfo[] =
+static constexpr TAG_INFO g_tagInfo[] =
 {
 	{ 0x00000000, g_key0, 0x42 },
 	{ 0x02000000, g_key2, 0x45 },
@@ -308,7 +308,7 @@ static const TAG_INFO g_tagInfo[] =
 	{ 0xBB67C59F, g_key_GAMESHARE2xx, 0x5E, 0x5E }
 };
 
-static const TAG_INFO *GetTagInfo(u32 tagFind)
+static constexpr const TAG_INFO *GetTagInfo(u32 tagFind)
 {
 	for (u32 iTag = 0; iTag < sizeof(g_tagInfo)/sizeof(TAG_INFO); iTag++)
 		if (g_tagInfo[iTag].tag == tagFind)
@@ -327,7 +327,7 @@ struct TAG_INFO2
 	const u8 *seed;
 };
 
-static const TAG_INFO2 g_tagInfo2[] =
+static constexpr TAG_INFO2 g_tagInfo2[] =
 {
 	{ 0x4C9494F0, keys660_k1, 0x43 },
 	{ 0x4C9495F0, keys660_k2, 0x43 },
@@ -460,7 +460,7 @@ static const TAG_INFO2 g_tagInfo2[] =
 	{ 0x2FD311F0, pauth_f7aa47f6_2, 0x47, 5, pauth_f7aa47f6_xor },
 };
 
-static const TAG_INFO2 *GetTagInfo2(u32 tagFind)
+static constexpr const TAG_INFO2 *GetTagInfo2(u32 tagFind)
 {
 	for (u32 iTag = 0; iTag < sizeof(g_tagInfo2) / sizeof(TAG_INFO2); iTag++)
 	{
@@ -473,6 +473,114 @@ static const TAG_INFO2 *GetTagInfo2(u32 tagFind)
 	return NULL; // not found
 }
 
+////////// Tag index //////////
+
+/* Maps every tag of g_tagInfo and g_tagInfo2 to its entries and the PRX types
+   that use them, built at compile time (see internal/perfect_hash.hpp).
+   Types 0 and 1 both use g_tagInfo and can't be told apart by the tag, the
+   type of a g_tagInfo2 entry is given by its type field, entries without one
+   may be any of types 2, 5 and 6. The type field is only the type to try
+   first, the other types of the entry's tables are tried if it fails. */
+
+#define PRX_TYPE_FLAG(T) (1 << (int)(T))
+
+struct TAG_INDEX_ENTRY
+{
+	u32 tag;
+	u8 types; // PRX_TYPE_FLAG of the types to try first
+	const TAG_INFO *info;   // types 0 and 1
+	const TAG_INFO2 *info2; // types 2, 5 and 6
+};
+
+static constexpr u8 GetTagInfo2Types(const TAG_INFO2 *pti)
+{
+	switch (pti->type)
+	{
+	case 2: return PRX_TYPE_FLAG(prx_type::Type2);
+	case 5: return PRX_TYPE_FLAG(prx_type::Type5);
+	case 6: return PRX_TYPE_FLAG(prx_type::Type6);
+	default:
+		return PRX_TYPE_FLAG(prx_type::Type2) | PRX_TYPE_FLAG(prx_type::Type5) | PRX_TYPE_FLAG(prx_type::Type6);
+	}
+}
+
+static constexpr u32 CountTags()
+{
+	u32 ret = 0;
+
+	for (const TAG_INFO &info : g_tagInfo)
+		if (GetTagInfo(info.tag) == &info)
+			ret++;
+
+	for (const TAG_INFO2 &info : g_tagInfo2)
+		if (GetTagInfo(info.tag) == NULL && GetTagInfo2(info.tag) == &info)
+			ret++;
+
+	return ret;
+}
+
+static constexpr u32 g_tagCount = CountTags();
+
+struct TAG_INDEX
+{
+	TAG_INDEX_ENTRY entries[g_tagCount];
+	u64 hashes[g_tagCount];
+};
+
+static constexpr TAG_INDEX BuildTagIndex()
+{
+	TAG_INDEX ret{};
+	u32 count = 0;
+
+	auto add = [&](u32 tag)
+	{
+		for (u32 i = 0; i < count; ++i)
+			if (ret.entries[i].tag == tag)
+				return;
+
+		TAG_INDEX_ENTRY &entry = ret.entries[count];
+		entry.tag = tag;
+		entry.info = GetTagInfo(tag);
+		entry.info2 = GetTagInfo2(tag);
+		entry.types = 0;
+
+		if (entry.info)
+			entry.types |= PRX_TYPE_FLAG(prx_type::Type0) | PRX_TYPE_FLAG(prx_type::Type1);
+
+		if (entry.info2)
+			entry.types |= GetTagInfo2Types(entry.info2);
+
+		ret.hashes[count] = _perfect_hash_mix(tag);
+		count++;
+	};
+
+	for (const TAG_INFO &info : g_tagInfo)
+		add(info.tag);
+
+	for (const TAG_INFO2 &info : g_tagInfo2)
+		add(info.tag);
+
+	return ret;
+}
+
+static constexpr TAG_INDEX g_tagIndex = BuildTagIndex();
+static constexpr auto g_tagIndexTable = _build_perfect_hash<g_tagCount,
+                                                            _perfect_hash_size(g_tagCount / 4),
+                                                            _perfect_hash_size(g_tagCount * 2)>(g_tagIndex.hashes);
+static_assert(g_tagIndexTable.ok, "could not build the PRX tag index");
+
+static const TAG_INDEX_ENTRY *GetTagIndexEntry(u32 tagFind)
+{
+	u32 i = _perfect_hash_lookup(&g_tagIndexTable, _perfect_hash_mix(tagFind));
+
+	if (i == PERFECT_HASH_NOT_FOUND || g_tagIndex.entries[i].tag != tagFind)
+	{
+		return NULL; // not found
+	}
+
+	return &g_tagIndex.entries[i];
+}
+
 static std::array<u8, 0x90> expandSeed(const u8 *seed, int key, const u8 *bonusSeed = nullptr)
 {
 	std::array<u8, 0x90> expandedSeed;
@@ -702,17 +810,10 @@ struct PRXType6
 };
 static_assert(sizeof(PRXType6) == 0x150, "inconsistent size of PRX Type 6");
 
-static int pspDecryptType0(const u8 *inbuf, u8 *outbuf, u32 size)
+static int pspDecryptType0(const u8 *inbuf, u8 *outbuf, u32 size, const TAG_INFO *pti)
 {
 	// INFO_LOG(LOADER, "Decrypting tag %02X", (u32)*(u32_le *)&inbuf[0xD0]);
 	const auto decryptSize = *(s32_le*)&inbuf[0xB0];
-	const auto pti = GetTagInfo((u32)*(u32_le *)&inbuf[0xD0]);
-
-	if (!pti)
-	{
-		return -1;
-	}
-
 	// no need to expand seed, and no need to decrypt
 	// normally this would be a kirk7 op, but we have the seed pre-decrypted
 	std::array<u8, 0x90> xorbuf;
@@ -756,17 +857,10 @@ static int pspDecryptType0(const u8 *inbuf, u8 *outbuf, u32 size)
 	return decryptSize;
 }
 
-static int pspDecryptType1(const u8 *inbuf, u8 *outbuf, u32 size)
+static int pspDecryptType1(const u8 *inbuf, u8 *outbuf, u32 size, const TAG_INFO *pti)
 {
 	// INFO_LOG(LOADER, "Decrypting tag %02X", (u32)*(u32_le *)&inbuf[0xD0]);
 	const auto decryptSize = *(s32_le*)&inbuf[0xB0];
-	const auto pti = GetTagInfo((u32)*(u32_le *)&inbuf[0xD0]);
-
-	if (!pti)
-	{
-		return -1;
-	}
-
 	// no need to expand seed, and no need to decrypt
 	// normally this would be a kirk7 op, but we have the seed pre-decrypted
 	std::array<u8, 0x90> xorbuf;
@@ -811,17 +905,10 @@ static int pspDecryptType1(const u8 *inbuf, u8 *outbuf, u32 size)
 	return decryptSize;
 }
 
-static int pspDecryptType2(const u8 *inbuf, u8 *outbuf, u32 size)
+static int pspDecryptType2(const u8 *inbuf, u8 *outbuf, u32 size, const TAG_INFO2 *pti)
 {
 	// INFO_LOG(LOADER, "Decrypting tag %02X", (u32)*(u32_le *)&inbuf[0xD0]);
 	const auto decryptSize = *(s32_le*)&inbuf[0xB0];
-	const auto pti = GetTagInfo2((u32)*(u32_le *)&inbuf[0xD0]);
-
-	if (!pti)
-	{
-		return -1;
-	}
-
 	// check if range is non-zero
 	if (std::any_of(inbuf+0xD4, inbuf+0xD4+0x58, [](u8 x) { return x != 0; }))
 	{
@@ -875,17 +962,10 @@ static int pspDecryptType2(const u8 *inbuf, u8 *outbuf, u32 size)
 	return decryptSize;
 }
 
-static int pspDecryptType5(const u8 *inbuf, u8 *outbuf, u32 size, const u8 *seed)
+static int pspDecryptType5(const u8 *inbuf, u8 *outbuf, u32 size, const TAG_INFO2 *pti, const u8 *seed)
 	{
 	// INFO_LOG(LOADER, "Decrypting tag %02X", (u32)*(u32_le *)&inbuf[0xD0]);
 	const auto decryptSize = *(s32_le*)&inbuf[0xB0];
-	const auto pti = GetTagInfo2((u32)*(u32_le *)&inbuf[0xD0]);
-
-	if (!pti)
-	{
-		return -1;
-	}
-
 	// check if range is non-zero
 	if (std::any_of(inbuf+0xD4+1, inbuf+0xD4+0x58, [](u8 x) { return x != 0; }))
 	{
@@ -939,17 +1019,10 @@ static int pspDecryptType5(const u8 *inbuf, u8 *outbuf, u32 size, const u8 *seed
 	return decryptSize;
 	}
 
-static int pspDecryptType6(const u8 *inbuf, u8 *outbuf, u32 size)
+static int pspDecryptType6(const u8 *inbuf, u8 *outbuf, u32 size, const TAG_INFO2 *pti)
 {
 	// INFO_LOG(LOADER, "Decrypting tag %02X", (u32)*(u32_le *)&inbuf[0xD0]);
 	const auto decryptSize = *(s32_le*)&inbuf[0xB0];
-	const auto pti = GetTagInfo2((u32)*(u32_le *)&inbuf[0xD0]);
-
-	if (!pti)
-	{
-		return -1;
-	}
-
 	// check if range is non-zero
 	if (std::any_of(inbuf+0xD4, inbuf+0xD4+0x38, [](u8 x) { return x != 0; }))
 	{
@@ -1006,34 +1079,140 @@ static int pspDecryptType6(const u8 *inbuf, u8 *outbuf, u32 size)
 	return decryptSize;
 }
 
+// tries each type of types in ascending order until one decrypts inbuf
+static int pspDecryptTypes(const u8 *inbuf, u8 *outbuf, u32 size, const u8 *seed, const TAG_INDEX_ENTRY *entry, u8 types, prx_decrypt_info *info)
+{
+	int res = -1;
+
+	for (int t = 0; t < (int)prx_type::Unknown; ++t)
+	{
+		if (!(types & PRX_TYPE_FLAG(t)))
+		{
+			continue;
+		}
+
+		info->attempts++;
+
+		switch ((prx_type)t)
+		{
+		case prx_type::Type0: res = pspDecryptType0(inbuf, outbuf, size, entry->info); break;
+		case prx_type::Type1: res = pspDecryptType1(inbuf, outbuf, size, entry->info); break;
+		case prx_type::Type2: res = pspDecryptType2(inbuf, outbuf, size, entry->info2); break;
+		case prx_type::Type5: res = pspDecryptType5(inbuf, outbuf, size, entry->info2, seed); break;
+		case prx_type::Type6: res = pspDecryptType6(inbuf, outbuf, size, entry->info2); break;
+		default: break;
+		}
+
+		if (res >= 0)
+		{
+			info->type = (prx_type)t;
+			return res;
+		}
+	}
+
+	return res;
+}
+
 int pspDecryptPRX(const u8 *inbuf, u8 *outbuf, u32 size, const u8 *seed)
 {
+	prx_decrypt_info info;
+	return pspDecryptPRX(inbuf, outbuf, size, seed, &info);
+}
+
+int pspDecryptPRX(const u8 *inbuf, u8 *outbuf, u32 size, const u8 *seed, prx_decrypt_info *info)
+{
+	info->type = prx_type::Unknown;
+	info->attempts = 0;
+
+	if (size < sizeof(PSP_Header))
+	{
+		return -1;
+	}
+
+	const auto entry = GetTagIndexEntry((u32)*(u32_le *)&inbuf[0xD0]);
+
+	if (!entry)
+	{
+		return -1;
+	}
+
+	u8 types = entry->types;
+
+	// a seed given by the caller may turn any key of the second table into type 5
+	if (seed && entry->info2)
+	{
+		types |= PRX_TYPE_FLAG(prx_type::Type5);
+	}
+
+	// the kirk state is per thread, so this may run on multiple threads at once
 	kirk_init();
 
-	// this would be significantly better if we had a log of the tags
-	// and their appropriate prx types
-	// since we don't know the PRX type we attempt a decrypt using all
-	int res = pspDecryptType0(inbuf, outbuf, size);
+	int res = pspDecryptTypes(inbuf, outbuf, size, seed, entry, types, info);
 
 	if (res >= 0)
+	{
 		return res;
-	
-	res = pspDecryptType1(inbuf, outbuf, size);
+	}
 
-	if (res >= 0)
-		return res;
-	
-	res = pspDecryptType2(inbuf, outbuf, size);
+	// the type field of g_tagInfo2 may be wrong for some modules, so all other
+	// types of the entry's tables are tried before giving up, as all types were
+	// tried before there was an index
+	u8 fallback = 0;
 
-	if (res >= 0)
-		return res;
-	
-	res = pspDecryptType5(inbuf, outbuf, size, seed);
+	if (entry->info)
+	{
+		fallback |= PRX_TYPE_FLAG(prx_type::Type0) | PRX_TYPE_FLAG(prx_type::Type1);
+	}
 
-	if (res >= 0)
-		return res;
-	
-	return pspDecryptType6(inbuf, outbuf, size);
+	if (entry->info2)
+	{
+		fallback |= PRX_TYPE_FLAG(prx_type::Type2) | PRX_TYPE_FLAG(prx_type::Type5) | PRX_TYPE_FLAG(prx_type::Type6);
+	}
+
+	fallback &= ~types;
+
+	if (fallback != 0)
+	{
+		// if every type fails, the error of the indexed type says the most
+		int fallback_res = pspDecryptTypes(inbuf, outbuf, size, seed, entry, fallback, info);
+
+		if (fallback_res >= 0)
+		{
+			return fallback_res;
+		}
+	}
+
+	return res;
+}
+
+////////// Tag keys //////////
+
+bool get_prx_tag_keys(u32 tag, prx_tag_keys *out)
+{
+	const auto entry = GetTagIndexEntry(tag);
+
+	if (!entry)
+	{
+		return false;
+	}
+
+	*out = {};
+	out->types = entry->types;
+
+	if (entry->info)
+	{
+		out->key = reinterpret_cast<const u8 *>(entry->info->key);
+		out->code = entry->info->code;
+	}
+
+	if (entry->info2)
+	{
+		out->key2 = entry->info2->key;
+		out->code2 = entry->info2->code;
+		out->seed2 = entry->info2->seed;
+	}
+
+	return true;
 }
 
 #if MSVC
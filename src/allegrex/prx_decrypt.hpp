@@ -47,5 +47,25 @@ typedef struct
 #pragma pack(pop)
 #endif
 
-int pspDecryptPRX(const u8 *inbuf, u8 *outbuf, u32 size, const u8 *seed = nullptr);
+// the PRX header layouts, named after their pspDecryptType* decryptor
+enum class prx_type : u8
+{
+	Type0,
+	Type1,
+	Type2,
+	Type5,
+	Type6,
+	Unknown
+};
 
+struct prx_decrypt_info
+{
+	prx_type type; // the type that decrypted the PRX, Unknown if none did
+	u32 attempts;  // number of decryptors that were tried
+};
+
+/* The decryptor is picked by the tag at 0xD0 of the header: each known tag
+   maps to its key and the PRX types that use it, so usually only one
+   decryptor runs. Returns the decrypted size or a negative value on error. */
+int pspDecryptPRX(const u8 *inbuf, u8 *outbuf, u32 size, const u8 *seed = nullptr);
+int pspDecryptPRX(const u8 *inbuf, u8 *outbuf, u32 size, const u8 *seed, prx_decrypt_info *info);
@@ -12,13 +12,26 @@
 #include "shl/platform.hpp"
 
 #include "allegrex/psp_modules.hpp"
+#include "allegrex/internal/perfect_hash.hpp"
 #include "allegrex/internal/psp_module_function_argument_defs.hpp"
 #include "allegrex/internal/psp_module_function_pspdev_headers.hpp"
 #include "allegrex/psp_prx.hpp"
 #include "allegrex/prx_decrypt.hpp"
+#include "allegrex/inflate.hpp"
+#include "allegrex/stats.hpp"
 #include "allegrex/psp_elf.hpp"
 #include "allegrex/elf.hpp"
 
+#if Windows
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 constexpr fixed_array syslib_functions
 {
     psp_function{ 0xd632acdb, "module_start",
@@ -55,8 +68,20 @@ static const psp_variable *_get_syslib_variable(u32 nid)
     return nullptr;
 }
 
+static void _log(const psp_parse_elf_config *conf, const_string str)
+{
+    if (conf->log_buffer != nullptr)
+    {
+        u64 offset = conf->log_buffer->size;
+        ::resize(conf->log_buffer, offset + str.size);
+        copy_memory(str.c_str, conf->log_buffer->data + offset, str.size);
+    }
+    else if (conf->log != nullptr)
+        put(conf->log->handle, str);
+}
+
 #define log(CONF, ...) \
-    { if (CONF != nullptr && CONF->verbose && CONF->log != nullptr) { tprint(CONF->log->handle, __VA_ARGS__); }};
+    { if (CONF != nullptr && CONF->verbose && (CONF->log != nullptr || CONF->log_buffer != nullptr)) { _log(CONF, tformat(__VA_ARGS__)); }};
 
 template<typename T>
 static void read_section(memory_stream *in, const Elf32_Ehdr *ehdr, int index, T *out)
@@ -64,12 +89,41 @@ static void read_section(memory_stream *in, const Elf32_Ehdr *ehdr, int index, T
     read_at(in, out, ehdr->e_shoff + (index) * ehdr->e_shentsize);
 }
 
+/* The section header table, read once per module.
+   The symbols of all symbol tables are grouped by the section they belong to:
+   the symbols of section i are symbols[symbol_offsets[i]] up to
+   symbols[symbol_offsets[i + 1]], in symbol table order. */
+struct elf_section_index
+{
+    array<Elf32_Shdr> headers;
+    hash_table<u64, u32> names; // hash of section name -> first section with that name
+    array<elf_symbol> symbols;
+    array<u32> symbol_offsets; // headers.size + 1 entries
+};
+
+static void init(elf_section_index *index)
+{
+    ::init(&index->headers);
+    ::init(&index->names);
+    ::init(&index->symbols);
+    ::init(&index->symbol_offsets);
+}
+
+static void free(elf_section_index *index)
+{
+    ::free(&index->headers);
+    ::free(&index->names);
+    ::free(&index->symbols);
+    ::free(&index->symbol_offsets);
+}
+
 struct elf_read_ctx
 {
     memory_stream *in;
     const psp_parse_elf_config *conf;
     const Elf32_Ehdr *elf_header;
     const char *string_table_data;
+    elf_section_index sections;
     u32 min_vaddr;
     u32 max_vaddr;
     u32 min_offset;
@@ -78,49 +132,118 @@ struct elf_read_ctx
 
 #define file_offset_from_vaddr(ctx, vaddr) ((vaddr - ctx->min_vaddr) + ctx->min_offset)
 
-static void _add_section_to_symbols(elf_read_ctx *ctx, int section_index, hash_table<u32, elf_symbol> *symbols)
+struct indexed_symbol
+{
+    u16 section_index;
+    elf_symbol symbol;
+};
+
+static void _index_symbols(elf_read_ctx *ctx)
 {
+    elf_section_index *index = &ctx->sections;
+    u32 section_count = (u32)index->headers.size;
+
+    array<indexed_symbol> all_symbols;
+    ::init(&all_symbols);
+    defer { ::free(&all_symbols); };
+
+    ::resize(&index->symbol_offsets, section_count + 1);
+    fill_memory(index->symbol_offsets.data, 0, index->symbol_offsets.size * sizeof(u32));
+
     // there's a good chance symbols don't exist, but we add them anyway
-    for (int i = 0; i < ctx->elf_header->e_shnum; i++)
+    for_array(sec_header, &index->headers)
     {
-        Elf32_Shdr sec_header;
-        read_section(ctx->in, ctx->elf_header, i, &sec_header);
-        const char *section_name = ctx->string_table_data + sec_header.sh_name;
-
-        if (sec_header.sh_type != SHT_SYMTAB)
+        if (sec_header->sh_type != SHT_SYMTAB)
             continue;
 
-        assert(sec_header.sh_entsize == sizeof(Elf32_Sym));
+        assert(sec_header->sh_entsize == sizeof(Elf32_Sym));
 
-        if (sec_header.sh_size == 0)
+        if (sec_header->sh_size == 0)
             // log empty tables maybe?
             continue;
 
-        log(ctx->conf, "found symtab %s\n", section_name);
+        log(ctx->conf, "found symtab %s\n", ctx->string_table_data + sec_header->sh_name);
 
-        Elf32_Shdr strtab_header;
-        read_section(ctx->in, ctx->elf_header, sec_header.sh_link, &strtab_header);
+        if (sec_header->sh_link >= section_count)
+            continue;
 
-        const char *sec_string_table = ctx->in->data + strtab_header.sh_offset;
+        const char *sec_string_table = ctx->in->data + index->headers[sec_header->sh_link].sh_offset;
 
-        for (u32 j = 0; j < sec_header.sh_size; j += sizeof(Elf32_Sym))
+        for (u32 j = 0; j < sec_header->sh_size; j += sizeof(Elf32_Sym))
         {
             Elf32_Sym sym;
-            read_at(ctx->in, &sym, sec_header.sh_offset + j);
+            read_at(ctx->in, &sym, sec_header->sh_offset + j);
 
             const char *name = sec_string_table + sym.st_name;
 
-            if (strlen(name) == 0)
+            if (name[0] == '\0')
                 continue;
 
-            if (sym.st_shndx != section_index) //|| name[0] == '.')
+            // also skips SHN_ABS, SHN_COMMON, etc.
+            if (sym.st_shndx >= section_count)
                 continue;
 
-            log(ctx->conf, "  symbol at %08x: '%s'\n", sym.st_value, name);
-
-            (*symbols)[sym.st_value] = elf_symbol{sym.st_value, name};
+            ::add_at_end(&all_symbols, indexed_symbol{sym.st_shndx, elf_symbol{sym.st_value, name}});
+            index->symbol_offsets[sym.st_shndx + 1] += 1;
         }
     }
+
+    for (u32 i = 1; i <= section_count; ++i)
+        index->symbol_offsets[i] += index->symbol_offsets[i - 1];
+
+    // stable counting sort by section
+    ::resize(&index->symbols, all_symbols.size);
+
+    array<u32> next;
+    ::init(&next);
+    defer { ::free(&next); };
+
+    ::resize(&next, section_count);
+    copy_memory(index->symbol_offsets.data, next.data, section_count * sizeof(u32));
+
+    for_array(isym, &all_symbols)
+    {
+        index->symbols[next[isym->section_index]] = isym->symbol;
+        next[isym->section_index] += 1;
+    }
+}
+
+// reads the section header table and all symbol tables
+static void _index_sections(elf_read_ctx *ctx)
+{
+    elf_section_index *index = &ctx->sections;
+    int section_count = ctx->elf_header->e_shnum;
+
+    ::resize(&index->headers, section_count);
+
+    for (int i = 0; i < section_count; ++i)
+        read_section(ctx->in, ctx->elf_header, i, index->headers.data + i);
+
+    ctx->string_table_data = ctx->in->data + index->headers[ctx->elf_header->e_shstrndx].sh_offset;
+
+    for (int i = 0; i < section_count; ++i)
+    {
+        u64 hash = _perfect_hash_string(ctx->string_table_data + index->headers[i].sh_name);
+
+        if (::search(&index->names, &hash) == nullptr)
+            index->names[hash] = (u32)i;
+    }
+
+    _index_symbols(ctx);
+}
+
+static void _add_section_to_symbols(elf_read_ctx *ctx, int section_index, hash_table<u32, elf_symbol> *symbols)
+{
+    elf_section_index *index = &ctx->sections;
+
+    for (u32 i = index->symbol_offsets[section_index]; i < index->symbol_offsets[section_index + 1]; ++i)
+    {
+        const elf_symbol *sym = index->symbols.data + i;
+
+        log(ctx->conf, "  symbol at %08x: '%s'\n", sym->address, sym->name);
+
+        (*symbols)[sym->address] = *sym;
+    }
 }
 
 // TODO: actually add relocation information
@@ -128,30 +251,27 @@ static void _add_section_to_symbols(elf_read_ctx *ctx, int section_index, hash_t
 // do games have relocations...?
 static void _add_relocations(elf_read_ctx *ctx, array<elf_relocation> *out)
 {
-    for (int i = 0; i < ctx->elf_header->e_shnum; ++i)
+    for_array(sec_header, &ctx->sections.headers)
     {
-        Elf32_Shdr sec_header;
-        read_section(ctx->in, ctx->elf_header, i, &sec_header);
-
-        if (sec_header.sh_type != SHT_REL
-        // || sec_header.sh_info != (u32)section_index
+        if (sec_header->sh_type != SHT_REL
+        // || sec_header->sh_info != (u32)section_index
          )
             continue;
 
-        const char *section_name = ctx->string_table_data + sec_header.sh_name;
+        const char *section_name = ctx->string_table_data + sec_header->sh_name;
 
-        assert(sec_header.sh_entsize == sizeof(Elf32_Rel));
+        assert(sec_header->sh_entsize == sizeof(Elf32_Rel));
 
-        if (sec_header.sh_size == 0)
+        if (sec_header->sh_size == 0)
             // log empty tables maybe?
             continue;
 
         log(ctx->conf, "got relocation table %s\n", section_name);
 
-        for (u32 j = 0; j < sec_header.sh_size; j += sizeof(Elf32_Rel))
+        for (u32 j = 0; j < sec_header->sh_size; j += sizeof(Elf32_Rel))
         {
             Elf32_Rel rel;
-            read_at(ctx->in, &rel, sec_header.sh_offset + j);
+            read_at(ctx->in, &rel, sec_header->sh_offset + j);
             u32 index = ELF32_R_SYM(rel.r_info);
             u32 type = ELF32_R_TYPE(rel.r_info);
 
@@ -165,14 +285,24 @@ static bool _get_section_header_by_name(elf_read_ctx *ctx, const char *name, Elf
     if (out == nullptr)
         return false;
 
-    for (int i = 0; i < ctx->elf_header->e_shnum; i++)
-    {
-        read_section(ctx->in, ctx->elf_header, i, out);
+    elf_section_index *index = &ctx->sections;
+    u64 hash = _perfect_hash_string(name);
+    u32 *i = ::search(&index->names, &hash);
 
-        const char *section_name = ctx->string_table_data + out->sh_name;
+    if (i != nullptr && strcmp(ctx->string_table_data + index->headers[*i].sh_name, name) == 0)
+    {
+        *out = index->headers[*i];
+        return true;
+    }
 
-        if (strcmp(section_name, name) == 0)
+    // hash collision
+    for_array(sec_header, &index->headers)
+    {
+        if (strcmp(ctx->string_table_data + sec_header->sh_name, name) == 0)
+        {
+            *out = *sec_header;
             return true;
+        }
     }
 
     return false;
@@ -189,6 +319,9 @@ static void _read_prx_sce_module_info_section_header(elf_read_ctx *ctx, prx_sce_
     if (!_get_section_header_by_name(ctx, ELF_SECTION_PRX_MODULE_INFO, &sceModuleInfo_section_header))
     {
         log(ctx->conf, "could not find section '%s'\n", ELF_SECTION_PRX_MODULE_INFO);
+
+        // no exports or imports
+        fill_memory(out, 0);
         return;
     }
 
@@ -213,6 +346,9 @@ static void _add_prx_exports(elf_read_ctx *ctx, const prx_sce_module_info *mod_i
     u32 count = sz / sizeof(prx_module_export);
     ::reserve(&out->exported_modules, count);
 
+    u32 lookups = 0;
+    u32 misses = 0;
+
     for (u32 i = 0; i < sz; i += sizeof(prx_module_export))
     {
         prx_module_export exp;
@@ -245,9 +381,11 @@ static void _add_prx_exports(elf_read_ctx *ctx, const prx_sce_module_info *mod_i
             read_at(ctx->in, &f_vaddr, file_offset_from_vaddr(ctx, f_vaddr_vaddr));
 
             const psp_function *pf = _get_syslib_function(nid);
+            lookups += 1;
 
             if (pf == nullptr)
             {
+                misses += 1;
                 // TODO: maybe dont ignore these
                 log(ctx->conf, "  export unknown function nid %08x at %08x\n", nid, f_vaddr);
                 continue;
@@ -271,9 +409,11 @@ static void _add_prx_exports(elf_read_ctx *ctx, const prx_sce_module_info *mod_i
             read_at(ctx->in, &v_vaddr, file_offset_from_vaddr(ctx, v_vaddr_vaddr));
 
             const psp_variable *pv = _get_syslib_variable(nid);
+            lookups += 1;
 
             if (pv == nullptr)
             {
+                misses += 1;
                 // TODO: maybe dont ignore these
                 log(ctx->conf, "  export unknown variable nid %08x at %08x\n", nid, v_vaddr);
                 continue;
@@ -285,6 +425,9 @@ static void _add_prx_exports(elf_read_ctx *ctx, const prx_sce_module_info *mod_i
         }
     }
 
+    ALLEGREX_STATS_ADD(NidLookups, lookups);
+    ALLEGREX_STATS_ADD(NidMisses, misses);
+
     log(ctx->conf, "\n");
 }
 
@@ -297,6 +440,9 @@ static void _add_prx_imports(elf_read_ctx *ctx, const prx_sce_module_info *mod_i
     u32 count = sz / sizeof(prx_module_import);
     ::reserve(&out->imported_modules, count);
 
+    u32 lookups = 0;
+    u32 misses = 0;
+
     for (u32 i = 0; i < sz; i += sizeof(prx_module_import))
     {
         prx_module_import imp;
@@ -313,6 +459,8 @@ static void _add_prx_imports(elf_read_ctx *ctx, const prx_sce_module_info *mod_i
         ::init(&mi->functions);
         mi->module_name = module_name;
 
+        const psp_module *pmod = get_psp_module_by_name(module_name);
+
         for (u32 _j = 0; _j < imp.function_count; ++_j)
         {
             u32 j = _j * sizeof(u32);
@@ -321,10 +469,12 @@ static void _add_prx_imports(elf_read_ctx *ctx, const prx_sce_module_info *mod_i
 
             read_at(ctx->in, &nid, file_offset_from_vaddr(ctx, imp.nids_vaddr) + j);
 
-            const psp_function *pf = get_psp_function_by_nid(module_name, nid);
+            const psp_function *pf = get_psp_module_function_by_nid(pmod, nid);
+            lookups += 1;
 
             if (pf == nullptr)
             {
+                misses += 1;
                 // TODO: maybe dont ignore these
                 log(ctx->conf, "  import unknown function nid %08x at %08x\n", nid, f_vaddr);
                 continue;
@@ -341,10 +491,15 @@ static void _add_prx_imports(elf_read_ctx *ctx, const prx_sce_module_info *mod_i
 
         log(ctx->conf, "\n");
     }
+
+    ALLEGREX_STATS_ADD(NidLookups, lookups);
+    ALLEGREX_STATS_ADD(NidMisses, misses);
 }
 
 static void _add_prx_imports_and_exports(elf_read_ctx *ctx, elf_psp_module *out)
 {
+    ALLEGREX_STATS_TIMER(ImportsExports);
+
     prx_sce_module_info *mod_info = &out->module_info;
     _read_prx_sce_module_info_section_header(ctx, mod_info);
 
@@ -352,55 +507,43 @@ static void _add_prx_imports_and_exports(elf_read_ctx *ctx, elf_psp_module *out)
     _add_prx_imports(ctx, mod_info, out);
 }
 
-static void _get_elf_min_max_offsets_and_vaddrs(memory_stream *in, const Elf32_Ehdr *elf_header, elf_read_ctx *out)
+static void _get_elf_min_max_offsets_and_vaddrs(elf_read_ctx *ctx)
 {
-    out->min_vaddr = 0xFFFFFFFF;
-    out->max_vaddr = 0;
-    out->min_offset = 0xFFFFFFFF;
-    out->max_offset = 0;
-
-    Elf32_Shdr section_header;
+    ctx->min_vaddr = 0xFFFFFFFF;
+    ctx->max_vaddr = 0;
+    ctx->min_offset = 0xFFFFFFFF;
+    ctx->max_offset = 0;
 
     // find elf section offsets (need the values for address calculations)
-    for (int i = 0; i < elf_header->e_shnum; ++i)
+    for_array(section_header, &ctx->sections.headers)
     {
-        read_section(in, elf_header, i, &section_header);
-
-        if ((section_header.sh_type & SHT_NOBITS) == SHT_NOBITS)
+        if ((section_header->sh_type & SHT_NOBITS) == SHT_NOBITS)
             continue;
 
-        if (section_header.sh_addr == 0 || section_header.sh_offset == 0)
+        if (section_header->sh_addr == 0 || section_header->sh_offset == 0)
             continue;
 
-        if (section_header.sh_addr < out->min_vaddr)
-            out->min_vaddr = section_header.sh_addr;
+        if (section_header->sh_addr < ctx->min_vaddr)
+            ctx->min_vaddr = section_header->sh_addr;
 
-        if (section_header.sh_addr + section_header.sh_size > out->max_offset)
-            out->max_vaddr = section_header.sh_addr + section_header.sh_size;
+        if (section_header->sh_addr + section_header->sh_size > ctx->max_offset)
+            ctx->max_vaddr = section_header->sh_addr + section_header->sh_size;
 
-        if (section_header.sh_offset < out->min_offset)
-            out->min_offset = section_header.sh_offset;
+        if (section_header->sh_offset < ctx->min_offset)
+            ctx->min_offset = section_header->sh_offset;
 
-        if (section_header.sh_offset + section_header.sh_size > out->max_offset)
-            out->max_offset = section_header.sh_offset + section_header.sh_size;
+        if (section_header->sh_offset + section_header->sh_size > ctx->max_offset)
+            ctx->max_offset = section_header->sh_offset + section_header->sh_size;
     }
 }
 
-// returns the pointer to the start of the string table in the memory stream
-static const char *_get_string_table(memory_stream *in, const Elf32_Ehdr *elf_header)
-{
-    Elf32_Shdr string_table_header;
-    read_section(in, elf_header, elf_header->e_shstrndx, &string_table_header);
-
-    return in->data + string_table_header.sh_offset;
-}
-
 void init(elf_psp_module *mod)
 {
     assert(mod != nullptr);
 
     mod->elf_data = nullptr;
     mod->elf_size = 0;
+    mod->data_source = elf_data_source::None;
 
     ::init(&mod->relocations);
     ::init(&mod->sections);
@@ -412,12 +555,122 @@ void init(elf_psp_module *mod)
     ::init(&mod->exported_modules);
 }
 
+static bool _map_file(const char *path, memory_stream *out, error *err)
+{
+    // pages are only read once they're accessed, this is mostly the cost of the mapping
+    ALLEGREX_STATS_TIMER(ReadFile);
+
+#if Windows
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        set_GetLastError_error(err);
+        return false;
+    }
+
+    defer { CloseHandle(file); };
+
+    LARGE_INTEGER size;
+
+    if (!GetFileSizeEx(file, &size))
+    {
+        set_GetLastError_error(err);
+        return false;
+    }
+
+    out->data = nullptr;
+    out->size = (s64)size.QuadPart;
+    out->position = 0;
+
+    if (out->size == 0)
+        return true;
+
+    // the view keeps the mapping alive after the handles are closed
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if (mapping == nullptr)
+    {
+        set_GetLastError_error(err);
+        return false;
+    }
+
+    defer { CloseHandle(mapping); };
+
+    out->data = (char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+    if (out->data == nullptr)
+    {
+        set_GetLastError_error(err);
+        return false;
+    }
+#else
+    int fd = open(path, O_RDONLY);
+
+    if (fd == -1)
+    {
+        set_errno_error(err);
+        return false;
+    }
+
+    defer { close(fd); };
+
+    struct stat st;
+
+    if (fstat(fd, &st) == -1)
+    {
+        set_errno_error(err);
+        return false;
+    }
+
+    out->data = nullptr;
+    out->size = (s64)st.st_size;
+    out->position = 0;
+
+    if (out->size == 0)
+        return true;
+
+    void *data = mmap(nullptr, (size_t)out->size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (data == MAP_FAILED)
+    {
+        set_errno_error(err);
+        return false;
+    }
+
+    out->data = (char*)data;
+#endif
+
+    return true;
+}
+
+static void _unmap_file(char *data, u64 size)
+{
+    if (data == nullptr)
+        return;
+
+#if Windows
+    UnmapViewOfFile(data);
+#else
+    munmap(data, (size_t)size);
+#endif
+}
+
 void free(elf_psp_module *mod)
 {
     assert(mod != nullptr);
 
     if (mod->elf_data != nullptr)
-        dealloc(mod->elf_data, mod->elf_size);
+    {
+        if (mod->data_source == elf_data_source::Mapped)
+            _unmap_file(mod->elf_data, mod->elf_size);
+        else
+            dealloc(mod->elf_data, mod->elf_size);
+    }
+
+    mod->elf_data = nullptr;
+    mod->elf_size = 0;
+    mod->data_source = elf_data_source::None;
 
     ::free(&mod->relocations);
     ::free(&mod->sections);
@@ -441,6 +694,8 @@ void free(elf_psp_module *mod)
 
 static bool _read_elf(elf_psp_module *out, const psp_parse_elf_config *conf, error *err)
 {
+    ALLEGREX_STATS_TIMER(ReadElf);
+
     memory_stream in{};
     in.data = out->elf_data;
     in.size = out->elf_size;
@@ -481,9 +736,14 @@ static bool _read_elf(elf_psp_module *out, const psp_parse_elf_config *conf, err
         return false;
     }
 
-    const char *string_table_ptr = _get_string_table(&in, &elf_header);
+    elf_read_ctx ctx;
+    ctx.in = &in;
+    ctx.conf = conf;
+    ctx.elf_header = &elf_header;
+    init(&ctx.sections);
+    defer { free(&ctx.sections); };
 
-    Elf32_Shdr section_header;
+    _index_sections(&ctx);
 
     array<int> section_indices;
     init(&section_indices);
@@ -491,23 +751,20 @@ static bool _read_elf(elf_psp_module *out, const psp_parse_elf_config *conf, err
 
     log(conf, "              %-20s: offset   - size\n", "name");
 
-    int section_header_count = elf_header.e_shnum;
-
-    for (int i = 0; i < section_header_count; ++i)
+    for_array(i, section_header, &ctx.sections.headers)
     {
-        read_section(&in, &elf_header, i, &section_header);
-        const char *section_name = string_table_ptr + section_header.sh_name;
+        const char *section_name = ctx.string_table_data + section_header->sh_name;
 
         if (::string_is_blank(conf->section))
         {
-            if ((section_header.sh_flags & SHF_EXECINSTR) == 0) // ignore non-executable sections
+            if ((section_header->sh_flags & SHF_EXECINSTR) == 0) // ignore non-executable sections
                 continue;
         }
         else if (::string_compare(conf->section, section_name) != 0)
             continue;
 
-        log(conf, "found executable section %-20s: %08x - %08x\n", section_name, section_header.sh_offset, section_header.sh_size);
-        ::add_at_end(&section_indices, i);
+        log(conf, "found executable section %-20s: %08x - %08x\n", section_name, section_header->sh_offset, section_header->sh_size);
+        ::add_at_end(&section_indices, (int)i);
     }
 
     if (section_indices.size == 0)
@@ -524,12 +781,7 @@ static bool _read_elf(elf_psp_module *out, const psp_parse_elf_config *conf, err
         }
     }
 
-    elf_read_ctx ctx;
-    ctx.in = &in;
-    ctx.conf = conf;
-    ctx.elf_header = &elf_header;
-    ctx.string_table_data = string_table_ptr;
-    _get_elf_min_max_offsets_and_vaddrs(&in, &elf_header, &ctx);
+    _get_elf_min_max_offsets_and_vaddrs(&ctx);
     
     log(conf, "min section vaddr:  %08x, max section vaddr:  %08x\n", ctx.min_vaddr,  ctx.max_vaddr);
     log(conf, "min section offset: %08x, max section offset: %08x\n", ctx.min_offset, ctx.max_offset);
@@ -539,8 +791,8 @@ static bool _read_elf(elf_psp_module *out, const psp_parse_elf_config *conf, err
     for_array(_i, &section_indices)
     {
         int i = *_i;
-        read_section(&in, &elf_header, i, &section_header);
-        const char *section_name = string_table_ptr + section_header.sh_name;
+        const Elf32_Shdr *section_header = ctx.sections.headers.data + i;
+        const char *section_name = ctx.string_table_data + section_header->sh_name;
 
         elf_section *esec = ::add_at_end(&out->sections);
         esec->name = section_name;
@@ -548,16 +800,16 @@ static bool _read_elf(elf_psp_module *out, const psp_parse_elf_config *conf, err
         u32 vaddr = conf->vaddr;
 
         if (conf->vaddr == INFER_VADDR)
-            vaddr = section_header.sh_addr;
+            vaddr = section_header->sh_addr;
 
         esec->vaddr = vaddr;
 
         out->symbols[vaddr] = elf_symbol{vaddr, section_name};
         _add_section_to_symbols(&ctx, i, &out->symbols);
 
-        esec->content = in.data + section_header.sh_offset;
-        esec->content_size = section_header.sh_size;
-        esec->content_offset = section_header.sh_offset;
+        esec->content = in.data + section_header->sh_offset;
+        esec->content_size = section_header->sh_size;
+        esec->content_offset = section_header->sh_offset;
     }
 
     compare_function_p<elf_section> compare_elf_sections =
@@ -582,7 +834,9 @@ static bool _read_elf(elf_psp_module *out, const psp_parse_elf_config *conf, err
     NAME.section = ""_cs;\
     NAME.vaddr = INFER_VADDR;\
     NAME.verbose = false;\
-    NAME.log = &log;
+    NAME.log = &log;\
+    NAME.log_buffer = nullptr;\
+    NAME.map_file = true;
 
 bool parse_psp_module_from_elf(const char *path, elf_psp_module *out, error *err)
 {
@@ -594,19 +848,79 @@ bool parse_psp_module_from_elf(const char *path, elf_psp_module *out, error *err
     return parse_psp_module_from_elf(path, out, &conf, err);
 }
 
+static bool _parse_psp_module_from_elf(memory_stream *elf_stream, elf_psp_module *out, const psp_parse_elf_config *conf, bool mapped, error *err);
+static bool _read_file_at(file_stream *in, void *out, u64 offset, u64 size, error *err);
+
+/* reads the file into a buffer that the module takes ownership of. an encrypted
+   elf is decrypted within that buffer, so loading it takes a single buffer of
+   the larger of the file and the decrypted elf. */
+static bool _read_psp_module_file(const char *path, elf_psp_module *out, const psp_parse_elf_config *conf, error *err)
+{
+    file_stream in{};
+
+    if (!init(&in, path, open_mode::Read, err))
+        return false;
+
+    defer { free(&in); };
+
+    array<u8> elf_data{};
+
+    s64 sz = decrypt_elf(&in, &elf_data, err);
+
+    if (sz < 0)
+    {
+        ::free(&elf_data);
+        return false;
+    }
+
+    if (sz > 0)
+    {
+        log(conf, "ELF is encrypted and has been decrypted.\n");
+    }
+    else
+    {
+        // elf is not encrypted, decrypt_elf only read its header
+        s64 file_size = get_file_size(&in, err);
+        resize(&elf_data, (u64)file_size);
+
+        if (!_read_file_at(&in, elf_data.data, 0, (u64)file_size, err))
+        {
+            ::free(&elf_data);
+            return false;
+        }
+    }
+
+    out->elf_data = (char*)elf_data.data;
+    out->elf_size = elf_data.size;
+    out->data_source = elf_data_source::Allocated;
+
+    return _read_elf(out, conf, err);
+}
+
 bool parse_psp_module_from_elf(const char *path, elf_psp_module *out, const psp_parse_elf_config *conf, error *err)
 {
     assert(path != nullptr);
     assert(out != nullptr);
+    assert(conf != nullptr);
+
+    if (conf->map_file)
+    {
+        memory_stream mapped_stream{};
 
-    memory_stream elf_stream{};
+        if (!_map_file(path, &mapped_stream, err))
+            return false;
 
-    if (!read_entire_file(path, &elf_stream, err))
-        return false;
+        // encrypted elfs are decrypted within a buffer of their own, the mapping is not needed
+        if (mapped_stream.size < 4 || strncmp(mapped_stream.data, "~PSP", 4))
+        {
+            ALLEGREX_STATS_ADD(BytesRead, mapped_stream.size);
+            return _parse_psp_module_from_elf(&mapped_stream, out, conf, true, err);
+        }
 
-    defer { ::free(&elf_stream); };
+        _unmap_file(mapped_stream.data, mapped_stream.size);
+    }
 
-    return parse_psp_module_from_elf(&elf_stream, out, conf, err);
+    return _read_psp_module_file(path, out, conf, err);
 }
 
 bool parse_psp_module_from_elf(char *elf_data, u64 elf_size, elf_psp_module *out, error *err)
@@ -647,10 +961,21 @@ bool parse_psp_module_from_elf(memory_stream *elf_stream, elf_psp_module *out, c
     assert(elf_stream != nullptr);
     assert(out != nullptr);
 
+    return _parse_psp_module_from_elf(elf_stream, out, conf, false, err);
+}
+
+/* if mapped is true, elf_stream is a mapping of the input file which the module
+   takes ownership of if the elf is not encrypted, instead of copying it. */
+static bool _parse_psp_module_from_elf(memory_stream *elf_stream, elf_psp_module *out, const psp_parse_elf_config *conf, bool mapped, error *err)
+{
     array<u8> decrypted_elf{};
 
     s64 sz = decrypt_elf(elf_stream, &decrypted_elf, err);
 
+    // the module only owns the mapping once elf_data is set
+    if (mapped && sz != 0)
+        _unmap_file(elf_stream->data, elf_stream->size);
+
     if (sz < 0)
         return false;
 
@@ -660,78 +985,289 @@ bool parse_psp_module_from_elf(memory_stream *elf_stream, elf_psp_module *out, c
 
         out->elf_data = (char*)decrypted_elf.data;
         out->elf_size = decrypted_elf.size;
+        out->data_source = elf_data_source::Allocated;
 
         return _read_elf(out, conf, err);
     }
 
     free(&decrypted_elf);
 
+    if (mapped)
+    {
+        // elf is not encrypted, use the mapping as is
+        out->elf_data = elf_stream->data;
+        out->elf_size = elf_stream->size;
+        out->data_source = elf_data_source::Mapped;
+
+        return _read_elf(out, conf, err);
+    }
+
     // elf is not encrypted, copy it to the module
     out->elf_data = alloc<char>(elf_stream->size);
     out->elf_size = elf_stream->size;
+    out->data_source = elf_data_source::Allocated;
     copy_memory(elf_stream->data, out->elf_data, elf_stream->size);
 
     return _read_elf(out, conf, err);
 }
 
-s64 decrypt_elf(file_stream *in, array<u8> *out, error *err)
+static bool _read_file_at(file_stream *in, void *out, u64 offset, u64 size, error *err)
 {
-    memory_stream memstr;
-    init(&memstr, get_file_size(in));
-    defer { free(&memstr); };
+    ALLEGREX_STATS_TIMER(ReadFile);
 
-    read_at(in, memstr.data, 0, in->cached_size);
+    if (read_at(in, out, offset, size, err) < (s64)size)
+    {
+        set_error(err, 1, "could not read input file");
+        return false;
+    }
 
-    return decrypt_elf(&memstr, out, err);
+    ALLEGREX_STATS_ADD(BytesRead, size);
+
+    return true;
+}
+
+s64 decrypt_elf(file_stream *in, array<u8> *out, error *err)
+{
+    prx_decrypt_info info;
+    return decrypt_elf(in, out, &info, err);
 }
 
 s64 decrypt_elf(memory_stream *in, array<u8> *out, error *err)
 {
-    if (in->size < (s64)sizeof(Elf32_Ehdr))
+    prx_decrypt_info info;
+    return decrypt_elf(in, out, &info, err);
+}
+
+/* checks the magic of the first size bytes of the input.
+   returns 1 if the input is encrypted, 0 if it is a regular ELF, or -1 on error. */
+static int _check_elf_magic(const void *data, u64 size, error *err)
+{
+    if (size < sizeof(Elf32_Ehdr))
     {
         set_error(err, 1, "input is not an ELF file");
         return -1;
     }
 
-    char magic[4] = {};
-    read(in, magic, 4);
+    if (strncmp((const char*)data, "\x7f" "ELF", 4) == 0)
+        return 0;
 
-    if (strncmp(magic, "\x7f" "ELF", 4))
+    // not an ELF, might be encrypted
+    if (strncmp((const char*)data, "~PSP", 4) != 0)
     {
-        // not an ELF, might be encrypted
-        if (strncmp(magic, "~PSP", 4))
-        {
-            // nope, not encrypted either
-            set_error(err, 1, "input is not an ELF file and is not encrypted");
-            return -1;
-        }
+        // nope, not encrypted either
+        set_error(err, 1, "input is not an ELF file and is not encrypted");
+        return -1;
+    }
 
-        // ok its encrypted, attempt decrypt
-        PSP_Header phead{};
-        read_at(in, &phead, 0);
+    if (size < sizeof(PSP_Header))
+    {
+        set_error(err, 1, "encrypted input is smaller than its header");
+        return -1;
+    }
 
-        u64 nsize = Max(phead.elf_size, phead.psp_size);
-        resize(out, nsize);
+    return 1;
+}
 
-        int decrypted_size = pspDecryptPRX(reinterpret_cast<const u8*>(in->data),
-                                           out->data,
-                                           phead.psp_size);
+#define PRX_COMPRESSED_GZIP 1 // comp_attribute
 
-        if (decrypted_size < 0)
-        {
-            set_error(err, 1, "could not decrypt input file");
-            return -1;
-        }
+/* an encrypted elf is decrypted within a single buffer.
+   a compressed elf is decrypted at the end of the buffer and inflated to its
+   start, with some room for gzip blocks that compress worse than the rest so
+   the output doesn't catch up with the input that was not inflated yet. */
+static u64 _get_decrypt_buffer_size(const PSP_Header *phead)
+{
+    u64 size = Max((u64)phead->elf_size, (u64)phead->psp_size);
+
+    if (phead->comp_attribute & PRX_COMPRESSED_GZIP)
+    {
+        u64 comp_size = Min((u64)(u32)phead->comp_size, (u64)phead->psp_size);
+        u64 room = (phead->psp_size - comp_size) + (comp_size >> 12) + 64;
+        size = Max(size, phead->elf_size + room);
+    }
+
+    return size;
+}
+
+// where the encrypted elf goes in the buffer of _get_decrypt_buffer_size.
+// aligned, the decryptors read the headers as words.
+static u64 _get_encrypted_offset(const PSP_Header *phead)
+{
+    if (phead->comp_attribute & PRX_COMPRESSED_GZIP)
+        return (_get_decrypt_buffer_size(phead) - phead->psp_size) & ~(u64)15;
+
+    return 0;
+}
+
+/* decrypts the psp_size bytes at encrypted to data + _get_encrypted_offset,
+   encrypted may be that address, the Type* decryptors read every block before
+   overwriting it. compressed elfs are then inflated to the start of data. */
+static s64 _decrypt_elf_in_buffer(array<u8> *data, const u8 *encrypted, const PSP_Header *phead, prx_decrypt_info *info, error *err)
+{
+    u8 *decrypted = data->data + _get_encrypted_offset(phead);
+    int decrypted_size;
+
+    {
+        ALLEGREX_STATS_TIMER(Decrypt);
+        decrypted_size = pspDecryptPRX(encrypted, decrypted, phead->psp_size, nullptr, info);
+    }
+
+    if (decrypted_size < 0)
+    {
+        set_error(err, 1, "could not decrypt input file");
+        return -1;
+    }
 
-        /* TODO: implement gzip
-        const auto isGzip = phead.comp_attribute & 1;
-        if (isGzip)
-            ...
-        */
+    ALLEGREX_STATS_ADD(BytesDecrypted, decrypted_size);
 
+    if (!(phead->comp_attribute & PRX_COMPRESSED_GZIP))
         return decrypted_size;
+
+    s64 elf_size;
+
+    {
+        ALLEGREX_STATS_TIMER(Inflate);
+        elf_size = inflate_gzip(decrypted, (u64)decrypted_size, data->data, phead->elf_size, err);
     }
 
-    // nothing to decrypt
-    return 0;
+    if (elf_size < 0)
+        return -1;
+
+    ALLEGREX_STATS_ADD(BytesInflated, elf_size);
+
+    resize(data, (u64)elf_size);
+
+    return elf_size;
+}
+
+/* only the header is read for regular ELFs. encrypted ELFs are read directly
+   to where they are decrypted in out, so the input is never copied. */
+s64 decrypt_elf(file_stream *in, array<u8> *out, prx_decrypt_info *info, error *err)
+{
+    info->type = prx_type::Unknown;
+    info->attempts = 0;
+
+    s64 file_size = get_file_size(in, err);
+
+    if (file_size < 0)
+        return -1;
+
+    PSP_Header phead{};
+    u64 header_size = Min((u64)file_size, (u64)sizeof(PSP_Header));
+
+    if (!_read_file_at(in, &phead, 0, header_size, err))
+        return -1;
+
+    int encrypted = _check_elf_magic(&phead, header_size, err);
+
+    if (encrypted <= 0)
+        return encrypted;
+
+    if (phead.psp_size > (u64)file_size)
+    {
+        set_error(err, 1, "encrypted input is smaller than its header says");
+        return -1;
+    }
+
+    resize(out, _get_decrypt_buffer_size(&phead));
+    u8 *encrypted_data = out->data + _get_encrypted_offset(&phead);
+
+    if (!_read_file_at(in, encrypted_data, 0, phead.psp_size, err))
+        return -1;
+
+    return _decrypt_elf_in_buffer(out, encrypted_data, &phead, info, err);
+}
+
+int get_decrypted_elf_size(file_stream *in, u64 *elf_size, u64 *buffer_size, error *err)
+{
+    s64 file_size = get_file_size(in, err);
+
+    if (file_size < 0)
+        return -1;
+
+    PSP_Header phead{};
+    u64 header_size = Min((u64)file_size, (u64)sizeof(PSP_Header));
+
+    if (!_read_file_at(in, &phead, 0, header_size, err))
+        return -1;
+
+    int encrypted = _check_elf_magic(&phead, header_size, err);
+
+    if (encrypted < 0)
+        return -1;
+
+    if (encrypted == 0)
+    {
+        *elf_size = (u64)file_size;
+        *buffer_size = (u64)file_size;
+        return 0;
+    }
+
+    *elf_size = phead.elf_size;
+    *buffer_size = _get_decrypt_buffer_size(&phead);
+
+    return 1;
+}
+
+s64 decrypt_elf(memory_stream *in, array<u8> *out, prx_decrypt_info *info, error *err)
+{
+    info->type = prx_type::Unknown;
+    info->attempts = 0;
+
+    int encrypted = _check_elf_magic(in->data, (u64)in->size, err);
+
+    if (encrypted <= 0)
+        return encrypted;
+
+    // ok its encrypted, attempt decrypt
+    PSP_Header phead{};
+    read_at(in, &phead, 0);
+
+    if (phead.psp_size > (u64)in->size)
+    {
+        set_error(err, 1, "encrypted input is smaller than its header says");
+        return -1;
+    }
+
+    resize(out, _get_decrypt_buffer_size(&phead));
+
+    return _decrypt_elf_in_buffer(out, reinterpret_cast<const u8*>(in->data), &phead, info, err);
+}
+
+s64 decrypt_elf_in_place(array<u8> *data, error *err)
+{
+    prx_decrypt_info info;
+    return decrypt_elf_in_place(data, &info, err);
+}
+
+s64 decrypt_elf_in_place(array<u8> *data, prx_decrypt_info *info, error *err)
+{
+    info->type = prx_type::Unknown;
+    info->attempts = 0;
+
+    int encrypted = _check_elf_magic(data->data, data->size, err);
+
+    if (encrypted <= 0)
+        return encrypted;
+
+    PSP_Header phead{};
+    copy_memory(data->data, &phead, sizeof(PSP_Header));
+
+    if (phead.psp_size > data->size)
+    {
+        set_error(err, 1, "encrypted input is smaller than its header says");
+        return -1;
+    }
+
+    u64 size = _get_decrypt_buffer_size(&phead);
+
+    if (size > data->size)
+        resize(data, size);
+
+    // compressed elfs are decrypted at the end of the buffer, only the encrypted data is moved
+    u64 offset = _get_encrypted_offset(&phead);
+
+    if (offset > 0)
+        move_memory(data->data, data->data + offset, phead.psp_size);
+
+    return _decrypt_elf_in_buffer(data, data->data + offset, &phead, info, err);
 }
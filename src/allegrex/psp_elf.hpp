@@ -12,12 +12,23 @@
 
 #define INFER_VADDR max_value(u32)
 
+struct prx_decrypt_info;
+
 struct psp_parse_elf_config
 {
     const_string section; // leave empty to read all executable sections
     u32 vaddr;
     bool verbose;
     file_stream *log;
+
+    /* if not nullptr, verbose output is appended here instead of written to log,
+       e.g. to write the output of a file in one piece when parsing many at once. */
+    array<char> *log_buffer;
+
+    /* when parsing from a path, map the file into memory instead of reading it.
+       unencrypted ELFs are then used directly from the mapping without copying.
+       encrypted ELFs are always read and decrypted within a single buffer. */
+    bool map_file;
 };
 
 struct elf_symbol
@@ -74,10 +85,18 @@ struct module_export
     array<variable_export> variables;
 };
 
+enum class elf_data_source : u8
+{
+    None,
+    Allocated, // allocated by the module, e.g. a copy of the input or the decrypted elf
+    Mapped     // read-only mapping of the input file, owned by the module
+};
+
 struct elf_psp_module
 {
     char *elf_data; // the whole decrypted elf data, including strings, sections, etc.
     u64 elf_size; // size of elf_data
+    elf_data_source data_source; // how elf_data is freed
 
     prx_sce_module_info module_info;
 
@@ -106,6 +125,23 @@ bool parse_psp_module_from_elf(memory_stream *elf_stream, elf_psp_module *out, c
 // void read_elf(file_stream *in, const psp_parse_elf_config *conf, elf_psp_module *out);
 // void read_elf(memory_stream *in, const psp_parse_elf_config *conf, elf_psp_module *out);
 
-// returns decrypted size, 0 if input is regular ELF, or -1 on error
+// returns decrypted size, 0 if input is regular ELF, or -1 on error.
+// gzip compressed ELFs are inflated and the inflated size is returned.
 s64 decrypt_elf(file_stream *in, array<u8> *out, error *err = nullptr);
 s64 decrypt_elf(memory_stream *in, array<u8> *out, error *err = nullptr);
+// info is set to the PRX type and the number of decryption attempts of encrypted input
+s64 decrypt_elf(file_stream *in, array<u8> *out, prx_decrypt_info *info, error *err);
+s64 decrypt_elf(memory_stream *in, array<u8> *out, prx_decrypt_info *info, error *err);
+
+/* reads only the header of the ELF in. elf_size is set to the size of the
+   ELF once decrypted and inflated and buffer_size to the size of the buffer
+   decrypt_elf decrypts it in, or both to the file size if it's a regular ELF.
+   returns 1 if in is encrypted, 0 if it's a regular ELF, or -1 on error. */
+int get_decrypted_elf_size(file_stream *in, u64 *elf_size, u64 *buffer_size, error *err = nullptr);
+
+/* decrypts the encrypted ELF in data within the same buffer, which is grown
+   to the decrypted size if needed. reserve enough space beforehand to avoid a
+   reallocation. compressed ELFs are inflated within the buffer as well.
+   returns decrypted size, 0 if data is a regular ELF, or -1 on error */
+s64 decrypt_elf_in_place(array<u8> *data, error *err = nullptr);
+s64 decrypt_elf_in_place(array<u8> *data, prx_decrypt_info *info, error *err);
@@ -7,6 +7,7 @@
 
 #include "allegrex/internal/psp_module_function_argument_defs.hpp"
 #include "allegrex/internal/psp_module_function_pspdev_headers.hpp"
+#include "allegrex/internal/perfect_hash.hpp"
 #include "allegrex/psp_modules.hpp"
 
 #if MSVC
@@ -30,6 +31,116 @@ constexpr psp_function unknown_function{
 
 constexpr psp_module unknown_module{0xffff, "unknown_module", &unknown_function, 1};
 
+/* Lookup tables
+
+Perfect hash tables over the modules and functions above, built at compile time
+(see internal/perfect_hash.hpp):
+- module name -> module,
+- (module number, NID) -> function of the module,
+- NID -> first function with the NID in any module.
+*/
+constexpr u64 _count_psp_functions()
+{
+    u64 ret = 0;
+
+    for (u64 m = 0; m < array_size(&_modules); ++m)
+        ret += _modules[m].function_count;
+
+    return ret;
+}
+
+constexpr u64 psp_module_count = array_size(&_modules);
+constexpr u64 psp_function_count = _count_psp_functions();
+
+template<u64 N>
+struct psp_function_list
+{
+    const psp_function *functions[N];
+};
+
+template<u64 N>
+struct psp_hash_list
+{
+    u64 hashes[N];
+};
+
+// all functions in module order
+constexpr auto _flatten_psp_functions()
+{
+    psp_function_list<psp_function_count> ret{};
+    u64 i = 0;
+
+    for (u64 m = 0; m < psp_module_count; ++m)
+    {
+        for (u32 f = 0; f < _modules[m].function_count; ++f)
+        {
+            ret.functions[i] = _modules[m].functions + f;
+            i += 1;
+        }
+    }
+
+    return ret;
+}
+
+constexpr auto _module_name_hashes()
+{
+    psp_hash_list<psp_module_count> ret{};
+
+    for (u64 m = 0; m < psp_module_count; ++m)
+        ret.hashes[m] = _perfect_hash_string(_modules[m].name);
+
+    return ret;
+}
+
+constexpr auto _module_nid_hashes(const psp_function_list<psp_function_count> *funcs)
+{
+    psp_hash_list<psp_function_count> ret{};
+    u64 i = 0;
+
+    for (u64 m = 0; m < psp_module_count; ++m)
+    {
+        for (u32 f = 0; f < _modules[m].function_count; ++f)
+        {
+            ret.hashes[i] = _perfect_hash_pair(_modules[m].module_num, funcs->functions[i]->nid);
+            i += 1;
+        }
+    }
+
+    return ret;
+}
+
+constexpr auto _nid_hashes(const psp_function_list<psp_function_count> *funcs)
+{
+    psp_hash_list<psp_function_count> ret{};
+
+    for (u64 i = 0; i < psp_function_count; ++i)
+        ret.hashes[i] = _perfect_hash_mix(funcs->functions[i]->nid);
+
+    return ret;
+}
+
+constexpr auto _psp_functions = _flatten_psp_functions();
+
+constexpr auto _module_names_list = _module_name_hashes();
+constexpr auto _module_nids_list = _module_nid_hashes(&_psp_functions);
+constexpr auto _nids_list = _nid_hashes(&_psp_functions);
+
+constexpr auto _module_name_table = _build_perfect_hash<psp_module_count,
+                                                        _perfect_hash_size(psp_module_count / 4),
+                                                        _perfect_hash_size(psp_module_count * 2)>(_module_names_list.hashes);
+
+constexpr auto _module_nid_table = _build_perfect_hash<psp_function_count,
+                                                       _perfect_hash_size(psp_function_count / 4),
+                                                       _perfect_hash_size(psp_function_count * 2)>(_module_nids_list.hashes);
+
+constexpr auto _nid_table = _build_perfect_hash<psp_function_count,
+                                                _perfect_hash_size(psp_function_count / 4),
+                                                _perfect_hash_size(psp_function_count * 2)>(_nids_list.hashes);
+
+static_assert(_module_name_table.ok);
+static_assert(_module_nid_table.ok);
+static_assert(_nid_table.ok);
+
 const psp_module *get_psp_modules()
 {
     return _modules.data;
@@ -45,12 +156,18 @@ const psp_module *get_psp_module_by_name(const char *mod)
     if (mod == nullptr)
         return nullptr;
 
-    // could be optimized
-    for_array(md, &_modules)
-        if (strcmp(md->name, mod) == 0)
-            return md;
+    u32 i = _perfect_hash_lookup(&_module_name_table, _perfect_hash_string(mod));
 
-    return nullptr;
+    if (i == PERFECT_HASH_NOT_FOUND)
+        return nullptr;
+
+    // the only module it can be
+    const psp_module *md = _modules.data + i;
+
+    if (strcmp(md->name, mod) != 0)
+        return nullptr;
+
+    return md;
 }
 
 const psp_function *get_psp_function_by_nid(const char *mod, u32 nid)
@@ -58,21 +175,40 @@ const psp_function *get_psp_function_by_nid(const char *mod, u32 nid)
     if (mod == nullptr)
         return nullptr;
 
-    const psp_module *md = get_psp_module_by_name(mod);
+    return get_psp_module_function_by_nid(get_psp_module_by_name(mod), nid);
+}
 
-    if (md == nullptr)
+const psp_function *get_psp_module_function_by_nid(const psp_module *mod, u32 nid)
+{
+    if (mod == nullptr)
         return nullptr;
 
-    // could be optimized even more
-    for (u32 i = 0; i < md->function_count; ++i)
-    {
-        const psp_function *f = md->functions + i;
+    u32 i = _perfect_hash_lookup(&_module_nid_table, _perfect_hash_pair(mod->module_num, nid));
 
-        if (f->nid == nid)
-            return f;
-    }
+    if (i == PERFECT_HASH_NOT_FOUND)
+        return nullptr;
 
-    return nullptr;
+    const psp_function *f = _psp_functions.functions[i];
+
+    if (f->nid != nid || f < mod->functions || f >= mod->functions + mod->function_count)
+        return nullptr;
+
+    return f;
+}
+
+const psp_function *get_psp_function_by_nid(u32 nid)
+{
+    u32 i = _perfect_hash_lookup(&_nid_table, _perfect_hash_mix(nid));
+
+    if (i == PERFECT_HASH_NOT_FOUND)
+        return nullptr;
+
+    const psp_function *f = _psp_functions.functions[i];
+
+    if (f->nid != nid)
+        return nullptr;
+
+    return f;
 }
 
 const psp_function *get_psp_function_by_name(const char *mod, const char *name)
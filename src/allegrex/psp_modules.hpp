@@ -36,8 +36,13 @@ struct psp_module
 const psp_module *get_psp_modules();
 u32 get_psp_module_count();
 
+// lookups by module name and NID are constant time
 const psp_module *get_psp_module_by_name(const char *mod);
 const psp_function *get_psp_function_by_nid(const char *mod, u32 nid);
+const psp_function *get_psp_module_function_by_nid(const psp_module *mod, u32 nid);
+
+// first function with the given NID in any module
+const psp_function *get_psp_function_by_nid(u32 nid);
 const psp_function *get_psp_function_by_name(const char *mod, const char *name);
 
 const psp_function *get_psp_function(u16 mod, u16 fun);
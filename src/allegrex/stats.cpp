@@ -0,0 +1,128 @@
+#include <atomic>
+#include <chrono>
+
+#include "shl/assert.hpp"
+
+#include "allegrex/stats.hpp"
+#include "allegrex/trace.hpp"
+
+// relaxed is enough, the stats are only read once all work is done
+static std::atomic<bool> _enabled{false};
+static std::atomic<u64> _phase_calls[ALLEGREX_PHASE_COUNT]{};
+static std::atomic<u64> _phase_nanoseconds[ALLEGREX_PHASE_COUNT]{};
+static std::atomic<u64> _counters[ALLEGREX_COUNTER_COUNT]{};
+
+const char *allegrex_phase_name(allegrex_phase phase)
+{
+    switch (phase)
+    {
+    case allegrex_phase::ReadFile:          return "read file";
+    case allegrex_phase::Decrypt:           return "decrypt";
+    case allegrex_phase::Inflate:           return "inflate";
+    case allegrex_phase::ReadElf:           return "read elf";
+    case allegrex_phase::ImportsExports:    return "imports/exports";
+    case allegrex_phase::ParseInstructions: return "parse instructions";
+    case allegrex_phase::CollectJumps:      return "collect jumps";
+    case allegrex_phase::Format:            return "format";
+    default:                                return "unknown";
+    }
+}
+
+const char *allegrex_counter_name(allegrex_counter counter)
+{
+    switch (counter)
+    {
+    case allegrex_counter::BytesRead:           return "bytes read";
+    case allegrex_counter::BytesDecrypted:      return "bytes decrypted";
+    case allegrex_counter::BytesInflated:       return "bytes inflated";
+    case allegrex_counter::InstructionsDecoded: return "instructions decoded";
+    case allegrex_counter::UnknownOpcodes:      return "unknown opcodes";
+    case allegrex_counter::Jumps:               return "jumps";
+    case allegrex_counter::Branches:            return "branches";
+    case allegrex_counter::NidLookups:          return "NID lookups";
+    case allegrex_counter::NidMisses:           return "NID misses";
+    case allegrex_counter::DecodeCacheHits:     return "decode cache hits";
+    case allegrex_counter::DecodeCacheMisses:   return "decode cache misses";
+    case allegrex_counter::BytesWritten:        return "bytes written";
+    default:                                    return "unknown";
+    }
+}
+
+void set_stats_enabled(bool enabled)
+{
+    _enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool stats_enabled()
+{
+    return _enabled.load(std::memory_order_relaxed);
+}
+
+void get_stats(allegrex_stats *out)
+{
+    assert(out != nullptr);
+
+    for (u32 i = 0; i < ALLEGREX_PHASE_COUNT; ++i)
+    {
+        out->phases[i].calls = _phase_calls[i].load(std::memory_order_relaxed);
+        out->phases[i].nanoseconds = _phase_nanoseconds[i].load(std::memory_order_relaxed);
+    }
+
+    for (u32 i = 0; i < ALLEGREX_COUNTER_COUNT; ++i)
+        out->counters[i] = _counters[i].load(std::memory_order_relaxed);
+}
+
+void reset_stats()
+{
+    for (u32 i = 0; i < ALLEGREX_PHASE_COUNT; ++i)
+    {
+        _phase_calls[i].store(0, std::memory_order_relaxed);
+        _phase_nanoseconds[i].store(0, std::memory_order_relaxed);
+    }
+
+    for (u32 i = 0; i < ALLEGREX_COUNTER_COUNT; ++i)
+        _counters[i].store(0, std::memory_order_relaxed);
+}
+
+static u64 _now()
+{
+    return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+u64 stats_timer_begin()
+{
+    if (!stats_enabled() && !trace_enabled())
+        return 0;
+
+    return _now();
+}
+
+void stats_timer_end(allegrex_phase phase, u64 start)
+{
+    if (start == 0)
+        return;
+
+    u32 i = (u32)phase;
+    assert(i < ALLEGREX_PHASE_COUNT);
+
+    u64 end = _now();
+
+    if (stats_enabled())
+    {
+        _phase_calls[i].fetch_add(1, std::memory_order_relaxed);
+        _phase_nanoseconds[i].fetch_add(end - start, std::memory_order_relaxed);
+    }
+
+    trace_phase(phase, start, end);
+}
+
+void stats_add(allegrex_counter counter, u64 n)
+{
+    if (!stats_enabled())
+        return;
+
+    u32 i = (u32)counter;
+    assert(i < ALLEGREX_COUNTER_COUNT);
+
+    _counters[i].fetch_add(n, std::memory_order_relaxed);
+}
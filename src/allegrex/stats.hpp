@@ -0,0 +1,121 @@
+
+#pragma once
+
+#include "shl/number_types.hpp"
+#include "shl/defer.hpp"
+
+/*
+STATS
+
+Timers and counters of where time goes when loading and disassembling modules,
+e.g. for psp-elfdump --stats.
+
+Phases are timed with ALLEGREX_STATS_TIMER, which times the rest of the
+enclosing scope, and counters are increased with ALLEGREX_STATS_ADD.
+Both compile to nothing unless ALLEGREX_STATS is 1, and do nothing but check
+a flag until stats are enabled with set_stats_enabled. While tracing is
+enabled (see allegrex/trace.hpp), every timer is also a trace event.
+The functions below always exist, the stats are all zero if ALLEGREX_STATS
+is 0.
+
+Phases and counters are shared by all threads, the time of a phase is the sum
+of the time spent in it on every thread. Some phases contain others, e.g.
+ReadElf contains ImportsExports.
+
+Usage:
+
+    void read_something(...)
+    {
+        ALLEGREX_STATS_TIMER(ReadFile);
+        ...
+        ALLEGREX_STATS_ADD(BytesRead, size);
+    }
+
+    set_stats_enabled(true);
+    read_something(...);
+
+    allegrex_stats stats;
+    get_stats(&stats);
+*/
+
+#ifndef ALLEGREX_STATS
+#define ALLEGREX_STATS 0
+#endif
+
+enum class allegrex_phase : u8
+{
+    ReadFile,
+    Decrypt,
+    Inflate,
+    ReadElf,
+    ImportsExports,    // within ReadElf
+    ParseInstructions,
+    CollectJumps,
+    Format,
+    _MAX
+};
+
+#define ALLEGREX_PHASE_COUNT ((u32)allegrex_phase::_MAX)
+
+enum class allegrex_counter : u8
+{
+    BytesRead,
+    BytesDecrypted,
+    BytesInflated,
+    InstructionsDecoded,
+    UnknownOpcodes,
+    Jumps,
+    Branches,
+    NidLookups,
+    NidMisses,
+    DecodeCacheHits,
+    DecodeCacheMisses,
+    BytesWritten,
+    _MAX
+};
+
+#define ALLEGREX_COUNTER_COUNT ((u32)allegrex_counter::_MAX)
+
+struct allegrex_phase_stats
+{
+    u64 calls;
+    u64 nanoseconds;
+};
+
+struct allegrex_stats
+{
+    allegrex_phase_stats phases[ALLEGREX_PHASE_COUNT];
+    u64 counters[ALLEGREX_COUNTER_COUNT];
+};
+
+const char *allegrex_phase_name(allegrex_phase phase);
+const char *allegrex_counter_name(allegrex_counter counter);
+
+void set_stats_enabled(bool enabled);
+bool stats_enabled();
+
+void get_stats(allegrex_stats *out);
+void reset_stats();
+
+// use the macros below instead of these.
+// stats_timer_begin returns 0 if stats and tracing are disabled, which stats_timer_end ignores.
+u64 stats_timer_begin();
+void stats_timer_end(allegrex_phase phase, u64 start);
+void stats_add(allegrex_counter counter, u64 n);
+
+#if ALLEGREX_STATS
+#define _ALLEGREX_STATS_CAT2(a, b) a##b
+#define _ALLEGREX_STATS_CAT(a, b) _ALLEGREX_STATS_CAT2(a, b)
+#define _ALLEGREX_STATS_START _ALLEGREX_STATS_CAT(_stats_start_, __LINE__)
+
+#define ALLEGREX_STATS_TIMER(PHASE) \
+    u64 _ALLEGREX_STATS_START = stats_timer_begin();\
+    defer { stats_timer_end(allegrex_phase::PHASE, _ALLEGREX_STATS_START); }
+
+#define ALLEGREX_STATS_ADD(COUNTER, N) \
+    stats_add(allegrex_counter::COUNTER, (u64)(N))
+#else
+#define ALLEGREX_STATS_TIMER(PHASE)
+// N is still evaluated so the counts of callers are not unused
+#define ALLEGREX_STATS_ADD(COUNTER, N) ((void)(N))
+#endif
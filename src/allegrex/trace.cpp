@@ -0,0 +1,267 @@
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+#include "shl/array.hpp"
+#include "shl/assert.hpp"
+#include "shl/memory.hpp"
+#include "shl/file_stream.hpp"
+#include "shl/print.hpp"
+#include "shl/defer.hpp"
+
+#include "allegrex/trace.hpp"
+
+static_assert((TRACE_BUFFER_EVENT_COUNT & (TRACE_BUFFER_EVENT_COUNT - 1)) == 0, "TRACE_BUFFER_EVENT_COUNT must be a power of 2");
+
+#define NO_TRACE_NAME max_value(u32)
+#define TRACE_FILE_EVENT ((u8)allegrex_phase::_MAX) // phase of the events of ALLEGREX_TRACE_FILE
+
+struct trace_event
+{
+    u64 start;    // nanoseconds since tracing was enabled
+    u64 duration; // nanoseconds
+    u32 name;     // offset of the file name in the names of the thread, or NO_TRACE_NAME
+    u8 phase;     // allegrex_phase or TRACE_FILE_EVENT
+};
+
+struct trace_buffer
+{
+    u32 thread_id;
+    trace_event *events; // ring of TRACE_BUFFER_EVENT_COUNT events
+    u64 event_count;     // all events recorded, the ring holds the last ones
+    array<char> names;   // null-terminated file names, escaped for JSON
+    u32 last_name;
+    u32 current_name;
+};
+
+static std::atomic<bool> _enabled{false};
+static std::atomic<u64> _start{0};
+
+/* buffers are never freed. when a thread exits its buffer is added to the
+   free buffers and the next new thread records to it, on the same track,
+   so there are only as many buffers as threads ever ran at the same time. */
+static std::mutex _buffers_mutex;
+static array<trace_buffer*> _buffers{};
+static array<trace_buffer*> _free_buffers{};
+
+// returns the buffer of its thread to the free buffers when the thread exits
+struct trace_buffer_owner
+{
+    trace_buffer *buf = nullptr;
+
+    ~trace_buffer_owner()
+    {
+        if (buf == nullptr)
+            return;
+
+        std::lock_guard lock(_buffers_mutex);
+        buf->current_name = NO_TRACE_NAME;
+        ::add_at_end(&_free_buffers, buf);
+    }
+};
+
+static thread_local trace_buffer_owner _thread_buffer;
+
+static u64 _now()
+{
+    return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static trace_buffer *_get_thread_buffer()
+{
+    if (_thread_buffer.buf != nullptr)
+        return _thread_buffer.buf;
+
+    std::lock_guard lock(_buffers_mutex);
+
+    if (_free_buffers.size > 0)
+    {
+        _thread_buffer.buf = _free_buffers[_free_buffers.size - 1];
+        ::remove_from_end(&_free_buffers);
+        return _thread_buffer.buf;
+    }
+
+    trace_buffer *buf = alloc<trace_buffer>(1);
+    fill_memory(buf, 0);
+    buf->events = alloc<trace_event>(TRACE_BUFFER_EVENT_COUNT);
+    ::init(&buf->names);
+    buf->last_name = NO_TRACE_NAME;
+    buf->current_name = NO_TRACE_NAME;
+    buf->thread_id = (u32)_buffers.size + 1;
+    ::add_at_end(&_buffers, buf);
+
+    _thread_buffer.buf = buf;
+    return buf;
+}
+
+static void _add_event(trace_buffer *buf, u8 phase, u64 start, u64 end)
+{
+    // timers may have been started before tracing was enabled
+    u64 trace_start = _start.load(std::memory_order_relaxed);
+    start = Max(start, trace_start);
+    end = Max(end, start);
+
+    trace_event *e = buf->events + (buf->event_count & (TRACE_BUFFER_EVENT_COUNT - 1));
+    e->start = start - trace_start;
+    e->duration = end - start;
+    e->name = buf->current_name;
+    e->phase = phase;
+
+    buf->event_count += 1;
+}
+
+// returns the offset of name in the names of buf, files are usually traced once per thread
+static u32 _add_name(trace_buffer *buf, const char *name)
+{
+    if (buf->last_name != NO_TRACE_NAME && strcmp(buf->names.data + buf->last_name, name) == 0)
+        return buf->last_name;
+
+    u32 offset = (u32)buf->names.size;
+
+    for (const char *c = name; *c != '\0'; ++c)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            ::add_at_end(&buf->names, '\\');
+            ::add_at_end(&buf->names, *c);
+        }
+        else if ((u8)*c < 0x20)
+        {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", (u32)(u8)*c);
+
+            for (const char *e = escaped; *e != '\0'; ++e)
+                ::add_at_end(&buf->names, *e);
+        }
+        else
+            ::add_at_end(&buf->names, *c);
+    }
+
+    ::add_at_end(&buf->names, '\0');
+    buf->last_name = offset;
+
+    return offset;
+}
+
+void set_trace_enabled(bool enabled)
+{
+    if (enabled && _start.load(std::memory_order_relaxed) == 0)
+        _start.store(_now(), std::memory_order_relaxed);
+
+    _enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool trace_enabled()
+{
+    return _enabled.load(std::memory_order_relaxed);
+}
+
+void reset_trace()
+{
+    std::lock_guard lock(_buffers_mutex);
+
+    for_array(buf, &_buffers)
+    {
+        (*buf)->event_count = 0;
+        ::clear(&(*buf)->names);
+        (*buf)->last_name = NO_TRACE_NAME;
+        (*buf)->current_name = NO_TRACE_NAME;
+    }
+
+    _start.store(trace_enabled() ? _now() : 0, std::memory_order_relaxed);
+}
+
+void trace_phase(allegrex_phase phase, u64 start, u64 end)
+{
+    if (!trace_enabled())
+        return;
+
+    _add_event(_get_thread_buffer(), (u8)phase, start, end);
+}
+
+u64 trace_file_begin(const char *name)
+{
+    assert(name != nullptr);
+
+    if (!trace_enabled())
+        return 0;
+
+    trace_buffer *buf = _get_thread_buffer();
+    buf->current_name = _add_name(buf, name);
+
+    return _now();
+}
+
+void trace_file_end(u64 start)
+{
+    if (start == 0)
+        return;
+
+    trace_buffer *buf = _get_thread_buffer();
+    _add_event(buf, TRACE_FILE_EVENT, start, _now());
+    buf->current_name = NO_TRACE_NAME;
+}
+
+// a complete ("X") event of the Chrome Trace Event Format, times are in microseconds
+static void _write_event(file_stream *out, const trace_buffer *buf, const trace_event *e)
+{
+    const char *file = e->name != NO_TRACE_NAME ? buf->names.data + e->name : nullptr;
+    const char *name;
+    const char *category;
+
+    if (e->phase == TRACE_FILE_EVENT)
+    {
+        name = file != nullptr ? file : "file";
+        category = "file";
+    }
+    else
+    {
+        name = allegrex_phase_name((allegrex_phase)e->phase);
+        category = "phase";
+    }
+
+    tprint(out->handle, ",\n  {\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": %u, \"args\": {\"thread\": %u",
+           name, category, (double)e->start / 1000.0, (double)e->duration / 1000.0, buf->thread_id, buf->thread_id);
+
+    if (file != nullptr)
+        tprint(out->handle, ", \"file\": \"%s\"", file);
+
+    tprint(out->handle, "}}");
+}
+
+bool write_trace(const char *path, error *err)
+{
+    file_stream out{};
+
+    if (!init(&out, path, open_mode::WriteTrunc, err))
+        return false;
+
+    defer { free(&out); };
+
+    std::lock_guard lock(_buffers_mutex);
+
+    u64 dropped = 0;
+
+    tprint(out.handle, "{\"traceEvents\": [\n  {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"liballegrex\"}}");
+
+    for_array(bufp, &_buffers)
+    {
+        const trace_buffer *buf = *bufp;
+
+        tprint(out.handle, ",\n  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": \"thread %u\"}}",
+               buf->thread_id, buf->thread_id);
+
+        // oldest first
+        u64 count = Min(buf->event_count, (u64)TRACE_BUFFER_EVENT_COUNT);
+        dropped += buf->event_count - count;
+
+        for (u64 i = buf->event_count - count; i < buf->event_count; ++i)
+            _write_event(&out, buf, buf->events + (i & (TRACE_BUFFER_EVENT_COUNT - 1)));
+    }
+
+    tprint(out.handle, "\n],\n\"displayTimeUnit\": \"ms\",\n\"otherData\": {\"dropped_events\": %llu}}\n", dropped);
+
+    return true;
+}
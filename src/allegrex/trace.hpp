@@ -0,0 +1,71 @@
+
+#pragma once
+
+#include "shl/number_types.hpp"
+#include "shl/error.hpp"
+#include "shl/defer.hpp"
+
+#include "allegrex/stats.hpp"
+
+/*
+TRACE
+
+Records the phases of allegrex/stats.hpp as Chrome trace events, e.g. to see
+which files take the longest and how phases overlap when many files are
+processed on multiple threads. The trace is written as JSON, which Perfetto
+(ui.perfetto.dev) and chrome://tracing open.
+
+Every ALLEGREX_STATS_TIMER is also a trace event while tracing is enabled.
+Events of a thread go to a ring buffer of that thread, so recording doesn't
+lock, and once a buffer is full the oldest events of the thread are
+overwritten. The buffer of a thread that exited is reused by the next new
+thread, so a buffer is the track of threads that ran one after another and
+there are only as many as threads ran at the same time. Each event has the
+file the thread works on as argument, ALLEGREX_TRACE_FILE sets it for the
+rest of the enclosing scope, which is also an event of its own.
+
+Like the timers, all of this compiles to nothing unless ALLEGREX_STATS is 1.
+
+Usage:
+
+    set_trace_enabled(true);
+
+    // on any thread
+    {
+        ALLEGREX_TRACE_FILE(path);
+        parse_psp_module_from_elf(path, &mod, &err);
+        ...
+    }
+
+    // once all threads are done
+    write_trace("trace.json", &err);
+*/
+
+// events per thread
+#define TRACE_BUFFER_EVENT_COUNT 65536
+
+void set_trace_enabled(bool enabled);
+bool trace_enabled();
+
+// discards all recorded events
+void reset_trace();
+
+/* writes the events of all threads to path.
+   must not be called while other threads record events. */
+bool write_trace(const char *path, error *err = nullptr);
+
+// use the macros below and in allegrex/stats.hpp instead of these.
+// trace_file_begin returns 0 if tracing is disabled, which trace_file_end ignores.
+void trace_phase(allegrex_phase phase, u64 start, u64 end);
+u64 trace_file_begin(const char *name);
+void trace_file_end(u64 start);
+
+#if ALLEGREX_STATS
+#define _ALLEGREX_TRACE_START _ALLEGREX_STATS_CAT(_trace_start_, __LINE__)
+
+#define ALLEGREX_TRACE_FILE(NAME) \
+    u64 _ALLEGREX_TRACE_START = trace_file_begin(NAME);\
+    defer { trace_file_end(_ALLEGREX_TRACE_START); }
+#else
+#define ALLEGREX_TRACE_FILE(NAME)
+#endif
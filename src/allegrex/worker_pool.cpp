@@ -0,0 +1,43 @@
+
+#include <assert.h>
+#include <thread>
+
+#include "allegrex/worker_pool.hpp"
+
+u32 get_worker_count(u32 requested, u64 work_count, u32 max_workers)
+{
+    u64 ret = requested;
+
+    if (ret == 0)
+        ret = std::thread::hardware_concurrency();
+
+    if (ret > max_workers)
+        ret = max_workers;
+
+    if (ret > MAX_WORKER_THREADS)
+        ret = MAX_WORKER_THREADS;
+
+    if (ret > work_count)
+        ret = work_count;
+
+    if (ret == 0)
+        ret = 1;
+
+    return (u32)ret;
+}
+
+void run_workers(u32 worker_count, void (*work)(u32 worker, void *userdata), void *userdata)
+{
+    assert(work != nullptr);
+    assert(worker_count <= MAX_WORKER_THREADS);
+
+    std::thread workers[MAX_WORKER_THREADS];
+
+    for (u32 t = 1; t < worker_count; ++t)
+        workers[t] = std::thread(work, t, userdata);
+
+    work(0, userdata);
+
+    for (u32 t = 1; t < worker_count; ++t)
+        workers[t].join();
+}
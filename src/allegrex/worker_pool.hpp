@@ -0,0 +1,44 @@
+
+#pragma once
+
+#include "shl/number_types.hpp"
+
+/*
+WORKER POOL
+
+Runs the same work function on multiple threads, e.g. to decode the chunks of
+a module or to decrypt many files at once. The calling thread is worker 0 and
+the others are started for the call and joined before run_workers returns.
+The work function usually takes its next item from a shared atomic index.
+
+Usage:
+
+    std::atomic<u64> next_item = 0;
+
+    u32 worker_count = get_worker_count(conf->thread_count, item_count, MAX_THREADS);
+
+    run_workers(worker_count, [&](u32 worker)
+    {
+        for (u64 i = next_item.fetch_add(1); i < item_count; i = next_item.fetch_add(1))
+            process(items + i, results + worker);
+    });
+*/
+
+#define MAX_WORKER_THREADS 256
+
+/* Number of workers for work_count items.
+   requested 0 means as many as the hardware supports.
+   The result is at most max_workers, MAX_WORKER_THREADS and work_count,
+   and at least 1. */
+u32 get_worker_count(u32 requested, u64 work_count, u32 max_workers);
+
+/* Calls work(worker, userdata) for every worker in [0, worker_count) on its
+   own thread and returns once all of them returned. Worker 0 runs on the
+   calling thread, so a worker_count of 1 starts no threads. */
+void run_workers(u32 worker_count, void (*work)(u32 worker, void *userdata), void *userdata);
+
+template<typename F>
+void run_workers(u32 worker_count, F work)
+{
+    run_workers(worker_count, [](u32 worker, void *userdata) { (*(F*)userdata)(worker); }, (void*)&work);
+}
@@ -0,0 +1,9 @@
+// this file was generated by better-cmake
+// allegrex-sweep v0.1.0
+
+#define allegrex_sweep_NAME "allegrex-sweep"
+#define allegrex_sweep_AUTHOR "DaemonTsun"
+#define allegrex_sweep_VERSION "0.1.0"
+#define allegrex_sweep_VERSION_MAJOR 0
+#define allegrex_sweep_VERSION_MINOR 1
+#define allegrex_sweep_VERSION_PATCH 0
@@ -0,0 +1,527 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+
+#include "shl/array.hpp"
+#include "shl/file_stream.hpp"
+#include "shl/number_types.hpp"
+#include "shl/string.hpp"
+#include "shl/print.hpp"
+#include "shl/error.hpp"
+#include "shl/defer.hpp"
+
+#include "allegrex/parse_instructions.hpp"
+#include "allegrex/worker_pool.hpp"
+
+#include "sweep/config.hpp"
+
+/*
+Decodes every opcode (or a range of them) with parse_instruction and hashes
+the mnemonic, argument types and argument values of each instruction, so two
+decoders can be compared without storing any output.
+
+The opcodes are split into chunks of 2^CHUNK_BITS opcodes which the threads
+take one at a time. Every chunk has a digest of its instructions in order, and
+the digest of the sweep is the digest of the chunk digests in order, so it is
+the same regardless of the number of threads. If two sweeps differ, the chunk
+digests written by --digests show where.
+*/
+
+#define CHUNK_BITS 20
+#define CHUNK_SIZE (1u << CHUNK_BITS)
+#define CHUNK_COUNT (1u << (32 - CHUNK_BITS))
+#define CHUNKS_PER_PRIMARY (CHUNK_COUNT / 64)
+#define MAX_SWEEP_THREADS 256
+
+// the constants of XXH64
+#define HASH_PRIME1 0x9e3779b185ebca87ull
+#define HASH_PRIME2 0xc2b2ae3d27d4eb4full
+#define HASH_PRIME3 0x165667b19e3779f9ull
+#define HASH_PRIME4 0x85ebca77c2b2ae63ull
+
+struct arguments
+{
+    u32 thread_count; // -j, --jobs
+    u32 first_opcode; // -r, --range
+    u32 last_opcode;  // -r, --range
+    bool emit_pseudo; // -p, --pseudo
+    const_string digests_file; // --digests
+};
+
+const arguments default_arguments{
+    .thread_count = 0,
+    .first_opcode = 0x00000000,
+    .last_opcode = 0xffffffff,
+    .emit_pseudo = false,
+    .digests_file = ""_cs
+};
+
+struct chunk_result
+{
+    u64 digest;
+    u32 opcode_count;
+    u32 unknown_count;
+    u64 nanoseconds;
+};
+
+struct thread_result
+{
+    u64 opcode_count;
+    u64 nanoseconds;
+};
+
+#define PRIMARY(X) (1ull << (X))
+#define PRIMARY_RANGE(FIRST, LAST) (((2ull << (LAST)) - 1) & ~(PRIMARY(FIRST) - 1))
+
+// groups of primary opcodes (the upper 6 bits), the same as in allegrex-bench
+static const struct
+{
+    const char *name;
+    u64 primaries; // bit n is set if primary opcode n is part of the group
+} _opcode_categories[] = {
+    { "special",         PRIMARY(0x00) },
+    { "regimm",          PRIMARY(0x01) },
+    { "jump/branch",     PRIMARY_RANGE(0x02, 0x07) | PRIMARY_RANGE(0x14, 0x17) },
+    { "immediate",       PRIMARY_RANGE(0x08, 0x0f) },
+    { "cop0",            PRIMARY(0x10) },
+    { "cop1",            PRIMARY(0x11) | PRIMARY(0x31) | PRIMARY(0x39) },
+    { "cop2",            PRIMARY(0x12) },
+    { "special2/3",      PRIMARY(0x1c) | PRIMARY(0x1f) },
+    { "load/store",      PRIMARY_RANGE(0x20, 0x2f) | PRIMARY(0x30) | PRIMARY(0x38) },
+    { "vfpu",            PRIMARY(0x18) | PRIMARY(0x19) | PRIMARY(0x1b) | PRIMARY(0x34) | PRIMARY(0x37) | PRIMARY(0x3c) | PRIMARY(0x3f) },
+    { "vfpu load/store", PRIMARY(0x32) | PRIMARY(0x35) | PRIMARY(0x36) | PRIMARY(0x3a) | PRIMARY(0x3d) | PRIMARY(0x3e) }
+};
+
+#define OPCODE_CATEGORY_COUNT (sizeof(_opcode_categories) / sizeof(_opcode_categories[0]))
+
+static void _print_usage()
+{
+    puts("Usage: " allegrex_sweep_NAME " [-h] [-j JOBS] [-r FIRST-LAST] [-p] [--digests FILE]\n"
+         "\n"
+         allegrex_sweep_NAME " v" allegrex_sweep_VERSION ": decodes every Allegrex opcode and prints a digest of the results\n"
+         "by " allegrex_sweep_AUTHOR "\n"
+         "\n"
+         "Optional arguments:\n"
+         "  -h, --help                  show this help and exit\n"
+         "  -j JOBS, --jobs JOBS        number of threads (default: number of CPUs)\n"
+         "  -r FIRST-LAST, --range FIRST-LAST\n"
+         "                              only decode the opcodes from FIRST to LAST, inclusive\n"
+         "                              (default: 0x00000000-0xffffffff)\n"
+         "  -p, --pseudo                decode pseudoinstructions\n"
+         "  --digests FILE              write the digest of every chunk of 2^20 opcodes to FILE\n"
+         );
+}
+
+static inline u64 _rotl(u64 x, u32 r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline u64 _hash(u64 h, u64 value)
+{
+    h ^= _rotl(value * HASH_PRIME2, 31) * HASH_PRIME1;
+    return _rotl(h, 27) * HASH_PRIME1 + HASH_PRIME4;
+}
+
+static inline u64 _hash_avalanche(u64 h)
+{
+    h ^= h >> 33;
+    h *= HASH_PRIME2;
+    h ^= h >> 29;
+    h *= HASH_PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+static u64 _hash_string(u64 h, const char *str)
+{
+    if (str == nullptr)
+        return _hash(h, 0);
+
+    u64 length = strlen(str);
+
+    for (u64 i = 0; i < length; ++i)
+        h = _hash(h, (u8)str[i]);
+
+    return _hash(h, length);
+}
+
+// only the value of the type is hashed, not the rest of the union
+static u64 _hash_argument(u64 h, argument_type type, const instruction_argument *arg)
+{
+    h = _hash(h, (u64)type);
+
+    switch (type)
+    {
+    case argument_type::Invalid:
+        return _hash_string(h, arg->invalid_argument.data);
+    case argument_type::MIPS_Register:
+        return _hash(h, (u64)arg->mips_register);
+    case argument_type::MIPS_FPU_Register:
+        return _hash(h, (u64)arg->mips_fpu_register);
+    case argument_type::VFPU_Register:
+        return _hash(h, arg->vfpu_register.num | ((u64)arg->vfpu_register.size << 8));
+    case argument_type::VFPU_Matrix:
+        return _hash(h, arg->vfpu_matrix.num | ((u64)arg->vfpu_matrix.size << 8));
+    case argument_type::VFPU_Condition:
+        return _hash(h, (u64)arg->vfpu_condition);
+    case argument_type::VFPU_Constant:
+        return _hash(h, (u64)arg->vfpu_constant);
+    case argument_type::VFPU_Prefix_Array:
+    {
+        const vfpu_prefix *p = arg->vfpu_prefix_array.data;
+        return _hash(h, (u64)p[0] | ((u64)p[1] << 8) | ((u64)p[2] << 16) | ((u64)p[3] << 24));
+    }
+    case argument_type::VFPU_Destination_Prefix_Array:
+    {
+        const vfpu_destination_prefix *p = arg->vfpu_destination_prefix_array.data;
+        return _hash(h, (u64)p[0] | ((u64)p[1] << 8) | ((u64)p[2] << 16) | ((u64)p[3] << 24));
+    }
+    case argument_type::VFPU_Rotation_Array:
+    {
+        const vfpu_rotation *r = arg->vfpu_rotation_array.data;
+        h = _hash(h, (u64)r[0] | ((u64)r[1] << 8) | ((u64)r[2] << 16) | ((u64)r[3] << 24));
+        return _hash(h, arg->vfpu_rotation_array.size);
+    }
+    case argument_type::PSP_Function_Pointer:
+    {
+        const psp_function *f = arg->psp_function_pointer;
+
+        if (f == nullptr)
+            return _hash(h, 0);
+
+        h = _hash(h, f->nid);
+        return _hash_string(h, f->name);
+    }
+    case argument_type::Shift:
+        return _hash(h, arg->shift.data);
+    case argument_type::Coprocessor_Register:
+        return _hash(h, arg->coprocessor_register.rd | ((u64)arg->coprocessor_register.sel << 8));
+    case argument_type::Base_Register:
+        return _hash(h, (u64)arg->base_register.data);
+    case argument_type::Jump_Address:
+        return _hash(h, arg->jump_address.data);
+    case argument_type::Branch_Address:
+        return _hash(h, arg->branch_address.data);
+    case argument_type::Memory_Offset:
+        return _hash(h, (u64)(s64)arg->memory_offset.data);
+    case argument_type::Immediate_u32:
+        return _hash(h, arg->immediate_u32.data);
+    case argument_type::Immediate_s32:
+        return _hash(h, (u64)(s64)arg->immediate_s32.data);
+    case argument_type::Immediate_u16:
+        return _hash(h, arg->immediate_u16.data);
+    case argument_type::Immediate_s16:
+        return _hash(h, (u64)(s64)arg->immediate_s16.data);
+    case argument_type::Immediate_u8:
+        return _hash(h, arg->immediate_u8.data);
+    case argument_type::Immediate_float:
+    {
+        u32 bits;
+        memcpy(&bits, &arg->immediate_float.data, sizeof(bits));
+        return _hash(h, bits);
+    }
+    case argument_type::Condition_Code:
+        return _hash(h, arg->condition_code.data);
+    case argument_type::Bitfield_Pos:
+        return _hash(h, arg->bitfield_pos.data);
+    case argument_type::Bitfield_Size:
+        return _hash(h, arg->bitfield_size.data);
+    case argument_type::Extra:
+        return _hash(h, arg->extra.data);
+    case argument_type::String:
+        return _hash_string(h, arg->string_argument.data);
+    default:
+        return h;
+    }
+}
+
+// decodes opcodes first to last of the chunk, every instruction at address 0
+static void _sweep_chunk(u32 first, u32 last, const parse_instructions_config *conf, chunk_result *out)
+{
+    u64 h = HASH_PRIME4;
+    u32 unknown = 0;
+    instruction inst;
+    u32 opcode = first;
+
+    while (true)
+    {
+        inst = {};
+        inst.opcode = opcode;
+
+        parse_instruction(opcode, &inst, nullptr, conf);
+
+        h = _hash(h, opcode);
+        h = _hash(h, (u64)inst.mnemonic | ((u64)inst.argument_count << 32));
+
+        if (inst.mnemonic == allegrex_mnemonic::_UNKNOWN)
+            unknown += 1;
+
+        for (u32 i = 0; i < inst.argument_count; ++i)
+            h = _hash_argument(h, inst.argument_types[i], inst.arguments + i);
+
+        if (opcode == last)
+            break;
+
+        opcode += 1;
+    }
+
+    out->digest = _hash_avalanche(h);
+    out->opcode_count = last - first + 1;
+    out->unknown_count = unknown;
+}
+
+static u64 _now_ns()
+{
+    return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool _parse_opcode_range(const char *arg, arguments *out, error *err)
+{
+    const char *minus = strchr(arg, '-');
+
+    if (minus == nullptr)
+    {
+        format_error(err, 1, "range expects FIRST-LAST, got '%s'", arg);
+        return false;
+    }
+
+    out->first_opcode = string_to_u32(arg, nullptr, 0);
+    out->last_opcode = string_to_u32(minus + 1, nullptr, 0);
+
+    if (out->last_opcode < out->first_opcode)
+    {
+        format_error(err, 1, "first opcode %08x is larger than last opcode %08x", out->first_opcode, out->last_opcode);
+        return false;
+    }
+
+    return true;
+}
+
+static bool _parse_arguments(int argc, const char **argv, arguments *out, error *err)
+{
+    for (int i = 1; i < argc;)
+    {
+        const_string arg = to_const_string(argv[i]);
+
+        if (arg == "-h"_cs || arg == "--help"_cs)
+        {
+            _print_usage();
+            exit(0);
+        }
+
+        if (arg == "-j"_cs || arg == "--jobs"_cs)
+        {
+            if (i >= argc - 1)
+            {
+                format_error(err, 1, "%s expects a positional argument: the number of jobs", arg.c_str);
+                return false;
+            }
+
+            out->thread_count = string_to_u32(argv[i + 1], nullptr, 0);
+            i += 2;
+            continue;
+        }
+
+        if (arg == "-r"_cs || arg == "--range"_cs)
+        {
+            if (i >= argc - 1)
+            {
+                format_error(err, 1, "%s expects a positional argument: the range of opcodes", arg.c_str);
+                return false;
+            }
+
+            if (!_parse_opcode_range(argv[i + 1], out, err))
+                return false;
+
+            i += 2;
+            continue;
+        }
+
+        if (arg == "-p"_cs || arg == "--pseudo"_cs)
+        {
+            out->emit_pseudo = true;
+            i += 1;
+            continue;
+        }
+
+        if (arg == "--digests"_cs)
+        {
+            if (i >= argc - 1)
+            {
+                format_error(err, 1, "%s expects a positional argument: the output file", arg.c_str);
+                return false;
+            }
+
+            out->digests_file = to_const_string(argv[i + 1]);
+            i += 2;
+            continue;
+        }
+
+        format_error(err, 1, "unknown argument '%s'", arg.c_str);
+        return false;
+    }
+
+    return true;
+}
+
+static bool _write_digests(const char *path, const arguments *args, const chunk_result *chunks, error *err)
+{
+    file_stream out{};
+
+    if (!init(&out, path, open_mode::WriteTrunc, err))
+        return false;
+
+    defer { free(&out); };
+
+    tprint(out.handle, "# chunk first_opcode digest unknown_opcodes\n");
+
+    for (u32 c = args->first_opcode >> CHUNK_BITS; c <= args->last_opcode >> CHUNK_BITS; ++c)
+        tprint(out.handle, "%03x %08x %016llx %u\n", c, Max(c << CHUNK_BITS, args->first_opcode),
+               (unsigned long long)chunks[c].digest, chunks[c].unknown_count);
+
+    return true;
+}
+
+static void _print_results(const arguments *args, const chunk_result *chunks, const thread_result *threads, u32 thread_count, u64 digest, double wall_seconds)
+{
+    u64 opcode_count = (u64)args->last_opcode - args->first_opcode + 1;
+
+    tprint("%llu opcodes (%08x-%08x), %u thread%s, pseudoinstructions %s\n",
+           (unsigned long long)opcode_count, args->first_opcode, args->last_opcode,
+           thread_count, thread_count == 1 ? "" : "s", args->emit_pseudo ? "on" : "off");
+
+    tprint("digest %016llx\n\n", (unsigned long long)digest);
+
+    // time is the time of a single thread, throughput is per core
+    tprint("%-16s %12s %12s %10s %10s\n", "category", "opcodes", "unknown", "time", "Minst/s");
+
+    u64 other_primaries = max_value(u64);
+
+    for (u32 g = 0; g < OPCODE_CATEGORY_COUNT; ++g)
+        other_primaries &= ~_opcode_categories[g].primaries;
+
+    // the last row are the primary opcodes of no category
+    for (u32 g = 0; g <= OPCODE_CATEGORY_COUNT; ++g)
+    {
+        bool other = g == OPCODE_CATEGORY_COUNT;
+        u64 primaries = other ? other_primaries : _opcode_categories[g].primaries;
+        u64 count = 0;
+        u64 unknown = 0;
+        u64 ns = 0;
+
+        for (u32 c = args->first_opcode >> CHUNK_BITS; c <= args->last_opcode >> CHUNK_BITS; ++c)
+        {
+            if (!(primaries & PRIMARY(c / CHUNKS_PER_PRIMARY)))
+                continue;
+
+            count += chunks[c].opcode_count;
+            unknown += chunks[c].unknown_count;
+            ns += chunks[c].nanoseconds;
+        }
+
+        if (count == 0)
+            continue;
+
+        double seconds = (double)ns / 1e9;
+        tprint("%-16s %12llu %12llu %9.3fs %10.1f\n", other ? "other" : _opcode_categories[g].name,
+               (unsigned long long)count, (unsigned long long)unknown, seconds,
+               seconds > 0 ? (double)count / 1e6 / seconds : 0.0);
+    }
+
+    tprint("\n");
+
+    for (u32 t = 0; t < thread_count; ++t)
+    {
+        double seconds = (double)threads[t].nanoseconds / 1e9;
+        tprint("thread %-3u %12llu opcodes in %9.3fs, %7.1f Minst/s\n", t + 1,
+               (unsigned long long)threads[t].opcode_count, seconds,
+               seconds > 0 ? (double)threads[t].opcode_count / 1e6 / seconds : 0.0);
+    }
+
+    tprint("total      %12llu opcodes in %9.3fs, %7.1f Minst/s\n",
+           (unsigned long long)opcode_count, wall_seconds,
+           wall_seconds > 0 ? (double)opcode_count / 1e6 / wall_seconds : 0.0);
+}
+
+int main(int argc, const char **argv)
+{
+    arguments args = default_arguments;
+    error err{};
+
+    if (!_parse_arguments(argc, argv, &args, &err))
+    {
+        tprint("Error: %\n", err.what);
+        return err.error_code;
+    }
+
+    parse_instructions_config conf{};
+    conf.vaddr = 0;
+    conf.log = nullptr;
+    conf.verbose = false;
+    conf.emit_pseudo = args.emit_pseudo;
+
+    array<chunk_result> chunks;
+    ::init(&chunks);
+    ::resize(&chunks, CHUNK_COUNT);
+    defer { ::free(&chunks); };
+    fill_memory(chunks.data, 0, chunks.size * sizeof(chunk_result));
+
+    u32 first_chunk = args.first_opcode >> CHUNK_BITS;
+    u32 last_chunk = args.last_opcode >> CHUNK_BITS;
+
+    u32 thread_count = get_worker_count(args.thread_count, (u64)(last_chunk - first_chunk) + 1, MAX_SWEEP_THREADS);
+    thread_result threads[MAX_SWEEP_THREADS]{};
+
+    std::atomic<u32> next_chunk = first_chunk;
+
+    auto work = [&](u32 worker)
+    {
+        thread_result *result = threads + worker;
+
+        while (true)
+        {
+            u32 c = next_chunk.fetch_add(1);
+
+            if (c > last_chunk)
+                break;
+
+            u32 first = Max(c << CHUNK_BITS, args.first_opcode);
+            u32 last = Min((c << CHUNK_BITS) + (CHUNK_SIZE - 1), args.last_opcode);
+
+            u64 start = _now_ns();
+            _sweep_chunk(first, last, &conf, chunks.data + c);
+            chunks[c].nanoseconds = _now_ns() - start;
+
+            result->opcode_count += chunks[c].opcode_count;
+            result->nanoseconds += chunks[c].nanoseconds;
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+
+    run_workers(thread_count, work);
+
+    double wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // digest of the chunk digests in order, and of the settings
+    u64 digest = _hash(HASH_PRIME4, args.emit_pseudo ? 1 : 0);
+
+    for (u32 c = first_chunk; c <= last_chunk; ++c)
+        digest = _hash(digest, chunks[c].digest);
+
+    digest = _hash_avalanche(digest);
+
+    _print_results(&args, chunks.data, threads, thread_count, digest, wall_seconds);
+
+    if (!string_is_blank(args.digests_file)
+     && !_write_digests(args.digests_file.c_str, &args, chunks.data, &err))
+    {
+        tprint("Error: %\n", err.what);
+        return err.error_code;
+    }
+
+    return 0;
+}
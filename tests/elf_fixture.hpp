@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+
+#include "shl/array.hpp"
+#include "shl/memory.hpp"
+#include "allegrex/elf.hpp"
+
+/* ELF fixtures
+
+make_test_elf builds a little-endian MIPS ELF with one executable section per
+test_elf_section, named .text.0, .text.1 and so on, so tests can disassemble
+modules without game files. A section without code is empty.
+There are no program headers, symbols, relocations or PRX sections.
+
+Header only, since every test is a program of a single source file.
+*/
+
+struct test_elf_section
+{
+    u32 vaddr;
+    const u32 *code;
+    u32 size; // in bytes
+};
+
+// appends size bytes of data aligned to 16 bytes, returns their offset
+inline u32 _add_test_elf_data(array<char> *out, const void *data, u64 size)
+{
+    u64 end = out->size;
+    u64 offset = (end + 15) & ~(u64)15;
+    ::resize(out, offset + size);
+    fill_memory(out->data + end, 0, offset - end);
+
+    if (size > 0)
+        copy_memory(data, out->data + offset, size);
+
+    return (u32)offset;
+}
+
+inline void make_test_elf(const test_elf_section *sections, u32 section_count, array<char> *out)
+{
+    ::clear(out);
+
+    Elf32_Ehdr ehdr{};
+    _add_test_elf_data(out, &ehdr, sizeof(ehdr));
+
+    // null section, .shstrtab, then the text sections
+    array<Elf32_Shdr> headers{};
+    ::init(&headers);
+    ::resize(&headers, section_count + 2);
+    fill_memory(headers.data, 0, headers.size * sizeof(Elf32_Shdr));
+
+    // starts with the empty name of the null section
+    array<char> names{};
+    ::init(&names);
+    ::resize(&names, 1);
+    names.data[0] = '\0';
+
+    for (u32 i = 0; i < section_count; ++i)
+    {
+        char name[32];
+        int name_size = snprintf(name, sizeof(name), ".text.%u", i);
+
+        Elf32_Shdr *sec = headers.data + i + 2;
+        sec->sh_name = (u32)names.size;
+        sec->sh_type = SHT_PROGBITS;
+        sec->sh_flags = SHF_ALLOC | SHF_EXECINSTR;
+        sec->sh_addr = sections[i].vaddr;
+        sec->sh_offset = _add_test_elf_data(out, sections[i].code, sections[i].size);
+        sec->sh_size = sections[i].size;
+        sec->sh_addralign = 16;
+
+        u64 offset = names.size;
+        ::resize(&names, offset + name_size + 1);
+        copy_memory(name, names.data + offset, name_size + 1);
+    }
+
+    Elf32_Shdr *shstrtab = headers.data + 1;
+    shstrtab->sh_name = (u32)names.size;
+    u64 offset = names.size;
+    ::resize(&names, offset + sizeof(".shstrtab"));
+    copy_memory(".shstrtab", names.data + offset, sizeof(".shstrtab"));
+
+    shstrtab->sh_type = SHT_STRTAB;
+    shstrtab->sh_offset = _add_test_elf_data(out, names.data, names.size);
+    shstrtab->sh_size = (u32)names.size;
+    shstrtab->sh_addralign = 1;
+
+    Elf32_Ehdr *hdr = (Elf32_Ehdr*)out->data;
+    copy_memory("\x7f" "ELF", hdr->e_ident, 4);
+    hdr->e_ident[EI_CLASS] = ELFCLASS32;
+    hdr->e_ident[EI_DATA] = ELFDATA2LSB;
+    hdr->e_ident[EI_VERSION] = EV_CURRENT;
+    hdr->e_type = ET_EXEC;
+    hdr->e_machine = EM_MIPS;
+    hdr->e_version = EV_CURRENT;
+    hdr->e_ehsize = sizeof(Elf32_Ehdr);
+    hdr->e_shentsize = sizeof(Elf32_Shdr);
+    hdr->e_shnum = (u16)headers.size;
+    hdr->e_shstrndx = 1;
+
+    u32 shoff = _add_test_elf_data(out, headers.data, headers.size * sizeof(Elf32_Shdr));
+    ((Elf32_Ehdr*)out->data)->e_shoff = shoff;
+
+    ::free(&names);
+    ::free(&headers);
+}
@@ -0,0 +1,228 @@
+
+#pragma once
+
+#include <array>
+#include <string.h>
+#include <vector>
+
+extern "C"
+{
+#include "libkirk/kirk_engine.h"
+#include "libkirk/SHA1.h"
+}
+
+// defined by kirk_engine.h, hides array_size of shl
+#undef array_size
+
+#include "allegrex/internal/prx_keys.hpp"
+#include "allegrex/prx_decrypt.hpp"
+
+/* Encrypted PRX fixtures
+
+pspEncryptPRX encrypts the ELF in elfbuf as a PRX of the given type with the
+key of tag, so tests and benchmarks can decrypt modules without needing
+encrypted firmware or game files. This is the inverse of pspDecryptPRX and
+not part of liballegrex. Type 6 is not supported since it is signed with ECDSA.
+
+outbuf must be at least prx_encrypted_size(elf_size) bytes, returns the size of
+the PRX or a negative value if the tag has no key for type.
+If elfbuf is a gzip compressed ELF, pass the size of the ELF as
+decompressed_size to mark the PRX as compressed.
+
+Header only, since every test is a program of a single source file.
+*/
+
+inline u32 prx_encrypted_size(u32 elf_size)
+{
+    return sizeof(PSP_Header) + ((elf_size + 15) & ~15u);
+}
+
+// same as expandSeed of prx_decrypt.cpp
+inline std::array<u8, 0x90> _prx_fixture_expand_seed(const u8 *seed, int key)
+{
+    std::array<u8, 0x90> ret;
+
+    for (u32 i = 0; i < ret.size(); i += 0x10)
+    {
+        memcpy(ret.data() + i, seed, 0x10);
+        ret[i] = (u8)(i / 0x10);
+    }
+
+    kirk7(ret.data(), ret.data(), ret.size(), key);
+
+    return ret;
+}
+
+// the inverse of pspDecryptType0 and pspDecryptType1
+inline void _prx_fixture_encrypt_type01(u8 *prx, const u8 *kirk_header, const prx_tag_keys *keys, bool type1)
+{
+    std::array<u8, 0x90> xorbuf;
+    memcpy(xorbuf.data(), keys->key, xorbuf.size());
+
+    // decryptKirkHeaderType0 in reverse, the rest of the kirk header is not encrypted
+    u8 kirk_block[0x90];
+
+    for (int i = 0; i < 0x70; ++i)
+        kirk_block[i] = kirk_header[i] ^ xorbuf[i + 0x20];
+
+    kirk4(kirk_block, kirk_block, 0x70, keys->code);
+
+    for (int i = 0; i < 0x70; ++i)
+        kirk_block[i] ^= xorbuf[i + 0x14];
+
+    memcpy(kirk_block + 0x70, kirk_header + 0x70, 0x20);
+
+    // sha1, unused and kirk block in the order of PRXType0
+    u8 data[0x14 + 0x28 + 0x90] = {};
+    memcpy(data + 0x3C, kirk_block, sizeof(kirk_block));
+
+    SHA_CTX ctx;
+    SHAInit(&ctx);
+    SHAUpdate(&ctx, xorbuf.data(), 0x14);
+    SHAUpdate(&ctx, data + 0x14, 0x28);
+    SHAUpdate(&ctx, kirk_block, sizeof(kirk_block));
+    SHAUpdate(&ctx, prx, 0x80);
+    SHAFinal(data, &ctx);
+
+    if (type1)
+        kirk4(data + 0xC, data + 0xC, 0xA0, keys->code);
+
+    memcpy(prx + 0xD4, data, 0x14 + 0x28);
+    memcpy(prx + 0x110, data + 0x3C, 0x40);
+    memcpy(prx + 0x80, data + 0x7C, 0x50);
+}
+
+// the inverse of pspDecryptType2 and pspDecryptType5 without a seed from the caller
+inline void _prx_fixture_encrypt_type25(u8 *prx, const u8 *kirk_header, const prx_tag_keys *keys, bool type5)
+{
+    const u8 *xor1 = type5 ? keys->seed2 : nullptr;
+    std::array<u8, 0x90> xorbuf = _prx_fixture_expand_seed(keys->key2, keys->code2);
+
+    // id, sha1 and kirk header in the order of PRXType2
+    u8 data[0x10 + 0x14 + 0x40];
+    u8 *id = data;
+    u8 *sha1 = data + 0x10;
+    u8 *header = data + 0x24;
+
+    for (int i = 0; i < 0x10; ++i)
+        id[i] = (u8)(i * 0x11);
+
+    // decryptKirkHeader in reverse
+    for (int i = 0; i < 0x40; ++i)
+        header[i] = kirk_header[i] ^ xorbuf[i + 0x50];
+
+    kirk4(header, header, 0x40, keys->code2);
+
+    for (int i = 0; i < 0x40; ++i)
+        header[i] ^= xorbuf[i + 0x10];
+
+    u8 empty[0x58] = {};
+    u8 kirk_metadata[0x10];
+    memcpy(kirk_metadata, kirk_header + 0x70, sizeof(kirk_metadata));
+
+    SHA_CTX ctx;
+    SHAInit(&ctx);
+    SHAUpdate(&ctx, prx + 0xD0, 4);
+    SHAUpdate(&ctx, xorbuf.data(), 0x10);
+    SHAUpdate(&ctx, empty, sizeof(empty));
+    SHAUpdate(&ctx, id, 0x10);
+    SHAUpdate(&ctx, header, 0x40);
+    SHAUpdate(&ctx, kirk_metadata, sizeof(kirk_metadata));
+    SHAUpdate(&ctx, prx, 0x80);
+    SHAFinal(sha1, &ctx);
+
+    kirk4(id, id, 0x60, keys->code2);
+
+    if (type5)
+    {
+        // PRXType5::decrypt in reverse
+        if (xor1)
+            for (int i = 0; i < 0x60; ++i)
+                id[i] ^= xor1[i % 0x10];
+
+        u8 first[0x50];
+        memcpy(first, header, 0x40);
+        memcpy(first + 0x40, sha1, 0x10);
+
+        kirk4(first, first, sizeof(first), keys->code2);
+
+        if (xor1)
+            for (int i = 0; i < 0x50; ++i)
+                first[i] ^= xor1[i % 0x10];
+
+        memcpy(header, first, 0x40);
+        memcpy(sha1, first + 0x40, 0x10);
+    }
+
+    memcpy(prx + 0x140, id, 0x10);
+    memcpy(prx + 0x12C, sha1, 0x14);
+    memcpy(prx + 0x80, header, 0x30);
+    memcpy(prx + 0xC0, header + 0x30, 0x10);
+    memcpy(prx + 0xB0, kirk_metadata, sizeof(kirk_metadata));
+}
+
+inline int pspEncryptPRX(const u8 *elfbuf, u32 elf_size, u8 *outbuf, u32 tag, prx_type type, u32 decompressed_size = 0)
+{
+    prx_tag_keys keys;
+
+    if (!get_prx_tag_keys(tag, &keys) || type == prx_type::Type6)
+        return -1;
+
+    // any type the tag has a key for, not only the types the tag index tries first,
+    // so modules with an unexpected type can be built as well
+    bool type01 = type == prx_type::Type0 || type == prx_type::Type1;
+
+    if ((type01 && keys.key == nullptr) || (!type01 && keys.key2 == nullptr))
+        return -1;
+
+    kirk_init();
+
+    const u32 psp_size = prx_encrypted_size(elf_size);
+
+    PSP_Header psp_header{};
+    psp_header.signature = 0x5053507E; // ~PSP
+    psp_header.comp_attribute = decompressed_size != 0 ? 1 : 0;
+    psp_header.elf_size = decompressed_size != 0 ? decompressed_size : elf_size;
+    psp_header.psp_size = psp_size;
+    psp_header.comp_size = (s32)elf_size;
+    psp_header._80 = 0x80;
+    psp_header.tag = tag;
+    u8 *prx = reinterpret_cast<u8 *>(&psp_header);
+
+    // the kirk block that pspDecryptType* rebuild in front of the encrypted ELF,
+    // with the first 0x80 bytes of the PSP header as unencrypted data
+    constexpr u32 offset = sizeof(PSP_Header) - sizeof(KIRK_CMD1_HEADER) - 0x80;
+    std::vector<u8> plain(psp_size - offset);
+    KIRK_CMD1_HEADER *header = reinterpret_cast<KIRK_CMD1_HEADER *>(plain.data());
+
+    for (int i = 0; i < 0x10; ++i)
+    {
+        header->AES_key[i] = (u8)(tag >> (i % 4 * 8)) ^ (u8)i;
+        header->CMAC_key[i] = (u8)(tag >> (i % 4 * 8)) ^ (u8)(0xF0 - i);
+    }
+
+    header->mode = KIRK_MODE_CMD1;
+    header->data_size = elf_size;
+    header->data_offset = 0x80;
+    memcpy(plain.data() + sizeof(KIRK_CMD1_HEADER), prx, 0x80);
+    memcpy(plain.data() + sizeof(KIRK_CMD1_HEADER) + 0x80, elfbuf, elf_size);
+
+    if (kirk_CMD0(outbuf + offset, plain.data(), (int)plain.size(), 0) != KIRK_OPERATION_SUCCESS)
+        return -4;
+
+    u8 kirk_header[sizeof(KIRK_CMD1_HEADER)];
+    memcpy(kirk_header, outbuf + offset, sizeof(kirk_header));
+
+    switch (type)
+    {
+    case prx_type::Type0: _prx_fixture_encrypt_type01(prx, kirk_header, &keys, false); break;
+    case prx_type::Type1: _prx_fixture_encrypt_type01(prx, kirk_header, &keys, true); break;
+    case prx_type::Type2: _prx_fixture_encrypt_type25(prx, kirk_header, &keys, false); break;
+    case prx_type::Type5: _prx_fixture_encrypt_type25(prx, kirk_header, &keys, true); break;
+    default: return -1;
+    }
+
+    memcpy(outbuf, prx, sizeof(PSP_Header));
+
+    return (int)psp_size;
+}
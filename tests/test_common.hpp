@@ -4,6 +4,42 @@
 #include "shl/memory.hpp"
 #include "allegrex/parse_instructions.hpp"
 
+// seed of the pseudorandom numbers of all tests, so failures can be reproduced
+#define TEST_RANDOM_SEED 0x2545f491
+
+// xorshift32, returns the next number of state
+inline u32 test_random(u32 *state)
+{
+    u32 x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+
+    return x;
+}
+
+// fills out with the low bytes of the numbers of TEST_RANDOM_SEED
+inline void fill_test_random(void *out, u64 size)
+{
+    u32 state = TEST_RANDOM_SEED;
+
+    for (u64 i = 0; i < size; ++i)
+        ((u8*)out)[i] = (u8)test_random(&state);
+}
+
+// without log and verbose output
+inline parse_instructions_config test_parse_instructions_config(u32 vaddr, bool emit_pseudo)
+{
+    parse_instructions_config conf;
+    conf.vaddr = vaddr;
+    conf.log = nullptr;
+    conf.verbose = false;
+    conf.emit_pseudo = emit_pseudo;
+
+    return conf;
+}
+
 #define clear_instruction() \
     fill_memory(&inst, 0);\
     inst.mnemonic = allegrex_mnemonic::_UNKNOWN;\
@@ -11,10 +47,7 @@
 #define setup_test_variables() \
     instruction inst;\
     clear_instruction();\
-    parse_instructions_config conf;\
-    conf.vaddr = 0;\
-    conf.log = nullptr;\
-    conf.emit_pseudo = false;
+    parse_instructions_config conf = test_parse_instructions_config(0, false);
 
 #define emit_pseudoinstructions()\
     conf.emit_pseudo = true;
@@ -0,0 +1,116 @@
+
+#include <string.h>
+
+#include <t1/t1.hpp>
+#include "tests/test_common.hpp"
+
+#include "allegrex/compact_instructions.hpp"
+
+static const u32 _opcodes_0[] = {
+    0x27bdffd0, // addiu sp, sp, -0x30
+    0x00a06821, // move t5, a1 (addu)
+    0x30a30003, // andi v1, a1, 0x3
+    0x10400004, // beqz v0, +4
+    0x0c200010, // jal
+    0x00000000, // nop
+};
+
+static const u32 _opcodes_1[] = {
+    0x00000840, // sll at, zero, 1
+    0x08000040, // j
+    0xd0060000, // vfpu
+    0xffffffff, // unknown
+};
+
+#define setup_compact_test_variables(EMIT_PSEUDO) \
+    parse_instructions_config conf = test_parse_instructions_config(0, EMIT_PSEUDO);\
+    array<instruction> instructions;\
+    ::init(&instructions);\
+    compact_instructions compact;\
+    init(&compact);\
+    defer { ::free(&instructions); free(&compact); };\
+    conf.vaddr = 0x08804000;\
+    parse_instructions((const char*)_opcodes_0, sizeof(_opcodes_0), &instructions, nullptr, &conf);\
+    parse_instructions((const char*)_opcodes_0, sizeof(_opcodes_0), &compact, nullptr, &conf);\
+    conf.vaddr = 0x08900000;\
+    parse_instructions((const char*)_opcodes_1, sizeof(_opcodes_1), &instructions, nullptr, &conf);\
+    parse_instructions((const char*)_opcodes_1, sizeof(_opcodes_1), &compact, nullptr, &conf);
+
+#define assert_same_instruction(A, B) \
+    assert_equal((A)->address, (B)->address);\
+    assert_equal((A)->opcode, (B)->opcode);\
+    assert_equal((A)->mnemonic, (B)->mnemonic);\
+    assert_equal((A)->argument_count, (B)->argument_count);\
+    assert_equal(memcmp((A), (B), sizeof(instruction)), 0);
+
+define_test(compact_instructions_size)
+{
+    setup_compact_test_variables(false);
+
+    assert_equal(compact.opcodes.size, instructions.size);
+    assert_equal(compact.mnemonics.size, instructions.size);
+    assert_equal(compact.ranges.size, (u64)2);
+    assert_less(get_memory_size(&compact), instructions.size * sizeof(instruction));
+}
+
+define_test(compact_instructions_get_instruction)
+{
+    setup_compact_test_variables(true);
+
+    instruction inst;
+
+    for_array(i, expected, &instructions)
+    {
+        assert_equal(get_instruction_address(&compact, i), expected->address);
+
+        get_instruction(&compact, i, &inst);
+        assert_same_instruction(&inst, expected);
+    }
+}
+
+define_test(compact_instructions_iterate_all)
+{
+    setup_compact_test_variables(true);
+
+    compact_instruction_iterator it = iterate_instructions(&compact);
+    u64 i = 0;
+
+    while (next(&it))
+    {
+        assert_less(i, instructions.size);
+        assert_same_instruction(&it.current, instructions.data + i);
+        i += 1;
+    }
+
+    assert_equal(i, instructions.size);
+}
+
+define_test(compact_instructions_iterate_across_ranges)
+{
+    setup_compact_test_variables(false);
+
+    // starts in the first range, ends in the second
+    u64 start = 4;
+    u64 count = 4;
+
+    compact_instruction_iterator it = iterate_instructions(&compact, start, count);
+    u64 i = start;
+
+    while (next(&it))
+    {
+        assert_same_instruction(&it.current, instructions.data + i);
+        i += 1;
+    }
+
+    assert_equal(i, start + count);
+    assert_equal(it.current.address, 0x08900004u);
+
+    // empty and past the end
+    it = iterate_instructions(&compact, compact.opcodes.size);
+    assert_equal(next(&it), false);
+
+    it = iterate_instructions(&compact, 2, 0);
+    assert_equal(next(&it), false);
+}
+
+define_default_test_main();
@@ -0,0 +1,120 @@
+
+#include <string.h>
+#include <t1/t1.hpp>
+#include "tests/test_common.hpp"
+
+static void _random_opcodes(array<u32> *out, u32 count)
+{
+    // repeat a small set of opcodes, like code does, with some random ones in between
+    const u32 common[] = {
+        0x00000000, // nop
+        0x03e00008, // jr ra
+        0x27bdffd0, // addiu sp, sp, -0x30
+        0x00a06821, // addu / move
+        0x34020001, // ori / li
+        0x10400004, // beqz v0, +4
+        0x0c200010, // jal
+        0xffffffff, // unknown
+    };
+
+    u32 state = TEST_RANDOM_SEED;
+
+    for (u32 i = 0; i < count; ++i)
+    {
+        u32 x = test_random(&state);
+
+        if (x & 1)
+            ::add_at_end(out, common[(x >> 1) % (sizeof(common) / sizeof(common[0]))]);
+        else
+            ::add_at_end(out, x);
+    }
+}
+
+static void _assert_same_as_uncached(const array<u32> *opcodes, u32 vaddr, bool emit_pseudo, decode_cache *cache)
+{
+    parse_instructions_config conf = test_parse_instructions_config(vaddr, emit_pseudo);
+
+    array<instruction> expected_instructions;
+    array<jump_destination> expected_jumps;
+    array<instruction> instructions;
+    array<jump_destination> jumps;
+    ::init(&expected_instructions);
+    ::init(&expected_jumps);
+    ::init(&instructions);
+    ::init(&jumps);
+    defer { ::free(&expected_instructions); ::free(&expected_jumps); ::free(&instructions); ::free(&jumps); };
+
+    u64 size = opcodes->size * sizeof(u32);
+    parse_instructions((const char*)opcodes->data, size, &expected_instructions, &expected_jumps, &conf);
+    parse_instructions((const char*)opcodes->data, size, &instructions, &jumps, &conf, cache);
+
+    assert_equal(instructions.size, expected_instructions.size);
+    assert_equal(jumps.size, expected_jumps.size);
+
+    for (u64 i = 0; i < instructions.size; ++i)
+        assert_equal(memcmp(instructions.data + i, expected_instructions.data + i, sizeof(instruction)), 0);
+
+    for (u64 i = 0; i < jumps.size; ++i)
+    {
+        assert_equal(jumps.data[i].address, expected_jumps.data[i].address);
+        assert_equal(jumps.data[i].type == jump_type::Jump, expected_jumps.data[i].type == jump_type::Jump);
+    }
+}
+
+define_test(decode_cache_same_as_uncached)
+{
+    array<u32> opcodes;
+    ::init(&opcodes);
+    defer { ::free(&opcodes); };
+
+    _random_opcodes(&opcodes, 50000);
+
+    decode_cache cache;
+    ::init(&cache);
+    defer { ::free(&cache); };
+
+    // the cache is reused for other addresses and pseudoinstruction settings
+    _assert_same_as_uncached(&opcodes, 0x08804000, false, &cache);
+    _assert_same_as_uncached(&opcodes, 0x08900000, false, &cache);
+    _assert_same_as_uncached(&opcodes, 0x08804000, true, &cache);
+    _assert_same_as_uncached(&opcodes, 0x08a00000, true, &cache);
+    _assert_same_as_uncached(&opcodes, 0x08804000, false, &cache);
+
+    assert_greater(cache.hits, (u64)0);
+    assert_equal(cache.hits + cache.misses, (u64)(opcodes.size * 5));
+}
+
+define_test(decode_cache_pseudoinstructions)
+{
+    const u32 opcodes[] = {
+        0x00a06821, // move t5, a1 (addu)
+        0x00a06821,
+    };
+
+    parse_instructions_config conf = test_parse_instructions_config(0x08804000, false);
+
+    array<instruction> instructions;
+    ::init(&instructions);
+    defer { ::free(&instructions); };
+
+    decode_cache cache;
+    ::init(&cache);
+    defer { ::free(&cache); };
+
+    parse_instructions((const char*)opcodes, sizeof(opcodes), &instructions, nullptr, &conf, &cache);
+
+    assert_equal(instructions.data[1].mnemonic, allegrex_mnemonic::ADDU);
+    assert_equal(instructions.data[1].address, 0x08804004u);
+    assert_equal(cache.hits, (u64)1);
+
+    // cached addu must not be used when emitting pseudoinstructions
+    conf.emit_pseudo = true;
+    ::clear(&instructions);
+    parse_instructions((const char*)opcodes, sizeof(opcodes), &instructions, nullptr, &conf, &cache);
+
+    assert_equal(instructions.data[0].mnemonic, allegrex_mnemonic::MOVE);
+    assert_equal(instructions.data[1].mnemonic, allegrex_mnemonic::MOVE);
+    assert_equal(cache.hits, (u64)2);
+}
+
+define_default_test_main();
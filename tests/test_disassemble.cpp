@@ -0,0 +1,129 @@
+#include <string.h>
+#include <t1/t1.hpp>
+#include "tests/test_common.hpp"
+#include "tests/elf_fixture.hpp"
+#include "allegrex/disassemble.hpp"
+
+// random words, every fourth one a branch or jal so sections have many jumps
+static void _random_code(array<u32> *out, u32 count, u32 *state)
+{
+    const u32 jumps[] = {
+        0x10400040, // beqz v0, +0x40
+        0x1440ffc0, // bnez v0, -0x40
+        0x04110100, // bal +0x100
+        0x0e201000, // jal 0x08804000
+        0x0e202000, // jal 0x08808000
+        0x0e248000, // jal 0x08920000
+    };
+
+    for (u32 i = 0; i < count; ++i)
+    {
+        u32 x = test_random(state);
+
+        if ((x & 3) == 0)
+            ::add_at_end(out, jumps[(x >> 2) % (sizeof(jumps) / sizeof(jumps[0]))]);
+        else
+            ::add_at_end(out, x);
+    }
+}
+
+static void _disassemble(array<char> *elf, u32 thread_count, psp_disassembly *out)
+{
+    psp_disassembly_config conf{};
+    conf.thread_count = thread_count;
+
+    error err{};
+    assert_true(disassemble_psp_elf(elf->data, elf->size, out, &conf, &err));
+}
+
+define_test(disassembly_is_the_same_on_multiple_threads)
+{
+    // larger than DISASSEMBLY_CHUNK_SIZE and not a multiple of it, a small
+    // section right after it and another large one after a gap
+    const u32 sizes[] = {
+        2 * DISASSEMBLY_CHUNK_SIZE + 0x1234,
+        0x100,
+        DISASSEMBLY_CHUNK_SIZE + 4,
+    };
+
+    const u32 vaddrs[] = {
+        0x08804000,
+        0x08804000 + sizes[0],
+        0x08920000,
+    };
+
+    array<u32> code[3];
+    test_elf_section sections[3];
+    u32 state = TEST_RANDOM_SEED;
+
+    for (u32 i = 0; i < 3; ++i)
+    {
+        ::init(code + i);
+        _random_code(code + i, sizes[i] / sizeof(u32), &state);
+
+        sections[i].vaddr = vaddrs[i];
+        sections[i].code = code[i].data;
+        sections[i].size = sizes[i];
+    }
+
+    defer { for (u32 i = 0; i < 3; ++i) ::free(code + i); };
+
+    array<char> elf{};
+    ::init(&elf);
+    defer { ::free(&elf); };
+
+    make_test_elf(sections, 3, &elf);
+
+    psp_disassembly expected;
+    init(&expected);
+    defer { free(&expected); };
+
+    _disassemble(&elf, 1, &expected);
+
+    assert_equal(expected.disassembly_sections.size, (u64)3);
+    assert_equal(expected.all_instructions.size, (u64)((sizes[0] + sizes[1] + sizes[2]) / sizeof(u32)));
+    assert_greater(expected.disassembly_sections[0].function_count, 0);
+    assert_greater(expected.disassembly_sections[0].branch_count, 0);
+
+    const u32 thread_counts[] = {2, 4, 7};
+
+    for (u32 thread_count : thread_counts)
+    {
+        psp_disassembly disasm;
+        init(&disasm);
+        defer { free(&disasm); };
+
+        _disassemble(&elf, thread_count, &disasm);
+
+        assert_equal(disasm.all_instructions.size, expected.all_instructions.size);
+
+        for (u64 i = 0; i < disasm.all_instructions.size; ++i)
+            assert_equal(memcmp(disasm.all_instructions.data + i, expected.all_instructions.data + i, sizeof(instruction)), 0);
+
+        assert_equal(disasm.all_jumps.size, expected.all_jumps.size);
+
+        for (u64 i = 0; i < disasm.all_jumps.size; ++i)
+        {
+            assert_equal(disasm.all_jumps[i].address, expected.all_jumps[i].address);
+            assert_equal(disasm.all_jumps[i].type == jump_type::Jump, expected.all_jumps[i].type == jump_type::Jump);
+        }
+
+        assert_equal(disasm.disassembly_sections.size, expected.disassembly_sections.size);
+
+        for (u64 i = 0; i < disasm.disassembly_sections.size; ++i)
+        {
+            psp_disassembly_section *sec = disasm.disassembly_sections.data + i;
+            psp_disassembly_section *expected_sec = expected.disassembly_sections.data + i;
+
+            assert_equal(sec->vaddr_end, expected_sec->vaddr_end);
+            assert_equal(sec->instruction_start_index, expected_sec->instruction_start_index);
+            assert_equal(sec->instruction_count, expected_sec->instruction_count);
+            assert_equal(sec->jump_count, expected_sec->jump_count);
+            assert_equal(sec->function_count, expected_sec->function_count);
+            assert_equal(sec->branch_count, expected_sec->branch_count);
+            assert_equal(sec->jumps - disasm.all_jumps.data, expected_sec->jumps - expected.all_jumps.data);
+        }
+    }
+}
+
+define_default_test_main();
@@ -0,0 +1,203 @@
+
+#include <stdio.h>
+#include <string.h>
+#include <t1/t1.hpp>
+#include "tests/test_common.hpp"
+
+#include "shl/array.hpp"
+#include "allegrex/inflate.hpp"
+#include "allegrex/prx_decrypt.hpp"
+#include "allegrex/psp_elf.hpp"
+#include "tests/prx_fixture.hpp"
+
+#define assert_bytes_equal(A, B, N) assert_equal(memcmp(A, B, N), 0)
+
+#define WORDS_COUNT 300
+#define WORDS_SIZE 1533
+
+// gzip -9 of _words(), a single dynamic block
+static const u8 words_gz[] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x75, 0x54, 0x5b, 0x0e, 0xc2, 0x30,
+    0x0c, 0xfb, 0xcf, 0x29, 0x7a, 0xb5, 0x8d, 0x21, 0x21, 0x34, 0x18, 0x02, 0x76, 0x7f, 0xd6, 0x47,
+    0x62, 0x27, 0x19, 0x1f, 0x2d, 0x63, 0x4b, 0x6c, 0x27, 0x4e, 0xbb, 0x6e, 0xd3, 0x52, 0x3e, 0xdf,
+    0xed, 0x7d, 0x2d, 0xd3, 0xb2, 0x94, 0xfb, 0xfe, 0x78, 0x95, 0xf9, 0x3d, 0x3d, 0x2f, 0x37, 0xfd,
+    0x69, 0xaf, 0x7a, 0xc4, 0x7a, 0x04, 0x4b, 0x7f, 0x1c, 0xfb, 0x3e, 0x4b, 0x4d, 0xab, 0xab, 0x7e,
+    0xa4, 0x60, 0xe9, 0xe9, 0x42, 0xe9, 0x35, 0xea, 0xc8, 0x08, 0xf8, 0xf5, 0x0d, 0xe0, 0x23, 0x5d,
+    0xdf, 0x2a, 0xcf, 0x0a, 0xa5, 0x23, 0x53, 0x99, 0x81, 0xae, 0x90, 0xed, 0x05, 0x21, 0xd5, 0xfc,
+    0xa1, 0x47, 0x45, 0x20, 0x91, 0xa2, 0xc1, 0xd8, 0x4a, 0x6d, 0x9b, 0xd5, 0xe6, 0x8a, 0x10, 0xd5,
+    0x15, 0x72, 0x0a, 0xe1, 0x0b, 0x40, 0x94, 0xb1, 0xb1, 0x70, 0x08, 0x4a, 0x11, 0xc2, 0x57, 0xd1,
+    0xae, 0x86, 0xb4, 0x5b, 0xe8, 0x69, 0xaa, 0x91, 0x43, 0x25, 0xa1, 0xa1, 0x5c, 0xb2, 0x2c, 0xf5,
+    0x0d, 0x88, 0xa8, 0x8d, 0x04, 0x04, 0x1f, 0xb4, 0x35, 0x75, 0x75, 0x90, 0x33, 0x6b, 0x55, 0x8c,
+    0xf3, 0x4a, 0xd3, 0x69, 0xe6, 0x84, 0xe7, 0xa3, 0x2f, 0xb1, 0xe4, 0xa1, 0x37, 0x74, 0x48, 0xff,
+    0xda, 0x26, 0xc4, 0x9e, 0xc6, 0xcd, 0x40, 0xf3, 0xb0, 0x99, 0x45, 0x81, 0x67, 0x60, 0x30, 0x1e,
+    0x17, 0xce, 0x31, 0xfc, 0x0c, 0x16, 0x43, 0xca, 0xd3, 0xec, 0x68, 0x69, 0xe9, 0x20, 0x95, 0xa8,
+    0xc2, 0x06, 0x33, 0x34, 0x0a, 0xbd, 0xb6, 0x86, 0x1b, 0xa5, 0x84, 0x93, 0xea, 0x0d, 0x22, 0x07,
+    0xb8, 0x0a, 0x3b, 0x82, 0x79, 0x04, 0xff, 0x1c, 0x65, 0x61, 0x5d, 0xa0, 0x73, 0x96, 0xab, 0x5c,
+    0x32, 0x8b, 0x3a, 0x90, 0xa6, 0x83, 0x8a, 0x86, 0xea, 0x93, 0x0f, 0xcc, 0x6c, 0xa7, 0x6d, 0x2c,
+    0x9b, 0xca, 0x53, 0x37, 0x68, 0x92, 0x72, 0x59, 0xe4, 0x57, 0xf4, 0x01, 0x97, 0x8b, 0xbb, 0xf9,
+    0xe2, 0xe1, 0x71, 0xd7, 0xa9, 0xab, 0xdb, 0x7a, 0x0f, 0x2d, 0xc9, 0x5b, 0xb4, 0x2c, 0x77, 0xdf,
+    0x8c, 0x45, 0xfe, 0xff, 0x4e, 0xb3, 0x29, 0x3f, 0x87, 0xbc, 0xc6, 0x30, 0xfd, 0x05, 0x00, 0x00
+};
+
+// fixed block
+static const u8 hello_gz[] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0xcb, 0x48, 0xcd, 0xc9, 0xc9, 0x57,
+    0xc8, 0x40, 0x27, 0xb9, 0x00, 0x00, 0x88, 0x59, 0x0b, 0x18, 0x00, 0x00, 0x00
+};
+
+// stored block
+static const u8 stored_gz[] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x03, 0x01, 0x0b, 0x00, 0xf4, 0xff, 0x73,
+    0x74, 0x6f, 0x72, 0x65, 0x64, 0x20, 0x64, 0x61, 0x74, 0x61, 0x11, 0x55, 0xd7, 0x99, 0x0b, 0x00,
+    0x00, 0x00
+};
+
+// pseudorandom words, compressible but not as well as repeated text
+static void _words(char *out)
+{
+    static const char *vocabulary[] = { "load", "store", "jump", "branch", "add", "sub" };
+    u32 state = TEST_RANDOM_SEED;
+
+    for (int i = 0; i < WORDS_COUNT; ++i)
+    {
+        u32 x = test_random(&state);
+
+        const char *word = vocabulary[x % 6];
+        u32 len = (u32)strlen(word);
+        memcpy(out, word, len);
+        out[len] = ((x >> 8) & 7) == 7 ? '\n' : ' ';
+        out += len + 1;
+    }
+}
+
+define_test(crc32_matches_known_answer)
+{
+    assert_equal(gzip_crc32(0, "123456789", 9), 0xCBF43926u);
+    assert_equal(gzip_crc32(gzip_crc32(0, "1234", 4), "56789", 5), 0xCBF43926u);
+    assert_equal(gzip_crc32(0, "", 0), 0u);
+}
+
+define_test(inflates_every_block_type)
+{
+    char expected[WORDS_SIZE];
+    u8 out[WORDS_SIZE];
+    _words(expected);
+
+    assert_equal(inflate_gzip(words_gz, sizeof(words_gz), out, sizeof(out)), (s64)WORDS_SIZE);
+    assert_bytes_equal(out, expected, WORDS_SIZE);
+
+    assert_equal(inflate_gzip(hello_gz, sizeof(hello_gz), out, sizeof(out)), (s64)24);
+    assert_bytes_equal(out, "hello hello hello hello\n", 24);
+
+    assert_equal(inflate_gzip(stored_gz, sizeof(stored_gz), out, sizeof(out)), (s64)11);
+    assert_bytes_equal(out, "stored data", 11);
+
+    // without the gzip header and trailer
+    assert_equal(inflate_raw(hello_gz + 10, sizeof(hello_gz) - 18, out, sizeof(out)), (s64)24);
+    assert_bytes_equal(out, "hello hello hello hello\n", 24);
+}
+
+define_test(inflates_within_the_same_buffer)
+{
+    char expected[WORDS_SIZE];
+    _words(expected);
+
+    // with no room, the output catches up with the input
+    for (u32 room : {0u, 64u, (u32)sizeof(words_gz)})
+    {
+        u8 buffer[WORDS_SIZE + sizeof(words_gz)];
+        u8 *in = buffer + WORDS_SIZE + room - sizeof(words_gz);
+        memcpy(in, words_gz, sizeof(words_gz));
+
+        assert_equal(inflate_gzip(in, sizeof(words_gz), buffer, WORDS_SIZE), (s64)WORDS_SIZE);
+        assert_bytes_equal(buffer, expected, WORDS_SIZE);
+    }
+}
+
+define_test(rejects_invalid_data)
+{
+    u8 data[sizeof(words_gz)];
+    u8 out[WORDS_SIZE];
+    error err{};
+
+    assert_equal(inflate_gzip(words_gz, sizeof(words_gz) - 9, out, sizeof(out), &err), (s64)-1);
+    assert_equal(inflate_gzip(words_gz, sizeof(words_gz), out, sizeof(out) - 1, &err), (s64)-1);
+
+    memcpy(data, words_gz, sizeof(data));
+    data[sizeof(data) - 8] ^= 1; // CRC-32
+    assert_equal(inflate_gzip(data, sizeof(data), out, sizeof(out), &err), (s64)-1);
+
+    memcpy(data, words_gz, sizeof(data));
+    data[0] = 0;
+    assert_equal(inflate_gzip(data, sizeof(data), out, sizeof(out), &err), (s64)-1);
+
+    // block type 3
+    const u8 reserved_block[] = { 0x07, 0x00 };
+    assert_equal(inflate_raw(reserved_block, sizeof(reserved_block), out, sizeof(out), &err), (s64)-1);
+}
+
+define_test(decrypts_compressed_prx)
+{
+    char expected[WORDS_SIZE];
+    _words(expected);
+
+    array<u8> data;
+    init(&data);
+    resize(&data, prx_encrypted_size(sizeof(words_gz)));
+
+    assert_equal(pspEncryptPRX(words_gz, sizeof(words_gz), data.data, 0xD91605F0, prx_type::Type2, WORDS_SIZE),
+                 (int)data.size);
+
+    memory_stream in{};
+    in.data = (char*)data.data;
+    in.size = (s64)data.size;
+
+    array<u8> decrypted;
+    init(&decrypted);
+
+    assert_equal(decrypt_elf(&in, &decrypted), (s64)WORDS_SIZE);
+    assert_bytes_equal(decrypted.data, expected, WORDS_SIZE);
+
+    assert_equal(decrypt_elf_in_place(&data), (s64)WORDS_SIZE);
+    assert_equal(data.size, (u64)WORDS_SIZE);
+    assert_bytes_equal(data.data, expected, WORDS_SIZE);
+
+    free(&decrypted);
+    free(&data);
+}
+
+#define COMPRESSED_PRX_PATH "test_inflate_compressed.prx"
+
+define_test(reads_the_decrypted_size_of_compressed_prx)
+{
+    array<u8> data;
+    init(&data);
+    resize(&data, prx_encrypted_size(sizeof(words_gz)));
+
+    assert_equal(pspEncryptPRX(words_gz, sizeof(words_gz), data.data, 0xD91605F0, prx_type::Type2, WORDS_SIZE),
+                 (int)data.size);
+
+    FILE *f = fopen(COMPRESSED_PRX_PATH, "wb");
+    assert_true(f != nullptr);
+    fwrite(data.data, 1, data.size, f);
+    fclose(f);
+
+    file_stream in{};
+    assert_true(init(&in, COMPRESSED_PRX_PATH, open_mode::Read));
+
+    u64 elf_size = 0;
+    u64 buffer_size = 0;
+
+    assert_equal(get_decrypted_elf_size(&in, &elf_size, &buffer_size), 1);
+    assert_equal(elf_size, (u64)WORDS_SIZE);
+
+    // the buffer holds the encrypted and the inflated ELF
+    assert_greater_or_equal(buffer_size, data.size);
+    assert_greater_or_equal(buffer_size, (u64)WORDS_SIZE);
+
+    free(&in);
+    free(&data);
+    remove(COMPRESSED_PRX_PATH);
+}
+
+define_default_test_main();
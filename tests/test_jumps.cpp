@@ -0,0 +1,95 @@
+
+#include <t1/t1.hpp>
+#include "tests/test_common.hpp"
+
+define_t1_to_string(jump_type x, "%s", x == jump_type::Jump ? "Jump" : "Branch");
+
+#define assert_jump(N, Addr, Type) \
+    assert_equal(jumps.data[N].address, (u32)Addr);\
+    assert_equal(jumps.data[N].type, jump_type::Type);
+
+define_test(sort_jumps_empty)
+{
+    array<jump_destination> jumps;
+    ::init(&jumps);
+    defer { ::free(&jumps); };
+
+    sort_jumps(&jumps);
+    assert_equal(jumps.size, (u64)0);
+}
+
+define_test(sort_jumps_orders_jumps_before_branches)
+{
+    array<jump_destination> jumps;
+    ::init(&jumps);
+    defer { ::free(&jumps); };
+
+    ::add_at_end(&jumps, jump_destination{0x08804010, jump_type::Branch});
+    ::add_at_end(&jumps, jump_destination{0x08804000, jump_type::Branch});
+    ::add_at_end(&jumps, jump_destination{0x08804010, jump_type::Jump});
+    ::add_at_end(&jumps, jump_destination{0x08804000, jump_type::Branch});
+    ::add_at_end(&jumps, jump_destination{0x08800000, jump_type::Jump});
+
+    sort_jumps(&jumps);
+
+    assert_equal(jumps.size, (u64)4);
+    assert_jump(0, 0x08800000, Jump);
+    assert_jump(1, 0x08804000, Branch);
+    assert_jump(2, 0x08804010, Jump);
+    assert_jump(3, 0x08804010, Branch);
+}
+
+define_test(sort_jumps_same_as_set)
+{
+    // enough jumps to not use insertion sort
+    array<jump_destination> jumps;
+    set<jump_destination> expected;
+    ::init(&jumps);
+    ::init(&expected);
+    defer { ::free(&jumps); ::free(&expected); };
+
+    u32 state = TEST_RANDOM_SEED;
+
+    for (u32 i = 0; i < 5000; ++i)
+    {
+        u32 x = test_random(&state);
+
+        // few distinct addresses so there are duplicates
+        jump_destination jmp{(x & 0xff000fff) >> 2 << 2, (x & 0x100) ? jump_type::Branch : jump_type::Jump};
+        ::add_at_end(&jumps, jmp);
+        ::insert_element(&expected, jmp);
+    }
+
+    sort_jumps(&jumps);
+
+    assert_equal(jumps.size, expected.size);
+
+    for (u64 i = 0; i < jumps.size; ++i)
+    {
+        assert_equal(jumps.data[i].address, expected.data[i].address);
+        assert_equal(jumps.data[i].type, expected.data[i].type);
+    }
+}
+
+define_test(parse_instructions_appends_jumps)
+{
+    // j 0x08804000, beq zero, zero, -1, nop
+    const u32 opcodes[] = {0x0a201000, 0x1000ffff, 0x00000000};
+
+    parse_instructions_config conf = test_parse_instructions_config(0x08804000, false);
+
+    array<instruction> instructions;
+    array<jump_destination> jumps;
+    ::init(&instructions);
+    ::init(&jumps);
+    defer { ::free(&instructions); ::free(&jumps); };
+
+    parse_instructions((const char*)opcodes, sizeof(opcodes), &instructions, &jumps, &conf);
+
+    // in the order they were found
+    assert_equal(jumps.size, (u64)2);
+    assert_jump(0, 0x08804000, Jump);
+    assert_jump(1, 0x08804004, Branch);
+}
+
+define_default_test_main();
@@ -0,0 +1,156 @@
+
+#include <string.h>
+#include <t1/t1.hpp>
+#include "tests/test_common.hpp"
+
+extern "C"
+{
+#include "libkirk/AES.h"
+}
+
+// defined by kirk_engine.h, hides array_size of shl
+#undef array_size
+
+#define assert_bytes_equal(A, B, N) assert_equal(memcmp(A, B, N), 0)
+
+// FIPS-197 appendix C.1
+static const u8 fips197_key[16] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+
+static const u8 fips197_plaintext[16] = {
+    0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff
+};
+
+static const u8 fips197_ciphertext[16] = {
+    0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a
+};
+
+// RFC 4493 section 4
+static const u8 rfc4493_key[16] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+
+static const u8 rfc4493_message[64] = {
+    0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+    0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+    0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+    0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10
+};
+
+static const u8 rfc4493_mac_0[16] = {
+    0xbb, 0x1d, 0x69, 0x29, 0xe9, 0x59, 0x37, 0x28, 0x7f, 0xa3, 0x7d, 0x12, 0x9b, 0x75, 0x67, 0x46
+};
+
+static const u8 rfc4493_mac_16[16] = {
+    0x07, 0x0a, 0x16, 0xb4, 0x6b, 0x4d, 0x41, 0x44, 0xf7, 0x9b, 0xdd, 0x9d, 0xd0, 0x4a, 0x28, 0x7c
+};
+
+static const u8 rfc4493_mac_40[16] = {
+    0xdf, 0xa6, 0x67, 0x47, 0xde, 0x9a, 0xe6, 0x30, 0x30, 0xca, 0x32, 0x61, 0x14, 0x97, 0xc8, 0x27
+};
+
+static const u8 rfc4493_mac_64[16] = {
+    0x51, 0xf0, 0xbe, 0xbf, 0x7e, 0x3b, 0x9d, 0x92, 0xfc, 0x49, 0x74, 0x17, 0x79, 0x36, 0x3c, 0xfe
+};
+
+// runs every test with the lookup tables and, if supported, with AES-NI
+#define for_each_aes_backend(AESNI) \
+    for (int AESNI = 0; AESNI <= AES_aesni_supported(); ++AESNI) \
+        if (AES_set_aesni_enabled(AESNI); true)
+
+define_test(aes_cbc_single_block_matches_fips197)
+{
+    for_each_aes_backend(aesni)
+    {
+        AES_ctx ctx;
+        u8 out[16];
+
+        AES_set_key(&ctx, fips197_key, 128);
+
+        // CBC without IV, so the first block is plain AES
+        AES_cbc_encrypt(&ctx, fips197_plaintext, out, 16);
+        assert_bytes_equal(out, fips197_ciphertext, 16);
+
+        AES_cbc_decrypt(&ctx, fips197_ciphertext, out, 16);
+        assert_bytes_equal(out, fips197_plaintext, 16);
+    }
+
+    AES_set_aesni_enabled(1);
+}
+
+define_test(aes_cmac_matches_rfc4493)
+{
+    for_each_aes_backend(aesni)
+    {
+        AES_ctx ctx;
+        u8 message[64];
+        u8 mac[16];
+
+        memcpy(message, rfc4493_message, 64);
+        AES_set_key(&ctx, rfc4493_key, 128);
+
+        AES_CMAC(&ctx, message, 0, mac);
+        assert_bytes_equal(mac, rfc4493_mac_0, 16);
+
+        AES_CMAC(&ctx, message, 16, mac);
+        assert_bytes_equal(mac, rfc4493_mac_16, 16);
+
+        AES_CMAC(&ctx, message, 40, mac);
+        assert_bytes_equal(mac, rfc4493_mac_40, 16);
+
+        AES_CMAC(&ctx, message, 64, mac);
+        assert_bytes_equal(mac, rfc4493_mac_64, 16);
+    }
+
+    AES_set_aesni_enabled(1);
+}
+
+define_test(aes_backends_produce_identical_results)
+{
+    if (!AES_aesni_supported())
+        return;
+
+    const int max_size = 16 * 37;
+    u8 key[16];
+    u8 input[max_size];
+    u8 tables[max_size];
+    u8 aesni[max_size];
+    u8 mac_tables[16];
+    u8 mac_aesni[16];
+
+    fill_test_random(key, 16);
+    fill_test_random(input, max_size);
+
+    AES_ctx ctx;
+    AES_set_key(&ctx, key, 128);
+
+    // odd block counts to cover the remainder after blocks of four
+    for (int size = 16; size <= max_size; size += 16 * 3)
+    {
+        AES_set_aesni_enabled(0);
+        AES_cbc_encrypt(&ctx, input, tables, size);
+        AES_set_aesni_enabled(1);
+        AES_cbc_encrypt(&ctx, input, aesni, size);
+        assert_bytes_equal(tables, aesni, size);
+
+        AES_set_aesni_enabled(0);
+        AES_cbc_decrypt(&ctx, input, tables, size);
+        AES_set_aesni_enabled(1);
+        AES_cbc_decrypt(&ctx, input, aesni, size);
+        assert_bytes_equal(tables, aesni, size);
+
+        // in place
+        memcpy(aesni, input, size);
+        AES_cbc_decrypt(&ctx, aesni, aesni, size);
+        assert_bytes_equal(tables, aesni, size);
+
+        AES_set_aesni_enabled(0);
+        AES_CMAC(&ctx, input, size - 5, mac_tables);
+        AES_set_aesni_enabled(1);
+        AES_CMAC(&ctx, input, size - 5, mac_aesni);
+        assert_bytes_equal(mac_tables, mac_aesni, 16);
+    }
+}
+
+define_default_test_main();
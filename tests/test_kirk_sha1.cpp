@@ -0,0 +1,151 @@
+
+#include <string.h>
+#include <t1/t1.hpp>
+#include "tests/test_common.hpp"
+
+extern "C"
+{
+#include "libkirk/SHA1.h"
+}
+
+#define assert_bytes_equal(A, B, N) assert_equal(memcmp(A, B, N), 0)
+
+struct sha1_known_answer
+{
+    const char *message;
+    BYTE digest[20];
+};
+
+// FIPS 180-2 appendix A and the empty message
+static const sha1_known_answer known_answers[] = {
+    { "",
+      { 0xda, 0x39, 0xa3, 0xee, 0x5e, 0x6b, 0x4b, 0x0d, 0x32, 0x55, 0xbf, 0xef, 0x95, 0x60, 0x18, 0x90, 0xaf, 0xd8, 0x07, 0x09 } },
+    { "abc",
+      { 0xa9, 0x99, 0x3e, 0x36, 0x47, 0x06, 0x81, 0x6a, 0xba, 0x3e, 0x25, 0x71, 0x78, 0x50, 0xc2, 0x6c, 0x9c, 0xd0, 0xd8, 0x9d } },
+    { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+      { 0x84, 0x98, 0x3e, 0x44, 0x1c, 0x3b, 0xd2, 0x6e, 0xba, 0xae, 0x4a, 0xa1, 0xf9, 0x51, 0x29, 0xe5, 0xe5, 0x46, 0x70, 0xf1 } },
+};
+
+static const BYTE million_a_digest[20] = {
+    0x34, 0xaa, 0x97, 0x3c, 0xd4, 0xc4, 0xda, 0xa4, 0xf6, 0x1e, 0xeb, 0x2b, 0xdb, 0xad, 0x27, 0x31, 0x65, 0x34, 0x01, 0x6f
+};
+
+static void _sha1(BYTE *data, int size, BYTE *out)
+{
+    SHA_CTX ctx;
+    SHAInit(&ctx);
+    SHAUpdate(&ctx, data, size);
+    SHAFinal(out, &ctx);
+}
+
+// runs every test with the C code, SHA-NI and AVX2. unsupported ones fall back to the C code
+static const int sha1_backends[] = {
+    SHA_ACCELERATION_NONE,
+    SHA_ACCELERATION_SHANI,
+    SHA_ACCELERATION_AVX2
+};
+
+#define for_each_sha1_backend(ACCEL) \
+    for (int ACCEL : sha1_backends) \
+        if (SHA_set_acceleration(ACCEL); true)
+
+define_test(sha1_matches_known_answers)
+{
+    for_each_sha1_backend(accel)
+    {
+        BYTE digest[20];
+
+        for (const sha1_known_answer &ka : known_answers)
+        {
+            _sha1((BYTE*)ka.message, (int)strlen(ka.message), digest);
+            assert_bytes_equal(digest, ka.digest, 20);
+        }
+
+        // in uneven pieces
+        BYTE piece[1000];
+        memset(piece, 'a', sizeof(piece));
+
+        SHA_CTX ctx;
+        SHAInit(&ctx);
+
+        for (int total = 0; total < 1000000; total += 1000)
+        {
+            SHAUpdate(&ctx, piece, 333);
+            SHAUpdate(&ctx, piece, 667);
+        }
+
+        SHAFinal(digest, &ctx);
+        assert_bytes_equal(digest, million_a_digest, 20);
+    }
+
+    SHA_set_acceleration(SHA_ACCELERATION_ALL);
+}
+
+define_test(sha1_accelerated_matches_c_implementation)
+{
+    if (!SHA_shani_supported())
+        return;
+
+    BYTE data[300];
+    BYTE expected[20];
+    BYTE digest[20];
+
+    fill_test_random(data, sizeof(data));
+
+    // every padding case: 0-2 blocks of padding, split updates
+    for (int size = 0; size <= (int)sizeof(data); ++size)
+    {
+        SHA_set_acceleration(SHA_ACCELERATION_NONE);
+        _sha1(data, size, expected);
+
+        SHA_set_acceleration(SHA_ACCELERATION_ALL);
+        _sha1(data, size, digest);
+        assert_bytes_equal(digest, expected, 20);
+
+        SHA_CTX ctx;
+        SHAInit(&ctx);
+        SHAUpdate(&ctx, data, size / 3);
+        SHAUpdate(&ctx, data + size / 3, size - size / 3);
+        SHAFinal(digest, &ctx);
+        assert_bytes_equal(digest, expected, 20);
+    }
+}
+
+define_test(sha1_multi_matches_single_messages)
+{
+    const int count = 2 * SHA_MULTI_LANES + 3;
+    BYTE data[count * 150];
+    BYTE *inputs[count];
+    int sizes[count];
+    BYTE outputs[count * 20];
+    BYTE expected[20];
+
+    fill_test_random(data, sizeof(data));
+
+    // different lengths, so lanes finish after a different number of blocks
+    for (int i = 0; i < count; ++i)
+    {
+        inputs[i] = data + i * 150;
+        sizes[i] = (i * 37) % 150;
+    }
+
+    for_each_sha1_backend(accel)
+    {
+        memset(outputs, 0, sizeof(outputs));
+        SHAMulti(inputs, sizes, count, outputs);
+
+        SHA_set_acceleration(SHA_ACCELERATION_NONE);
+
+        for (int i = 0; i < count; ++i)
+        {
+            _sha1(inputs[i], sizes[i], expected);
+            assert_bytes_equal(outputs + i * 20, expected, 20);
+        }
+
+        SHA_set_acceleration(accel);
+    }
+
+    SHA_set_acceleration(SHA_ACCELERATION_ALL);
+}
+
+define_default_test_main();
@@ -0,0 +1,237 @@
+#include <string.h>
+#include <t1/t1.hpp>
+#include "tests/test_common.hpp"
+#include "tests/elf_fixture.hpp"
+#include "allegrex/lazy_disassembly.hpp"
+
+#define PAGE_SIZE LAZY_DISASSEMBLY_PAGE_SIZE
+
+static void _random_code(array<u32> *out, u32 count, u32 *state)
+{
+    for (u32 i = 0; i < count; ++i)
+    {
+        u32 x = test_random(state);
+
+        // lui + addiu pairs, so pseudoinstructions can span pages
+        if ((x & 7) == 0 && i + 1 < count)
+        {
+            ::add_at_end(out, 0x3c040880u);              // lui a0, 0x0880
+            ::add_at_end(out, 0x24840000u | (x >> 16)); // addiu a0, a0, x
+            i += 1;
+        }
+        else
+            ::add_at_end(out, x);
+    }
+}
+
+struct lazy_test_module
+{
+    array<u32> code[4];
+    test_elf_section sections[4];
+    array<char> elf;
+};
+
+// a module of 4 sections with random code, sizes may be 0
+static void _make_module(lazy_test_module *mod, const u32 *vaddrs, const u32 *sizes)
+{
+    u32 state = TEST_RANDOM_SEED;
+
+    for (u32 i = 0; i < 4; ++i)
+    {
+        ::init(mod->code + i);
+        _random_code(mod->code + i, sizes[i] / sizeof(u32), &state);
+
+        mod->sections[i].vaddr = vaddrs[i];
+        mod->sections[i].code = mod->code[i].data;
+        mod->sections[i].size = sizes[i];
+    }
+
+    ::init(&mod->elf);
+    make_test_elf(mod->sections, 4, &mod->elf);
+}
+
+static void _free_module(lazy_test_module *mod)
+{
+    for (u32 i = 0; i < 4; ++i)
+        ::free(mod->code + i);
+
+    ::free(&mod->elf);
+}
+
+// the instructions of a whole section decoded at once
+static void _parse_section(const test_elf_section *sec, array<instruction> *out)
+{
+    parse_instructions_config conf = test_parse_instructions_config(sec->vaddr, true);
+
+    array<jump_destination> jumps;
+    ::init(&jumps);
+    defer { ::free(&jumps); };
+
+    parse_instructions((const char*)sec->code, sec->size, out, &jumps, &conf);
+}
+
+static void _assert_same_instruction(const instruction *inst, const instruction *expected)
+{
+    assert_true(inst != nullptr);
+    assert_equal(inst->address, expected->address);
+    assert_equal(memcmp(inst, expected, sizeof(instruction)), 0);
+}
+
+static void _assert_same_as_parse_instructions(const u32 *vaddrs, const u32 *sizes)
+{
+    lazy_test_module mod;
+    _make_module(&mod, vaddrs, sizes);
+    defer { _free_module(&mod); };
+
+    lazy_disassembly by_address;
+    init(&by_address);
+    defer { free(&by_address); };
+
+    lazy_disassembly by_index;
+    init(&by_index);
+    defer { free(&by_index); };
+
+    error err{};
+    assert_true(lazy_disassemble_psp_elf(mod.elf.data, mod.elf.size, &by_address, &err));
+    assert_true(lazy_disassemble_psp_elf(mod.elf.data, mod.elf.size, &by_index, &err));
+
+    assert_equal(by_address.sections.size, (u64)4);
+    assert_equal(by_address.instruction_count, (u64)((sizes[0] + sizes[1] + sizes[2] + sizes[3]) / sizeof(u32)));
+    assert_equal(by_address.decoded_page_count, (u64)0);
+
+    // sections of psp_module are sorted by vaddr, as are the indices
+    u32 order[4] = {0, 1, 2, 3};
+
+    for (u32 i = 1; i < 4; ++i)
+        for (u32 j = i; j > 0 && vaddrs[order[j - 1]] > vaddrs[order[j]]; --j)
+        {
+            u32 tmp = order[j];
+            order[j] = order[j - 1];
+            order[j - 1] = tmp;
+        }
+
+    u64 index = 0;
+
+    for (u32 s : order)
+    {
+        array<instruction> expected;
+        ::init(&expected);
+        defer { ::free(&expected); };
+
+        _parse_section(mod.sections + s, &expected);
+
+        for_array(i, inst, &expected)
+        {
+            _assert_same_instruction(get_instruction_at_address(&by_address, inst->address), inst);
+            _assert_same_instruction(get_instruction(&by_index, index + i), inst);
+        }
+
+        index += expected.size;
+    }
+
+    assert_equal(index, by_index.instruction_count);
+
+    // every page is decoded once
+    u64 page_count = 0;
+
+    for (u32 i = 0; i < 4; ++i)
+        page_count += (sizes[i] + PAGE_SIZE - 1) / PAGE_SIZE;
+
+    assert_equal(by_address.decoded_page_count, page_count);
+    assert_equal(by_index.decoded_page_count, page_count);
+}
+
+define_test(same_as_parse_instructions)
+{
+    /* three pages and a bit, an empty section and one of less than a page at
+       the same vaddr, and one of exactly two pages */
+    const u32 vaddrs[] = {0x08804000, 0x08810000, 0x08810000, 0x08900000};
+    const u32 sizes[]  = {3 * PAGE_SIZE + 0x10, 0, 0x800, 2 * PAGE_SIZE};
+
+    _assert_same_as_parse_instructions(vaddrs, sizes);
+}
+
+define_test(same_as_parse_instructions_with_adjacent_sections)
+{
+    // sections right after each other, an empty one after another at the same vaddr
+    const u32 vaddrs[] = {0x08804000, 0x08804000, 0x08804800, 0x08806800};
+    const u32 sizes[]  = {0x800, 0, 2 * PAGE_SIZE, PAGE_SIZE + 4};
+
+    _assert_same_as_parse_instructions(vaddrs, sizes);
+}
+
+define_test(decodes_only_the_accessed_pages)
+{
+    const u32 vaddrs[] = {0x08804000, 0x08810000, 0x08810000, 0x08900000};
+    const u32 sizes[]  = {3 * PAGE_SIZE + 0x10, 0, 0x800, 2 * PAGE_SIZE};
+
+    lazy_test_module mod;
+    _make_module(&mod, vaddrs, sizes);
+    defer { _free_module(&mod); };
+
+    lazy_disassembly disasm;
+    init(&disasm);
+    defer { free(&disasm); };
+
+    assert_true(lazy_disassemble_psp_elf(mod.elf.data, mod.elf.size, &disasm, nullptr));
+
+    // the last instruction of the first page and the first of the second
+    const instruction *last = get_instruction_at_address(&disasm, 0x08804000 + PAGE_SIZE - 4);
+    assert_true(last != nullptr);
+    assert_equal(last->address, 0x08804000u + PAGE_SIZE - 4);
+    assert_equal(disasm.decoded_page_count, (u64)1);
+
+    const instruction *first = get_instruction(&disasm, LAZY_DISASSEMBLY_PAGE_INSTRUCTION_COUNT);
+    assert_true(first != nullptr);
+    assert_equal(first->address, 0x08804000u + PAGE_SIZE);
+    assert_equal(disasm.decoded_page_count, (u64)2);
+
+    // decoded pages are not decoded again and stay where they are
+    assert_true(get_instruction_at_address(&disasm, 0x08804000 + PAGE_SIZE - 4) == last);
+    assert_true(get_instruction(&disasm, LAZY_DISASSEMBLY_PAGE_INSTRUCTION_COUNT - 1) == last);
+    assert_equal(disasm.decoded_page_count, (u64)2);
+
+    // the last page of the first section only has 4 instructions
+    const instruction *tail = get_instruction_at_address(&disasm, 0x08804000 + 3 * PAGE_SIZE + 0xc);
+    assert_true(tail != nullptr);
+    assert_equal(tail->address, 0x08804000u + 3 * PAGE_SIZE + 0xc);
+    assert_equal(disasm.decoded_page_count, (u64)3);
+}
+
+define_test(addresses_outside_of_sections)
+{
+    const u32 vaddrs[] = {0x08804000, 0x08810000, 0x08810000, 0x08900000};
+    const u32 sizes[]  = {3 * PAGE_SIZE + 0x10, 0, 0x800, 2 * PAGE_SIZE};
+
+    lazy_test_module mod;
+    _make_module(&mod, vaddrs, sizes);
+    defer { _free_module(&mod); };
+
+    lazy_disassembly disasm;
+    init(&disasm);
+    defer { free(&disasm); };
+
+    assert_true(lazy_disassemble_psp_elf(mod.elf.data, mod.elf.size, &disasm, nullptr));
+
+    // before the first section, gaps, right after sections and after the last one
+    assert_true(get_instruction_at_address(&disasm, 0) == nullptr);
+    assert_true(get_instruction_at_address(&disasm, 0x08804000 - 4) == nullptr);
+    assert_true(get_instruction_at_address(&disasm, 0x08804000 + 3 * PAGE_SIZE + 0x10) == nullptr);
+    assert_true(get_instruction_at_address(&disasm, 0x0880c000) == nullptr);
+    assert_true(get_instruction_at_address(&disasm, 0x08810800) == nullptr);
+    assert_true(get_instruction_at_address(&disasm, 0x08900000 + 2 * PAGE_SIZE) == nullptr);
+    assert_true(get_instruction_at_address(&disasm, 0xfffffffc) == nullptr);
+
+    // not aligned to instructions
+    assert_true(get_instruction_at_address(&disasm, 0x08804002) == nullptr);
+
+    // the empty section at the same vaddr doesn't hide the other one
+    const instruction *inst = get_instruction_at_address(&disasm, 0x08810000);
+    assert_true(inst != nullptr);
+    assert_equal(inst->address, 0x08810000u);
+
+    // nothing outside of the sections was decoded
+    assert_equal(disasm.decoded_page_count, (u64)1);
+}
+
+define_default_test_main();
@@ -0,0 +1,156 @@
+
+#include <string.h>
+#include <t1/t1.hpp>
+#include "tests/test_common.hpp"
+
+#include "allegrex/prx_decrypt.hpp"
+#include "allegrex/psp_elf.hpp"
+#include "tests/prx_fixture.hpp"
+
+#define assert_bytes_equal(A, B, N) assert_equal(memcmp(A, B, N), 0)
+
+#define TEST_ELF_SIZE 1000 // not a multiple of the AES block size
+
+struct encrypted_prx
+{
+    u8 elf[TEST_ELF_SIZE];
+    u8 prx[TEST_ELF_SIZE + 0x200];
+    u8 decrypted[TEST_ELF_SIZE + 0x200];
+    u32 size;
+};
+
+static void _encrypt(encrypted_prx *out, u32 tag, prx_type type)
+{
+    fill_test_random(out->elf, TEST_ELF_SIZE);
+    memcpy(out->elf, "\x7f" "ELF", 4);
+
+    int size = pspEncryptPRX(out->elf, TEST_ELF_SIZE, out->prx, tag, type);
+
+    assert_equal(size, (int)prx_encrypted_size(TEST_ELF_SIZE));
+    assert_bytes_equal(out->prx, "~PSP", 4);
+    out->size = (u32)size;
+}
+
+static void _assert_decrypts(u32 tag, prx_type type, u32 expected_attempts)
+{
+    encrypted_prx prx;
+    _encrypt(&prx, tag, type);
+
+    prx_decrypt_info info;
+    int size = pspDecryptPRX(prx.prx, prx.decrypted, prx.size, nullptr, &info);
+
+    assert_equal(size, TEST_ELF_SIZE);
+    assert_bytes_equal(prx.decrypted, prx.elf, TEST_ELF_SIZE);
+    assert_equal(info.type, type);
+    assert_equal(info.attempts, expected_attempts);
+}
+
+define_test(decrypts_every_supported_type)
+{
+    _assert_decrypts(0x02000000, prx_type::Type0, 1);
+    _assert_decrypts(0x08000000, prx_type::Type1, 2); // type 0 is tried first
+    _assert_decrypts(0xD91605F0, prx_type::Type2, 1); // tag of type 2
+    _assert_decrypts(0x4C9494F0, prx_type::Type2, 1); // tag without a type
+    _assert_decrypts(0x2FD313F0, prx_type::Type5, 1);
+}
+
+define_test(decrypts_tags_of_both_tables)
+{
+    // tag 0 has keys for types 0 and 1 and for types 2, 5 and 6
+    _assert_decrypts(0x00000000, prx_type::Type0, 1);
+    _assert_decrypts(0x00000000, prx_type::Type1, 2);
+    _assert_decrypts(0x00000000, prx_type::Type2, 3);
+}
+
+define_test(decrypts_types_other_than_the_indexed_type)
+{
+    // the tag index says 0xD91605F0 is type 2 and 0x2FD313F0 is type 5,
+    // the other types of g_tagInfo2 are tried if those fail
+    _assert_decrypts(0xD91605F0, prx_type::Type5, 2);
+    _assert_decrypts(0x2FD313F0, prx_type::Type2, 2);
+}
+
+define_test(decrypts_in_place)
+{
+    encrypted_prx prx;
+    _encrypt(&prx, 0x457B0AF0, prx_type::Type2);
+
+    int size = pspDecryptPRX(prx.prx, prx.prx, prx.size);
+
+    assert_equal(size, TEST_ELF_SIZE);
+    assert_bytes_equal(prx.prx, prx.elf, TEST_ELF_SIZE);
+}
+
+define_test(decrypts_elf_in_place)
+{
+    encrypted_prx prx;
+    _encrypt(&prx, 0x2FD313F0, prx_type::Type5);
+
+    array<u8> data;
+    init(&data);
+    reserve(&data, sizeof(prx.prx));
+    resize(&data, prx.size);
+    memcpy(data.data, prx.prx, prx.size);
+
+    u8 *buffer = data.data;
+    prx_decrypt_info info;
+
+    assert_equal(decrypt_elf_in_place(&data, &info, nullptr), (s64)TEST_ELF_SIZE);
+    assert_equal(data.data, buffer); // reserved, so not reallocated
+    assert_bytes_equal(data.data, prx.elf, TEST_ELF_SIZE);
+    assert_equal(info.type, prx_type::Type5);
+
+    // already decrypted
+    assert_equal(decrypt_elf_in_place(&data), (s64)0);
+
+    // cut off
+    resize(&data, prx.size - 16);
+    memcpy(data.data, prx.prx, prx.size - 16);
+    assert_equal(decrypt_elf_in_place(&data), (s64)-1);
+
+    free(&data);
+}
+
+define_test(unknown_tag_fails_without_attempts)
+{
+    encrypted_prx prx;
+    _encrypt(&prx, 0x02000000, prx_type::Type0);
+
+    prx.prx[0xD0] = 0x12;
+
+    prx_decrypt_info info;
+    assert_equal(pspDecryptPRX(prx.prx, prx.decrypted, prx.size, nullptr, &info), -1);
+    assert_equal(info.type, prx_type::Unknown);
+    assert_equal(info.attempts, 0u);
+}
+
+define_test(modified_prx_fails)
+{
+    prx_decrypt_info info;
+    encrypted_prx prx;
+
+    // header, fails the SHA-1 check
+    _encrypt(&prx, 0xD91605F0, prx_type::Type2);
+    prx.prx[0x20] ^= 1;
+    assert_equal(pspDecryptPRX(prx.prx, prx.decrypted, prx.size, nullptr, &info), -3);
+    assert_equal(info.attempts, 3u); // type 2 of the tag, then types 5 and 6
+
+    // data, fails the CMAC check of KIRK
+    _encrypt(&prx, 0xD91605F0, prx_type::Type2);
+    prx.prx[prx.size - 1] ^= 1;
+    assert_equal(pspDecryptPRX(prx.prx, prx.decrypted, prx.size, nullptr, &info), -4);
+    assert_equal(info.type, prx_type::Unknown);
+}
+
+define_test(encrypt_rejects_types_of_other_tags)
+{
+    u8 elf[64] = {};
+    u8 prx[64 + 0x200];
+
+    assert_equal(pspEncryptPRX(elf, sizeof(elf), prx, 0x02000000, prx_type::Type2), -1);
+    assert_equal(pspEncryptPRX(elf, sizeof(elf), prx, 0xD91605F0, prx_type::Type0), -1);
+    assert_equal(pspEncryptPRX(elf, sizeof(elf), prx, 0xD91680F0, prx_type::Type6), -1);
+    assert_equal(pspEncryptPRX(elf, sizeof(elf), prx, 0x12345678, prx_type::Type2), -1);
+}
+
+define_default_test_main();
@@ -0,0 +1,67 @@
+
+#include <stdio.h>
+#include <string.h>
+#include <t1/t1.hpp>
+#include "shl/defer.hpp"
+#include "allegrex/psp_elf.hpp"
+
+#define NOT_AN_ELF_PATH "test_psp_elf_not_an_elf.bin"
+
+static void _write_not_an_elf(const char *path)
+{
+    FILE *f = fopen(path, "wb");
+    assert_true(f != nullptr);
+
+    char data[4096];
+    memset(data, 'x', sizeof(data));
+    fwrite(data, 1, sizeof(data), f);
+    fclose(f);
+}
+
+// whether path is mapped into this process, always false where it can't be checked
+static bool _is_mapped(const char *path)
+{
+#if defined(__linux__)
+    FILE *f = fopen("/proc/self/maps", "r");
+
+    if (f == nullptr)
+        return false;
+
+    char line[1024];
+    bool ret = false;
+
+    while (!ret && fgets(line, sizeof(line), f) != nullptr)
+        ret = strstr(line, path) != nullptr;
+
+    fclose(f);
+
+    return ret;
+#else
+    return false;
+#endif
+}
+
+define_test(mapped_non_elf_fails_and_is_unmapped)
+{
+    _write_not_an_elf(NOT_AN_ELF_PATH);
+    defer { remove(NOT_AN_ELF_PATH); };
+
+    psp_parse_elf_config conf{};
+    conf.section = ""_cs;
+    conf.vaddr = INFER_VADDR;
+    conf.verbose = false;
+    conf.log = nullptr;
+    conf.map_file = true;
+
+    elf_psp_module mod;
+    init(&mod);
+    defer { free(&mod); };
+
+    error err{};
+
+    assert_false(parse_psp_module_from_elf(NOT_AN_ELF_PATH, &mod, &conf, &err));
+    assert_true(mod.elf_data == nullptr);
+    assert_false(_is_mapped(NOT_AN_ELF_PATH));
+}
+
+define_default_test_main();
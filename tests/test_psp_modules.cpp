@@ -35,6 +35,65 @@ define_test(get_psp_function_by_nid)
     assert_equal(fun->nid, 0x092968f4u);
 }
 
+define_test(get_psp_module_by_name_finds_all_modules)
+{
+    const psp_module *mods = get_psp_modules();
+    u32 count = get_psp_module_count();
+
+    for (u32 i = 0; i < count; ++i)
+    {
+        // the first module with the name, e.g. sceNetApctl exists twice
+        const psp_module *expected = mods;
+
+        while (strcmp(expected->name, mods[i].name) != 0)
+            expected++;
+
+        assert_equal(get_psp_module_by_name(mods[i].name), expected);
+    }
+
+    assert_equal(get_psp_module_by_name("Kernel_Librar"), nullptr);
+    assert_equal(get_psp_module_by_name("Kernel_Library_"), nullptr);
+}
+
+define_test(get_psp_function_by_nid_finds_all_functions)
+{
+    const psp_module *mods = get_psp_modules();
+    u32 count = get_psp_module_count();
+
+    for (u32 i = 0; i < count; ++i)
+    {
+        const psp_module *mod = mods + i;
+
+        for (u32 j = 0; j < mod->function_count; ++j)
+        {
+            const psp_function *f = mod->functions + j;
+
+            // the first function with the nid in the module
+            const psp_function *expected = mod->functions;
+
+            while (expected->nid != f->nid)
+                expected++;
+
+            assert_equal(get_psp_function_by_nid(mod->name, f->nid), expected);
+            assert_equal(get_psp_module_function_by_nid(mod, f->nid), expected);
+            assert_equal(get_psp_function_by_nid(f->nid)->nid, f->nid);
+        }
+    }
+}
+
+define_test(get_psp_function_by_nid_of_other_module)
+{
+    // sceKernelCpuSuspendIntr is in Kernel_Library, not ThreadManForUser
+    assert_equal(get_psp_function_by_nid("ThreadManForUser", 0x092968f4), nullptr);
+    assert_equal(get_psp_module_function_by_nid(nullptr, 0x092968f4), nullptr);
+
+    const psp_function *fun = get_psp_function_by_nid(0x092968f4);
+    assert_not_equal(fun, nullptr);
+    assert_str_equal(fun->name, "sceKernelCpuSuspendIntr");
+
+    assert_equal(get_psp_function_by_nid(0u), nullptr);
+}
+
 define_test(get_psp_function_by_name)
 {
     assert_equal(get_psp_function_by_name(nullptr, nullptr), nullptr);
@@ -0,0 +1,100 @@
+
+#include <t1/t1.hpp>
+#include "tests/test_common.hpp"
+
+static const u32 _opcodes[] = {
+    0x27bdffd0, // addiu sp, sp, -0x30
+    0x00a06821, // move t5, a1 (addu)
+    0x34020001, // li v0, 1 (ori)
+    0x10400004, // beqz v0, +4
+    0x10000004, // b +4 (beq)
+    0x50000004, // bl +4 (beql)
+    0x04110004, // bal +4 (bgezal)
+    0x0c200010, // jal
+    0x08000040, // j
+    0x45010004, // bc1t
+    0x49000004, // bvf
+    0x03e00008, // jr ra
+    0xd0060000, // vfpu
+    0xffffffff, // unknown
+    0x00000000, // nop
+};
+
+static void _assert_same_as_parse_instructions(const u32 *opcodes, u64 size, bool emit_pseudo, bool with_jumps)
+{
+    parse_instructions_config conf = test_parse_instructions_config(0x08804000, emit_pseudo);
+
+    array<instruction> instructions;
+    array<jump_destination> expected_jumps;
+    array<allegrex_mnemonic> mnemonics;
+    array<jump_destination> jumps;
+    ::init(&instructions);
+    ::init(&expected_jumps);
+    ::init(&mnemonics);
+    ::init(&jumps);
+    defer { ::free(&instructions); ::free(&expected_jumps); ::free(&mnemonics); ::free(&jumps); };
+
+    parse_instructions((const char*)opcodes, size, &instructions, &expected_jumps, &conf);
+    scan_mnemonics((const char*)opcodes, size, &mnemonics, with_jumps ? &jumps : nullptr, &conf);
+
+    assert_equal(mnemonics.size, instructions.size);
+
+    for (u64 i = 0; i < mnemonics.size; ++i)
+        assert_equal(mnemonics.data[i], instructions.data[i].mnemonic);
+
+    if (!with_jumps)
+        return;
+
+    assert_equal(jumps.size, expected_jumps.size);
+
+    for (u64 i = 0; i < jumps.size; ++i)
+    {
+        assert_equal(jumps.data[i].address, expected_jumps.data[i].address);
+        assert_equal(jumps.data[i].type == jump_type::Jump, expected_jumps.data[i].type == jump_type::Jump);
+    }
+}
+
+define_test(scan_mnemonics_same_as_parse_instructions)
+{
+    _assert_same_as_parse_instructions(_opcodes, sizeof(_opcodes), false, false);
+    _assert_same_as_parse_instructions(_opcodes, sizeof(_opcodes), false, true);
+    _assert_same_as_parse_instructions(_opcodes, sizeof(_opcodes), true, false);
+    _assert_same_as_parse_instructions(_opcodes, sizeof(_opcodes), true, true);
+}
+
+define_test(scan_mnemonics_pseudoinstructions)
+{
+    parse_instructions_config conf = test_parse_instructions_config(0x08804000, true);
+
+    array<allegrex_mnemonic> mnemonics;
+    ::init(&mnemonics);
+    defer { ::free(&mnemonics); };
+
+    scan_mnemonics((const char*)_opcodes, sizeof(_opcodes), &mnemonics, nullptr, &conf);
+
+    assert_equal(mnemonics.size, (u64)(sizeof(_opcodes) / sizeof(u32)));
+    assert_equal(mnemonics.data[1], allegrex_mnemonic::MOVE);
+    assert_equal(mnemonics.data[2], allegrex_mnemonic::LI);
+    assert_equal(mnemonics.data[4], allegrex_mnemonic::B);
+    assert_equal(mnemonics.data[5], allegrex_mnemonic::BL);
+    assert_equal(mnemonics.data[6], allegrex_mnemonic::BAL);
+    assert_equal(mnemonics.data[13], allegrex_mnemonic::_UNKNOWN);
+}
+
+define_test(scan_mnemonics_random_opcodes)
+{
+    // every category of opcodes, with and without pseudoinstructions
+    array<u32> opcodes;
+    ::init(&opcodes);
+    defer { ::free(&opcodes); };
+
+    u32 state = TEST_RANDOM_SEED;
+
+    for (u32 i = 0; i < 50000; ++i)
+        ::add_at_end(&opcodes, test_random(&state));
+
+    _assert_same_as_parse_instructions(opcodes.data, opcodes.size * sizeof(u32), false, true);
+    _assert_same_as_parse_instructions(opcodes.data, opcodes.size * sizeof(u32), true, true);
+}
+
+define_default_test_main();
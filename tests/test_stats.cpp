@@ -0,0 +1,81 @@
+
+#include <t1/t1.hpp>
+#include "tests/test_common.hpp"
+#include "allegrex/stats.hpp"
+
+// all stats are zero if they are compiled out
+#define expected(N) (ALLEGREX_STATS ? (u64)(N) : (u64)0)
+
+// j 0x08804000, beq zero, zero, -1, nop, unknown
+static const u32 opcodes[] = {0x0a201000, 0x1000ffff, 0x00000000, 0xffffffff};
+
+static void _parse_opcodes()
+{
+    parse_instructions_config conf = test_parse_instructions_config(0x08804000, false);
+
+    array<instruction> instructions;
+    array<jump_destination> jumps;
+    ::init(&instructions);
+    ::init(&jumps);
+    defer { ::free(&instructions); ::free(&jumps); };
+
+    parse_instructions((const char*)opcodes, sizeof(opcodes), &instructions, &jumps, &conf);
+    sort_jumps(&jumps);
+}
+
+define_test(stats_count_parsed_instructions)
+{
+    reset_stats();
+    set_stats_enabled(true);
+    defer { set_stats_enabled(false); };
+
+    _parse_opcodes();
+
+    allegrex_stats stats;
+    get_stats(&stats);
+
+    assert_equal(stats.counters[(u32)allegrex_counter::InstructionsDecoded], expected(4));
+    assert_equal(stats.counters[(u32)allegrex_counter::UnknownOpcodes], expected(1));
+    assert_equal(stats.counters[(u32)allegrex_counter::Jumps], expected(1));
+    assert_equal(stats.counters[(u32)allegrex_counter::Branches], expected(1));
+    assert_equal(stats.phases[(u32)allegrex_phase::ParseInstructions].calls, expected(1));
+    assert_equal(stats.phases[(u32)allegrex_phase::CollectJumps].calls, expected(1));
+    assert_equal(stats.phases[(u32)allegrex_phase::Format].calls, (u64)0);
+}
+
+define_test(stats_disabled_count_nothing)
+{
+    reset_stats();
+    set_stats_enabled(false);
+
+    _parse_opcodes();
+
+    allegrex_stats stats;
+    get_stats(&stats);
+
+    assert_equal(stats.counters[(u32)allegrex_counter::InstructionsDecoded], (u64)0);
+    assert_equal(stats.phases[(u32)allegrex_phase::ParseInstructions].calls, (u64)0);
+}
+
+define_test(reset_stats_clears_stats)
+{
+    set_stats_enabled(true);
+    defer { set_stats_enabled(false); };
+
+    _parse_opcodes();
+    reset_stats();
+
+    allegrex_stats stats;
+    get_stats(&stats);
+
+    for (u32 i = 0; i < ALLEGREX_COUNTER_COUNT; ++i)
+        assert_equal(stats.counters[i], (u64)0);
+
+    for (u32 i = 0; i < ALLEGREX_PHASE_COUNT; ++i)
+    {
+        assert_equal(stats.phases[i].calls, (u64)0);
+        assert_equal(stats.phases[i].nanoseconds, (u64)0);
+    }
+}
+
+define_default_test_main();
@@ -0,0 +1,142 @@
+
+#include <stdio.h>
+#include <string.h>
+#include <t1/t1.hpp>
+#include "tests/test_common.hpp"
+#include "allegrex/trace.hpp"
+#include "allegrex/worker_pool.hpp"
+
+#define TRACE_PATH "test_trace.json"
+
+static void _read_text_file(const char *path, array<char> *out)
+{
+    ::clear(out);
+
+    FILE *f = fopen(path, "rb");
+
+    if (f == nullptr)
+        return;
+
+    char buf[4096];
+    u64 n;
+
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        for (u64 i = 0; i < n; ++i)
+            ::add_at_end(out, buf[i]);
+
+    fclose(f);
+    ::add_at_end(out, '\0');
+}
+
+static u32 _count_occurrences(const char *str, const char *part)
+{
+    u32 count = 0;
+
+    for (const char *c = strstr(str, part); c != nullptr; c = strstr(c + 1, part))
+        count += 1;
+
+    return count;
+}
+
+static void _parse_nop(const char *file_name)
+{
+    const u32 opcodes[] = {0x00000000};
+
+    parse_instructions_config conf = test_parse_instructions_config(0x08804000, false);
+
+    array<instruction> instructions;
+    ::init(&instructions);
+    defer { ::free(&instructions); };
+
+    ALLEGREX_TRACE_FILE(file_name);
+    parse_instructions((const char*)opcodes, sizeof(opcodes), &instructions, nullptr, &conf);
+}
+
+define_test(write_trace_writes_phases_and_files)
+{
+    set_trace_enabled(true);
+    reset_trace();
+
+    _parse_nop("dir/\"quoted\".prx");
+
+    set_trace_enabled(false);
+
+    // not traced
+    _parse_nop("untraced.prx");
+
+    assert_true(write_trace(TRACE_PATH));
+    defer { remove(TRACE_PATH); };
+
+    array<char> json;
+    ::init(&json);
+    defer { ::free(&json); };
+
+    _read_text_file(TRACE_PATH, &json);
+    assert_greater(json.size, (u64)0);
+
+    assert_true(strstr(json.data, "\"traceEvents\"") != nullptr);
+    assert_true(strstr(json.data, "untraced.prx") == nullptr);
+
+    if (ALLEGREX_STATS)
+    {
+        assert_true(strstr(json.data, "{\"name\": \"parse instructions\", \"cat\": \"phase\", \"ph\": \"X\"") != nullptr);
+        assert_true(strstr(json.data, "\"file\": \"dir/\\\"quoted\\\".prx\"") != nullptr);
+        assert_true(strstr(json.data, "\"dropped_events\": 0") != nullptr);
+    }
+}
+
+define_test(trace_ring_buffer_keeps_latest_events)
+{
+    set_trace_enabled(true);
+    reset_trace();
+
+    for (u32 i = 0; i < TRACE_BUFFER_EVENT_COUNT + 10; ++i)
+        trace_phase(allegrex_phase::Format, 1, 2);
+
+    set_trace_enabled(false);
+
+    assert_true(write_trace(TRACE_PATH));
+    defer { remove(TRACE_PATH); };
+
+    array<char> json;
+    ::init(&json);
+    defer { ::free(&json); };
+
+    _read_text_file(TRACE_PATH, &json);
+
+    assert_true(strstr(json.data, "\"dropped_events\": 10}") != nullptr);
+}
+
+define_test(new_threads_reuse_the_buffers_of_exited_threads)
+{
+    set_trace_enabled(true);
+    reset_trace();
+
+    // 8 rounds of the calling thread and 3 new threads each
+    for (u32 round = 0; round < 8; ++round)
+        run_workers(4, [](u32)
+        {
+            trace_phase(allegrex_phase::Format, 1, 2);
+        });
+
+    set_trace_enabled(false);
+
+    assert_true(write_trace(TRACE_PATH));
+    defer { remove(TRACE_PATH); };
+
+    array<char> json;
+    ::init(&json);
+    defer { ::free(&json); };
+
+    _read_text_file(TRACE_PATH, &json);
+
+    // a track per thread running at the same time, at most 4 instead of 25
+    u32 tracks = _count_occurrences(json.data, "\"thread_name\"");
+    assert_greater(tracks, 0u);
+    assert_less(tracks, 5u);
+
+    // with the events of all rounds
+    assert_equal(_count_occurrences(json.data, "\"cat\": \"phase\""), 32u);
+}
+
+define_default_test_main();
@@ -71,6 +71,17 @@ define_test(vcst_4)
     assert_argument_equals(1, vfpu_constant, vfpu_constant::VFPU_UNDEFINED);
 }
 
+// constants 20-31 have no name
+define_test(vcst_5)
+{
+    setup_test_variables();
+
+    parse_opcode(0xd07f0000);
+    assert_mnemonic(VCST);
+    assert_argument_type(1, argument_type::VFPU_Constant);
+    assert_equal(strcmp(vfpu_constant_name(inst.arguments[1].vfpu_constant), "(undefined)"), 0);
+}
+
 // vf2in vd, vs, imm
 define_test(vf2in_0)
 {
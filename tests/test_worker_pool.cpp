@@ -0,0 +1,48 @@
+
+#include <atomic>
+#include <thread>
+#include <t1/t1.hpp>
+#include "allegrex/worker_pool.hpp"
+
+define_test(get_worker_count_clamps)
+{
+    assert_equal(get_worker_count(4, 100, 64), 4u);
+    assert_equal(get_worker_count(100, 100, 64), 64u);
+    assert_equal(get_worker_count(8, 3, 64), 3u);
+    assert_equal(get_worker_count(8, 0, 64), 1u);
+    assert_equal(get_worker_count(1000, 1000, 1000), (u32)MAX_WORKER_THREADS);
+
+    // as many as the hardware supports, but at least one
+    assert_greater(get_worker_count(0, 100, 64), 0u);
+}
+
+define_test(run_workers_runs_every_worker_once)
+{
+    std::atomic<u32> calls[8];
+
+    for (u32 i = 0; i < 8; ++i)
+        calls[i] = 0;
+
+    run_workers(8, [&](u32 worker)
+    {
+        calls[worker].fetch_add(1);
+    });
+
+    for (u32 i = 0; i < 8; ++i)
+        assert_equal(calls[i].load(), 1u);
+}
+
+define_test(run_workers_single_worker_runs_on_calling_thread)
+{
+    std::thread::id caller = std::this_thread::get_id();
+    std::thread::id worker_thread{};
+
+    run_workers(1, [&](u32)
+    {
+        worker_thread = std::this_thread::get_id();
+    });
+
+    assert_true(worker_thread == caller);
+}
+
+define_default_test_main();